@@ -0,0 +1,45 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Sphere impostors used by vl::Molecule in MRM_Impostors mode, requires "molecule_atom_impostor.vs".
+// Ray-casts the sphere in eye coordinates, lights it with gl_LightSource[0] and writes its depth.
+
+varying vec3 center;
+varying vec3 position;
+varying float radius;
+
+void main(void)
+{
+	bool ortho = gl_ProjectionMatrix[3][3] != 0.0;
+	vec3 origin = ortho ? vec3(position.xy, 0.0) : vec3(0.0);
+	vec3 dir    = ortho ? vec3(0.0, 0.0, -1.0) : normalize(position);
+
+	vec3 oc = origin - center;
+	float b = dot(oc, dir);
+	float h = b*b - dot(oc, oc) + radius*radius;
+	if (h < 0.0)
+		discard;
+	vec3 hit = origin + dir * (-b - sqrt(h));
+	vec3 n = (hit - center) / radius;
+
+	vec3 L = gl_LightSource[0].position.w == 0.0 ? normalize(gl_LightSource[0].position.xyz) : normalize(gl_LightSource[0].position.xyz - hit);
+	float NdotL = max(dot(n, L), 0.0);
+	float NdotH = max(dot(n, normalize(L - dir)), 0.0);
+	vec3 color = gl_Color.rgb * (gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * NdotL);
+	if (NdotL > 0.0)
+		color += gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb * pow(NdotH, max(gl_FrontMaterial.shininess, 1.0));
+	gl_FragColor = vec4(color, gl_Color.a);
+
+	vec4 clip = gl_ProjectionMatrix * vec4(hit, 1.0);
+	gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far);
+}
@@ -0,0 +1,38 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Sphere impostors used by vl::Molecule in MRM_Impostors mode, requires "molecule_atom_impostor.fs".
+// The 4 vertices of the quad of an atom are all at the atom's center, gl_MultiTexCoord0.xy is the corner of the quad
+// and gl_MultiTexCoord0.z the radius of the atom.
+
+varying vec3 center;
+varying vec3 position;
+varying float radius;
+
+void main(void)
+{
+	center = (gl_ModelViewMatrix * gl_Vertex).xyz;
+	radius = gl_MultiTexCoord0.z;
+
+	// the quad faces the eye and is large enough to cover the silhouette of the sphere seen in perspective
+	bool ortho = gl_ProjectionMatrix[3][3] != 0.0;
+	vec3 view  = ortho ? vec3(0.0, 0.0, 1.0) : -normalize(center);
+	float dist = length(center);
+	float scale = ortho ? 1.0 : dist / sqrt(max(dist*dist - radius*radius, 0.01*radius*radius));
+	vec3 right = normalize(cross(abs(view.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), view));
+	vec3 up    = cross(view, right);
+	position = center + (right * gl_MultiTexCoord0.x + up * gl_MultiTexCoord0.y) * radius * scale;
+
+	gl_Position = gl_ProjectionMatrix * vec4(position, 1.0);
+	gl_FrontColor = gl_Color;
+}
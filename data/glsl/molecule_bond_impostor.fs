@@ -0,0 +1,59 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Cylinder impostors used by vl::Molecule in MRM_Impostors mode, requires "molecule_bond_impostor.vs".
+// Ray-casts the side of the cylinder in eye coordinates, lights it with gl_LightSource[0] and writes its depth.
+// The ends are left open since they are covered by the atoms or by the spheres joining the sticks.
+
+varying vec3 p1;
+varying vec3 p2;
+varying vec3 position;
+varying float radius;
+varying vec4 color2;
+
+void main(void)
+{
+	bool ortho = gl_ProjectionMatrix[3][3] != 0.0;
+	vec3 origin = ortho ? vec3(position.xy, 0.0) : vec3(0.0);
+	vec3 dir    = ortho ? vec3(0.0, 0.0, -1.0) : normalize(position);
+
+	vec3 ba = p2 - p1;
+	vec3 oc = origin - p1;
+	float baba = dot(ba, ba);
+	float bard = dot(ba, dir);
+	float baoc = dot(ba, oc);
+	float k2 = baba - bard*bard;
+	float k1 = baba*dot(oc, dir) - baoc*bard;
+	float k0 = baba*dot(oc, oc) - baoc*baoc - radius*radius*baba;
+	float h = k1*k1 - k2*k0;
+	if (k2 <= 1.0e-6*baba || h < 0.0)
+		discard;
+	float t = (-k1 - sqrt(h)) / k2;
+	float y = baoc + t*bard;
+	if (y < 0.0 || y > baba)
+		discard;
+	vec3 hit = origin + dir * t;
+	vec3 n = (oc + dir * t - ba * (y / baba)) / radius;
+	vec4 base = y < 0.5 * baba ? gl_Color : color2;
+
+	vec3 L = gl_LightSource[0].position.w == 0.0 ? normalize(gl_LightSource[0].position.xyz) : normalize(gl_LightSource[0].position.xyz - hit);
+	float NdotL = max(dot(n, L), 0.0);
+	float NdotH = max(dot(n, normalize(L - dir)), 0.0);
+	vec3 color = base.rgb * (gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * NdotL);
+	if (NdotL > 0.0)
+		color += gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb * pow(NdotH, max(gl_FrontMaterial.shininess, 1.0));
+	gl_FragColor = vec4(color, base.a);
+
+	vec4 clip = gl_ProjectionMatrix * vec4(hit, 1.0);
+	gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far);
+}
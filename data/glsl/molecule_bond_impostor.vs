@@ -0,0 +1,57 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Cylinder impostors used by vl::Molecule in MRM_Impostors mode, requires "molecule_bond_impostor.fs".
+// The 4 vertices of the quad of a bond are all at the first atom, gl_MultiTexCoord0.xyz is the second atom,
+// gl_MultiTexCoord1.xy is the corner of the quad along (0/1) and across (-1/+1) the bond and gl_MultiTexCoord1.z its radius.
+// gl_Color is the color of the first half of the bond and gl_SecondaryColor the color of the second half.
+
+varying vec3 p1;
+varying vec3 p2;
+varying vec3 position;
+varying float radius;
+varying vec4 color2;
+
+void main(void)
+{
+	p1 = (gl_ModelViewMatrix * gl_Vertex).xyz;
+	p2 = (gl_ModelViewMatrix * vec4(gl_MultiTexCoord0.xyz, 1.0)).xyz;
+	radius = gl_MultiTexCoord1.z;
+
+	// the quad contains the axis of the bond, faces the eye and is moved towards it by one radius
+	bool ortho = gl_ProjectionMatrix[3][3] != 0.0;
+	vec3 axis = normalize(p2 - p1);
+	vec3 view = ortho ? vec3(0.0, 0.0, 1.0) : -normalize(p1 + p2);
+	vec3 side = cross(axis, view);
+	if (dot(side, side) < 1.0e-6)
+		side = cross(axis, abs(axis.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0));
+	side = normalize(side);
+	vec3 front = cross(side, axis);
+	if (dot(front, view) < 0.0)
+		front = -front;
+
+	// seen in perspective the ends of the bond project beyond the quad, on the side opposite to the eye
+	float ext1 = radius;
+	float ext2 = radius;
+	if (!ortho)
+	{
+		float dist = max(length(p1 - axis * dot(p1, axis)), radius);
+		ext1 += max(dot(p1, axis), 0.0) * 2.0 * radius / dist;
+		ext2 += max(-dot(p2, axis), 0.0) * 2.0 * radius / dist;
+	}
+	position = mix(p1 - axis * ext1, p2 + axis * ext2, gl_MultiTexCoord1.x) + side * gl_MultiTexCoord1.y * radius + front * radius;
+
+	gl_Position = gl_ProjectionMatrix * vec4(position, 1.0);
+	gl_FrontColor = gl_Color;
+	color2 = vec4(gl_SecondaryColor.rgb, gl_Color.a);
+}
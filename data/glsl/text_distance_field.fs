@@ -0,0 +1,25 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+// Renders the signed distance field glyphs of a DistanceFieldAtlas with antialiased edges.
+// The outline of the glyphs is at 0.5, the smoothing width adapts to the on-screen size of the glyphs.
+
+uniform sampler2D glyph_texture;
+
+void main(void)
+{
+	float dist  = texture2D(glyph_texture, gl_TexCoord[0].st).a;
+	float width = fwidth(dist) * 0.7;
+	float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+	gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * alpha);
+}
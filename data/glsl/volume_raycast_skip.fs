@@ -0,0 +1,92 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+/* raycast with empty space skipping, see vl::RaycastVolume::setMacroCellGrid() */
+
+varying vec3 frag_position;     // in object space
+uniform sampler3D volume_texunit;
+uniform sampler1D trfunc_texunit;
+uniform sampler3D macrocell_texunit; // vl::MacroCellGrid::createTexture()
+uniform vec3 eye_position;      // camera position in object space
+uniform float sample_step;      // step used to advance the sampling ray
+uniform vec3 macro_cell_count;  // number of cells along x, y and z
+uniform vec3 macro_cell_size;   // size of a cell in texture coordinates
+uniform vec3 macro_cell_origin; // texture coordinates of the first voxel
+
+// returns the distance along the ray to the exit of the given cell
+float cellExit(vec3 cell, vec3 ray_pos, vec3 ray_dir)
+{
+	// the first and last cells extend to the border of the texture
+	vec3 lo = macro_cell_origin + cell * macro_cell_size;
+	vec3 hi = lo + macro_cell_size;
+	lo = mix(lo, vec3(-1.0, -1.0, -1.0), vec3(lessThan(cell, vec3(0.5, 0.5, 0.5))));
+	hi = mix(hi, vec3( 2.0,  2.0,  2.0), vec3(greaterThan(cell, macro_cell_count - vec3(1.5, 1.5, 1.5))));
+	vec3 bound = mix(lo, hi, vec3(greaterThan(ray_dir, vec3(0.0, 0.0, 0.0))));
+	vec3 dist = (bound - ray_pos) / ray_dir; // the axes with ray_dir == 0 give +inf or nan
+	float t = 1.0e10;
+	for(int i=0; i<3; ++i)
+		if (ray_dir[i] != 0.0)
+			t = min(t, dist[i]);
+	return t;
+}
+
+void main(void)
+{
+	// NOTE: ray direction goes from eye_position to frag_position, i.e. front to back
+	vec3 ray_dir = normalize(frag_position - eye_position);
+	vec3 ray_pos = gl_TexCoord[0].xyz; // the current ray position
+	vec3 pos111 = vec3(1.0, 1.0, 1.0);
+	vec3 pos000 = vec3(0.0, 0.0, 0.0);
+
+	vec4 frag_color = vec4(0.0, 0.0, 0.0, 0.0);
+	do
+	{
+		// note: 
+		// - we assume the volume has a cube-like shape
+
+		// break out if ray reached the end of the cube.
+		if (any(greaterThan(ray_pos,pos111)))
+			break;
+
+		if (any(lessThan(ray_pos,pos000)))
+			break;
+
+		vec3 cell = clamp(floor((ray_pos - macro_cell_origin) / macro_cell_size), vec3(0.0, 0.0, 0.0), macro_cell_count - vec3(1.0, 1.0, 1.0));
+		if (texture3D(macrocell_texunit, (cell + vec3(0.5, 0.5, 0.5)) / macro_cell_count).b < 0.5)
+		{
+			// empty cell: jump to the first sample past its exit, staying on the same samples of a ray not skipping
+			ray_pos += ray_dir * sample_step * (floor(cellExit(cell, ray_pos, ray_dir) / sample_step) + 1.0);
+			continue;
+		}
+
+		float density = texture3D(volume_texunit, ray_pos).r;
+		vec4 color = texture1D(trfunc_texunit, density);
+
+		// front to back compositing
+		frag_color.rgb += (1.0 - frag_color.a) * color.a * color.rgb;
+		frag_color.a   += (1.0 - frag_color.a) * color.a;
+
+		// early ray termination
+		if (frag_color.a > 0.99)
+			break;
+
+		ray_pos += ray_dir * sample_step;
+	}
+	while(true);
+
+	if (frag_color.a == 0.0)
+		discard;
+	else
+		gl_FragColor = vec4(frag_color.rgb / frag_color.a, frag_color.a);
+}
+// Have fun!
\ No newline at end of file
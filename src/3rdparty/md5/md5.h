@@ -38,7 +38,8 @@ typedef unsigned int uint32;
 #elif defined(__APPLE__)
 typedef uint32_t uint32;
 #else
-typedef unsigned long uint32;
+// unsigned long is 64 bits on LP64 platforms
+typedef unsigned int uint32;
 #endif
 
 struct MD5Context {
@@ -483,6 +483,9 @@ public:
       // return exp(-y)*sin(z)+cos(z*x); // == 2.0f
       return -x/5.0f*sin(z/5.0f)+exp(y*y*y/5.0f/5.0f/5.0f); // == 0.900f
     }
+
+    // the function has no state and can be evaluated by several threads at once
+    virtual bool isThreadSafe() const { return true; }
   };
 
   // Shows how to use vl::VolumePlot to create a 3D plot.
@@ -0,0 +1,141 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef Atomic_INCLUDE_ONCE
+#define Atomic_INCLUDE_ONCE
+
+#include <vlCore/config.hpp>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #pragma intrinsic(_InterlockedIncrement)
+  #pragma intrinsic(_InterlockedDecrement)
+  #pragma intrinsic(_InterlockedExchangeAdd)
+  #pragma intrinsic(_InterlockedCompareExchange)
+#endif
+
+/**
+ * \file Atomic.hpp
+ * Lock-free atomic integer operations used by the reference counting of vl::Object and by the multithreaded subsystems.
+ *
+ * All the read-modify-write operations act as full memory barriers, i.e. they provide both acquire and release semantics.
+*/
+
+#if defined(_MSC_VER)
+  #define VL_HAS_ATOMICS 1
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+  #define VL_HAS_ATOMICS 1
+  #define VL_GCC_ATOMIC_BUILTINS 1
+#elif defined(__GNUC__) && ((__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+  #define VL_HAS_ATOMICS 1
+  #define VL_GCC_SYNC_BUILTINS 1
+#else
+  // a non atomic fallback would make the reference counting and the ThreadPool silently racy
+  #error "vlCore/Atomic.hpp: no lock-free atomic operations available for this compiler, add them here."
+#endif
+
+namespace vl
+{
+  //! Atomically increments \p *val and returns the incremented value.
+  inline int atomicIncrement(volatile int* val)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedIncrement((volatile long*)val);
+  #elif defined(VL_GCC_ATOMIC_BUILTINS)
+    return __atomic_add_fetch(val, 1, __ATOMIC_ACQ_REL);
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    return __sync_add_and_fetch(val, 1);
+  #endif
+  }
+
+  //! Atomically decrements \p *val and returns the decremented value.
+  inline int atomicDecrement(volatile int* val)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedDecrement((volatile long*)val);
+  #elif defined(VL_GCC_ATOMIC_BUILTINS)
+    return __atomic_sub_fetch(val, 1, __ATOMIC_ACQ_REL);
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    return __sync_sub_and_fetch(val, 1);
+  #endif
+  }
+
+  //! Atomically adds \p delta to \p *val and returns the value \p *val had before the addition.
+  inline int atomicFetchAdd(volatile int* val, int delta)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedExchangeAdd((volatile long*)val, (long)delta);
+  #elif defined(VL_GCC_ATOMIC_BUILTINS)
+    return __atomic_fetch_add(val, delta, __ATOMIC_ACQ_REL);
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    return __sync_fetch_and_add(val, delta);
+  #endif
+  }
+
+  //! Atomically sets \p *val to \p new_val if \p *val is equal to \p expected. Returns the value \p *val had before the operation.
+  inline int atomicCompareAndSwap(volatile int* val, int expected, int new_val)
+  {
+  #if defined(_MSC_VER)
+    return (int)_InterlockedCompareExchange((volatile long*)val, (long)new_val, (long)expected);
+  #elif defined(VL_GCC_ATOMIC_BUILTINS)
+    __atomic_compare_exchange_n(val, &expected, new_val, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return expected;
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    return __sync_val_compare_and_swap(val, expected, new_val);
+  #endif
+  }
+
+  //! Reads \p *val with acquire semantics.
+  inline int atomicLoad(const volatile int* val)
+  {
+  #if defined(VL_GCC_ATOMIC_BUILTINS)
+    return __atomic_load_n(val, __ATOMIC_ACQUIRE);
+  #elif defined(_MSC_VER)
+    int v = *val; _ReadWriteBarrier(); return v;
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    int v = *val; __sync_synchronize(); return v;
+  #endif
+  }
+
+  //! Writes \p new_val into \p *val with release semantics.
+  inline void atomicStore(volatile int* val, int new_val)
+  {
+  #if defined(VL_GCC_ATOMIC_BUILTINS)
+    __atomic_store_n(val, new_val, __ATOMIC_RELEASE);
+  #elif defined(_MSC_VER)
+    _ReadWriteBarrier(); *val = new_val;
+  #elif defined(VL_GCC_SYNC_BUILTINS)
+    __sync_synchronize(); *val = new_val;
+  #endif
+  }
+}
+
+#endif
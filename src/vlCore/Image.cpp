@@ -39,10 +39,19 @@
 #include <vlCore/glsl_math.hpp>
 #include <vlCore/ResourceDatabase.hpp>
 #include <vlCore/LoadWriterManager.hpp>
+#include <vlCore/ImageTools.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/half.hpp>
 
 #include <map>
 #include <cmath>
 
+#if VL_F16C
+  #include <immintrin.h>
+#elif VL_SSE2
+  #include <emmintrin.h>
+#endif
+
 using namespace vl;
 
 //-----------------------------------------------------------------------------
@@ -150,6 +159,7 @@ bool Image::isValid() const
     case IT_UNSIGNED_INT:
     case IT_INT:
     case IT_FLOAT:
+    case IT_HALF_FLOAT:
     {
       switch(format())
       {
@@ -290,6 +300,7 @@ String Image::printType() const
   ty[IT_UNSIGNED_INT] = "IT_UNSIGNED_INT";
   ty[IT_INT] = "IT_INT";
   ty[IT_FLOAT] = "IT_FLOAT";
+  ty[IT_HALF_FLOAT] = "IT_HALF_FLOAT";
   ty[IT_UNSIGNED_BYTE_3_3_2] = "IT_UNSIGNED_BYTE_3_3_2";
   ty[IT_UNSIGNED_BYTE_2_3_3_REV] = "IT_UNSIGNED_BYTE_2_3_3_REV";
   ty[IT_UNSIGNED_SHORT_5_6_5] = "IT_UNSIGNED_SHORT_5_6_5";
@@ -387,6 +398,7 @@ int Image::bitsPerPixel(EImageType type, EImageFormat format)
     case IT_UNSIGNED_INT:   comp_size = sizeof(unsigned int)   * 8; break;
     case IT_INT:            comp_size = sizeof(int)    * 8; break;
     case IT_FLOAT:          comp_size = sizeof(float)  * 8; break;
+    case IT_HALF_FLOAT:     comp_size = sizeof(half)   * 8; break;
 
     case IT_UNSIGNED_BYTE_3_3_2:          return 8;
     case IT_UNSIGNED_BYTE_2_3_3_REV:      return 8;
@@ -479,6 +491,7 @@ int Image::alphaBits() const
     case IT_UNSIGNED_INT:   comp_size = sizeof(unsigned int)   * 8; break;
     case IT_INT:            comp_size = sizeof(int)    * 8; break;
     case IT_FLOAT:          comp_size = sizeof(float)  * 8; break;
+    case IT_HALF_FLOAT:     comp_size = sizeof(half)   * 8; break;
 
     case IT_UNSIGNED_BYTE_3_3_2:          return 0;
     case IT_UNSIGNED_BYTE_2_3_3_REV:      return 0;
@@ -665,7 +678,7 @@ void Image::reset()
 {
   mPixels->clear();
   mMipmaps.clear();
-  mObjectName.clear();
+  setObjectName(NULL);
   mWidth = 0;
   mHeight = 0;
   mDepth = 0;
@@ -1266,7 +1279,414 @@ ref<Image> vl::loadRAW(VirtualFile* file, long long file_offset, int width, int
   }
 }
 //-----------------------------------------------------------------------------
+// Pixel conversion engine
+//-----------------------------------------------------------------------------
+namespace
+{
+  // Type conversion: each component is normalized to 0..1, windowed, clamped and converted to the destination type.
+
+  //! Normalization factors of the supported types.
+  template<typename T> struct TypeInfo { };
+  template<> struct TypeInfo<unsigned char>  { static double maxValue() { return 255.0; } };
+  template<> struct TypeInfo<GLbyte>         { static double maxValue() { return 127.0; } };
+  template<> struct TypeInfo<GLushort>       { static double maxValue() { return 65535.0; } };
+  template<> struct TypeInfo<GLshort>        { static double maxValue() { return 32767.0; } };
+  template<> struct TypeInfo<unsigned int>   { static double maxValue() { return 4294967295.0; } };
+  template<> struct TypeInfo<int>            { static double maxValue() { return 2147483647.0; } };
+  template<> struct TypeInfo<float>          { static double maxValue() { return 1.0; } };
+  template<> struct TypeInfo<half>           { static double maxValue() { return 1.0; } };
+
+  template<typename T> inline double toNormalized(T v) { return (long long)v / TypeInfo<T>::maxValue(); }
+  template<> inline double toNormalized(float v) { return v; }
+  template<> inline double toNormalized(half v) { return (double)half::convertHalfToFloat(v); }
+
+  template<typename T> inline T fromNormalized(double v) { return (T)(v * TypeInfo<T>::maxValue()); }
+  template<> inline float fromNormalized(double v) { return (float)v; }
+  template<> inline half fromNormalized(double v) { return half::convertFloatToHalf((float)v); }
+
+  //! Maps the normalized window [black, white] to 0..1, the identity window is [0, 1].
+  struct TypeWindow
+  {
+    TypeWindow(float black, float white): mBlack(black), mScale(1.0f / (white - black)) {}
+    bool isIdentity() const { return mBlack == 0 && mScale == 1.0f; }
+    float mBlack;
+    float mScale;
+  };
+
+  typedef void (*TypeRowConverter)(const void* src, void* dst, int count, const TypeWindow& win);
+
+  template<typename T_Src, typename T_Dst>
+  void convertTypeRow(const void* src, void* dst, int count, const TypeWindow& win)
+  {
+    const T_Src* s = (const T_Src*)src;
+    T_Dst* d = (T_Dst*)dst;
+    for(int i=0; i<count; ++i)
+    {
+      double dval = (toNormalized<T_Src>(s[i]) - win.mBlack) * win.mScale;
+      // clamp 0.0 >= dval >= 1.0
+      dval = dval < 0.0 ? 0.0 :
+             dval > 1.0 ? 1.0 :
+             dval;
+      d[i] = fromNormalized<T_Dst>(dval);
+    }
+  }
+
+#if VL_SSE2
+  // The SIMD kernels work in double precision so that they produce exactly the same results of convertTypeRow().
+
+  //! Returns 2 windowed and clamped values.
+  inline __m128d windowClamp(__m128d v, const TypeWindow& win)
+  {
+    v = _mm_mul_pd( _mm_sub_pd(v, _mm_set1_pd(win.mBlack)), _mm_set1_pd(win.mScale) );
+    return _mm_min_pd( _mm_max_pd(v, _mm_setzero_pd()), _mm_set1_pd(1.0) );
+  }
+
+  //! Normalizes, windows and clamps 4 integers.
+  inline void normalizeWindowClamp(__m128i v, __m128d norm, const TypeWindow& win, __m128d& lo, __m128d& hi)
+  {
+    lo = windowClamp( _mm_div_pd(_mm_cvtepi32_pd(v), norm), win );
+    hi = windowClamp( _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), norm), win );
+  }
+
+  //! Windows, clamps and scales 4 floats, returns 4 truncated integers.
+  inline __m128i windowClampScale(__m128 v, __m128d norm, const TypeWindow& win)
+  {
+    __m128i lo = _mm_cvttpd_epi32( _mm_mul_pd(windowClamp(_mm_cvtps_pd(v), win), norm) );
+    __m128i hi = _mm_cvttpd_epi32( _mm_mul_pd(windowClamp(_mm_cvtps_pd(_mm_movehl_ps(v, v)), win), norm) );
+    return _mm_unpacklo_epi64(lo, hi);
+  }
+
+  //! Same as windowClampScale() but the input are 4 normalized integers.
+  inline __m128i windowClampScale(__m128i v, __m128d inorm, __m128d norm, const TypeWindow& win)
+  {
+    __m128d lo, hi;
+    normalizeWindowClamp(v, inorm, win, lo, hi);
+    return _mm_unpacklo_epi64( _mm_cvttpd_epi32(_mm_mul_pd(lo, norm)), _mm_cvttpd_epi32(_mm_mul_pd(hi, norm)) );
+  }
+
+  void convertTypeRow_UByte_Float(const void* src, void* dst, int count, const TypeWindow& win)
+  {
+    const unsigned char* s = (const unsigned char*)src;
+    float* d = (float*)dst;
+    const __m128d norm = _mm_set1_pd(255.0);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i+16 <= count; i+=16)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(s+i));
+      __m128i px16[] = { _mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero) };
+      for(int j=0; j<4; ++j)
+      {
+        __m128i px32 = j & 1 ? _mm_unpackhi_epi16(px16[j>>1], zero) : _mm_unpacklo_epi16(px16[j>>1], zero);
+        __m128d lo, hi;
+        normalizeWindowClamp(px32, norm, win, lo, hi);
+        _mm_storeu_ps(d+i+j*4, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+      }
+    }
+    convertTypeRow<unsigned char, float>(s+i, d+i, count-i, win);
+  }
+
+  void convertTypeRow_Float_UByte(const void* src, void* dst, int count, const TypeWindow& win)
+  {
+    const float* s = (const float*)src;
+    unsigned char* d = (unsigned char*)dst;
+    const __m128d norm = _mm_set1_pd(255.0);
+    int i = 0;
+    for(; i+16 <= count; i+=16)
+    {
+      __m128i a = windowClampScale(_mm_loadu_ps(s+i+0),  norm, win);
+      __m128i b = windowClampScale(_mm_loadu_ps(s+i+4),  norm, win);
+      __m128i c = windowClampScale(_mm_loadu_ps(s+i+8),  norm, win);
+      __m128i e = windowClampScale(_mm_loadu_ps(s+i+12), norm, win);
+      _mm_storeu_si128((__m128i*)(d+i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, e)));
+    }
+    convertTypeRow<float, unsigned char>(s+i, d+i, count-i, win);
+  }
+
+  //! Typically used to apply a window/level to 16 bits CT data.
+  void convertTypeRow_UShort_UByte(const void* src, void* dst, int count, const TypeWindow& win)
+  {
+    const GLushort* s = (const GLushort*)src;
+    unsigned char* d = (unsigned char*)dst;
+    const __m128d inorm = _mm_set1_pd(65535.0);
+    const __m128d norm = _mm_set1_pd(255.0);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i+16 <= count; i+=16)
+    {
+      __m128i px0 = _mm_loadu_si128((const __m128i*)(s+i+0));
+      __m128i px1 = _mm_loadu_si128((const __m128i*)(s+i+8));
+      __m128i a = windowClampScale(_mm_unpacklo_epi16(px0, zero), inorm, norm, win);
+      __m128i b = windowClampScale(_mm_unpackhi_epi16(px0, zero), inorm, norm, win);
+      __m128i c = windowClampScale(_mm_unpacklo_epi16(px1, zero), inorm, norm, win);
+      __m128i e = windowClampScale(_mm_unpackhi_epi16(px1, zero), inorm, norm, win);
+      _mm_storeu_si128((__m128i*)(d+i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, e)));
+    }
+    convertTypeRow<GLushort, unsigned char>(s+i, d+i, count-i, win);
+  }
+
+  void convertTypeRow_Float_Half(const void* src, void* dst, int count, const TypeWindow& win)
+  {
+    const float* s = (const float*)src;
+    half* d = (half*)dst;
+    int i = 0;
+  #if VL_F16C
+    for(; i+8 <= count; i+=8)
+    {
+      __m128 v0 = _mm_loadu_ps(s+i+0);
+      __m128 v1 = _mm_loadu_ps(s+i+4);
+      v0 = _mm_movelh_ps( _mm_cvtpd_ps(windowClamp(_mm_cvtps_pd(v0), win)), _mm_cvtpd_ps(windowClamp(_mm_cvtps_pd(_mm_movehl_ps(v0, v0)), win)) );
+      v1 = _mm_movelh_ps( _mm_cvtpd_ps(windowClamp(_mm_cvtps_pd(v1), win)), _mm_cvtpd_ps(windowClamp(_mm_cvtps_pd(_mm_movehl_ps(v1, v1)), win)) );
+      // round toward zero like half::convertFloatToHalf()
+      _mm_storeu_si128((__m128i*)(d+i), _mm_unpacklo_epi64(_mm_cvtps_ph(v0, 3), _mm_cvtps_ph(v1, 3)));
+    }
+  #endif
+    convertTypeRow<float, half>(s+i, d+i, count-i, win);
+  }
+#endif
+
+  //! Returns the index of the given type in the conversion tables or -1 if the type is not supported.
+  int typeIndex(EImageType type)
+  {
+    switch(type)
+    {
+      case IT_UNSIGNED_BYTE:  return 0;
+      case IT_BYTE:           return 1;
+      case IT_UNSIGNED_SHORT: return 2;
+      case IT_SHORT:          return 3;
+      case IT_UNSIGNED_INT:   return 4;
+      case IT_INT:            return 5;
+      case IT_FLOAT:          return 6;
+      case IT_HALF_FLOAT:     return 7;
+      default:                return -1;
+    }
+  }
+
+  template<typename T_Src>
+  void fillTypeRowTable(TypeRowConverter* row)
+  {
+    row[0] = convertTypeRow<T_Src, unsigned char>;
+    row[1] = convertTypeRow<T_Src, GLbyte>;
+    row[2] = convertTypeRow<T_Src, GLushort>;
+    row[3] = convertTypeRow<T_Src, GLshort>;
+    row[4] = convertTypeRow<T_Src, unsigned int>;
+    row[5] = convertTypeRow<T_Src, int>;
+    row[6] = convertTypeRow<T_Src, float>;
+    row[7] = convertTypeRow<T_Src, half>;
+  }
+
+  //! The [source][destination] type conversion table, the most common pairs use SIMD kernels.
+  class TypeConverterTable
+  {
+  public:
+    TypeConverterTable()
+    {
+      fillTypeRowTable<unsigned char>(mTable[0]);
+      fillTypeRowTable<GLbyte>       (mTable[1]);
+      fillTypeRowTable<GLushort>     (mTable[2]);
+      fillTypeRowTable<GLshort>      (mTable[3]);
+      fillTypeRowTable<unsigned int> (mTable[4]);
+      fillTypeRowTable<int>          (mTable[5]);
+      fillTypeRowTable<float>        (mTable[6]);
+      fillTypeRowTable<half>         (mTable[7]);
+#if VL_SSE2
+      mTable[0][6] = convertTypeRow_UByte_Float;
+      mTable[6][0] = convertTypeRow_Float_UByte;
+      mTable[2][0] = convertTypeRow_UShort_UByte;
+      mTable[6][7] = convertTypeRow_Float_Half;
+#endif
+    }
+
+    TypeRowConverter converter(EImageType src, EImageType dst) const { return mTable[typeIndex(src)][typeIndex(dst)]; }
+
+  private:
+    TypeRowConverter mTable[8][8];
+  };
+
+  const TypeConverterTable& typeConverterTable()
+  {
+    static TypeConverterTable table;
+    return table;
+  }
+
+  // Format conversion: each destination component is either copied from a source component,
+  // set to a constant or computed as the luminance of the source RGB components.
+
+  class rgbal
+  {
+  public:
+    rgbal(): r(-1), g(-1), b(-1), a(-1), l(-1) {}
+    int r,g,b,a,l;
+  };
+
+  struct FormatPlan
+  {
+    enum { Zero, One, Copy, Gray };
+    int mSrcComps;
+    int mDstComps;
+    int mMode[4];
+    int mIndex[4];
+    int mGray[3];
+  };
+
+  //! Computes how each destination component is generated.
+  void computeFormatPlan(FormatPlan& plan, const rgbal& srco, const rgbal& dsto)
+  {
+    int dst[5] = { dsto.r, dsto.g, dsto.b, dsto.a, dsto.l };
+    int src[5] = { srco.r, srco.g, srco.b, srco.a, srco.l };
+    plan.mGray[0] = srco.r;
+    plan.mGray[1] = srco.g;
+    plan.mGray[2] = srco.b;
+    for(int ch=0; ch<5; ++ch)
+    {
+      int c = dst[ch];
+      if (c == -1)
+        continue;
+      plan.mIndex[c] = -1;
+      if (ch < 3) // r, g, b: copy the same component or the luminance
+      {
+        plan.mMode[c] = src[ch] != -1 || srco.l != -1 ? (int)FormatPlan::Copy : (int)FormatPlan::Zero;
+        plan.mIndex[c] = src[ch] != -1 ? src[ch] : srco.l;
+      }
+      else
+      if (ch == 3) // alpha: copy or opaque
+      {
+        plan.mMode[c] = srco.a != -1 ? (int)FormatPlan::Copy : (int)FormatPlan::One;
+        plan.mIndex[c] = srco.a;
+      }
+      else // luminance: rgb -> gray, r/g/b -> gray or copy
+      {
+        int single = srco.r != -1 && srco.g == -1 && srco.b == -1 ? srco.r :
+                     srco.r == -1 && srco.g != -1 && srco.b == -1 ? srco.g :
+                     srco.r == -1 && srco.g == -1 && srco.b != -1 ? srco.b :
+                     srco.l;
+        if (srco.r != -1 && srco.g != -1 && srco.b != -1)
+          plan.mMode[c] = FormatPlan::Gray;
+        else
+        {
+          plan.mMode[c] = single != -1 ? (int)FormatPlan::Copy : (int)FormatPlan::Zero;
+          plan.mIndex[c] = single;
+        }
+      }
+    }
+  }
+
+  typedef void (*FormatRowConverter)(const void* src, void* dst, int count, const FormatPlan& plan);
+
+  template<typename T>
+  void convertFormatRow(const void* src, void* dst, int count, const FormatPlan& plan)
+  {
+    const T* src_px = (const T*)src;
+    T* dst_px = (T*)dst;
+    const T max_value = fromNormalized<T>(1.0);
+    for(int i=0; i<count; ++i, src_px+=plan.mSrcComps, dst_px+=plan.mDstComps)
+    {
+      for(int c=0; c<plan.mDstComps; ++c)
+      {
+        switch(plan.mMode[c])
+        {
+          case FormatPlan::Zero: dst_px[c] = fromNormalized<T>(0.0); break;
+          case FormatPlan::One:  dst_px[c] = max_value; break;
+          case FormatPlan::Copy: dst_px[c] = src_px[plan.mIndex[c]]; break;
+          case FormatPlan::Gray:
+          {
+            dvec3 col(toNormalized<T>(src_px[plan.mGray[0]]), toNormalized<T>(src_px[plan.mGray[1]]), toNormalized<T>(src_px[plan.mGray[2]]));
+            double gray = dot(col, dvec3(0.299,0.587,0.114));
+            dst_px[c] = fromNormalized<T>(gray);
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  void convertFormatRow_RGB_RGBA(const void* src, void* dst, int count, const FormatPlan&) 
+  { 
+    convertRowRGBToRGBA((const unsigned char*)src, (unsigned char*)dst, count, 0xFF); 
+  }
+  void convertFormatRow_RGBA_RGB(const void* src, void* dst, int count, const FormatPlan&) 
+  { 
+    convertRowRGBAToRGB((const unsigned char*)src, (unsigned char*)dst, count); 
+  }
+  void convertFormatRow_BGRA_RGBA(const void* src, void* dst, int count, const FormatPlan&) 
+  { 
+    swapRowBGRA_RGBA((const unsigned char*)src, (unsigned char*)dst, count); 
+  }
+  void convertFormatRow_BGR_RGB(const void* src, void* dst, int count, const FormatPlan&) 
+  { 
+    swapRowBGR_RGB((const unsigned char*)src, (unsigned char*)dst, count); 
+  }
+
+  //! Returns the row converter for the given formats and type.
+  FormatRowConverter formatConverter(EImageFormat src, EImageFormat dst, EImageType type)
+  {
+    if (type == IT_UNSIGNED_BYTE)
+    {
+      if ( (src == IF_RGB && dst == IF_RGBA) || (src == IF_BGR && dst == IF_BGRA) )
+        return convertFormatRow_RGB_RGBA;
+      if ( (src == IF_RGBA && dst == IF_RGB) || (src == IF_BGRA && dst == IF_BGR) )
+        return convertFormatRow_RGBA_RGB;
+      if ( (src == IF_BGRA && dst == IF_RGBA) || (src == IF_RGBA && dst == IF_BGRA) )
+        return convertFormatRow_BGRA_RGBA;
+      if ( (src == IF_BGR && dst == IF_RGB) || (src == IF_RGB && dst == IF_BGR) )
+        return convertFormatRow_BGR_RGB;
+    }
+    switch(type)
+    {
+      case IT_UNSIGNED_BYTE:  return convertFormatRow<unsigned char>;
+      case IT_BYTE:           return convertFormatRow<GLbyte>;
+      case IT_UNSIGNED_SHORT: return convertFormatRow<GLushort>;
+      case IT_SHORT:          return convertFormatRow<GLshort>;
+      case IT_UNSIGNED_INT:   return convertFormatRow<unsigned int>;
+      case IT_INT:            return convertFormatRow<int>;
+      case IT_FLOAT:          return convertFormatRow<float>;
+      case IT_HALF_FLOAT:     return convertFormatRow<half>;
+      default:                return NULL;
+    }
+  }
+
+  //! Converts the rows of an image in parallel using vl::defThreadPool().
+  class ConvertRowsTask: public ParallelForTask
+  {
+  public:
+    ConvertRowsTask(const Image* src, Image* dst): mSrc(src), mDst(dst), mTypeRow(NULL), mFormatRow(NULL), mWindow(0,1), mCount(0) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+      {
+        const void* src_line = mSrc->pixels() + mSrc->pitch()*i;
+        void* dst_line = mDst->pixels() + mDst->pitch()*i;
+        if (mTypeRow)
+          mTypeRow(src_line, dst_line, mCount, mWindow);
+        else
+          mFormatRow(src_line, dst_line, mCount, mPlan);
+      }
+    }
+
+    void runAll(int line_count)
+    {
+      // at least 64K per job to amortize the dispatch
+      int grain = 64*1024 / (mSrc->pitch() ? mSrc->pitch() : 1);
+      parallelFor(0, line_count, this, grain > 1 ? grain : 1);
+    }
+
+    const Image* mSrc;
+    Image* mDst;
+    TypeRowConverter mTypeRow;
+    FormatRowConverter mFormatRow;
+    TypeWindow mWindow;
+    FormatPlan mPlan;
+    int mCount;
+  };
+}
+//-----------------------------------------------------------------------------
 ref<Image> vl::Image::convertType(EImageType new_type) const
+{
+  return convertType(new_type, 0.0f, 1.0f);
+}
+//-----------------------------------------------------------------------------
+ref<Image> vl::Image::convertType(EImageType new_type, float black, float white) const
 {
   switch(type())
   {
@@ -1277,6 +1697,7 @@ ref<Image> vl::Image::convertType(EImageType new_type) const
     case IT_UNSIGNED_INT:  
     case IT_INT:           
     case IT_FLOAT:
+    case IT_HALF_FLOAT:
       break;
     default:
       Log::error("Image::convertType(): unsupported source image type.\n");
@@ -1292,6 +1713,7 @@ ref<Image> vl::Image::convertType(EImageType new_type) const
     case IT_UNSIGNED_INT:  
     case IT_INT:           
     case IT_FLOAT:
+    case IT_HALF_FLOAT:
       break;
     default:
       Log::error("Image::convertType(): unsupported destination image type.\n");
@@ -1355,105 +1777,208 @@ ref<Image> vl::Image::convertType(EImageType new_type) const
   if (img->isCubemap())
     line_count *= 6;
 
-  for(int i=0; i<line_count; ++i)
+  ConvertRowsTask task(this, img.get());
+  task.mWindow = TypeWindow(black, white);
+  task.mCount = img->width() * components;
+  if (type() == new_type && task.mWindow.isIdentity() && (new_type == IT_UNSIGNED_BYTE || new_type == IT_UNSIGNED_SHORT || new_type == IT_UNSIGNED_INT))
+  {
+    // unsigned types are already within range: plain copy
+    for(int i=0; i<line_count; ++i)
+      memcpy(img->pixels() + img->pitch()*i, pixels() + pitch()*i, img->pitch());
+  }
+  else
   {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
+    task.mTypeRow = typeConverterTable().converter(type(), new_type);
+    task.runAll(line_count);
+  }
 
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
+  return img;
+}
+//-----------------------------------------------------------------------------
+namespace {
+  // Levels: equalize() and contrast() first compute the range of the values (equalize only) in parallel, 
+  // then remap the values in parallel through a lookup table for 8 and 16 bits types.
+
+  template<typename T>
+  inline void rowMinMaxScalar(const T* px, int count, T& vmin, T& vmax)
+  {
+    for(int i=0; i<count; ++i)
+    {
+      if (vmin > px[i]) vmin = px[i];
+      if (vmax < px[i]) vmax = px[i];
+    }
+  }
 
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
+  template<typename T>
+  inline void rowMinMax(const T* px, int count, T& vmin, T& vmax)
+  {
+    rowMinMaxScalar(px, count, vmin, vmax);
+  }
 
-    for(int j=0; j<img->width(); ++j)
+#if VL_SSE2
+  template<>
+  inline void rowMinMax(const unsigned char* px, int count, unsigned char& vmin, unsigned char& vmax)
+  {
+    int i = 0;
+    if (count >= 16)
     {
-      for(int c=0; c<components; ++c)
+      __m128i mn = _mm_set1_epi8((char)vmin);
+      __m128i mx = _mm_set1_epi8((char)vmax);
+      for(; i+16<=count; i+=16)
       {
-        double dval = 0;
-        long long qint = 0;
+        __m128i v = _mm_loadu_si128((const __m128i*)(px+i));
+        mn = _mm_min_epu8(mn, v);
+        mx = _mm_max_epu8(mx, v);
+      }
+      unsigned char tmn[16], tmx[16];
+      _mm_storeu_si128((__m128i*)tmn, mn);
+      _mm_storeu_si128((__m128i*)tmx, mx);
+      rowMinMaxScalar(tmn, 16, vmin, vmax);
+      rowMinMaxScalar(tmx, 16, vmin, vmax);
+    }
+    rowMinMaxScalar(px+i, count-i, vmin, vmax);
+  }
 
-        // convert dst format to double
+  template<>
+  inline void rowMinMax(const unsigned short* px, int count, unsigned short& vmin, unsigned short& vmax)
+  {
+    int i = 0;
+    if (count >= 8)
+    {
+      // SSE2 has only signed 16 bits min/max: flip the sign bit
+      const __m128i bias = _mm_set1_epi16((short)0x8000);
+      __m128i mn = _mm_set1_epi16((short)(vmin ^ 0x8000));
+      __m128i mx = _mm_set1_epi16((short)(vmax ^ 0x8000));
+      for(; i+8<=count; i+=8)
+      {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(px+i)), bias);
+        mn = _mm_min_epi16(mn, v);
+        mx = _mm_max_epi16(mx, v);
+      }
+      unsigned short tmn[8], tmx[8];
+      _mm_storeu_si128((__m128i*)tmn, _mm_xor_si128(mn, bias));
+      _mm_storeu_si128((__m128i*)tmx, _mm_xor_si128(mx, bias));
+      rowMinMaxScalar(tmn, 8, vmin, vmax);
+      rowMinMaxScalar(tmx, 8, vmin, vmax);
+    }
+    rowMinMaxScalar(px+i, count-i, vmin, vmax);
+  }
+#endif
 
-        switch(type())
-        {
-          case IT_UNSIGNED_BYTE:  qint = *srcUByte;  dval = qint/255.0; ++srcUByte; break;
-          case IT_BYTE:           qint = *srcSByte;  dval = qint/127.0; ++srcSByte; break;
-          case IT_UNSIGNED_SHORT: qint = *srcUShort; dval = qint/65535.0; ++srcUShort; break;
-          case IT_SHORT:          qint = *srcSShort; dval = qint/32767.0; ++srcSShort; break;
-          case IT_UNSIGNED_INT:   qint = *srcUInt;   dval = qint/4294967295.0; ++srcUInt; break;
-          case IT_INT:            qint = *srcSInt;   dval = qint/2147483647.0; ++srcSInt; break;
-          case IT_FLOAT:          dval = *srcFloat;  ++srcFloat; break;
-          default:
-            return NULL;
-        }
+  //! Computes the min/max of the first \p count components of each line.
+  template<typename T>
+  class MinMaxTask: public ParallelForTask
+  {
+  public:
+    MinMaxTask(unsigned char* ptr, int pitch, int count): mPtr(ptr), mPitch(pitch), mCount(count) 
+    {
+      mMin.resize(parallelThreadCount(), *(T*)ptr);
+      mMax.resize(parallelThreadCount(), *(T*)ptr);
+    }
 
-        // clamp 0.0 >= dval >= 1.0
-        dval = dval < 0.0 ? 0.0 :
-               dval > 1.0 ? 1.0 :
-               dval;
+    virtual void run(int begin, int end, int thread_index)
+    {
+      T vmin = mMin[thread_index];
+      T vmax = mMax[thread_index];
+      for(int y=begin; y<end; ++y)
+        rowMinMax<T>((const T*)(mPtr + (size_t)mPitch*y), mCount, vmin, vmax);
+      mMin[thread_index] = vmin;
+      mMax[thread_index] = vmax;
+    }
 
-        // convert double to dst format
+    void runAll(int lines, T& vmin, T& vmax)
+    {
+      parallelFor(0, lines, this, lineGrain(mPitch));
+      vmin = mMin[0];
+      vmax = mMax[0];
+      rowMinMaxScalar(&mMin[0], (int)mMin.size(), vmin, vmax);
+      rowMinMaxScalar(&mMax[0], (int)mMax.size(), vmin, vmax);
+    }
 
-        switch(img->type())
-        {
-          case IT_UNSIGNED_BYTE:  *dstUByte  = (unsigned char) (dval*255.0); ++dstUByte; break;
-          case IT_BYTE:           *dstSByte  = (GLbyte)  (dval*127.0); ++dstSByte; break;
-          case IT_UNSIGNED_SHORT: *dstUShort = (GLushort)(dval*65535.0); ++dstUShort; break;
-          case IT_SHORT:          *dstSShort = (GLshort) (dval*32767.0); ++dstSShort; break;
-          case IT_UNSIGNED_INT:   *dstUInt   = (unsigned int)  (dval*4294967295.0); ++dstUInt; break;
-          case IT_INT:            *dstSInt   = (int)   (dval*2147483647.0); ++dstSInt; break;
-          case IT_FLOAT:          *dstFloat  = (float)dval; ++dstFloat; break;
-          default:
-            return NULL;
-        }
-      }
+    static int lineGrain(int pitch) 
+    { 
+      int grain = 64*1024 / (pitch ? pitch : 1);
+      return grain > 1 ? grain : 1;
     }
+
+    unsigned char* mPtr;
+    int mPitch;
+    int mCount;
+    std::vector<T> mMin;
+    std::vector<T> mMax;
+  };
+
+  //! Number of entries of the lookup table used to remap the values of type T, 0 if no table is used.
+  template<typename T> struct LevelsLUT { enum { size = 0 }; };
+  template<> struct LevelsLUT<unsigned char> { enum { size = 0x100 }; };
+  template<> struct LevelsLUT<unsigned short> { enum { size = 0x10000 }; };
+
+  template<typename T, typename T_Map>
+  inline void remapRow(T* px, int count, const std::vector<T>&, const T_Map& map)
+  {
+    for(int i=0; i<count; ++i)
+      px[i] = map(px[i]);
   }
 
-  return img;
-}
-//-----------------------------------------------------------------------------
-namespace {
-  template<typename T>
-  void equalizeTemplate(void* ptr, int pitch, int comps, int w, int h, T max_val)
+  template<typename T_Map>
+  inline void remapRow(unsigned char* px, int count, const std::vector<unsigned char>& lut, const T_Map&)
+  {
+    for(int i=0; i<count; ++i)
+      px[i] = lut[px[i]];
+  }
+
+  template<typename T_Map>
+  inline void remapRow(unsigned short* px, int count, const std::vector<unsigned short>& lut, const T_Map&)
+  {
+    for(int i=0; i<count; ++i)
+      px[i] = lut[px[i]];
+  }
+
+  //! Remaps the first \p count components of each line with \p T_Map::operator() or a lookup table filled with it.
+  template<typename T, typename T_Map>
+  class RemapTask: public ParallelForTask
   {
-    // find min/max
-    T vmin = *((T*)ptr);
-    T vmax = *((T*)ptr);
-    for(int y=0; y<h; ++y)
+  public:
+    RemapTask(unsigned char* ptr, int pitch, int count, const T_Map& map): mPtr(ptr), mPitch(pitch), mCount(count), mMap(map) 
     {
-      T* px = (T*)((char*)ptr + pitch*y);
-      for(int x=0; x<w; ++x)
-      {
-        for(int i=0; i<comps; ++i)
-        {
-          if (vmin > px[x*comps+i]) vmin = px[x*comps+i];
-          if (vmax < px[x*comps+i]) vmax = px[x*comps+i];
-        }
-      }
+      mLUT.resize(LevelsLUT<T>::size);
+      for(int i=0; i<(int)mLUT.size(); ++i)
+        mLUT[i] = mMap((T)i);
     }
-    // equalize
-    T range = vmax-vmin;
-    for(int y=0; y<h; ++y)
+
+    virtual void run(int begin, int end, int)
     {
-      T* px = (T*)((char*)ptr + pitch*y);
-      for(int x=0; x<w; ++x)
+      for(int y=begin; y<end; ++y)
       {
-        for(int i=0; i<comps; ++i)
-          px[x*comps+i] = (T)(((float)px[x*comps+i]-vmin)/range*max_val);
+        remapRow((T*)(mPtr + (size_t)mPitch*y), mCount, mLUT, mMap);
       }
     }
+
+    void runAll(int lines) { parallelFor(0, lines, this, MinMaxTask<T>::lineGrain(mPitch)); }
+
+    unsigned char* mPtr;
+    int mPitch;
+    int mCount;
+    T_Map mMap;
+    std::vector<T> mLUT;
+  };
+
+  template<typename T>
+  struct EqualizeMap
+  {
+    EqualizeMap(T vmin, T vmax, T max_val): mMin(vmin), mRange(vmax-vmin), mMaxVal(max_val) {}
+    T operator()(T v) const { return (T)(((float)v-mMin)/mRange*mMaxVal); }
+    T mMin, mRange, mMaxVal;
+  };
+
+  template<typename T>
+  void equalizeTemplate(void* ptr, int pitch, int comps, int w, int h, T max_val)
+  {
+    T vmin, vmax;
+    MinMaxTask<T>((unsigned char*)ptr, pitch, w*comps).runAll(h, vmin, vmax);
+    if (vmin == vmax)
+      return;
+    RemapTask< T, EqualizeMap<T> >((unsigned char*)ptr, pitch, w*comps, EqualizeMap<T>(vmin, vmax, max_val)).runAll(h);
   }
 }
 //! This function is mainly useful for images whose type() is IF_LUMINANCE, IF_RED, IF_GREEN, IF_BLUE, IF_ALPHA or IF_DEPTH_COMPONENT.
@@ -1559,20 +2084,24 @@ bool Image::contrastHounsfield(float center, float width, float intercept, float
 //-----------------------------------------------------------------------------
 namespace {
   template<typename T>
-  void contrastTemplate(void* ptr, int pitch, int w, int h, T max_val, float black, float white)
+  struct ContrastMap
   {
-    float range = white-black;
-    for(int y=0; y<h; ++y)
+    ContrastMap(T max_val, float black, float white): mMaxVal(max_val), mBlack(black), mRange(white-black) {}
+    T operator()(T v) const
     {
-      T* px = (T*)((char*)ptr + pitch*y);
-      for(int x=0; x<w; ++x)
-      {
-        float t = (float)px[x]/max_val; // 0..1
-        t = (t-black)/range;
-        t = vl::clamp(t, 0.0f, 1.0f);
-        px[x] = (T)(t*max_val);
-      }
+      float t = (float)v/mMaxVal; // 0..1
+      t = (t-mBlack)/mRange;
+      t = vl::clamp(t, 0.0f, 1.0f);
+      return (T)(t*mMaxVal);
     }
+    T mMaxVal;
+    float mBlack, mRange;
+  };
+
+  template<typename T>
+  void contrastTemplate(void* ptr, int pitch, int w, int h, T max_val, float black, float white)
+  {
+    RemapTask< T, ContrastMap<T> >((unsigned char*)ptr, pitch, w, ContrastMap<T>(max_val, black, white)).runAll(h);
   }
 }
 //! This function supports only images whose type() is IF_LUMINANCE, IF_RED, IF_GREEN, IF_BLUE, IF_ALPHA or IF_DEPTH_COMPONENT.
@@ -1614,74 +2143,6 @@ bool Image::contrast(float black, float white)
   return true;
 }
 //-----------------------------------------------------------------------------
-namespace
-{
-  class rgbal
-  {
-  public:
-    rgbal(): r(-1), g(-1), b(-1), a(-1), l(-1) {}
-    int r,g,b,a,l;
-  };
-
-  template<typename T>
-  void convert(const T*src_px, T*dst_px, T max_value, const rgbal& srco, const rgbal& dsto)
-  {
-    // set dst default values first
-    if (dsto.r != -1)
-      dst_px[dsto.r] = 0;
-    if (dsto.g != -1)
-      dst_px[dsto.g] = 0;
-    if (dsto.b != -1)
-      dst_px[dsto.b] = 0;
-    if (dsto.a != -1)
-      dst_px[dsto.a] = max_value;
-    if (dsto.l != -1)
-      dst_px[dsto.l] = 0;
-
-    // try copy src -> dst
-    if (dsto.r != -1 && srco.r != -1 )
-      dst_px[dsto.r] = src_px[srco.r];
-    if (dsto.g != -1 && srco.g != -1)
-      dst_px[dsto.g] = src_px[srco.g];
-    if (dsto.b != -1 && srco.b != -1)
-      dst_px[dsto.b] = src_px[srco.b];
-    if (dsto.a != -1 && srco.a != -1)
-      dst_px[dsto.a] = src_px[srco.a];
-    if (dsto.l != -1 && srco.l != -1)
-      dst_px[dsto.l] = src_px[srco.l];
-
-    // try rgb -> gray conversion
-    if (dsto.l != -1 && srco.r != -1 && srco.g != -1 && srco.b != -1)
-    {
-      dvec3 col(src_px[srco.r], src_px[srco.g], src_px[srco.b]);
-      double gray = dot(col / dvec3(max_value,max_value,max_value), dvec3(0.299,0.587,0.114));
-      dst_px[dsto.l] = T(gray * max_value);
-    }
-    else
-    // try r -> gray conversion
-    if (dsto.l != -1 && srco.r != -1 && srco.g == -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.r];
-    else
-    // try g -> gray conversion
-    if (dsto.l != -1 && srco.r == -1 && srco.g != -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.g];
-    else
-    // try b -> gray conversion
-    if (dsto.l != -1 && srco.r == -1 && srco.g == -1 && srco.b != -1)
-      dst_px[dsto.l] = src_px[srco.b];
-    else
-    // try gray -> r,g,b
-    if (srco.l != -1)
-    {
-      if (dsto.r != -1)
-        dst_px[dsto.r] = src_px[srco.l];
-      if (dsto.g != -1)
-        dst_px[dsto.g] = src_px[srco.l];
-      if (dsto.b != -1)
-        dst_px[dsto.b] = src_px[srco.l];
-    }
-  }
-}
 ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
 {
   switch(type())
@@ -1693,6 +2154,7 @@ ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
     case IT_UNSIGNED_INT:  
     case IT_INT:           
     case IT_FLOAT:
+    case IT_HALF_FLOAT:
       break;
     default:
       Log::error("Image::convertType(): unsupported image type.\n");
@@ -1827,45 +2289,623 @@ ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
   if (img->isCubemap())
     line_count *= 6;
 
-  for(int i=0; i<line_count; ++i)
+  ConvertRowsTask task(this, img.get());
+  task.mPlan.mSrcComps = src_comp;
+  task.mPlan.mDstComps = dst_comp;
+  computeFormatPlan(task.mPlan, srco, dsto);
+  task.mFormatRow = formatConverter(format(), new_format, type());
+  task.mCount = img->width();
+  task.runAll(line_count);
+
+  return img;
+}
+//-----------------------------------------------------------------------------
+namespace
+{
+  // Resampling: the image is converted to a float buffer and filtered separably along X, Y and Z.
+
+  //! Image pixels stored as normalized floats, the lines of the faces/slices are consecutive.
+  struct FloatImage
   {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
+    FloatImage(): mWidth(0), mHeight(0), mPlanes(0), mComps(0) {}
 
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
+    void allocate(int w, int h, int planes, int comps)
+    {
+      mWidth = w; mHeight = h; mPlanes = planes; mComps = comps;
+      mData.resize( (size_t)w * h * planes * comps );
+    }
+    int lineCount() const { return mHeight * mPlanes; }
+    int lineSize() const { return mWidth * mComps; }
+    float* line(int i) { return &mData[0] + (size_t)i * lineSize(); }
+    const float* line(int i) const { return &mData[0] + (size_t)i * lineSize(); }
+
+    int mWidth;
+    int mHeight;
+    int mPlanes; // depth for 3D images, 6 for cubemaps, 1 otherwise
+    int mComps;
+    std::vector<float> mData;
+  };
 
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
+  int resampleComponents(EImageFormat format)
+  {
+    switch(format)
+    {
+      case IF_RGB:
+      case IF_BGR:   return 3;
+      case IF_RGBA:
+      case IF_BGRA:  return 4;
+      case IF_RED:
+      case IF_GREEN:
+      case IF_BLUE:
+      case IF_ALPHA:
+      case IF_LUMINANCE:
+      case IF_DEPTH_COMPONENT: return 1;
+      case IF_LUMINANCE_ALPHA: return 2;
+      default:       return 0;
+    }
+  }
 
-    for(int j=0; j<img->width(); ++j)
+  //! Index of the component that must not be treated as a color, -1 if none.
+  int resampleAlphaIndex(EImageFormat format)
+  {
+    switch(format)
     {
-      switch(type())
+      case IF_RGBA:
+      case IF_BGRA:  return 3;
+      case IF_LUMINANCE_ALPHA: return 1;
+      case IF_ALPHA: 
+      case IF_DEPTH_COMPONENT: return 0;
+      default:       return -1;
+    }
+  }
+
+  inline float srgbToLinear(float v)
+  {
+    return v <= 0.04045f ? v * (1.0f/12.92f) : powf((v + 0.055f) * (1.0f/1.055f), 2.4f);
+  }
+
+  inline float linearToSrgb(float v)
+  {
+    if (v <= 0.0f)
+      return 0.0f;
+    return v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f/2.4f) - 0.055f;
+  }
+
+  //! Rounds to the nearest representable value and clamps to the range of the type.
+  template<typename T> inline T fromNormalizedRound(float v) 
+  { 
+    const double max_value = TypeInfo<T>::maxValue();
+    const double min_value = (T)-1 < 0 ? -max_value : 0.0;
+    double x = floor(v * max_value + 0.5);
+    return (T)(long long)(x < min_value ? min_value : x > max_value ? max_value : x);
+  }
+  template<> inline float fromNormalizedRound(float v) { return v; }
+  template<> inline half fromNormalizedRound(float v) { return half::convertFloatToHalf(v); }
+
+  typedef void (*FloatRowLoader)(const void* src, float* dst, int count);
+  typedef void (*FloatRowStorer)(const float* src, void* dst, int count);
+
+  template<typename T>
+  void loadFloatRow(const void* src, float* dst, int count)
+  {
+    const T* src_px = (const T*)src;
+    for(int i=0; i<count; ++i)
+      dst[i] = (float)toNormalized<T>(src_px[i]);
+  }
+
+  template<typename T>
+  void storeFloatRow(const float* src, void* dst, int count)
+  {
+    T* dst_px = (T*)dst;
+    for(int i=0; i<count; ++i)
+      dst_px[i] = fromNormalizedRound<T>(src[i]);
+  }
+
+  bool floatRowFunctions(EImageType type, FloatRowLoader& loader, FloatRowStorer& storer)
+  {
+    switch(type)
+    {
+      case IT_UNSIGNED_BYTE:  loader = loadFloatRow<unsigned char>; storer = storeFloatRow<unsigned char>; return true;
+      case IT_BYTE:           loader = loadFloatRow<GLbyte>;        storer = storeFloatRow<GLbyte>;        return true;
+      case IT_UNSIGNED_SHORT: loader = loadFloatRow<GLushort>;      storer = storeFloatRow<GLushort>;      return true;
+      case IT_SHORT:          loader = loadFloatRow<GLshort>;       storer = storeFloatRow<GLshort>;       return true;
+      case IT_UNSIGNED_INT:   loader = loadFloatRow<unsigned int>;  storer = storeFloatRow<unsigned int>;  return true;
+      case IT_INT:            loader = loadFloatRow<int>;           storer = storeFloatRow<int>;           return true;
+      case IT_FLOAT:          loader = loadFloatRow<float>;         storer = storeFloatRow<float>;         return true;
+      case IT_HALF_FLOAT:     loader = loadFloatRow<half>;          storer = storeFloatRow<half>;          return true;
+      default:                return false;
+    }
+  }
+
+  //! Converts the lines of an Image from/to a FloatImage applying the sRGB and normal map transforms.
+  class FloatImageIOTask: public ParallelForTask
+  {
+  public:
+    FloatImageIOTask(const Image* img, FloatImage* fimg, bool store, bool srgb): 
+      mImage(img), mFloatImage(fimg), mStore(store), mSRGB(srgb), mRenormalize(false), mEncodedNormals(false), mByteLUT(false)
+    {
+      floatRowFunctions(img->type(), mLoader, mStorer);
+      mAlpha = resampleAlphaIndex(img->format());
+      mRenormalize = img->isNormalMap() && fimg->mComps >= 3;
+      mEncodedNormals = img->type() == IT_UNSIGNED_BYTE || img->type() == IT_UNSIGNED_SHORT || img->type() == IT_UNSIGNED_INT;
+      mByteLUT = img->type() == IT_UNSIGNED_BYTE;
+      if (mByteLUT)
       {
-        case IT_UNSIGNED_BYTE:  convert<unsigned char> (srcUByte,  dstUByte,  255,         srco, dsto); srcUByte+=src_comp;  dstUByte+=dst_comp;  break;
-        case IT_BYTE:           convert<GLbyte>        (srcSByte,  dstSByte,  127,         srco, dsto); srcSByte+=src_comp;  dstSByte+=dst_comp;  break;
-        case IT_UNSIGNED_SHORT: convert<GLushort>      (srcUShort, dstUShort, 65535,       srco, dsto); srcUShort+=src_comp; dstUShort+=dst_comp; break;
-        case IT_SHORT:          convert<GLshort>       (srcSShort, dstSShort, 32767,       srco, dsto); srcSShort+=src_comp; dstSShort+=dst_comp; break;
-        case IT_UNSIGNED_INT:   convert<unsigned int>  (srcUInt,   dstUInt,   4294967295U, srco, dsto); srcUInt+=src_comp;   dstUInt+=dst_comp;   break;
-        case IT_INT:            convert<int>           (srcSInt,   dstSInt,   2147483647,  srco, dsto); srcSInt+=src_comp;   dstSInt+=dst_comp;   break;
-        case IT_FLOAT:          convert<float>         (srcFloat,  dstFloat,  1.0f,        srco, dsto); srcFloat+=src_comp;  dstFloat+=dst_comp;  break;
-        default:
-          return NULL;
+        // 8 bits: decode with a table, encode sRGB with a binary search of the decision levels, exact and without pow()
+        for(int i=0; i<256; ++i)
+        {
+          mLinear[i] = i / 255.0f;
+          mFromSRGB[i] = srgbToLinear(i / 255.0f);
+          mToSRGB[i] = i < 255 ? srgbToLinear((i + 0.5f) / 255.0f) : 1e30f;
+        }
+      }
+    }
+
+    void loadByteRow(const unsigned char* src, float* dst, int count) const
+    {
+      const float* linear = mLinear;
+      if (!mSRGB)
+      {
+        for(int j=0; j<count; ++j)
+          dst[j] = linear[src[j]];
+        return;
+      }
+      const float* from_srgb = mFromSRGB;
+      const int comps = mFloatImage->mComps, alpha = mAlpha;
+      for(int j=0, c=0; j<count; ++j, c = c+1 == comps ? 0 : c+1)
+        dst[j] = c != alpha ? from_srgb[src[j]] : linear[src[j]];
+    }
+
+    void storeByteRow(const float* src, unsigned char* dst, int count) const
+    {
+      const float* to_srgb = mToSRGB;
+      const int comps = mFloatImage->mComps, alpha = mSRGB ? mAlpha : -2;
+      for(int j=0, c=0; j<count; ++j, c = c+1 == comps ? 0 : c+1)
+      {
+        float v = src[j];
+        if (alpha != -2 && c != alpha)
+        {
+          int lo = 0;
+          for(int step=128; step; step>>=1)
+            if (v >= to_srgb[lo + step - 1])
+              lo += step;
+          dst[j] = (unsigned char)lo;
+        }
+        else
+        {
+          v = v * 255.0f + 0.5f;
+          dst[j] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : (int)v);
+        }
+      }
+    }
+
+    virtual void run(int begin, int end, int)
+    {
+      const int comps = mFloatImage->mComps;
+      const int count = mFloatImage->lineSize();
+      std::vector<float> tmp(mStore ? count : 0);
+      for(int i=begin; i<end; ++i)
+      {
+        unsigned char* img_line = (unsigned char*)mImage->pixels() + mImage->pitch() * i;
+        if (!mStore)
+        {
+          float* line = mFloatImage->line(i);
+          if (mByteLUT)
+          {
+            loadByteRow(img_line, line, count);
+            continue;
+          }
+          mLoader(img_line, line, count);
+          if (mSRGB)
+            for(int j=0; j<count; ++j)
+              if (j % comps != mAlpha)
+                line[j] = srgbToLinear(line[j]);
+        }
+        else
+        {
+          memcpy(&tmp[0], mFloatImage->line(i), sizeof(float)*count);
+          if (mRenormalize)
+            renormalize(&tmp[0], mFloatImage->mWidth, comps);
+          if (mByteLUT)
+          {
+            storeByteRow(&tmp[0], img_line, count);
+            continue;
+          }
+          if (mSRGB)
+            for(int j=0; j<count; ++j)
+              if (j % comps != mAlpha)
+                tmp[j] = linearToSrgb(tmp[j]);
+          mStorer(&tmp[0], img_line, count);
+        }
+      }
+    }
+
+    void renormalize(float* px, int count, int comps) const
+    {
+      for(int i=0; i<count; ++i, px+=comps)
+      {
+        fvec3 n(px[0], px[1], px[2]);
+        if (mEncodedNormals)
+          n = n * 2.0f - fvec3(1,1,1);
+        float len = n.length();
+        if (len == 0)
+          continue;
+        n /= len;
+        if (mEncodedNormals)
+          n = n * 0.5f + fvec3(0.5f,0.5f,0.5f);
+        px[0] = n.x(); px[1] = n.y(); px[2] = n.z();
       }
     }
+
+    void runAll()
+    {
+      int grain = 64*1024 / (mImage->pitch() ? mImage->pitch() : 1);
+      parallelFor(0, mFloatImage->lineCount(), this, grain > 1 ? grain : 1);
+    }
+
+    const Image* mImage;
+    FloatImage* mFloatImage;
+    FloatRowLoader mLoader;
+    FloatRowStorer mStorer;
+    int mAlpha;
+    bool mStore;
+    bool mSRGB;
+    bool mRenormalize;
+    bool mEncodedNormals;
+    bool mByteLUT;
+    float mLinear[256];
+    float mFromSRGB[256];
+    float mToSRGB[256];
+  };
+
+  double sinc(double x)
+  {
+    x = fabs(x) * dPi;
+    return x < 1e-8 ? 1.0 : sin(x) / x;
   }
 
-  return img;
+  //! Modified Bessel function of the first kind of order 0.
+  double besselI0(double x)
+  {
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    for(int k=1; k<32 && term > sum * 1e-12; ++k)
+    {
+      term *= q / ((double)k * k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  double filterRadius(EImageResampleFilter filter)
+  {
+    switch(filter)
+    {
+      case IRF_BOX:      return 0.5;
+      case IRF_TRIANGLE: return 1.0;
+      default:           return 3.0;
+    }
+  }
+
+  double filterWeight(EImageResampleFilter filter, double x)
+  {
+    switch(filter)
+    {
+      case IRF_BOX: 
+        return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+      case IRF_TRIANGLE: 
+        return fabs(x) < 1.0 ? 1.0 - fabs(x) : 0.0;
+      case IRF_KAISER:
+      {
+        const double alpha = 4.0;
+        double t = x / 3.0;
+        return fabs(t) < 1.0 ? sinc(x) * besselI0(alpha * sqrt(1.0 - t*t)) / besselI0(alpha) : 0.0;
+      }
+      case IRF_LANCZOS:
+        return fabs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+  }
+
+  //! Precomputed source indices and weights of each destination sample along one axis, 
+  //! each sample has the same number of taps, unused taps have zero weight.
+  struct ResampleKernel
+  {
+    ResampleKernel(int src_size, int dst_size, EImageResampleFilter filter)
+    {
+      double scale = (double)dst_size / src_size;
+      double fscale = scale < 1.0 ? 1.0 / scale : 1.0;
+      double support = filterRadius(filter) * fscale;
+      mTaps = (int)ceil(support * 2.0) + 1;
+      mIndex.resize(dst_size * mTaps);
+      mWeight.resize(dst_size * mTaps);
+      for(int i=0; i<dst_size; ++i)
+      {
+        double center = (i + 0.5) / scale;
+        int first = (int)floor(center - support);
+        double sum = 0;
+        for(int k=0; k<mTaps; ++k)
+        {
+          int j = first + k;
+          double w = filterWeight(filter, (j + 0.5 - center) / fscale);
+          mIndex[i*mTaps + k] = clamp(j, 0, src_size-1);
+          mWeight[i*mTaps + k] = (float)w;
+          sum += w;
+        }
+        if (sum == 0)
+        {
+          // cannot happen with the filters above but keep the sample defined
+          mWeight[i*mTaps] = 1.0f;
+          mIndex[i*mTaps] = clamp((int)center, 0, src_size-1);
+          sum = 1.0;
+        }
+        for(int k=0; k<mTaps; ++k)
+          mWeight[i*mTaps + k] = (float)(mWeight[i*mTaps + k] / sum);
+      }
+
+      // drop the leading and trailing zero weights, e.g. a 2:1 box reduction needs 2 taps instead of 3
+      std::vector<int> first_tap(dst_size);
+      int taps = 1;
+      for(int i=0; i<dst_size; ++i)
+      {
+        int lo = 0, hi = mTaps-1;
+        while(lo < hi && mWeight[i*mTaps + lo] == 0) ++lo;
+        while(hi > lo && mWeight[i*mTaps + hi] == 0) --hi;
+        first_tap[i] = lo;
+        taps = hi-lo+1 > taps ? hi-lo+1 : taps;
+      }
+      if (taps < mTaps)
+      {
+        std::vector<int> index(dst_size * taps);
+        std::vector<float> weight(dst_size * taps);
+        for(int i=0; i<dst_size; ++i)
+        {
+          for(int k=0; k<taps; ++k)
+          {
+            int t = first_tap[i] + k < mTaps ? first_tap[i] + k : mTaps-1;
+            index[i*taps + k]  = mIndex[i*mTaps + t];
+            weight[i*taps + k] = first_tap[i] + k < mTaps ? mWeight[i*mTaps + t] : 0.0f;
+          }
+        }
+        mTaps = taps;
+        mIndex.swap(index);
+        mWeight.swap(weight);
+      }
+    }
+
+    int mTaps;
+    std::vector<int> mIndex;
+    std::vector<float> mWeight;
+  };
+
+  //! dst[i] += src[i] * w
+  inline void accumulateRow(float* dst, const float* src, float w, int count)
+  {
+    int i=0;
+#if VL_SSE2
+    __m128 vw = _mm_set1_ps(w);
+    for(; i+4<=count; i+=4)
+      _mm_storeu_ps(dst+i, _mm_add_ps(_mm_loadu_ps(dst+i), _mm_mul_ps(_mm_loadu_ps(src+i), vw)));
+#endif
+    for(; i<count; ++i)
+      dst[i] += src[i] * w;
+  }
+
+  //! Filters a FloatImage along one axis.
+  class ResamplePassTask: public ParallelForTask
+  {
+  public:
+    enum EAxis { AxisX, AxisY, AxisZ };
+
+    ResamplePassTask(EAxis axis, const FloatImage& src, FloatImage& dst, const ResampleKernel& kernel): 
+      mAxis(axis), mSrc(src), mDst(dst), mKernel(kernel) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      const int taps = mKernel.mTaps;
+      const int comps = mSrc.mComps;
+      const int count = mDst.lineSize();
+      for(int i=begin; i<end; ++i)
+      {
+        float* dst = mDst.line(i);
+        if (mAxis == AxisX)
+        {
+          const float* src = mSrc.line(i);
+          for(int x=0; x<mDst.mWidth; ++x, dst+=comps)
+          {
+            const int* index = &mKernel.mIndex[x*taps];
+            const float* weight = &mKernel.mWeight[x*taps];
+#if VL_SSE2
+            if (comps == 4)
+            {
+              __m128 acc = _mm_setzero_ps();
+              for(int k=0; k<taps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + index[k]*4), _mm_set1_ps(weight[k])));
+              _mm_storeu_ps(dst, acc);
+              continue;
+            }
+#endif
+            for(int c=0; c<comps; ++c)
+            {
+              float acc = 0;
+              for(int k=0; k<taps; ++k)
+                acc += src[index[k]*comps + c] * weight[k];
+              dst[c] = acc;
+            }
+          }
+        }
+        else
+        {
+          // Y: line i = plane * dst_height + y; Z: line i = z * height + y
+          int sample, src_base, src_stride;
+          if (mAxis == AxisY)
+          {
+            sample = i % mDst.mHeight;
+            src_base = (i / mDst.mHeight) * mSrc.mHeight;
+            src_stride = 1;
+          }
+          else
+          {
+            sample = i / mDst.mHeight;
+            src_base = i % mDst.mHeight;
+            src_stride = mSrc.mHeight;
+          }
+          memset(dst, 0, sizeof(float)*count);
+          for(int k=0; k<taps; ++k)
+          {
+            float w = mKernel.mWeight[sample*taps + k];
+            if (w != 0)
+              accumulateRow(dst, mSrc.line(src_base + mKernel.mIndex[sample*taps + k]*src_stride), w, count);
+          }
+        }
+      }
+    }
+
+    void runAll()
+    {
+      int grain = 16*1024 / (mDst.lineSize() ? mDst.lineSize() : 1);
+      parallelFor(0, mDst.lineCount(), this, grain > 1 ? grain : 1);
+    }
+
+    EAxis mAxis;
+    const FloatImage& mSrc;
+    FloatImage& mDst;
+    const ResampleKernel& mKernel;
+  };
+
+  //! Resamples \p src to the given size, \p is_3d tells whether the planes are the slices of a 3D image or independent faces.
+  void resampleFloatImage(const FloatImage& src, FloatImage& dst, int w, int h, int d, bool is_3d, EImageResampleFilter filter)
+  {
+    FloatImage tmp[2];
+    const FloatImage* cur = &src;
+    int next = 0;
+
+    if (w != cur->mWidth)
+    {
+      ResampleKernel kernel(cur->mWidth, w, filter);
+      tmp[next].allocate(w, cur->mHeight, cur->mPlanes, cur->mComps);
+      ResamplePassTask(ResamplePassTask::AxisX, *cur, tmp[next], kernel).runAll();
+      cur = &tmp[next]; next = 1 - next;
+    }
+
+    if (h != cur->mHeight)
+    {
+      ResampleKernel kernel(cur->mHeight, h, filter);
+      tmp[next].allocate(cur->mWidth, h, cur->mPlanes, cur->mComps);
+      ResamplePassTask(ResamplePassTask::AxisY, *cur, tmp[next], kernel).runAll();
+      cur = &tmp[next]; next = 1 - next;
+    }
+
+    if (is_3d && d != cur->mPlanes)
+    {
+      ResampleKernel kernel(cur->mPlanes, d, filter);
+      tmp[next].allocate(cur->mWidth, cur->mHeight, d, cur->mComps);
+      ResamplePassTask(ResamplePassTask::AxisZ, *cur, tmp[next], kernel).runAll();
+      cur = &tmp[next]; next = 1 - next;
+    }
+
+    if (cur == &src)
+      dst = src;
+    else
+    {
+      FloatImage* result = const_cast<FloatImage*>(cur);
+      dst.mWidth  = result->mWidth;
+      dst.mHeight = result->mHeight;
+      dst.mPlanes = result->mPlanes;
+      dst.mComps  = result->mComps;
+      dst.mData.swap(result->mData);
+    }
+  }
+
+  bool canResample(const Image* img, const char* func)
+  {
+    FloatRowLoader loader;
+    FloatRowStorer storer;
+    if (!floatRowFunctions(img->type(), loader, storer))
+    {
+      Log::error( Say("%s: unsupported image type.\n") << func );
+      return false;
+    }
+    if (!resampleComponents(img->format()))
+    {
+      Log::error( Say("%s: unsupported image format.\n") << func );
+      return false;
+    }
+    if (!img->pixels() || img->dimension() == ID_Error)
+    {
+      Log::error( Say("%s: invalid image.\n") << func );
+      return false;
+    }
+    return true;
+  }
+
+  void loadFloatImage(const Image* img, FloatImage& fimg, bool srgb)
+  {
+    int planes = img->depth() ? img->depth() : img->isCubemap() ? 6 : 1;
+    fimg.allocate(img->width(), img->height() ? img->height() : 1, planes, resampleComponents(img->format()));
+    FloatImageIOTask(img, &fimg, false, srgb).runAll();
+  }
+
+  ref<Image> storeFloatImage(const FloatImage& fimg, const Image* like, int w, int h, int d, bool srgb)
+  {
+    ref<Image> img = new Image;
+    img->reset(w, h, d, like->byteAlignment(), like->format(), like->type(), like->isCubemap());
+    img->setObjectName( like->objectName().c_str() );
+    img->setIsNormalMap( like->isNormalMap() );
+    img->setHasAlpha( like->hasAlpha() );
+    img->allocate();
+    FloatImageIOTask(img.get(), const_cast<FloatImage*>(&fimg), true, srgb).runAll();
+    return img;
+  }
+}
+//-----------------------------------------------------------------------------
+ref<Image> Image::resample(int w, int h, int d, EImageResampleFilter filter, bool srgb) const
+{
+  if (!canResample(this, "Image::resample()"))
+    return NULL;
+
+  bool ok = w > 0;
+  switch(dimension())
+  {
+    case ID_1D:      ok &= h == 0 && d == 0; break;
+    case ID_2D:      ok &= h > 0 && d == 0; break;
+    case ID_3D:      ok &= h > 0 && d > 0; break;
+    case ID_Cubemap: ok &= h == w && d == 0; break;
+    default:         ok = false;
+  }
+  if (!ok)
+  {
+    Log::error( Say("Image::resample(): invalid size %nx%nx%n for a %s image.\n") << w << h << d << (isCubemap() ? "cubemap" : d ? "3D" : h ? "2D" : "1D") );
+    return NULL;
+  }
+
+  FloatImage src, dst;
+  loadFloatImage(this, src, srgb);
+  resampleFloatImage(src, dst, w, h ? h : 1, d ? d : src.mPlanes, dimension() == ID_3D, filter);
+  return storeFloatImage(dst, this, w, h, d, srgb);
+}
+//-----------------------------------------------------------------------------
+bool Image::buildMipmaps(EImageResampleFilter filter, bool srgb)
+{
+  if (!canResample(this, "Image::buildMipmaps()"))
+    return false;
+
+  mMipmaps.clear();
+
+  FloatImage level[2];
+  loadFloatImage(this, level[0], srgb);
+  int w = width(), h = height(), d = depth();
+  for(int i=1; w > 1 || h > 1 || d > 1; ++i)
+  {
+    w = w > 1 ? w / 2 : 1;
+    h = h > 1 ? h / 2 : h;
+    d = d > 1 ? d / 2 : d;
+    const FloatImage& src = level[(i-1) % 2];
+    FloatImage& dst = level[i % 2];
+    resampleFloatImage(src, dst, w, h ? h : 1, d ? d : src.mPlanes, dimension() == ID_3D, filter);
+    mMipmaps.push_back( storeFloatImage(dst, this, w, h, d, srgb) );
+  }
+
+  return true;
 }
 //-----------------------------------------------------------------------------
 fvec4 Image::sampleLinear(double x) const
@@ -1998,6 +3038,7 @@ fvec4 Image::sample(int x, int y, int z) const
     case IT_UNSIGNED_INT:   px += x*comp*4; break;
     case IT_INT:            px += x*comp*4; break;
     case IT_FLOAT:          px += x*comp*4; break;
+    case IT_HALF_FLOAT:     px += x*comp*2; break;
     default:
       break;
   }
@@ -2019,6 +3060,7 @@ fvec4 Image::sample(int x, int y, int z) const
       case IT_UNSIGNED_INT:   value = (double)((unsigned int*)px)[i]; value/=4294967295.0; break;
       case IT_INT:            value = (double)((int*)px)[i]; value/=2147483647.0; break;
       case IT_FLOAT:          value = (double)((float*)px)[i]; break;
+      case IT_HALF_FLOAT:     value = (double)((half*)px)[i]; break;
       default:
         break;
     }
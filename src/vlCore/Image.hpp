@@ -216,6 +216,7 @@ namespace vl
      * - IT_UNSIGNED_INT  
      * - IT_INT           
      * - IT_FLOAT
+     * - IT_HALF_FLOAT
      *
      * The source image format must be one of the following:
      * - IF_RGB
@@ -229,9 +230,21 @@ namespace vl
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
      * - IF_DEPTH_COMPONENT
+     *
+     * The values are normalized to 0..1 and clamped. The rows are converted in parallel using vl::defThreadPool() 
+     * and SIMD kernels are used for the most common conversions.
     */
     ref<Image> convertType(EImageType new_type) const;
 
+    /**
+     * Converts the \p type() of an image mapping the normalized source values between \p black and \p white to 0..1.
+     *
+     * This is equivalent to calling contrast(black, white) followed by convertType(new_type) but it does not modify 
+     * the source image and requires a single pass. Typically used to apply a window/level to IT_UNSIGNED_SHORT CT
+     * images while converting them to IT_UNSIGNED_BYTE. See convertType(EImageType) for the supported types and formats.
+    */
+    ref<Image> convertType(EImageType new_type, float black, float white) const;
+
     /**
      * Converts the \p format() of an image.
      *
@@ -243,6 +256,7 @@ namespace vl
      * - IT_UNSIGNED_INT  
      * - IT_INT           
      * - IT_FLOAT
+     * - IT_HALF_FLOAT
      *
      * The source image format and the new format must be one of the following:
      * - IF_RGB
@@ -258,10 +272,40 @@ namespace vl
      */
     ref<Image> convertFormat(EImageFormat new_format) const;
 
+    /**
+     * Returns a copy of the image resampled to the given size using the given \p filter.
+     *
+     * The image is filtered separably in floating point along each axis, downsampling widens the filter footprint 
+     * accordingly and the borders are clamped to the edge. The lines are processed in parallel using vl::defThreadPool() 
+     * and SSE2 is used for the inner loops. 1D images require \p height == 0 and \p depth == 0, 2D images and cubemaps 
+     * require \p depth == 0 and cubemap faces must be square.
+     *
+     * \param srgb If true the color components are converted to linear space before filtering and back to sRGB afterwards, 
+     * the alpha component is always filtered as is.
+     *
+     * If isNormalMap() is true the RGB vectors are renormalized after filtering, unsigned integer types are assumed to store 
+     * normals in the usual 0..1 = -1..+1 encoding.
+     *
+     * Supports the same types and formats of convertType(), returns NULL on failure.
+    */
+    ref<Image> resample(int width, int height, int depth, EImageResampleFilter filter=IRF_KAISER, bool srgb=false) const;
+
+    /**
+     * Generates the full mipmap chain of the image down to 1x1(x1) and stores it in mipmaps() replacing its previous content.
+     *
+     * Each level is downsampled from the floating point version of the previous level, halving each dimension and rounding down, 
+     * as expected by OpenGL. Supports 1D, 2D, 3D images and cubemaps; see resample() for the meaning of the parameters and the 
+     * supported types and formats. Texture uses the mipmaps() of an image when present, this allows to precompute them offline 
+     * or on a worker thread instead of stalling the rendering thread. Returns false on failure.
+    */
+    bool buildMipmaps(EImageResampleFilter filter=IRF_BOX, bool srgb=false);
+
     //! Equalizes the image. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
+    //! The lines are processed in parallel using vl::defThreadPool(), 8 and 16 bits images are remapped through a lookup table.
     bool equalize();
 
     //! Adjusts the contrast of an image. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
+    //! The lines are processed in parallel using vl::defThreadPool(), 8 and 16 bits images are remapped through a lookup table.
     bool contrast(float black, float white);
 
     //! Adjusts the contrast of an image using the window-center/window-with method used for CT images. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
@@ -306,6 +350,9 @@ namespace vl
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
      * - IF_DEPTH_COMPONENT
+     *
+     * This function dispatches on type() and format() for every call, use ConstImageView and ImageView 
+     * to access the pixels from the inner loops of image processing kernels.
      */
     fvec4 sample(int x, int y=0, int z=0) const;
 
@@ -32,13 +32,124 @@
 #ifndef ImageTools_INCLUDE_ONCE
 #define ImageTools_INCLUDE_ONCE
 
+#include <vlCore/config.hpp>
 #include <memory.h>
 
+#if VL_SSSE3
+  #include <tmmintrin.h>
+#elif VL_SSE2
+  #include <emmintrin.h>
+#endif
+
 namespace vl
 {
 //-----------------------------------------------------------------------------
   typedef unsigned char TPalette3x256[256*3];
   typedef unsigned char TPalette4x256[256*4];
+//-----------------------------------------------------------------------------
+// Row kernels
+//-----------------------------------------------------------------------------
+  //! Converts \p count RGB pixels to RGBA (or BGR to BGRA). \p src and \p dst must not overlap unless they are equal, 
+  //! in which case the buffer must be large enough to contain the RGBA pixels and the conversion is done in place.
+  inline void convertRowRGBToRGBA(const unsigned char* src, unsigned char* dst, int count, unsigned char alpha)
+  {
+    // processed backwards so that the conversion can be done in place
+    int i = count;
+#if VL_SSSE3
+    const __m128i shuffle = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+    const __m128i alpha_mask = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    // the last 4 pixels are left to the scalar loop since the 16 bytes load would read past the end of the row
+    int simd_end = (count - 2) / 4 * 4;
+    for(; i > simd_end; --i)
+    {
+      dst[(i-1)*4+3] = alpha;
+      dst[(i-1)*4+2] = src[(i-1)*3+2];
+      dst[(i-1)*4+1] = src[(i-1)*3+1];
+      dst[(i-1)*4+0] = src[(i-1)*3+0];
+    }
+    for(; i >= 4; i-=4)
+    {
+      __m128i rgb = _mm_loadu_si128((const __m128i*)(src + (i-4)*3));
+      _mm_storeu_si128((__m128i*)(dst + (i-4)*4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha_mask));
+    }
+#endif
+    for(; i > 0; --i)
+    {
+      dst[(i-1)*4+3] = alpha;
+      dst[(i-1)*4+2] = src[(i-1)*3+2];
+      dst[(i-1)*4+1] = src[(i-1)*3+1];
+      dst[(i-1)*4+0] = src[(i-1)*3+0];
+    }
+  }
+//-----------------------------------------------------------------------------
+  //! Converts \p count RGBA pixels to RGB (or BGRA to BGR). \p src and \p dst must not overlap unless they are equal.
+  inline void convertRowRGBAToRGB(const unsigned char* src, unsigned char* dst, int count)
+  {
+    int i = 0;
+#if VL_SSSE3
+    const __m128i shuffle = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    // the 16 bytes store writes 4 bytes past the 4 pixels: stop early enough not to write past the end of the row
+    for(; i+6 <= count; i+=4)
+    {
+      __m128i rgba = _mm_loadu_si128((const __m128i*)(src + i*4));
+      _mm_storeu_si128((__m128i*)(dst + i*3), _mm_shuffle_epi8(rgba, shuffle));
+    }
+#endif
+    for(; i<count; ++i)
+    {
+      dst[i*3+0] = src[i*4+0];
+      dst[i*3+1] = src[i*4+1];
+      dst[i*3+2] = src[i*4+2];
+    }
+  }
+//-----------------------------------------------------------------------------
+  //! Swaps the R and B components of \p count BGRA pixels (or RGBA pixels). \p src and \p dst can be equal.
+  inline void swapRowBGRA_RGBA(const unsigned char* src, unsigned char* dst, int count)
+  {
+    int i = 0;
+#if VL_SSE2
+    const __m128i ga_mask = _mm_set1_epi32((int)0xFF00FF00);
+    const __m128i rb_mask = _mm_set1_epi32(0x000000FF);
+    for(; i+4 <= count; i+=4)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(src + i*4));
+      __m128i ga = _mm_and_si128(px, ga_mask);
+      __m128i b  = _mm_and_si128(_mm_srli_epi32(px, 16), rb_mask);
+      __m128i r  = _mm_slli_epi32(_mm_and_si128(px, rb_mask), 16);
+      _mm_storeu_si128((__m128i*)(dst + i*4), _mm_or_si128(ga, _mm_or_si128(r, b)));
+    }
+#endif
+    for(; i<count; ++i)
+    {
+      unsigned char r = src[i*4+0];
+      dst[i*4+0] = src[i*4+2];
+      dst[i*4+1] = src[i*4+1];
+      dst[i*4+2] = r;
+      dst[i*4+3] = src[i*4+3];
+    }
+  }
+//-----------------------------------------------------------------------------
+  //! Swaps the R and B components of \p count BGR pixels (or RGB pixels). \p src and \p dst can be equal.
+  inline void swapRowBGR_RGB(const unsigned char* src, unsigned char* dst, int count)
+  {
+    int i = 0;
+#if VL_SSSE3
+    const __m128i shuffle = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 12,13,14,15);
+    // process 4 pixels at a time, the last 4 bytes loaded are stored back unchanged
+    for(; i+6 <= count; i+=4)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(src + i*3));
+      _mm_storeu_si128((__m128i*)(dst + i*3), _mm_shuffle_epi8(px, shuffle));
+    }
+#endif
+    for(; i<count; ++i)
+    {
+      unsigned char r = src[i*3+0];
+      dst[i*3+0] = src[i*3+2];
+      dst[i*3+1] = src[i*3+1];
+      dst[i*3+2] = r;
+    }
+  }
 //-----------------------------------------------------------------------------
   inline void convertRGBToRGBA(void* buf, int w, int h, unsigned char alpha, int bytealign = 1)
   {
@@ -66,17 +177,7 @@ namespace vl
       }
     }
 
-    unsigned char * px32 = (unsigned char*)buf + w * h * 4 - 4;
-    unsigned char * px24 = (unsigned char*)buf + w * h * 3 - 3;
-    for(int i=0; i<w * h; ++i)
-    {
-      px32[0] = px24[0];
-      px32[1] = px24[1];
-      px32[2] = px24[2];
-      px32[3] = alpha;
-      px24 -= 3;
-      px32 -= 4;
-    }
+    convertRowRGBToRGBA((unsigned char*)buf, (unsigned char*)buf, w * h, alpha);
   }
 //-----------------------------------------------------------------------------
   inline void convertGrayscaleToRGBA(void* buf, int size, unsigned char alpha)
@@ -210,27 +311,12 @@ namespace vl
 //-----------------------------------------------------------------------------
   inline void swapBytes32_BGRA_RGBA(void* buf, int bytecount)
   {
-    unsigned char* p = (unsigned char*)buf;
-    unsigned char dw[4];
-    for(int i=0; i<bytecount; i+=4, p+=4)
-    {
-      memcpy(dw, p, 4);
-      p[0] = dw[2];
-      p[2] = dw[0];
-    }
+    swapRowBGRA_RGBA((unsigned char*)buf, (unsigned char*)buf, bytecount / 4);
   }
 //-----------------------------------------------------------------------------
   inline void swapBytes24_BGR_RGB(void* buf, int bytecount)
   {
-    unsigned char* p = (unsigned char*)buf;
-    unsigned char dw[4];
-    int pxl = bytecount / 3;
-    for(int i=0; i<pxl; ++i, p+=3)
-    {
-      memcpy(dw, p, 3);
-      p[0] = dw[2];
-      p[2] = dw[0];
-    }
+    swapRowBGR_RGB((unsigned char*)buf, (unsigned char*)buf, bytecount / 3);
   }
 //-----------------------------------------------------------------------------
   inline void fillRGBA32_Alpha(void* buf, int bytecount, unsigned char alpha)
@@ -0,0 +1,183 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef ImageView_INCLUDE_ONCE
+#define ImageView_INCLUDE_ONCE
+
+#include <vlCore/Image.hpp>
+#include <vlCore/half.hpp>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // ImageComponent
+  //-----------------------------------------------------------------------------
+  /**
+   * Maps a C++ component type to its EImageType and to the value that Image::sample() maps to 1.0.
+   * Defined for unsigned char, GLbyte, unsigned short, short, unsigned int, int, float and half.
+  */
+  template<typename T> struct ImageComponent { };
+  template<> struct ImageComponent<unsigned char>  { static EImageType type() { return IT_UNSIGNED_BYTE;  } static double maxValue() { return 255.0; } };
+  template<> struct ImageComponent<GLbyte>         { static EImageType type() { return IT_BYTE;           } static double maxValue() { return 127.0; } };
+  template<> struct ImageComponent<unsigned short> { static EImageType type() { return IT_UNSIGNED_SHORT; } static double maxValue() { return 65535.0; } };
+  template<> struct ImageComponent<short>          { static EImageType type() { return IT_SHORT;          } static double maxValue() { return 32767.0; } };
+  template<> struct ImageComponent<unsigned int>   { static EImageType type() { return IT_UNSIGNED_INT;   } static double maxValue() { return 4294967295.0; } };
+  template<> struct ImageComponent<int>            { static EImageType type() { return IT_INT;            } static double maxValue() { return 2147483647.0; } };
+  template<> struct ImageComponent<float>          { static EImageType type() { return IT_FLOAT;          } static double maxValue() { return 1.0; } };
+  template<> struct ImageComponent<half>           { static EImageType type() { return IT_HALF_FLOAT;     } static double maxValue() { return 1.0; } };
+
+  //-----------------------------------------------------------------------------
+  // ConstImageView
+  //-----------------------------------------------------------------------------
+  /**
+   * A read-only typed view of the pixels of an Image whose type() stores \p T_Component values and whose format() has \p N components.
+   *
+   * Unlike Image::sample() the view does not dispatch on the type() and format() of the image for every access, the
+   * compatibility is checked once when the view is created and row() returns a plain typed pointer to the components,
+   * which makes it suitable for the inner loops of image and volume processing kernels. For example to read an 
+   * IF_LUMINANCE / IT_UNSIGNED_SHORT volume:
+   * \code
+   * ConstImageView<unsigned short, 1> view(img);
+   * if (view.isNull()) 
+   *   return; // incompatible image
+   * for(int z=0; z<view.depth(); ++z)
+   *   for(int y=0; y<view.height(); ++y)
+   *   {
+   *     const unsigned short* row = view.row(y, z);
+   *     for(int x=0; x<view.width(); ++x)
+   *       process(row[x]);
+   *   }
+   * \endcode
+   * 1D images have height() == 1, 1D and 2D images have depth() == 1 and cubemaps are seen as 6 slices, one per face.
+   * The view does not keep a reference to the image and becomes invalid if the image is reallocated.
+  */
+  template<typename T_Component, int N>
+  class ConstImageView
+  {
+  public:
+    typedef T_Component component_type;
+
+    ConstImageView(): mPixels(NULL), mWidth(0), mHeight(0), mDepth(0), mPitch(0) {}
+
+    ConstImageView(const Image* img) { reset(img); }
+
+    //! Points the view to the pixels of \p img, returns false and makes the view null if the image is not compatible.
+    bool reset(const Image* img)
+    {
+      mPixels = NULL;
+      mWidth = mHeight = mDepth = mPitch = 0;
+      if (!compatible(img))
+        return false;
+      mPixels = img->pixels();
+      mWidth  = img->width();
+      mHeight = img->height() ? img->height() : 1;
+      mDepth  = img->depth() ? img->depth() : img->isCubemap() ? 6 : 1;
+      mPitch  = img->pitch();
+      return true;
+    }
+
+    //! Returns true if the pixels of \p img can be accessed by this kind of view.
+    static bool compatible(const Image* img)
+    {
+      return img && img->pixels() && img->type() == ImageComponent<T_Component>::type() && 
+             Image::bitsPerPixel(img->type(), img->format()) == (int)sizeof(T_Component) * 8 * N;
+    }
+
+    bool isNull() const { return mPixels == NULL; }
+
+    //! The number of components per pixel.
+    static int components() { return N; }
+
+    int width() const { return mWidth; }
+
+    int height() const { return mHeight; }
+
+    int depth() const { return mDepth; }
+
+    //! The distance in bytes between two consecutive rows.
+    int pitch() const { return mPitch; }
+
+    //! The distance in components between two consecutive rows.
+    int rowStride() const { return mPitch / (int)sizeof(T_Component); }
+
+    //! The distance in components between two consecutive slices.
+    int sliceStride() const { return rowStride() * mHeight; }
+
+    //! The first component of the row \p y of the slice \p z.
+    const T_Component* row(int y, int z=0) const 
+    { 
+      VL_CHECK(y >= 0 && y < mHeight && z >= 0 && z < mDepth)
+      return (const T_Component*)(mPixels + (size_t)mPitch * (y + (size_t)mHeight * z)); 
+    }
+
+    //! The first component of the slice \p z.
+    const T_Component* slice(int z) const { return row(0, z); }
+
+    //! The first component of the pixel at \p x, \p y, \p z.
+    const T_Component* pixel(int x, int y, int z=0) const { return row(y, z) + x * N; }
+
+  protected:
+    const unsigned char* mPixels;
+    int mWidth;
+    int mHeight;
+    int mDepth;
+    int mPitch;
+  };
+
+  //-----------------------------------------------------------------------------
+  // ImageView
+  //-----------------------------------------------------------------------------
+  //! A writable typed view of the pixels of an Image, see ConstImageView for the details.
+  template<typename T_Component, int N>
+  class ImageView: public ConstImageView<T_Component, N>
+  {
+    typedef ConstImageView<T_Component, N> Base;
+
+  public:
+    ImageView() {}
+
+    ImageView(Image* img): Base(img) {}
+
+    bool reset(Image* img) { return Base::reset(img); }
+
+    //! The first component of the row \p y of the slice \p z.
+    T_Component* row(int y, int z=0) const { return const_cast<T_Component*>(Base::row(y, z)); }
+
+    //! The first component of the slice \p z.
+    T_Component* slice(int z) const { return row(0, z); }
+
+    //! The first component of the pixel at \p x, \p y, \p z.
+    T_Component* pixel(int x, int y, int z=0) const { return row(y, z) + x * N; }
+  };
+}
+
+#endif
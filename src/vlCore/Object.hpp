@@ -34,6 +34,7 @@
 
 #include <vlCore/checks.hpp>
 #include <vlCore/IMutex.hpp>
+#include <vlCore/Atomic.hpp>
 #include <vlCore/TypeInfo.hpp>
 #include <string>
 
@@ -51,6 +52,11 @@ namespace vl
   /**
    * The base class for all the reference counted objects.
    * See also vl::ref.
+   *
+   * When \p VL_ATOMIC_REF_COUNT is set to 1 (the default, see config.hpp) the reference count is updated
+   * using lock-free atomic operations, so that an Object can be safely referenced and released from
+   * multiple threads. Decrementing the count has release semantics and the thread that brings it to 0
+   * acquires all the writes performed by the other threads before deleting the Object.
   */
   class VLCORE_EXPORT Object
   {
@@ -60,6 +66,7 @@ namespace vl
     //! Constructor.
     Object()
     {
+      mObjectName = NULL;
       VL_DEBUG_SET_OBJECT_NAME()
       mRefCountMutex = NULL;
       mReferenceCount = 0;
@@ -78,7 +85,7 @@ namespace vl
     Object(const Object& other)
     {
       // copy the name, the ref count mutex and the user data.
-      mObjectName = other.mObjectName;
+      mObjectName = other.mObjectName ? new std::string(*other.mObjectName) : NULL;
       mRefCountMutex = other.mRefCountMutex;
       #if VL_OBJECT_USER_DATA
         mUserData = other.mUserData;
@@ -98,7 +105,8 @@ namespace vl
     Object& operator=(const Object& other) 
     { 
       // copy the name, the ref count mutex and the user data.
-      mObjectName = other.mObjectName;
+      if (this != &other)
+        setObjectName(other.mObjectName ? other.mObjectName->c_str() : NULL);
       mRefCountMutex = other.mRefCountMutex;
       #if VL_OBJECT_USER_DATA
         mUserData = other.mUserData;
@@ -110,11 +118,36 @@ namespace vl
       return *this;
     }
 
-    //! The name of the object, by default set to the object's class name.
-    const std::string& objectName() const { return mObjectName; }
+    //! The name of the object, by default set to the object's class name in debug builds.
+    //! Returns an empty string if no name has been set.
+    const std::string& objectName() const 
+    { 
+      if (mObjectName)
+        return *mObjectName;
+      static const std::string no_name;
+      return no_name;
+    }
+
+    //! The name of the object, by default set to the object's class name in debug builds.
+    //! The name storage is allocated only when a non empty name is set, passing NULL or "" releases it.
+    void setObjectName(const char* name) 
+    { 
+      if (name && name[0])
+      {
+        if (mObjectName)
+          *mObjectName = name;
+        else
+          mObjectName = new std::string(name);
+      }
+      else
+      {
+        delete mObjectName;
+        mObjectName = NULL;
+      }
+    }
 
     //! The name of the object, by default set to the object's class name in debug builds.
-    void setObjectName(const char* name) { mObjectName = name; }
+    void setObjectName(const std::string& name) { setObjectName(name.c_str()); }
 
     //! The mutex used to protect the reference counting of an Object across multiple threads.
     void setRefCountMutex(IMutex* mutex) { mRefCountMutex = mutex; }
@@ -128,12 +161,24 @@ namespace vl
     //! Returns the number of references of an object.
     int referenceCount() const 
     { 
+    #if VL_ATOMIC_REF_COUNT
+      return atomicLoad(&mReferenceCount);
+    #else
       return mReferenceCount; 
+    #endif
     }
 
     //! Increments the reference count of an object.
     void incReference() const
     {
+    #if VL_ATOMIC_REF_COUNT
+      if (!refCountMutex())
+      {
+        atomicIncrement(&mReferenceCount);
+        return;
+      }
+    #endif
+
       // Lock mutex
       if (refCountMutex())
         const_cast<IMutex*>(refCountMutex())->lock();
@@ -151,6 +196,18 @@ namespace vl
       // Save local copy in case of deletion.
       IMutex* mutex = mRefCountMutex;
 
+    #if VL_ATOMIC_REF_COUNT
+      if (!mutex)
+      {
+        VL_CHECK(referenceCount())
+        // The decrement is a full barrier: all the writes done by other threads before releasing
+        // their references are visible to the thread that deletes the object.
+        if (atomicDecrement(&mReferenceCount) == 0 && automaticDelete())
+          delete this;
+        return;
+      }
+    #endif
+
       // Lock mutex.
       if (mutex)
         mutex->lock();
@@ -191,10 +248,14 @@ namespace vl
 
   protected:
     virtual ~Object();
-    std::string mObjectName;
+    std::string* mObjectName;
 
     IMutex* mRefCountMutex;
+  #if VL_ATOMIC_REF_COUNT
+    mutable volatile int mReferenceCount;
+  #else
     mutable int mReferenceCount;
+  #endif
     bool mAutomaticDelete;
 
   // debugging facilities
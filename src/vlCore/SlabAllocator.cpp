@@ -0,0 +1,113 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/SlabAllocator.hpp>
+#include <vlCore/checks.hpp>
+#include <cstdlib>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// SlabAllocator
+//-----------------------------------------------------------------------------
+SlabAllocator::SlabAllocator(size_t block_size, int blocks_per_slab)
+{
+  VL_CHECK(blocks_per_slab > 0)
+  // blocks must be able to store the free list pointer and are kept 16 bytes aligned
+  if (block_size < sizeof(FreeBlock))
+    block_size = sizeof(FreeBlock);
+  mBlockSize = (block_size + 15) & ~(size_t)15;
+  mBlocksPerSlab = blocks_per_slab;
+  mFreeList = NULL;
+  mUsedBlocks = 0;
+  mLock = 0;
+}
+//-----------------------------------------------------------------------------
+SlabAllocator::~SlabAllocator()
+{
+  for(size_t i=0; i<mSlabs.size(); ++i)
+    free(mSlabs[i]);
+  mSlabs.clear();
+  mFreeList = NULL;
+}
+//-----------------------------------------------------------------------------
+void SlabAllocator::allocateSlab()
+{
+  // malloc() returns memory suitably aligned for any type, we round up the block size to 16 bytes
+  // and align the first block by hand to guarantee 16 bytes alignment of every block.
+  char* slab = (char*)malloc(mBlockSize * mBlocksPerSlab + 16);
+  if (!slab)
+    throw std::bad_alloc();
+  mSlabs.push_back(slab);
+  char* first = (char*)( ((size_t)slab + 15) & ~(size_t)15 );
+  for(int i=mBlocksPerSlab; i--; )
+  {
+    FreeBlock* block = (FreeBlock*)(first + mBlockSize * i);
+    block->mNext = mFreeList;
+    mFreeList = block;
+  }
+}
+//-----------------------------------------------------------------------------
+void* SlabAllocator::allocate()
+{
+  lock();
+  if (!mFreeList)
+  {
+    try
+    {
+      allocateSlab();
+    }
+    catch(...)
+    {
+      unlock();
+      throw;
+    }
+  }
+  FreeBlock* block = mFreeList;
+  mFreeList = block->mNext;
+  ++mUsedBlocks;
+  unlock();
+  return block;
+}
+//-----------------------------------------------------------------------------
+void SlabAllocator::deallocate(void* ptr)
+{
+  if (!ptr)
+    return;
+  FreeBlock* block = (FreeBlock*)ptr;
+  lock();
+  block->mNext = mFreeList;
+  mFreeList = block;
+  --mUsedBlocks;
+  VL_CHECK(mUsedBlocks >= 0)
+  unlock();
+}
+//-----------------------------------------------------------------------------
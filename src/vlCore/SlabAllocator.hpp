@@ -0,0 +1,127 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef SlabAllocator_INCLUDE_ONCE
+#define SlabAllocator_INCLUDE_ONCE
+
+#include <vlCore/Atomic.hpp>
+#include <vector>
+#include <cstddef>
+#include <new>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // SlabAllocator
+  //-----------------------------------------------------------------------------
+  /**
+   * A thread-safe fixed size block allocator that carves its blocks out of large slabs of memory.
+   * 
+   * Used via the VL_POOLED_ALLOCATION() macro to speed up the allocation of small, frequently created 
+   * objects such as Actor, Transform, Uniform and RenderToken and to reduce their memory footprint. 
+   * Released blocks are kept in a free list and recycled, slabs are returned to the system only when 
+   * the allocator is destroyed.
+  */
+  class VLCORE_EXPORT SlabAllocator
+  {
+  public:
+    //! Constructor.
+    //! \param block_size The size in bytes of the blocks returned by allocate().
+    //! \param blocks_per_slab The number of blocks allocated at once when the free list is empty.
+    SlabAllocator(size_t block_size, int blocks_per_slab=256);
+
+    ~SlabAllocator();
+
+    //! Returns a block of blockSize() bytes aligned to at least 16 bytes.
+    void* allocate();
+
+    //! Returns a block previously allocated with allocate() to the free list.
+    void deallocate(void* ptr);
+
+    //! The size in bytes of the blocks returned by allocate().
+    size_t blockSize() const { return mBlockSize; }
+
+    //! The number of blocks allocated at once when the free list is empty.
+    int blocksPerSlab() const { return mBlocksPerSlab; }
+
+    //! The number of blocks currently in use.
+    int usedBlocks() const { return atomicLoad(&mUsedBlocks); }
+
+    //! The number of slabs allocated so far.
+    int slabCount() const { return (int)mSlabs.size(); }
+
+  private:
+    SlabAllocator(const SlabAllocator&);
+    SlabAllocator& operator=(const SlabAllocator&);
+
+    void lock() { while(atomicCompareAndSwap(&mLock, 0, 1) != 0) {} }
+    void unlock() { atomicStore(&mLock, 0); }
+    void allocateSlab();
+
+  private:
+    struct FreeBlock { FreeBlock* mNext; };
+    std::vector<char*> mSlabs;
+    FreeBlock* mFreeList;
+    size_t mBlockSize;
+    int mBlocksPerSlab;
+    volatile int mUsedBlocks;
+    volatile int mLock;
+  };
+}
+
+/**
+ * Place this macro inside the declaration of a class derived from vl::Object to allocate its instances from 
+ * a per-class vl::SlabAllocator. Subclasses whose size differs from the size of \p ClassName fall back to
+ * the global operator new and delete. Objects are still released by vl::ref<> as usual.
+ * Enabled only if \p VL_OBJECT_POOLS is set to 1 in config.hpp.
+ */
+#if VL_OBJECT_POOLS
+  #define VL_POOLED_ALLOCATION(ClassName)                                                                                  \
+  public:                                                                                                                  \
+    /** The vl::SlabAllocator used to allocate instances of this class, never destroyed as objects can outlive it. */      \
+    static ::vl::SlabAllocator* slabAllocator() { static ::vl::SlabAllocator* allocator = new ::vl::SlabAllocator(sizeof(ClassName)); return allocator; } \
+    static void* operator new(size_t size)                                                                                 \
+    {                                                                                                                      \
+      return size == sizeof(ClassName) ? slabAllocator()->allocate() : ::operator new(size);                               \
+    }                                                                                                                      \
+    static void operator delete(void* ptr, size_t size)                                                                    \
+    {                                                                                                                      \
+      if (size == sizeof(ClassName))                                                                                       \
+        slabAllocator()->deallocate(ptr);                                                                                  \
+      else                                                                                                                 \
+        ::operator delete(ptr);                                                                                            \
+    }                                                                                                                      \
+  private:
+#else
+  #define VL_POOLED_ALLOCATION(ClassName)
+#endif
+
+#endif
@@ -0,0 +1,361 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/Atomic.hpp>
+#include <vlCore/checks.hpp>
+
+#if defined(VL_PLATFORM_WINDOWS)
+  #include <windows.h>
+  #include <process.h>
+#else
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// ThreadPool::Job
+//-----------------------------------------------------------------------------
+struct ThreadPool::Job
+{
+  ParallelForTask* mTask;
+  int mBegin;
+  int mEnd;
+  int mGrain;
+  volatile int mNext;
+  int mAsyncId;
+};
+//-----------------------------------------------------------------------------
+// ThreadPool::Platform
+//-----------------------------------------------------------------------------
+struct ThreadPool::Platform
+{
+#if defined(VL_PLATFORM_WINDOWS)
+  CRITICAL_SECTION mMutex;
+  CONDITION_VARIABLE mWakeWorkers;
+  CONDITION_VARIABLE mJobDone;
+
+  Platform()
+  {
+    InitializeCriticalSection(&mMutex);
+    InitializeConditionVariable(&mWakeWorkers);
+    InitializeConditionVariable(&mJobDone);
+  }
+  ~Platform() { DeleteCriticalSection(&mMutex); }
+  void lock() { EnterCriticalSection(&mMutex); }
+  void unlock() { LeaveCriticalSection(&mMutex); }
+  void waitWorkers() { SleepConditionVariableCS(&mWakeWorkers, &mMutex, INFINITE); }
+  void wakeWorkers() { WakeAllConditionVariable(&mWakeWorkers); }
+  void waitJobDone() { SleepConditionVariableCS(&mJobDone, &mMutex, INFINITE); }
+  void signalJobDone() { WakeAllConditionVariable(&mJobDone); }
+
+  struct StartInfo { ThreadPool* mPool; int mIndex; };
+  static unsigned __stdcall threadProc(void* arg)
+  {
+    StartInfo* info = (StartInfo*)arg;
+    ThreadPool* pool = info->mPool;
+    int index = info->mIndex;
+    delete info;
+    ThreadPool::workerMain(pool, index);
+    return 0;
+  }
+  static void* startThread(ThreadPool* pool, int index)
+  {
+    StartInfo* info = new StartInfo;
+    info->mPool = pool;
+    info->mIndex = index;
+    HANDLE handle = (HANDLE)_beginthreadex(NULL, 0, threadProc, info, 0, NULL);
+    if (!handle)
+      delete info;
+    return handle;
+  }
+  static void joinThread(void* handle)
+  {
+    WaitForSingleObject((HANDLE)handle, INFINITE);
+    CloseHandle((HANDLE)handle);
+  }
+#else
+  pthread_mutex_t mMutex;
+  pthread_cond_t mWakeWorkers;
+  pthread_cond_t mJobDone;
+
+  Platform()
+  {
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mWakeWorkers, NULL);
+    pthread_cond_init(&mJobDone, NULL);
+  }
+  ~Platform()
+  {
+    pthread_cond_destroy(&mJobDone);
+    pthread_cond_destroy(&mWakeWorkers);
+    pthread_mutex_destroy(&mMutex);
+  }
+  void lock() { pthread_mutex_lock(&mMutex); }
+  void unlock() { pthread_mutex_unlock(&mMutex); }
+  void waitWorkers() { pthread_cond_wait(&mWakeWorkers, &mMutex); }
+  void wakeWorkers() { pthread_cond_broadcast(&mWakeWorkers); }
+  void waitJobDone() { pthread_cond_wait(&mJobDone, &mMutex); }
+  void signalJobDone() { pthread_cond_broadcast(&mJobDone); }
+
+  struct StartInfo { ThreadPool* mPool; int mIndex; pthread_t mThread; };
+  static void* threadProc(void* arg)
+  {
+    StartInfo* info = (StartInfo*)arg;
+    ThreadPool::workerMain(info->mPool, info->mIndex);
+    return NULL;
+  }
+  static void* startThread(ThreadPool* pool, int index)
+  {
+    StartInfo* info = new StartInfo;
+    info->mPool = pool;
+    info->mIndex = index;
+    if (pthread_create(&info->mThread, NULL, threadProc, info) != 0)
+    {
+      delete info;
+      return NULL;
+    }
+    return info;
+  }
+  static void joinThread(void* handle)
+  {
+    StartInfo* info = (StartInfo*)handle;
+    pthread_join(info->mThread, NULL);
+    delete info;
+  }
+#endif
+};
+//-----------------------------------------------------------------------------
+// ThreadPool
+//-----------------------------------------------------------------------------
+ThreadPool::ThreadPool(int thread_count)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mPlatform = new Platform;
+  mJob = NULL;
+  mAsyncJob = new Job;
+  mBusy = 0;
+  mAsyncCount = 0;
+  mAsyncCompleted = 0;
+  mGeneration = 0;
+  mPendingWorkers = 0;
+  mQuit = false;
+
+  if (thread_count <= 0)
+    thread_count = hardwareConcurrency();
+
+  for(int i=1; i<thread_count; ++i)
+  {
+    void* thread = Platform::startThread(this, i);
+    if (!thread)
+      break;
+    mThreads.push_back(thread);
+  }
+}
+//-----------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+  mPlatform->lock();
+  // let a pending asynchronous job complete
+  while(mJob)
+    mPlatform->waitJobDone();
+  mQuit = true;
+  mPlatform->wakeWorkers();
+  mPlatform->unlock();
+
+  for(size_t i=0; i<mThreads.size(); ++i)
+    Platform::joinThread(mThreads[i]);
+  mThreads.clear();
+
+  delete mPlatform;
+  mPlatform = NULL;
+  delete mAsyncJob;
+  mAsyncJob = NULL;
+}
+//-----------------------------------------------------------------------------
+int ThreadPool::hardwareConcurrency()
+{
+#if defined(VL_PLATFORM_WINDOWS)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+#endif
+}
+//-----------------------------------------------------------------------------
+void ThreadPool::processJob(Job* job, int thread_index)
+{
+  for(;;)
+  {
+    int begin = atomicFetchAdd(&job->mNext, job->mGrain);
+    if (begin >= job->mEnd)
+      break;
+    int end = begin + job->mGrain;
+    if (end > job->mEnd || end < begin /*overflow*/)
+      end = job->mEnd;
+    job->mTask->run(begin, end, thread_index);
+  }
+}
+//-----------------------------------------------------------------------------
+void ThreadPool::workerMain(ThreadPool* pool, int thread_index)
+{
+  Platform* platform = pool->mPlatform;
+  int generation = 0;
+  platform->lock();
+  for(;;)
+  {
+    while(!pool->mQuit && pool->mGeneration == generation)
+      platform->waitWorkers();
+    if (pool->mQuit)
+      break;
+    generation = pool->mGeneration;
+    Job* job = pool->mJob;
+    platform->unlock();
+
+    processJob(job, thread_index);
+
+    platform->lock();
+    if (--pool->mPendingWorkers == 0)
+    {
+      // asynchronous jobs are retired by the last worker since nobody is waiting for them in parallelFor()
+      if (job == pool->mAsyncJob)
+      {
+        pool->mAsyncCompleted = job->mAsyncId;
+        pool->mJob = NULL;
+        atomicStore(&pool->mBusy, 0);
+      }
+      platform->signalJobDone();
+    }
+  }
+  platform->unlock();
+}
+//-----------------------------------------------------------------------------
+void ThreadPool::parallelFor(int begin, int end, ParallelForTask* task, int grain_size)
+{
+  VL_CHECK(task)
+  if (end <= begin)
+    return;
+  if (grain_size < 1)
+    grain_size = 1;
+
+  // run serially if there are no workers, if there is not enough work or if a job is already in progress
+  if (mThreads.empty() || end - begin <= grain_size || atomicCompareAndSwap(&mBusy, 0, 1) != 0)
+  {
+    task->run(begin, end, 0);
+    return;
+  }
+
+  Job job;
+  job.mTask  = task;
+  job.mBegin = begin;
+  job.mEnd   = end;
+  job.mGrain = grain_size;
+  job.mNext  = begin;
+  job.mAsyncId = 0;
+
+  // wake up the workers
+  mPlatform->lock();
+  mJob = &job;
+  mPendingWorkers = (int)mThreads.size();
+  ++mGeneration;
+  mPlatform->wakeWorkers();
+  mPlatform->unlock();
+
+  // the calling thread participates as thread #0
+  processJob(&job, 0);
+
+  // wait for all the workers to be done with the job
+  mPlatform->lock();
+  while(mPendingWorkers)
+    mPlatform->waitJobDone();
+  mJob = NULL;
+  mPlatform->unlock();
+
+  atomicStore(&mBusy, 0);
+}
+//-----------------------------------------------------------------------------
+int ThreadPool::parallelForAsync(int begin, int end, ParallelForTask* task, int grain_size)
+{
+  VL_CHECK(task)
+  if (end <= begin || mThreads.empty() || atomicCompareAndSwap(&mBusy, 0, 1) != 0)
+    return 0;
+
+  mPlatform->lock();
+  mAsyncJob->mTask  = task;
+  mAsyncJob->mBegin = begin;
+  mAsyncJob->mEnd   = end;
+  mAsyncJob->mGrain = grain_size < 1 ? 1 : grain_size;
+  mAsyncJob->mNext  = begin;
+  mAsyncJob->mAsyncId = ++mAsyncCount;
+  mJob = mAsyncJob;
+  mPendingWorkers = (int)mThreads.size();
+  ++mGeneration;
+  mPlatform->wakeWorkers();
+  mPlatform->unlock();
+
+  return mAsyncJob->mAsyncId;
+}
+//-----------------------------------------------------------------------------
+bool ThreadPool::asyncDone(int id)
+{
+  mPlatform->lock();
+  bool done = id <= mAsyncCompleted;
+  mPlatform->unlock();
+  return done;
+}
+//-----------------------------------------------------------------------------
+void ThreadPool::waitAsync(int id)
+{
+  mPlatform->lock();
+  while(id > mAsyncCompleted)
+    mPlatform->waitJobDone();
+  mPlatform->unlock();
+}
+//-----------------------------------------------------------------------------
+void vl::parallelFor(int begin, int end, ParallelForTask* task, int grain_size)
+{
+  ThreadPool* pool = defThreadPool();
+  if (pool)
+    pool->parallelFor(begin, end, task, grain_size);
+  else
+  if (end > begin)
+    task->run(begin, end, 0);
+}
+//-----------------------------------------------------------------------------
+int vl::parallelThreadCount()
+{
+  return defThreadPool() ? defThreadPool()->threadCount() : 1;
+}
+//-----------------------------------------------------------------------------
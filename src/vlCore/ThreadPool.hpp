@@ -0,0 +1,142 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef ThreadPool_INCLUDE_ONCE
+#define ThreadPool_INCLUDE_ONCE
+
+#include <vlCore/Object.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // ParallelForTask
+  //-----------------------------------------------------------------------------
+  /**
+   * The interface of the tasks executed by ThreadPool::parallelFor().
+   * The run() method is called concurrently by several threads on disjoint ranges.
+  */
+  class ParallelForTask
+  {
+  public:
+    virtual ~ParallelForTask() {}
+
+    //! Processes the items in the range [\p begin, \p end).
+    //! \p thread_index is in the range [0, ThreadPool::threadCount()) and can be used to index per-thread data.
+    virtual void run(int begin, int end, int thread_index) = 0;
+  };
+  //-----------------------------------------------------------------------------
+  // ThreadPool
+  //-----------------------------------------------------------------------------
+  /**
+   * A minimal pool of worker threads used by VL to parallelize CPU intensive computations such as
+   * volume processing, image conversion, tessellation and culling.
+   *
+   * The calling thread always participates to the computation as thread #0, so a ThreadPool with 
+   * threadCount() == 1 has no worker threads and runs everything serially.
+   * A parallelFor() issued while another one is in progress, for example from within a task, is executed 
+   * serially by the calling thread.
+   *
+   * parallelForAsync() hands a job to the worker threads and returns immediately, which is useful to overlap
+   * work needed by the next frame with the rendering of the current one.
+   *
+   * \sa defThreadPool(), parallelFor(), ParallelForTask
+  */
+  class VLCORE_EXPORT ThreadPool: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::ThreadPool, Object)
+
+  public:
+    //! Constructor.
+    //! \param thread_count The number of threads to use including the calling thread, if <= 0 hardwareConcurrency() is used.
+    ThreadPool(int thread_count=0);
+
+    ~ThreadPool();
+
+    //! The number of threads used by parallelFor() including the calling thread.
+    int threadCount() const { return (int)mThreads.size() + 1; }
+
+    //! Calls \p task->run() on consecutive chunks of at least \p grain_size items, partitioning the range [\p begin, \p end) 
+    //! among all the threads. Returns when all the items have been processed.
+    void parallelFor(int begin, int end, ParallelForTask* task, int grain_size=1);
+
+    //! Like parallelFor() but the range is processed by the worker threads only and the function returns immediately.
+    //! Returns an id to be passed to asyncDone() and waitAsync() or 0 if the job could not be started because
+    //! the pool has no worker threads or is busy, in which case the caller should run the task by itself.
+    //! \p task must stay valid until the job is done. While the job runs any other parallelFor() is executed serially.
+    int parallelForAsync(int begin, int end, ParallelForTask* task, int grain_size=1);
+
+    //! Returns true if the job started by parallelForAsync() with the given \p id has been completed.
+    bool asyncDone(int id);
+
+    //! Waits for the job started by parallelForAsync() with the given \p id to be completed.
+    void waitAsync(int id);
+
+    //! Returns the number of hardware threads available on the system.
+    static int hardwareConcurrency();
+
+  private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    struct Job;
+    struct Platform;
+    static void workerMain(ThreadPool* pool, int thread_index);
+    static void processJob(Job* job, int thread_index);
+    friend struct Platform;
+
+  private:
+    Platform* mPlatform;
+    std::vector<void*> mThreads;
+    Job* mJob;
+    Job* mAsyncJob;
+    volatile int mBusy;
+    int mAsyncCount;
+    int mAsyncCompleted;
+    int mGeneration;
+    int mPendingWorkers;
+    bool mQuit;
+  };
+
+  //! Returns the default ThreadPool used by VL, NULL if VisualizationLibrary::initCore() has not been called.
+  VLCORE_EXPORT ThreadPool* defThreadPool();
+
+  //! Sets the default ThreadPool used by VL, set it to NULL to disable multithreading.
+  VLCORE_EXPORT void setDefThreadPool(ThreadPool* pool);
+
+  //! Executes \p task on the range [\p begin, \p end) using defThreadPool() or serially in the calling thread if defThreadPool() is NULL.
+  VLCORE_EXPORT void parallelFor(int begin, int end, ParallelForTask* task, int grain_size=1);
+
+  //! The number of threads used by vl::parallelFor(), i.e. defThreadPool()->threadCount() or 1 if defThreadPool() is NULL.
+  VLCORE_EXPORT int parallelThreadCount();
+}
+
+#endif
@@ -34,6 +34,7 @@
 
 #include <vlCore/vlnamespace.hpp>
 #include <vlCore/Object.hpp>
+#include <vlCore/SlabAllocator.hpp>
 #include <vlCore/Matrix4.hpp>
 #include <vector>
 #include <set>
@@ -72,6 +73,7 @@ namespace vl
   class VLCORE_EXPORT Transform: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Transform, Object)
+    VL_POOLED_ALLOCATION(vl::Transform)
 
   public:
     /** Constructor. */
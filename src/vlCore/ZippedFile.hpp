@@ -202,8 +202,8 @@ namespace vl
   };
   //---------------------------------------------------------------------------
   // utilty functions
-  bool compress(const void* data, size_t size, std::vector<unsigned char>& out, int level);
-  bool decompress(const void* cdata, size_t csize, void* data_out);
+  VLCORE_EXPORT bool compress(const void* data, size_t size, std::vector<unsigned char>& out, int level);
+  VLCORE_EXPORT bool decompress(const void* cdata, size_t csize, void* data_out);
   //---------------------------------------------------------------------------
 }
 
@@ -205,12 +205,36 @@
 #define VL_DEFAULT_BUFFER_BYTE_ALIGNMENT 16
 
 
+/**
+ * Enables lock-free atomic reference counting for vl::Object.
+ *
+ * - 1 = Object::incReference() and Object::decReference() use lock-free atomic operations, see vl::atomicIncrement()
+ * - 0 = the reference count is a plain integer, protected only by the optional Object::setRefCountMutex()
+ *
+ * Atomic reference counting allows Geometry, Effect, Image etc. to be safely shared across threads 
+ * at the cost of a locked increment/decrement for every ref<> copy. If a ref count mutex is installed 
+ * via Object::setRefCountMutex() it is used instead of the atomic operations.
+ * The atomic operations are provided for MSVC and GCC 4.1+ compatible compilers, vlCore/Atomic.hpp stops the
+ * compilation with an error on other compilers.
+ */
+#define VL_ATOMIC_REF_COUNT 1
+
+
+/**
+ * Enables pooled allocation of small, frequently allocated objects.
+ *
+ * - 1 = Actor, Transform, Uniform and RenderToken are allocated from per-class vl::SlabAllocator-s, see VL_POOLED_ALLOCATION()
+ * - 0 = all objects are allocated using the global operator new
+ */
+#define VL_OBJECT_POOLS 1
+
+
 // -------------------- Do Not Touch The Following Section --------------------
 
 ///////////////////////////////////////////////////
 
 #ifndef NDEBUG
-  #define VL_DEBUG_SET_OBJECT_NAME() this->mObjectName = className();
+  #define VL_DEBUG_SET_OBJECT_NAME() this->setObjectName(className());
 #else
   #define VL_DEBUG_SET_OBJECT_NAME()
 #endif
@@ -235,6 +259,27 @@
 
 ///////////////////////////////////////////////////
 
+// SSE2 availability, used to enable the SIMD code paths
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define VL_SSE2 1
+#else
+  #define VL_SSE2 0
+#endif
+
+// SSSE3 and F16C availability, used by the image conversion kernels
+#if defined(__SSSE3__) || defined(__AVX__)
+  #define VL_SSSE3 1
+#else
+  #define VL_SSSE3 0
+#endif
+#if defined(__F16C__) || defined(__AVX2__)
+  #define VL_F16C 1
+#else
+  #define VL_F16C 0
+#endif
+
+///////////////////////////////////////////////////
+
 // Visual Studio special settings
 #ifdef _MSC_VER
   #pragma warning( once : 4996 ) // function or variable may be unsafe
@@ -42,6 +42,7 @@
 #include <vlCore/Sphere.hpp>
 #include <vlCore/version.hpp>
 #include <vlCore/MersenneTwister.hpp>
+#include <vlCore/ThreadPool.hpp>
 #include <cassert>
 
 using namespace vl;
@@ -186,6 +187,21 @@ void vl::setDefMersenneTwister(MersenneTwister* reg)
 {
   gDefaultMersenneTwister= reg;
 }
+//-----------------------------------------------------------------------------
+// Default ThreadPool
+//-----------------------------------------------------------------------------
+namespace 
+{
+  ref<ThreadPool> gDefaultThreadPool = NULL;
+}
+ThreadPool* vl::defThreadPool()
+{
+  return gDefaultThreadPool.get();
+}
+void vl::setDefThreadPool(ThreadPool* pool)
+{
+  gDefaultThreadPool = pool;
+}
 //------------------------------------------------------------------------------
 void VisualizationLibrary::initCore(bool log_info)
 {
@@ -218,6 +234,9 @@ void VisualizationLibrary::initCore(bool log_info)
 
   // Install default MersenneTwister (seed done automatically)
   gDefaultMersenneTwister = new MersenneTwister;
+
+  // Install default ThreadPool (one thread per hardware thread)
+  gDefaultThreadPool = new ThreadPool;
   
   // Register 2D modules
   #if defined(VL_IO_2D_JPG)
@@ -260,6 +279,9 @@ void VisualizationLibrary::shutdownCore()
 
   // --- Dispose Core ---
 
+  // Dispose default ThreadPool
+  gDefaultThreadPool = NULL;
+
   // Dispose default MersenneTwister
   gDefaultMersenneTwister = NULL;
   
@@ -593,6 +593,7 @@ namespace vl
     IT_UNSIGNED_INT   = GL_UNSIGNED_INT,
     IT_INT            = GL_INT,
     IT_FLOAT          = GL_FLOAT,
+    IT_HALF_FLOAT     = 0x140B, /* GL_HALF_FLOAT, not defined by all the OpenGL ES headers */
     IT_UNSIGNED_BYTE_3_3_2         = GL_UNSIGNED_BYTE_3_3_2,
     IT_UNSIGNED_BYTE_2_3_3_REV     = GL_UNSIGNED_BYTE_2_3_3_REV,
     IT_UNSIGNED_SHORT_5_6_5        = GL_UNSIGNED_SHORT_5_6_5,
@@ -613,6 +614,15 @@ namespace vl
 
   } EImageType;
 
+  //! Filters used by Image::resample() and Image::buildMipmaps()
+  typedef enum
+  {
+    IRF_BOX,      //!< Box filter, i.e. the average of the covered texels, the fastest and most common choice for mipmaps.
+    IRF_TRIANGLE, //!< Tent filter, i.e. bilinear interpolation when magnifying.
+    IRF_KAISER,   //!< Kaiser windowed sinc filter of radius 3, sharp with little ringing.
+    IRF_LANCZOS   //!< Lanczos windowed sinc filter of radius 3, the sharpest but with some ringing.
+  } EImageResampleFilter;
+
   typedef enum
   {
     PT_POINTS         = GL_POINTS,
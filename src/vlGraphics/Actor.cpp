@@ -30,6 +30,7 @@
 /**************************************************************************************/
 
 #include <vlGraphics/Actor.hpp>
+#include <vlGraphics/ActorBoundsTable.hpp>
 
 using namespace vl;
 
@@ -113,6 +114,22 @@ void Actor::computeBounds()
     mSphere = mAABB.isNull() ? Sphere() : mAABB;
     mBoundsUpdateTick = lod(0)->boundsUpdateTick();
   }
+
+  // keep the structure-of-arrays copy up to date
+  if (mBoundsTable)
+    mBoundsTable->setBounds(mBoundsTableSlot, mAABB, mTransformUpdateTick, mBoundsUpdateTick);
+}
+//-----------------------------------------------------------------------------
+void Actor::updateBoundsTableSlot()
+{
+  VL_CHECK(mBoundsTable)
+  mBoundsTable->updateSlot(mBoundsTableSlot);
+}
+//-----------------------------------------------------------------------------
+void Actor::updateBoundsTableEnableMask()
+{
+  VL_CHECK(mBoundsTable)
+  mBoundsTable->setEnableMask(mBoundsTableSlot, mEnableMask);
 }
 //-----------------------------------------------------------------------------
 void Actor::setUniform(Uniform* uniform) { gocUniformSet()->setUniform(uniform); }
@@ -45,6 +45,8 @@
 
 namespace vl
 {
+  class ActorBoundsTable;
+
   //------------------------------------------------------------------------------
   // ActorEventCallback
   //------------------------------------------------------------------------------
@@ -131,6 +133,9 @@ namespace vl
   class VLGRAPHICS_EXPORT Actor: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Actor, Object)
+    VL_POOLED_ALLOCATION(vl::Actor)
+
+    friend class ActorBoundsTable;
 
   public:
     /** Constructor.
@@ -142,7 +147,8 @@ namespace vl
     */
     Actor(Renderable* renderable = NULL, Effect* effect = NULL, Transform* transform = NULL, int block = 0, int rank = 0):
       mEffect(effect), mTransform(transform), mRenderBlock(block), mRenderRank(rank),
-      mTransformUpdateTick(-1), mBoundsUpdateTick(-1), mEnableMask(0xFFFFFFFF), mOcclusionQuery(0), mOcclusionQueryTick(0xFFFFFFFF), mIsOccludee(true)
+      mTransformUpdateTick(-1), mBoundsUpdateTick(-1), mEnableMask(0xFFFFFFFF), mOcclusionQuery(0), mOcclusionQueryTick(0xFFFFFFFF), mIsOccludee(true),
+      mBoundsTable(NULL), mBoundsTableSlot(-1)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mActorEventCallbacks.setAutomaticDelete(false);
@@ -167,6 +173,8 @@ namespace vl
         mBoundsUpdateTick = -1;
         mAABB.setNull();
         mSphere.setNull();
+        if (mBoundsTable)
+          updateBoundsTableSlot();
       }
     }
 
@@ -185,6 +193,8 @@ namespace vl
       mTransform = transform;
       mTransformUpdateTick = -1;
       mBoundsUpdateTick    = -1;
+      if (mBoundsTable)
+        updateBoundsTableSlot();
     }
     
     /** Returns the Transform bound tho an Actor */
@@ -263,7 +273,7 @@ namespace vl
     /** The enable mask of an Actor is usually used to defines whether the actor should be rendered or not 
       * depending on the Rendering::enableMask() but it can also be used for user-specific tasks (set to 0xFFFFFFFF by default).
       * See also vl::Rendering::effectOverrideMask() and vl::Renderer::shaderOverrideMask(). */
-    void setEnableMask(unsigned int mask) { mEnableMask = mask; }
+    void setEnableMask(unsigned int mask) { mEnableMask = mask; if (mBoundsTable) updateBoundsTableEnableMask(); }
 
     /** The enable mask of an Actor is usually used to defines whether the actor should be rendered or not 
       * depending on the Rendering::enableMask() but it can also be used for user-specific tasks (set to 0xFFFFFFFF by default).
@@ -438,6 +448,16 @@ namespace vl
     /** For internal use only. */
     unsigned occlusionQueryTick() const { return mOcclusionQueryTick; }
 
+    /** The ActorBoundsTable this Actor is registered into, if any. */
+    const ActorBoundsTable* boundsTable() const { return mBoundsTable; }
+
+    /** The slot of this Actor in its ActorBoundsTable or -1. */
+    int boundsTableSlot() const { return mBoundsTableSlot; }
+
+  protected:
+    void updateBoundsTableSlot();
+    void updateBoundsTableEnableMask();
+
 #if VL_ACTOR_USER_DATA
   public:
     void* actorUserData() { return mActorUserData; }
@@ -466,6 +486,8 @@ namespace vl
     GLuint mOcclusionQuery;
     unsigned mOcclusionQueryTick;
     bool mIsOccludee;
+    ActorBoundsTable* mBoundsTable;
+    int mBoundsTableSlot;
   };
   //---------------------------------------------------------------------------
   /** Defined as a simple subclass of Collection<Actor>, see Collection for more information. */
@@ -0,0 +1,319 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/ActorBoundsTable.hpp>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// ActorBoundsTable
+//-----------------------------------------------------------------------------
+ActorBoundsTable::~ActorBoundsTable()
+{
+  clear();
+}
+//-----------------------------------------------------------------------------
+int ActorBoundsTable::addActor(Actor* actor)
+{
+  VL_CHECK(actor)
+  if (actor->mBoundsTable)
+    return actor->mBoundsTable == this ? actor->mBoundsTableSlot : -1;
+
+  int slot = size();
+  mActors.push_back(actor);
+  mTransforms.push_back(NULL);
+  mRenderables.push_back(NULL);
+  mTransformTick.push_back(-1);
+  mBoundsTick.push_back(-1);
+  mCenterX.push_back(0);
+  mCenterY.push_back(0);
+  mCenterZ.push_back(0);
+  mExtentX.push_back(0);
+  mExtentY.push_back(0);
+  mExtentZ.push_back(0);
+  mRadius.push_back(-1);
+  mEnableMask.push_back(actor->enableMask());
+
+  actor->mBoundsTable = this;
+  actor->mBoundsTableSlot = slot;
+  updateSlot(slot);
+  return slot;
+}
+//-----------------------------------------------------------------------------
+bool ActorBoundsTable::eraseActor(Actor* actor)
+{
+  if (!actor || actor->mBoundsTable != this)
+    return false;
+
+  int slot = actor->mBoundsTableSlot;
+  int last = size() - 1;
+  VL_CHECK(mActors[slot] == actor)
+
+  // move the last slot in place of the erased one
+  if (slot != last)
+  {
+    mActors[slot]        = mActors[last];
+    mTransforms[slot]    = mTransforms[last];
+    mRenderables[slot]   = mRenderables[last];
+    mTransformTick[slot] = mTransformTick[last];
+    mBoundsTick[slot]    = mBoundsTick[last];
+    mCenterX[slot]       = mCenterX[last];
+    mCenterY[slot]       = mCenterY[last];
+    mCenterZ[slot]       = mCenterZ[last];
+    mExtentX[slot]       = mExtentX[last];
+    mExtentY[slot]       = mExtentY[last];
+    mExtentZ[slot]       = mExtentZ[last];
+    mRadius[slot]        = mRadius[last];
+    mEnableMask[slot]    = mEnableMask[last];
+    mActors[slot]->mBoundsTableSlot = slot;
+  }
+
+  actor->mBoundsTable = NULL;
+  actor->mBoundsTableSlot = -1;
+
+  mActors.pop_back();
+  mTransforms.pop_back();
+  mRenderables.pop_back();
+  mTransformTick.pop_back();
+  mBoundsTick.pop_back();
+  mCenterX.pop_back();
+  mCenterY.pop_back();
+  mCenterZ.pop_back();
+  mExtentX.pop_back();
+  mExtentY.pop_back();
+  mExtentZ.pop_back();
+  mRadius.pop_back();
+  mEnableMask.pop_back();
+  return true;
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::clear()
+{
+  for(size_t i=0; i<mActors.size(); ++i)
+  {
+    mActors[i]->mBoundsTable = NULL;
+    mActors[i]->mBoundsTableSlot = -1;
+  }
+  mActors.clear();
+  mTransforms.clear();
+  mRenderables.clear();
+  mTransformTick.clear();
+  mBoundsTick.clear();
+  mCenterX.clear();
+  mCenterY.clear();
+  mCenterZ.clear();
+  mExtentX.clear();
+  mExtentY.clear();
+  mExtentZ.clear();
+  mRadius.clear();
+  mEnableMask.clear();
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::updateSlot(int slot)
+{
+  Actor* act = mActors[slot].get();
+  mTransforms[slot]  = act->transform();
+  mRenderables[slot] = act->lod(0);
+  // force the recomputation of the bounds
+  mTransformTick[slot] = -1;
+  mBoundsTick[slot] = -1;
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::setBounds(int slot, const AABB& aabb, long long transform_tick, long long bounds_tick)
+{
+  mTransformTick[slot] = transform_tick;
+  mBoundsTick[slot] = bounds_tick;
+  if (aabb.isNull())
+  {
+    mCenterX[slot] = mCenterY[slot] = mCenterZ[slot] = 0;
+    mExtentX[slot] = mExtentY[slot] = mExtentZ[slot] = 0;
+    mRadius[slot] = -1;
+  }
+  else
+  {
+    vec3 c = aabb.center();
+    vec3 e = (aabb.maxCorner() - aabb.minCorner()) * (real)0.5;
+    mCenterX[slot] = c.x();
+    mCenterY[slot] = c.y();
+    mCenterZ[slot] = c.z();
+    mExtentX[slot] = e.x();
+    mExtentY[slot] = e.y();
+    mExtentZ[slot] = e.z();
+    mRadius[slot] = e.length();
+  }
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::updateBounds()
+{
+  const int count = size();
+  for(int i=0; i<count; ++i)
+  {
+    const Renderable* ren = mRenderables[i];
+    if (!ren)
+      continue;
+    const Transform* tr = mTransforms[i];
+    bool dirty = ren->boundsDirty() || ren->boundsUpdateTick() != mBoundsTick[i] || (tr && tr->worldMatrixUpdateTick() != mTransformTick[i]);
+    // Actor::computeBounds() writes the new bounds and ticks back into the slot.
+    if (dirty)
+      mActors[i]->computeBounds();
+  }
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::cull(std::vector<int>& slots, const Frustum& frustum, unsigned int enable_mask) const
+{
+  // copy the planes into local arrays to keep them in registers/L1
+  const int plane_count = (int)frustum.planes().size();
+  real nx[16], ny[16], nz[16], ax[16], ay[16], az[16], d[16];
+  VL_CHECK(plane_count <= 16)
+  for(int p=0; p<plane_count && p<16; ++p)
+  {
+    const Plane& plane = frustum.plane(p);
+    nx[p] = plane.normal().x(); ax[p] = ::fabs(nx[p]);
+    ny[p] = plane.normal().y(); ay[p] = ::fabs(ny[p]);
+    nz[p] = plane.normal().z(); az[p] = ::fabs(nz[p]);
+    d[p]  = plane.origin();
+  }
+
+  const int count = size();
+  const real* cx = count ? &mCenterX[0] : NULL;
+  const real* cy = count ? &mCenterY[0] : NULL;
+  const real* cz = count ? &mCenterZ[0] : NULL;
+  const real* ex = count ? &mExtentX[0] : NULL;
+  const real* ey = count ? &mExtentY[0] : NULL;
+  const real* ez = count ? &mExtentZ[0] : NULL;
+  const real* r  = count ? &mRadius[0]  : NULL;
+  const unsigned int* mask = count ? &mEnableMask[0] : NULL;
+
+  for(int i=0; i<count; ++i)
+  {
+    if ( !(mask[i] & enable_mask) )
+      continue;
+    // null bounds are always visible
+    bool visible = true;
+    if (r[i] >= 0)
+    {
+      for(int p=0; p<plane_count; ++p)
+      {
+        // signed distance of the box center minus the projected half extent, equivalent to Frustum::cull(const AABB&)
+        real dist = nx[p]*cx[i] + ny[p]*cy[i] + nz[p]*cz[i] - d[p];
+        real proj = ax[p]*ex[i] + ay[p]*ey[i] + az[p]*ez[i];
+        if (dist - proj >= 0)
+        {
+          visible = false;
+          break;
+        }
+      }
+    }
+    if (visible)
+      slots.push_back(i);
+  }
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::extractVisibleActors(ActorCollection& list, const Frustum& frustum, unsigned int enable_mask) const
+{
+  std::vector<int> slots;
+  slots.reserve(size());
+  cull(slots, frustum, enable_mask);
+  for(size_t i=0; i<slots.size(); ++i)
+    list.push_back( const_cast<Actor*>(mActors[slots[i]].get()) );
+}
+//-----------------------------------------------------------------------------
+void ActorBoundsTable::computeBounds(AABB& aabb, Sphere& sphere) const
+{
+  aabb.setNull();
+  sphere.setNull();
+  const int count = size();
+  bool found = false;
+  vec3 minc, maxc;
+  for(int i=0; i<count; ++i)
+  {
+    if (mRadius[i] < 0)
+      continue;
+    vec3 lo(mCenterX[i]-mExtentX[i], mCenterY[i]-mExtentY[i], mCenterZ[i]-mExtentZ[i]);
+    vec3 hi(mCenterX[i]+mExtentX[i], mCenterY[i]+mExtentY[i], mCenterZ[i]+mExtentZ[i]);
+    if (!found)
+    {
+      minc = lo;
+      maxc = hi;
+      found = true;
+    }
+    else
+    {
+      minc = min(minc, lo);
+      maxc = max(maxc, hi);
+    }
+  }
+  if (!found)
+    return;
+  aabb.setMinCorner(minc);
+  aabb.setMaxCorner(maxc);
+
+  // same strategy as SceneManager::computeBounds(): sphere centered on the box center
+  vec3 c = aabb.center();
+  real radius = -1;
+  for(int i=0; i<count; ++i)
+  {
+    if (mRadius[i] < 0)
+      continue;
+    real dx = mCenterX[i] - c.x();
+    real dy = mCenterY[i] - c.y();
+    real dz = mCenterZ[i] - c.z();
+    real rad = ::sqrt(dx*dx + dy*dy + dz*dz) + mRadius[i];
+    if (rad > radius)
+      radius = rad;
+  }
+  sphere.setCenter(c);
+  sphere.setRadius(radius);
+}
+//-----------------------------------------------------------------------------
+Sphere ActorBoundsTable::computeBoundingSphere(const std::vector<int>& slots) const
+{
+  Sphere sphere;
+  for(size_t i=0; i<slots.size(); ++i)
+  {
+    int s = slots[i];
+    if (mRadius[s] >= 0)
+      sphere += Sphere(center(s), mRadius[s]);
+  }
+  return sphere;
+}
+//-----------------------------------------------------------------------------
+AABB ActorBoundsTable::boundingBox(int slot) const
+{
+  AABB aabb;
+  if (!isNull(slot))
+  {
+    aabb.setMinCorner( center(slot) - extent(slot) );
+    aabb.setMaxCorner( center(slot) + extent(slot) );
+  }
+  return aabb;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,151 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef ActorBoundsTable_INCLUDE_ONCE
+#define ActorBoundsTable_INCLUDE_ONCE
+
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Frustum.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // ActorBoundsTable
+  //-----------------------------------------------------------------------------
+  /**
+   * Stores the world space bounds of a set of Actor[s] in contiguous structure-of-arrays form 
+   * so that culling, bounds and depth computations can be performed with linear memory accesses.
+   *
+   * An Actor can be registered into at most one ActorBoundsTable at a time. Once registered the Actor
+   * writes its bounds and enable mask into its slot every time they change (see Actor::computeBounds()),
+   * while updateBounds() detects transform and renderable changes looking only at the table's arrays,
+   * the Transform and the Renderable, without touching the Actor unless its bounds need to be recomputed.
+   *
+   * For each slot the table stores the bounding box center and half extent, the bounding sphere radius
+   * (negative for null bounds), the enable mask and the Transform and Renderable update ticks.
+   *
+   * \sa SceneManagerActorBoundsTable, Actor, Frustum
+   */
+  class VLGRAPHICS_EXPORT ActorBoundsTable: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::ActorBoundsTable, Object)
+
+  public:
+    ActorBoundsTable()
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    ~ActorBoundsTable();
+
+    //! Registers an Actor into the table. Returns the Actor's slot or -1 if the Actor already belongs to another table.
+    int addActor(Actor* actor);
+
+    //! Removes an Actor from the table. The last slot is moved in place of the removed one.
+    bool eraseActor(Actor* actor);
+
+    //! Removes all the Actor[s] from the table.
+    void clear();
+
+    //! The number of Actor[s] in the table.
+    int size() const { return (int)mActors.size(); }
+
+    //! The Actor stored in the given slot.
+    Actor* actor(int slot) { return mActors[slot].get(); }
+
+    //! The Actor stored in the given slot.
+    const Actor* actor(int slot) const { return mActors[slot].get(); }
+
+    //! Recomputes the bounds of all the Actor[s] whose Transform or Renderable changed.
+    void updateBounds();
+
+    //! Appends to \p list the Actor[s] whose enable mask matches \p enable_mask and that are not culled by \p frustum.
+    //! Actors with null bounds are always considered visible. Call updateBounds() before this.
+    void extractVisibleActors(ActorCollection& list, const Frustum& frustum, unsigned int enable_mask) const;
+
+    //! Appends to \p slots the indices of the Actor[s] whose enable mask matches \p enable_mask and that are not culled by \p frustum.
+    void cull(std::vector<int>& slots, const Frustum& frustum, unsigned int enable_mask) const;
+
+    //! Computes the bounding box and the bounding sphere containing all the Actor[s] of the table.
+    void computeBounds(AABB& aabb, Sphere& sphere) const;
+
+    //! Computes the bounding sphere containing the Actor[s] in the given slots, used for near/far clipping planes optimization.
+    Sphere computeBoundingSphere(const std::vector<int>& slots) const;
+
+    //! Returns the world space bounding box of the Actor in the given slot.
+    AABB boundingBox(int slot) const;
+
+    //! Returns the world space bounding sphere of the Actor in the given slot.
+    Sphere boundingSphere(int slot) const { return isNull(slot) ? Sphere() : Sphere(center(slot), mRadius[slot]); }
+
+    //! Returns the center of the bounds of the Actor in the given slot.
+    vec3 center(int slot) const { return vec3(mCenterX[slot], mCenterY[slot], mCenterZ[slot]); }
+
+    //! Returns the half extent of the bounding box of the Actor in the given slot.
+    vec3 extent(int slot) const { return vec3(mExtentX[slot], mExtentY[slot], mExtentZ[slot]); }
+
+    //! Returns true if the Actor in the given slot has null bounds.
+    bool isNull(int slot) const { return mRadius[slot] < 0; }
+
+    //! The enable mask of the Actor in the given slot.
+    unsigned int enableMask(int slot) const { return mEnableMask[slot]; }
+
+  protected:
+    friend class Actor;
+
+    //! Called by Actor::computeBounds() to update the Actor's slot.
+    void setBounds(int slot, const AABB& aabb, long long transform_tick, long long bounds_tick);
+
+    //! Called by Actor::setEnableMask().
+    void setEnableMask(int slot, unsigned int mask) { mEnableMask[slot] = mask; }
+
+    //! Called by Actor::setTransform() and Actor::setLod() to refresh the Transform and Renderable references.
+    void updateSlot(int slot);
+
+  protected:
+    std::vector< ref<Actor> > mActors;
+    std::vector<const Transform*> mTransforms;
+    std::vector<const Renderable*> mRenderables;
+    std::vector<long long> mTransformTick;
+    std::vector<long long> mBoundsTick;
+    std::vector<real> mCenterX;
+    std::vector<real> mCenterY;
+    std::vector<real> mCenterZ;
+    std::vector<real> mExtentX;
+    std::vector<real> mExtentY;
+    std::vector<real> mExtentZ;
+    std::vector<real> mRadius;
+    std::vector<unsigned int> mEnableMask;
+  };
+}
+
+#endif
@@ -71,9 +71,14 @@ void ActorTreeAbstract::extractActors(ActorCollection& list)
 }
 //-----------------------------------------------------------------------------
 void ActorTreeAbstract::extractVisibleActors(ActorCollection& list, const Camera* camera, unsigned enable_mask)
+{
+  extractVisibleActors(list, camera->frustum(), enable_mask);
+}
+//-----------------------------------------------------------------------------
+void ActorTreeAbstract::extractVisibleActors(ActorCollection& list, const Frustum& frustum, unsigned enable_mask)
 {
   // try to cull the whole node
-  if ( !camera->frustum().cull(aabb()) )
+  if ( !frustum.cull(aabb()) )
   {
     // cull Actor by Actor
     for(int i=0; i<actors()->size(); ++i)
@@ -82,13 +87,13 @@ void ActorTreeAbstract::extractVisibleActors(ActorCollection& list, const Camera
       {
         VL_CHECK(actors()->at(i)->lod(0))
         actors()->at(i)->computeBounds();
-        if ( !camera->frustum().cull( actors()->at(i)->boundingSphere() ) )
+        if ( !frustum.cull( actors()->at(i)->boundingSphere() ) )
           list.push_back(actors()->at(i));
       }
     }
     for(int i=0; i<childrenCount(); ++i)
       if (child(i))
-        child(i)->extractVisibleActors(list, camera);
+        child(i)->extractVisibleActors(list, frustum, enable_mask);
   }
 }
 //-----------------------------------------------------------------------------
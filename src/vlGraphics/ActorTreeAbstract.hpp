@@ -34,6 +34,7 @@
 
 #include <vlGraphics/Actor.hpp>
 #include <vlCore/AABB.hpp>
+#include <vlGraphics/Frustum.hpp>
 #include <set>
 
 namespace vl
@@ -95,6 +96,12 @@ namespace vl
      */
     void extractVisibleActors(ActorCollection& list, const Camera* camera, unsigned enable_mask=0xFFFFFFFF);
 
+    /**
+     * Like extractVisibleActors(ActorCollection&, const Camera*, unsigned) but culls the nodes and the Actor[s] against an arbitrary frustum,
+     * for example the one returned by Camera::computeRectFrustum().
+     */
+    void extractVisibleActors(ActorCollection& list, const Frustum& frustum, unsigned enable_mask=0xFFFFFFFF);
+
     /**
      * Removes the given Actor from the ActorTreeAbstract.
      */
@@ -378,3 +378,46 @@ Frustum Camera::computeRayFrustum(int winx, int winy)
   return frustum;
 }
 //-----------------------------------------------------------------------------
+Frustum Camera::computeRectFrustum(int x0, int y0, int x1, int y1)
+{
+  if (x0 > x1)
+    std::swap(x0, x1);
+  if (y0 > y1)
+    std::swap(y0, y1);
+  // a degenerate rectangle, i.e. a click, would give null plane normals: grow it like computeRayFrustum()
+  if (x0 == x1)
+  {
+    --x0;
+    ++x1;
+  }
+  if (y0 == y1)
+  {
+    --y0;
+    ++y1;
+  }
+
+  // corners on the near plane (0-3) and on the far plane (4-7)
+  vec4 c[8];
+  for(int i=0; i<8; ++i)
+    unproject( vec3((real)(i==1||i==2||i==5||i==6 ? x1 : x0), (real)(i==2||i==3||i==6||i==7 ? y1 : y0), (real)(i<4 ? 0 : 1)), c[i] );
+
+  vec3 center;
+  for(int i=0; i<8; ++i)
+    center += c[i].xyz();
+  center /= 8;
+
+  // bottom, right, top, left, near, far
+  const int faces[6][3] = { {0,1,5}, {1,2,6}, {2,3,7}, {3,0,4}, {0,2,1}, {4,5,6} };
+  Frustum frustum;
+  for(int i=0; i<6; ++i)
+  {
+    const vec3& a = c[faces[i][0]].xyz();
+    vec3 n = cross(c[faces[i][1]].xyz() - a, c[faces[i][2]].xyz() - a).normalize();
+    // normals point outside
+    if (dot(center - a, n) > 0)
+      n = -n;
+    frustum.planes().push_back( Plane( a, n ) );
+  }
+  return frustum;
+}
+//-----------------------------------------------------------------------------
@@ -262,6 +262,12 @@ namespace vl
     /** Computes a 1 pixel wide frustum suitable to cull objects during ray intersection detection. */
     Frustum computeRayFrustum(int viewp_x, int viewp_y);
 
+    /** Computes the frustum, including the near and far clipping planes, passing through the rectangle with corners <viewp_x0,viewp_y0> and <viewp_x1,viewp_y1>.
+    Useful to select the objects contained in a screen rectangle, see VolumeSelector. 
+    The coordinates are viewport coordinates with the same conventions used by computeRay(). A rectangle with zero width 
+    or height, such as a single click, is grown by one pixel on each side like in computeRayFrustum(). */
+    Frustum computeRectFrustum(int viewp_x0, int viewp_y0, int viewp_x1, int viewp_y1);
+
     /** Adjusts the camera position so that the given aabb can be properly viewed.
     \param aabb The AABB (in world coords) that should be visible from the newly computed camera position.
     \param dir The direction (in world coords) along which the camera should be displaced to view the given AABB.
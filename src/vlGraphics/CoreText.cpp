@@ -52,13 +52,12 @@ using namespace vl;
 // - Text geometry and bounding boxes should be pre-computed on text change.
 // - Line splitting should not be done at rendering time.
 // - Should use only OpenGL Core routines.
-// - Should use texture atlases and perform lazy texture binding.
 // - Cleaner left to right / right to left text reversing.
 // - Outline rendering should use 2 pass with enlarged glyphs instead of 5 passes or precompute an high quality outline texture.
 // - Avoid using doubles and floats if possible, use integer and Rect rather floats and AABBs.
 
 //-----------------------------------------------------------------------------
-void CoreText::render_Implementation(const Actor* actor, const Shader*, const Camera* camera, OpenGLContext* gl_context) const
+void CoreText::render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const
 {
   gl_context->bindVAS(NULL, false, false);
 
@@ -70,6 +69,9 @@ void CoreText::render_Implementation(const Actor* actor, const Shader*, const Ca
   if ( text().empty() )
     return;
 
+  // the glyph quads are rebuilt only when the text, its layout or its font change
+  updateGlyphQuads();
+
   // Lighting can be enabled or disabled.
   // glDisable(GL_LIGHTING);
 
@@ -105,19 +107,8 @@ void CoreText::render_Implementation(const Actor* actor, const Shader*, const Ca
 
   // to have the most correct results we should render the text twice one for color and stencil, the other for the z-buffer
 
-  // shadow render
-  if (shadowEnabled())
-    renderText( actor, camera, shadowColor(), shadowVector() );
-  // outline render
-  if (outlineEnabled())
-  {
-    renderText( actor, camera, outlineColor(), fvec2(-1,0) );
-    renderText( actor, camera, outlineColor(), fvec2(+1,0) );
-    renderText( actor, camera, outlineColor(), fvec2(0,-1) );
-    renderText( actor, camera, outlineColor(), fvec2(0,+1) );
-  }
-  // text render
-  renderText( actor, camera, color(), fvec2(0,0) );
+  // shadow, outline and text render: all baked in the glyph quads
+  renderText( actor, shader, camera );
 
   // Pass #2
   // fills the z-buffer (not the stencil buffer): approximated to the text bbox
@@ -154,26 +145,47 @@ void CoreText::render_Implementation(const Actor* actor, const Shader*, const Ca
     if (Has_GL_Version_2_0)
       glStencilMaskSeparate(GL_BACK, stencil_back_mask);
   }
+
+  // restore the right color and normal since we changed them
+  glColor4fv( gl_context->color().ptr() );
+  glNormal3fv( gl_context->normal().ptr() );
 }
 //-----------------------------------------------------------------------------
-void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const fvec2& offset) const
+void CoreText::renderText(const Actor*, const Shader* shader, const Camera*) const
 {
-  if(!mFont)
-  {
-    Log::error("CoreText::renderText() error: no Font assigned to the CoreText object.\n");
-    VL_TRAP()
+  if (mGlyphQuads.empty())
     return;
-  }
 
-  if (!font()->mFT_Face)
-  {
-    Log::error("CoreText::renderText() error: invalid FT_Face: probably you tried to load an unsupported font format.\n");
-    VL_TRAP()
+  // Constant normal
+  glNormal3fv( fvec3(0,0,1).ptr() );
+
+  // a GLSLProgram is expected to handle the distance field glyphs by itself
+  mGlyphQuads.render( !shader || !shader->getGLSLProgram() );
+}
+//-----------------------------------------------------------------------------
+void CoreText::updateGlyphQuads() const
+{
+  if ( !mQuadsDirty && mQuadsGlyphsTick == font()->glyphsTick() )
     return;
+
+  // creating new glyphs can grow an atlas page changing the texture coordinates of the glyphs already added
+  long long glyphs_tick = 0;
+  do
+  {
+    glyphs_tick = font()->glyphsTick();
+    mGlyphQuads.clear();
+    generateGlyphQuads();
   }
+  while( glyphs_tick != font()->glyphsTick() );
 
-  // mic fixme: these should be pre-computed when the text is set!!!
+  mGlyphQuads.finalize();
 
+  mQuadsDirty = false;
+  mQuadsGlyphsTick = glyphs_tick;
+}
+//-----------------------------------------------------------------------------
+void CoreText::generateGlyphQuads() const
+{
   AABB rbbox = rawboundingRect( text() ); // for text alignment
   VL_CHECK(rbbox.maxCorner().z() == 0)
   VL_CHECK(rbbox.minCorner().z() == 0)
@@ -182,36 +194,18 @@ void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const
   VL_CHECK(bbox.maxCorner().z() == 0)
   VL_CHECK(bbox.minCorner().z() == 0)
 
-  // basic render states
-
-  // mic fixme: detect GLSLProgram and use VertexAttribPointer if present.
-
-  float texc[] = { 0,0,0,0,0,0,0,0 };
-  VL_glActiveTexture( GL_TEXTURE0 );
-  VL_glClientActiveTexture( GL_TEXTURE0 );
-  glEnable(GL_TEXTURE_2D);
-  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-  glTexCoordPointer(2, GL_FLOAT, 0, texc);
-
-  // color
-  glColor4fv(color.ptr());
-
-  // Constant normal
-  glNormal3fv( fvec3(0,0,1).ptr() );
+  // the shadow, outline and text passes are baked in layers #0, #1 and #2
+  ubvec4 shadow_color  = GlyphQuads::packColor( shadowColor() );
+  ubvec4 outline_color = GlyphQuads::packColor( outlineColor() );
+  ubvec4 text_color    = GlyphQuads::packColor( color() );
 
   fvec3 vect[4];
-  glEnableClientState( GL_VERTEX_ARRAY );
-  glVertexPointer(3, GL_FLOAT, 0, vect[0].ptr());
 
   FT_Long use_kerning = FT_HAS_KERNING( font()->mFT_Face );
   FT_UInt previous = 0;
 
   fvec2 pen(0,0);
 
-  // mic fixme:
-  // - lines split and lines dimensions (linebox) should be precomputed on text set!
-  // - or convert this function to generate a pre-computed rendering-list!
-
   // split the text in different lines
 
   VL_CHECK(text().length())
@@ -315,17 +309,6 @@ void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const
 
       if (glyph->textureHandle())
       {
-        glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-        texc[0] = glyph->s0();
-        texc[1] = glyph->t1();
-        texc[2] = glyph->s1();
-        texc[3] = glyph->t1();
-        texc[4] = glyph->s1();
-        texc[5] = glyph->t0();
-        texc[6] = glyph->s0();
-        texc[7] = glyph->t0();
-
         int left = layout() == RightToLeftText ? -glyph->left() : +glyph->left();
 
         vect[0].x() = pen.x() + glyph->width()*0 + left -1;
@@ -369,16 +352,6 @@ void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const
         vect[3].x() += margin() + horz_text_align;
         vect[3].y() += margin();
 
-        // apply offset for outline rendering
-        vect[0].x() += offset.x();
-        vect[0].y() += offset.y();
-        vect[1].x() += offset.x();
-        vect[1].y() += offset.y();
-        vect[2].x() += offset.x();
-        vect[2].y() += offset.y();
-        vect[3].x() += offset.x();
-        vect[3].y() += offset.y();
-
         // text pivot
         for(int i=0; i<4; ++i)
         {
@@ -411,15 +384,16 @@ void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const
           }
         }
 
-        glDrawArrays(GL_QUADS, 0, 4);
-
-        #if (0)
-          glDisable(GL_TEXTURE_2D);
-          glColor3fv(vec3(1,0,0).ptr());
-          glDrawArrays(GL_LINE_LOOP, 0, 4);
-          glColor4fv(color.ptr());
-          glEnable(GL_TEXTURE_2D);
-        #endif
+        if (shadowEnabled())
+          mGlyphQuads.addQuad( glyph, vect, shadow_color, 0, fvec3(shadowVector().x(), shadowVector().y(), 0) );
+        if (outlineEnabled())
+        {
+          mGlyphQuads.addQuad( glyph, vect, outline_color, 1, fvec3(-1, 0, 0) );
+          mGlyphQuads.addQuad( glyph, vect, outline_color, 1, fvec3(+1, 0, 0) );
+          mGlyphQuads.addQuad( glyph, vect, outline_color, 1, fvec3( 0,-1, 0) );
+          mGlyphQuads.addQuad( glyph, vect, outline_color, 1, fvec3( 0,+1, 0) );
+        }
+        mGlyphQuads.addQuad( glyph, vect, text_color, 2 );
       }
 
       if (just_space && lines[iline][c] == ' ' && iline != lines.size()-1)
@@ -453,14 +427,6 @@ void CoreText::renderText(const Actor*, const Camera*, const fvec4& color, const
 
     }
   }
-
-  glDisableClientState( GL_VERTEX_ARRAY );
-  glDisableClientState( GL_TEXTURE_COORD_ARRAY );
-
-  VL_CHECK_OGL();
-
-  glDisable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
 }
 //-----------------------------------------------------------------------------
 // returns the raw bounding box of the string, i.e. without alignment, margin and matrix transform.
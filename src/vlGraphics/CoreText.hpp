@@ -33,6 +33,7 @@
 #define CoreText_INCLUDE_ONCE
 
 #include <vlGraphics/Font.hpp>
+#include <vlGraphics/GlyphQuads.hpp>
 #include <vlGraphics/Renderable.hpp>
 #include <vlCore/vlnamespace.hpp>
 #include <vlCore/String.hpp>
@@ -51,7 +52,8 @@ namespace vl
   public:
     CoreText(): mColor(1,1,1,1), mBorderColor(0,0,0,1), mBackgroundColor(1,1,1,1), mOutlineColor(0,0,0,1), mShadowColor(0,0,0,0.5f), mShadowVector(2,-2), 
       mTextOrigin(AlignBottom|AlignLeft), mMargin(5), mLayout(LeftToRightText), mTextAlignment(TextAlignLeft), 
-      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true) 
+      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true), 
+      mQuadsDirty(true), mQuadsGlyphsTick(0)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
@@ -59,44 +61,44 @@ namespace vl
     //! The text to be rendered.
     const String& text() const { return mText; }
     //! The text to be rendered.
-    void setText(const String& text) { mText = text; }
+    void setText(const String& text) { mText = text; mQuadsDirty = true; }
 
     //! The color of the text.
     const fvec4& color() const { return mColor; }
     //! The color of the text.
-    void setColor(const fvec4& color) { mColor = color; }
+    void setColor(const fvec4& color) { mColor = color; mQuadsDirty = true; }
 
     //! The margin to be left around the text.
     int margin() const { return mMargin; }
     //! The margin to be left around the text.
-    void setMargin(int margin) { mMargin = margin; }
+    void setMargin(int margin) { mMargin = margin; mQuadsDirty = true; }
 
     //! The font to be used to render the text.
     const Font* font() const { return mFont.get(); }
     //! The font to be used to render the text.
     Font* font() { return mFont.get(); }
     //! The font to be used to render the text.
-    void setFont(Font* font) { mFont = font; }
+    void setFont(Font* font) { mFont = font; mQuadsDirty = true; }
 
     //! Text layout: left to right, right to left.
     ETextLayout layout() const { return mLayout; }
     //! Text layout: left to right, right to left.
-    void setLayout(ETextLayout layout) { mLayout = layout; }
+    void setLayout(ETextLayout layout) { mLayout = layout; mQuadsDirty = true; }
 
     //! Text alignment: left, right, center, justify.
     ETextAlign textAlignment() const { return mTextAlignment; }
     //! Text alignment: left, right, center, justify.
-    void setTextAlignment(ETextAlign align) { mTextAlignment = align; }
+    void setTextAlignment(ETextAlign align) { mTextAlignment = align; mQuadsDirty = true; }
 
     //! The origin of the text (pivot point for offsetting and rotations).
     int  textOrigin() const { return mTextOrigin; }
     //! The origin of the text (pivot point for offsetting and rotations).
-    void setTextOrigin(int align) { mTextOrigin = align; }
+    void setTextOrigin(int align) { mTextOrigin = align; mQuadsDirty = true; }
 
     //! If enabled text rendering uses kerning information for better quality results (slower).
     bool kerningEnabled() const { return mKerningEnabled; }
     //! If enabled text rendering uses kerning information for better quality results (slower).
-    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; }
+    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; mQuadsDirty = true; }
 
     //! If true draws a rectangular border around the text.
     bool borderEnabled() const { return mBorderEnabled; }
@@ -121,27 +123,27 @@ namespace vl
     //! If true the characters are drawn with an outline.
     bool outlineEnabled() const { return mOutlineEnabled; }
     //! If true the characters are drawn with an outline.
-    void setOutlineEnabled(bool outline) { mOutlineEnabled = outline; }
+    void setOutlineEnabled(bool outline) { mOutlineEnabled = outline; mQuadsDirty = true; }
 
     //! The color of the character outline.
     const fvec4& outlineColor() const { return mOutlineColor; }
     //! The color of the character outline.
-    void setOutlineColor(const fvec4& outline_color) { mOutlineColor = outline_color; }
+    void setOutlineColor(const fvec4& outline_color) { mOutlineColor = outline_color; mQuadsDirty = true; }
 
     //! If true a sort of shadow is rendered below the text.
     bool shadowEnabled() const { return mShadowEnabled; }
     //! If true a sort of shadow is rendered below the text.
-    void setShadowEnabled(bool shadow) { mShadowEnabled = shadow; }
+    void setShadowEnabled(bool shadow) { mShadowEnabled = shadow; mQuadsDirty = true; }
 
     //! The color of the text shadow.
     const fvec4& shadowColor() const { return mShadowColor; }
     //! The color of the text shadow.
-    void setShadowColor(const fvec4& shadow_color) { mShadowColor = shadow_color; }
+    void setShadowColor(const fvec4& shadow_color) { mShadowColor = shadow_color; mQuadsDirty = true; }
 
     //! The offset vector of the shadow.
     const fvec2& shadowVector() const { return mShadowVector; }
     //! The offset vector of the shadow.
-    void setShadowVector(const fvec2& shadow_vector) { mShadowVector = shadow_vector; }
+    void setShadowVector(const fvec2& shadow_vector) { mShadowVector = shadow_vector; mQuadsDirty = true; }
 
     //! Returns the plain 2D bounding box of the text, in local coordinates.
     AABB boundingRect() const;
@@ -153,13 +155,15 @@ namespace vl
 
     virtual void updateDirtyBufferObject(EBufferObjectUpdateMode) {}
 
-    virtual void deleteBufferObject() {}
+    virtual void deleteBufferObject() { mGlyphQuads.deleteBufferObject(); }
 
   protected:
     virtual void render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const;
     void computeBounds_Implementation() { setBoundingBox(AABB()); setBoundingSphere(Sphere()); }
 
-    void renderText(const Actor*, const Camera* camera, const fvec4& color, const fvec2& offset) const;
+    void updateGlyphQuads() const;
+    void generateGlyphQuads() const;
+    void renderText(const Actor*, const Shader* shader, const Camera* camera) const;
     void renderBackground(const Actor* actor, const Camera* camera) const;
     void renderBorder(const Actor* actor, const Camera* camera) const;
     AABB rawboundingRect(const String& text) const;
@@ -182,6 +186,10 @@ namespace vl
     bool mOutlineEnabled;
     bool mShadowEnabled;
     bool mKerningEnabled;
+    // glyph quads cache: shadow, outline and text are rendered with one draw call per Font atlas page
+    mutable GlyphQuads mGlyphQuads;
+    mutable bool mQuadsDirty;
+    mutable long long mQuadsGlyphsTick;
   };
 }
 
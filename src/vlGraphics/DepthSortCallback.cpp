@@ -0,0 +1,289 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/DepthSortCallback.hpp>
+#include <algorithm>
+
+#if VL_SSE2
+  #include <emmintrin.h>
+#endif
+
+using namespace vl;
+
+namespace
+{
+  // the depth keys are quantized to 24 bits and sorted in two passes of 12 bits
+  const int KeyBits = 24;
+  const int RadixBits = 12;
+  const int RadixBuckets = 1 << RadixBits;
+
+  // below this number of primitives std::sort is faster than the radix sort
+  const int RadixSortThreshold = 2048;
+
+  // average number of moves per primitive after which the incremental sorting gives up
+  const int IncrementalMoveBudget = 4;
+
+  // the grain used to split vertices and primitives among the threads
+  const int ParallelGrain = 4096;
+
+  //-----------------------------------------------------------------------------
+  class EyeSpaceZTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      if (mPositions)
+      {
+        int i = begin;
+#if VL_SSE2
+        const __m128 rx = _mm_set1_ps(mRow[0]);
+        const __m128 ry = _mm_set1_ps(mRow[1]);
+        const __m128 rz = _mm_set1_ps(mRow[2]);
+        const __m128 rw = _mm_set1_ps(mRow[3]);
+        for(; i+4<=end; i+=4)
+        {
+          // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+          const float* p = mPositions[i].ptr();
+          __m128 a = _mm_loadu_ps(p);
+          __m128 b = _mm_loadu_ps(p+4);
+          __m128 c = _mm_loadu_ps(p+8);
+          __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+          __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+          __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+          __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rx), _mm_mul_ps(y, ry)), _mm_add_ps(_mm_mul_ps(z, rz), rw));
+          _mm_storeu_ps(mZ+i, d);
+        }
+#endif
+        for(; i<end; ++i)
+          mZ[i] = mRow[0]*mPositions[i].x() + mRow[1]*mPositions[i].y() + mRow[2]*mPositions[i].z() + mRow[3];
+      }
+      else
+      {
+        for(int i=begin; i<end; ++i)
+        {
+          vec3 v = mVerts->getAsVec3(i);
+          mZ[i] = (float)(mRow[0]*v.x() + mRow[1]*v.y() + mRow[2]*v.z() + mRow[3]);
+        }
+      }
+    }
+
+  public:
+    const ArrayAbstract* mVerts;
+    const fvec3* mPositions;
+    float mRow[4];
+    float* mZ;
+  };
+  //-----------------------------------------------------------------------------
+  // Each index of the parallelFor() is a chunk of mChunkSize primitives.
+  template<typename T>
+  class RadixTask: public ParallelForTask
+  {
+  public:
+    typedef enum { BuildKeys, Histogram, Scatter, WriteBack } EStep;
+
+    void run(int begin, int end, int)
+    {
+      for(int ichunk=begin; ichunk<end; ++ichunk)
+      {
+        int first = ichunk * mChunkSize;
+        int last  = std::min(first + mChunkSize, (int)mPrimitiveZ->size());
+        int* hist = mHistograms + ichunk * RadixBuckets;
+        switch(mStep)
+        {
+        case BuildKeys:
+          for(int i=first; i<last; ++i)
+          {
+            float k = ((*mPrimitiveZ)[i].mZ - mMinZ) * mScale;
+            unsigned long long key = k > 0 ? (k < mMaxKey ? (unsigned long long)k : (unsigned long long)mMaxKey) : 0;
+            if (mInvert)
+              key = (unsigned long long)mMaxKey - key;
+            mKeys[i] = (key << 32) | (*mPrimitiveZ)[i].mPrimitiveIndex;
+          }
+          break;
+        case Histogram:
+          memset(hist, 0, sizeof(int) * RadixBuckets);
+          for(int i=first; i<last; ++i)
+            ++hist[ (mKeys[i] >> mShift) & (RadixBuckets-1) ];
+          break;
+        case Scatter:
+          for(int i=first; i<last; ++i)
+            mTemp[ hist[ (mKeys[i] >> mShift) & (RadixBuckets-1) ]++ ] = mKeys[i];
+          break;
+        case WriteBack:
+          for(int i=first; i<last; ++i)
+            (*mPrimitiveZ)[i].mPrimitiveIndex = (unsigned int)mKeys[i];
+          break;
+        }
+      }
+    }
+
+  public:
+    std::vector<T>* mPrimitiveZ;
+    unsigned long long* mKeys;
+    unsigned long long* mTemp;
+    int* mHistograms;
+    float mMinZ;
+    float mScale;
+    float mMaxKey;
+    int mChunkSize;
+    int mShift;
+    EStep mStep;
+    bool mInvert;
+  };
+  //-----------------------------------------------------------------------------
+  // Insertion sort giving up after 'budget' moves, very fast on nearly sorted sequences.
+  template<typename T>
+  bool incrementalSort(std::vector<T>& prims, long long budget, bool back_to_front)
+  {
+    for(size_t i=1; i<prims.size(); ++i)
+    {
+      T x = prims[i];
+      size_t j = i;
+      if (back_to_front)
+        for(; j>0 && x.mZ < prims[j-1].mZ; --j)
+          prims[j] = prims[j-1];
+      else
+        for(; j>0 && x.mZ > prims[j-1].mZ; --j)
+          prims[j] = prims[j-1];
+      prims[j] = x;
+      budget -= i - j;
+      if (budget < 0)
+        return false;
+    }
+    return true;
+  }
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::runTask(ParallelForTask* task, int count)
+{
+  if (count >= parallelThreshold())
+    parallelFor(0, count, task, ParallelGrain);
+  else
+    task->run(0, count, 0);
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::computeEyeSpaceZ(const ArrayAbstract* verts, const mat4& matrix)
+{
+  mEyeSpaceZ.resize( verts->size() );
+  if (mEyeSpaceZ.empty())
+    return;
+
+  // only the Z row of the matrix is needed
+  EyeSpaceZTask task;
+  task.mVerts = verts;
+  const ArrayFloat3* fverts = cast_const<ArrayFloat3>(verts);
+  task.mPositions = fverts ? fverts->begin() : NULL;
+  for(int i=0; i<4; ++i)
+    task.mRow[i] = (float)matrix.e(2,i);
+  task.mZ = &mEyeSpaceZ[0];
+  runTask(&task, (int)mEyeSpaceZ.size());
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::sortPrimitiveZ()
+{
+  // the primitives are in the order computed at the previous frame
+  if (incrementalSorting() && incrementalSort(mPrimitiveZ, (long long)mPrimitiveZ.size() * IncrementalMoveBudget, sortMode() == SM_SortBackToFront))
+    return;
+
+  if (mPrimitiveZ.size() >= (size_t)RadixSortThreshold)
+    radixSortPrimitiveZ();
+  else
+  if (sortMode() == SM_SortBackToFront)
+    std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
+  else
+    std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
+}
+//-----------------------------------------------------------------------------
+void DepthSortCallback::radixSortPrimitiveZ()
+{
+  int count = (int)mPrimitiveZ.size();
+
+  float min_z = mPrimitiveZ[0].mZ;
+  float max_z = mPrimitiveZ[0].mZ;
+  for(int i=1; i<count; ++i)
+  {
+    min_z = std::min(min_z, mPrimitiveZ[i].mZ);
+    max_z = std::max(max_z, mPrimitiveZ[i].mZ);
+  }
+  // all the primitives at the same depth
+  if (!(max_z > min_z))
+    return;
+
+  int chunks = count >= parallelThreshold() ? parallelThreadCount() : 1;
+  mRadixKeys.resize(count);
+  mRadixTemp.resize(count);
+  mRadixHistograms.resize(chunks * RadixBuckets);
+
+  RadixTask<PrimitiveZ> task;
+  task.mPrimitiveZ = &mPrimitiveZ;
+  task.mKeys       = &mRadixKeys[0];
+  task.mTemp       = &mRadixTemp[0];
+  task.mHistograms = &mRadixHistograms[0];
+  task.mMaxKey     = (float)((1 << KeyBits) - 1);
+  task.mMinZ       = min_z;
+  task.mScale      = task.mMaxKey / (max_z - min_z);
+  task.mChunkSize  = (count + chunks - 1) / chunks;
+  task.mInvert     = sortMode() == SM_SortFrontToBack;
+
+  task.mStep = RadixTask<PrimitiveZ>::BuildKeys;
+  parallelFor(0, chunks, &task);
+  for(int pass=0; pass<KeyBits/RadixBits; ++pass)
+  {
+    task.mShift = 32 + pass * RadixBits;
+    task.mStep = RadixTask<PrimitiveZ>::Histogram;
+    parallelFor(0, chunks, &task);
+
+    // convert the per-chunk histograms into scatter offsets, stable across chunks
+    int offset = 0;
+    bool trivial = false;
+    for(int d=0; d<RadixBuckets; ++d)
+    {
+      int bucket_start = offset;
+      for(int c=0; c<chunks; ++c)
+      {
+        int n = mRadixHistograms[c*RadixBuckets+d];
+        mRadixHistograms[c*RadixBuckets+d] = offset;
+        offset += n;
+      }
+      trivial |= offset - bucket_start == count;
+    }
+    // all keys share the same digit
+    if (trivial)
+      continue;
+
+    task.mStep = RadixTask<PrimitiveZ>::Scatter;
+    parallelFor(0, chunks, &task);
+    std::swap(task.mKeys, task.mTemp);
+  }
+  task.mStep = RadixTask<PrimitiveZ>::WriteBack;
+  parallelFor(0, chunks, &task);
+}
+//-----------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 #include <vlGraphics/Actor.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/Camera.hpp>
+#include <vlCore/ThreadPool.hpp>
 
 namespace vl
 {
@@ -57,6 +58,10 @@ namespace vl
    * - This callback works well with multipassing, the sorting is done only once.
    * - Using DrawElementsUShort or DrawElementsUByte might result in a quicker sorting compared to DrawElementsUInt.
    *   Is therefore advisable to use them whenever possible.
+   * - Large draw calls are sorted with a radix sort on depth values quantized to 24 bits, splitting the work among
+   *   the threads of defThreadPool() when they contain more than parallelThreshold() primitives.
+   * - When the camera moves continuously enable setIncrementalSorting(): the order computed at the previous frame
+   *   is refined with an insertion sort, which is much faster than sorting from scratch when the order changed little.
    *
    *
    * \remarks
@@ -71,7 +76,7 @@ namespace vl
    *
    * \sa \ref pagGuidePolygonDepthSorting
    */
-  class DepthSortCallback: public ActorEventCallback
+  class VLGRAPHICS_EXPORT DepthSortCallback: public ActorEventCallback
   {
     VL_INSTRUMENT_CLASS(vl::DepthSortCallback, ActorEventCallback)
 
@@ -131,6 +136,40 @@ namespace vl
     public:
       bool operator()(const PrimitiveZ& t1, const PrimitiveZ& t2) const { return t1.mZ > t2.mZ; }
     };
+    // computes the depth of the primitives or gathers them in sorted order
+    template<typename T, typename P>
+    class PrimitiveTask: public ParallelForTask
+    {
+    public:
+      void run(int begin, int end, int)
+      {
+        const int N = sizeof(P) / sizeof(T);
+        if (mGather)
+        {
+          const P* prims = (const P*)mIndices;
+          for(int i=begin; i<end; ++i)
+            (*mSorted)[i] = prims[ (*mPrimitiveZ)[i].mPrimitiveIndex ];
+        }
+        else
+        {
+          for(int i=begin; i<end; ++i)
+          {
+            const T* idx = mIndices + i*N;
+            float z = 0;
+            for(int k=0; k<N; ++k)
+              z += (*mEyeSpaceZ)[idx[k]];
+            (*mPrimitiveZ)[i] = PrimitiveZ(i, z);
+          }
+        }
+      }
+
+    public:
+      const T* mIndices;
+      const std::vector<float>* mEyeSpaceZ;
+      std::vector<PrimitiveZ>* mPrimitiveZ;
+      std::vector<P>* mSorted;
+      bool mGather;
+    };
 
   public:
     //! Constructor.
@@ -138,6 +177,8 @@ namespace vl
     {
       VL_DEBUG_SET_OBJECT_NAME()
       setSortMode(SM_SortBackToFront);
+      mIncrementalSorting = false;
+      mParallelThreshold = 65536;
     }
 
     void onActorDelete(Actor*) {}
@@ -169,16 +210,8 @@ namespace vl
       if (!verts)
         return;
 
-      // computes eye-space vertex positions
-      mat4 m;
-      if (actor->transform())
-        m = cam->viewMatrix() * actor->transform()->worldMatrix();
-      else
-        m = cam->viewMatrix();
-      mEyeSpaceVerts.resize( verts->size() );
-      // would be nice to optimize this with SEE2
-      for(size_t i=0; i<verts->size(); ++i)
-        mEyeSpaceVerts[i] = m * verts->getAsVec3(i);
+      // computes eye-space vertex depths
+      computeEyeSpaceZ(verts, matrix);
 
       geometry->setBufferObjectDirty(true);
       geometry->setDisplayListDirty(true);
@@ -200,121 +233,21 @@ namespace vl
     template<typename T, typename deT>
     void sort(deT* polys, std::vector<Point<T> >& sorted_points, std::vector<Line<T> >& sorted_lines, std::vector<Triangle<T> >& sorted_triangles, std::vector<Quad<T> >& sorted_quads)
     {
+      bool sorted = false;
       if (polys->primitiveType() == PT_QUADS)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 4 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=4, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z() + mEyeSpaceVerts[it[2]].z() + mEyeSpaceVerts[it[3]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_quads.resize( polys->indexBuffer()->size() / 4 );
-        Quad<T>* tris = (Quad<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_quads[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_quads[0], sizeof(sorted_quads[0])*sorted_quads.size() );
-      }
+        sorted = sortPrimitives(polys->indexBuffer()->begin(), polys->indexBuffer()->size(), sorted_quads);
       else
       if (polys->primitiveType() == PT_TRIANGLES)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 3 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=3, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z() + mEyeSpaceVerts[it[2]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_triangles.resize( polys->indexBuffer()->size() / 3 );
-        Triangle<T>* tris = (Triangle<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_triangles[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_triangles[0], sizeof(sorted_triangles[0])*sorted_triangles.size() );
-      }
+        sorted = sortPrimitives(polys->indexBuffer()->begin(), polys->indexBuffer()->size(), sorted_triangles);
       else
       if (polys->primitiveType() == PT_LINES)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() / 2 );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; it+=2, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)(mEyeSpaceVerts[it[0]].z() + mEyeSpaceVerts[it[1]].z());
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
-
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_lines.resize( polys->indexBuffer()->size() / 2 );
-        Line<T>* tris = (Line<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_lines[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_lines[0], sizeof(sorted_lines[0])*sorted_lines.size() );
-      }
+        sorted = sortPrimitives(polys->indexBuffer()->begin(), polys->indexBuffer()->size(), sorted_lines);
       else
       if (polys->primitiveType() == PT_POINTS)
-      {
-        // compute zetas
-        mPrimitiveZ.resize( polys->indexBuffer()->size() );
-        if (mPrimitiveZ.empty())
-          return;
-
-        const typename deT::index_type* it  = polys->indexBuffer()->begin();
-        const typename deT::index_type* end = polys->indexBuffer()->end();
-        for(unsigned iz=0; it != end; ++it, ++iz)
-        {
-          mPrimitiveZ[iz].mZ = (float)mEyeSpaceVerts[it[0]].z();
-          mPrimitiveZ[iz].mPrimitiveIndex = iz;
-        }
+        sorted = sortPrimitives(polys->indexBuffer()->begin(), polys->indexBuffer()->size(), sorted_points);
 
-        // sort based on mPrimitiveZ
-        if (sortMode() == SM_SortBackToFront)
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Back_To_Front() );
-        else
-          std::sort( mPrimitiveZ.begin(), mPrimitiveZ.end(), Sorter_Front_To_Back() );
-
-        // regenerate the sorted indices
-        sorted_points.resize( polys->indexBuffer()->size() );
-        Point<T>* tris = (Point<T>*)polys->indexBuffer()->ptr();
-        for(unsigned int i=0; i<mPrimitiveZ.size(); ++i)
-          sorted_points[i] = tris[ mPrimitiveZ[i].mPrimitiveIndex ];
-        memcpy(&tris[0], &sorted_points[0], sizeof(sorted_points[0])*sorted_points.size() );
-      }
+      if (!sorted)
+        return;
 
       if (Has_BufferObject)
       {
@@ -331,17 +264,69 @@ namespace vl
       }
     }
 
+    template<typename T, typename P>
+    bool sortPrimitives(T* indices, size_t index_count, std::vector<P>& sorted)
+    {
+      int count = (int)(index_count / (sizeof(P) / sizeof(T)));
+      mPrimitiveZ.resize(count);
+      if (mPrimitiveZ.empty())
+        return false;
+
+      // compute zetas
+      PrimitiveTask<T, P> task;
+      task.mIndices    = indices;
+      task.mEyeSpaceZ  = &mEyeSpaceZ;
+      task.mPrimitiveZ = &mPrimitiveZ;
+      task.mSorted     = &sorted;
+      task.mGather     = false;
+      runTask(&task, count);
+
+      // sort based on mPrimitiveZ
+      sortPrimitiveZ();
+
+      // regenerate the sorted indices
+      sorted.resize(count);
+      task.mGather = true;
+      runTask(&task, count);
+      memcpy(indices, &sorted[0], sizeof(sorted[0])*sorted.size());
+      return true;
+    }
+
     ESortMode sortMode() const { return mSortMode; }
     void setSortMode(ESortMode sort_mode) { mSortMode = sort_mode; }
 
+    /**
+     * If enabled the primitives are sorted starting from the order computed at the previous frame using an adaptive
+     * insertion sort, which is much faster than sorting from scratch when the camera moves slightly.
+     * When the order changed too much the sorting falls back automatically to the radix sort. Default is false.
+     */
+    void setIncrementalSorting(bool enable) { mIncrementalSorting = enable; }
+    bool incrementalSorting() const { return mIncrementalSorting; }
+
+    /**
+     * Number of vertices or primitives above which the depth computation and the sorting are split among the
+     * threads of defThreadPool(). Default is 65536.
+     */
+    void setParallelThreshold(int count) { mParallelThreshold = count; }
+    int parallelThreshold() const { return mParallelThreshold; }
+
     /**
      * Forces sorting at the next rendering.
      */
     void invalidateCache() { mCacheMatrix = vl::mat4(); }
 
   protected:
-    std::vector<vec3> mEyeSpaceVerts;
+    void computeEyeSpaceZ(const ArrayAbstract* verts, const mat4& matrix);
+    void sortPrimitiveZ();
+    void radixSortPrimitiveZ();
+    void runTask(ParallelForTask* task, int count);
+
+  protected:
+    std::vector<float> mEyeSpaceZ;
     std::vector<PrimitiveZ> mPrimitiveZ;
+    std::vector<unsigned long long> mRadixKeys;
+    std::vector<unsigned long long> mRadixTemp;
+    std::vector<int> mRadixHistograms;
 
     std::vector<PointUInt> mSortedPointsUInt;
     std::vector<LineUInt> mSortedLinesUInt;
@@ -361,6 +346,8 @@ namespace vl
     vl::mat4 mCacheMatrix;
 
     ESortMode mSortMode;
+    int mParallelThreshold;
+    bool mIncrementalSorting;
   };
 }
 
@@ -0,0 +1,473 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/DistanceFieldAtlas.hpp>
+#include <vlGraphics/Font.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/FileSystem.hpp>
+#include <vlCore/VirtualFile.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <set>
+
+using namespace vl;
+
+namespace
+{
+  const char* CacheMagic = "VLSDFAT";
+  const unsigned int CacheVersion = 1;
+
+  //! A glyph rasterized at the upsampled size and its distance field at the reference size.
+  struct DistanceFieldJob
+  {
+    int mCharacter;
+    std::vector<unsigned char> mAlpha;
+    int mWidth;
+    int mHeight;
+    int mLeft;
+    int mTop;
+    DistanceFieldAtlas::GlyphInfo mInfo;
+    std::vector<unsigned char> mCell;
+  };
+
+  int floorDiv(int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+  int ceilDiv(int a, int b) { return -floorDiv(-a, b); }
+
+  // squared distance transform of a sampled function, see Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions".
+  void distanceTransform1D(const float* f, int n, float* d, int* v, double* z)
+  {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -1e30;
+    z[1] = +1e30;
+    for(int q=1; q<n; ++q)
+    {
+      double s = ( (f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k]) ) / (2.0*q - 2.0*v[k]);
+      while( s <= z[k] )
+      {
+        --k;
+        s = ( (f[q] + (double)q*q) - (f[v[k]] + (double)v[k]*v[k]) ) / (2.0*q - 2.0*v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k+1] = +1e30;
+    }
+
+    k = 0;
+    for(int q=0; q<n; ++q)
+    {
+      while( z[k+1] < q )
+        ++k;
+      d[q] = (float)( (double)(q-v[k])*(q-v[k]) + f[v[k]] );
+    }
+  }
+
+  // squared euclidean distance transform of a grid, the features having value 0 and the rest a very large value.
+  void distanceTransform2D(std::vector<float>& grid, int width, int height)
+  {
+    int n = width > height ? width : height;
+    std::vector<float> f(n), d(n);
+    std::vector<int> v(n);
+    std::vector<double> z(n+1);
+
+    for(int x=0; x<width; ++x)
+    {
+      for(int y=0; y<height; ++y)
+        f[y] = grid[y*width + x];
+      distanceTransform1D(&f[0], height, &d[0], &v[0], &z[0]);
+      for(int y=0; y<height; ++y)
+        grid[y*width + x] = d[y];
+    }
+
+    for(int y=0; y<height; ++y)
+    {
+      distanceTransform1D(&grid[y*width], width, &d[0], &v[0], &z[0]);
+      memcpy(&grid[y*width], &d[0], width*sizeof(float));
+    }
+  }
+
+  void computeDistanceField(DistanceFieldJob& job, int upsampling, int spread)
+  {
+    if (job.mAlpha.empty())
+      return;
+
+    // the box of the glyph at the reference size, rounded outwards
+    const int u = upsampling;
+    int left   = floorDiv(job.mLeft, u);
+    int right  = ceilDiv(job.mLeft + job.mWidth, u);
+    int top    = ceilDiv(job.mTop, u);
+    int bottom = floorDiv(job.mTop - job.mHeight, u);
+
+    DistanceFieldAtlas::GlyphInfo& info = job.mInfo;
+    info.mLeft   = left;
+    info.mTop    = top;
+    info.mWidth  = right - left;
+    info.mHeight = top - bottom;
+    info.mCellWidth  = info.mWidth  + spread*2;
+    info.mCellHeight = info.mHeight + spread*2;
+
+    // the upsampled cell, the rows going from the top to the bottom as in FreeType
+    const float far_away = 1e20f;
+    int w = info.mCellWidth  * u;
+    int h = info.mCellHeight * u;
+    int ox = job.mLeft - (left - spread) * u;
+    int oy = (top + spread) * u - job.mTop;
+    std::vector<float> to_inside ( w*h, far_away );
+    std::vector<float> to_outside( w*h, 0 );
+    for(int y=0; y<job.mHeight; ++y)
+    {
+      for(int x=0; x<job.mWidth; ++x)
+      {
+        if ( job.mAlpha[y*job.mWidth + x] >= 128 )
+        {
+          int i = (oy+y)*w + ox+x;
+          to_inside[i]  = 0;
+          to_outside[i] = far_away;
+        }
+      }
+    }
+    distanceTransform2D(to_inside,  w, h);
+    distanceTransform2D(to_outside, w, h);
+
+    // averages the signed distances, positive outside, of the upsampled pixels covered by each cell pixel
+    job.mCell.resize( info.mCellWidth * info.mCellHeight );
+    for(int cy=0; cy<info.mCellHeight; ++cy)
+    {
+      for(int cx=0; cx<info.mCellWidth; ++cx)
+      {
+        double sum = 0;
+        for(int sy=0; sy<u; ++sy)
+        {
+          for(int sx=0; sx<u; ++sx)
+          {
+            // the outline lies half way between an inside and an outside pixel
+            int i = (cy*u + sy)*w + cx*u + sx;
+            if (to_inside[i] > 0)
+              sum += sqrt(to_inside[i]) - 0.5;
+            else
+              sum -= sqrt(to_outside[i]) - 0.5;
+          }
+        }
+        double distance = sum / (u*u) / u;
+        double alpha = 0.5 - distance / (spread*2);
+        job.mCell[cy*info.mCellWidth + cx] = (unsigned char)( alpha <= 0 ? 0 : alpha >= 1 ? 255 : alpha * 255.0 + 0.5 );
+      }
+    }
+  }
+
+  class DistanceFieldTask: public ParallelForTask
+  {
+  public:
+    DistanceFieldTask(std::vector<DistanceFieldJob>& jobs, int upsampling, int spread): mJobs(jobs), mUpsampling(upsampling), mSpread(spread) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+        computeDistanceField(mJobs[i], mUpsampling, mSpread);
+    }
+
+  protected:
+    std::vector<DistanceFieldJob>& mJobs;
+    int mUpsampling;
+    int mSpread;
+  };
+}
+//-----------------------------------------------------------------------------
+// DistanceFieldAtlas
+//-----------------------------------------------------------------------------
+DistanceFieldAtlas::DistanceFieldAtlas(FontManager* fm, const String& font_file, int reference_size, int spread)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mFontManager = fm;
+  mFilePath = font_file;
+  mReferenceSize = reference_size;
+  mSpread = spread;
+  mUpsampling = 4;
+  mLineHeight = 0;
+  // the distance fields must be interpolated
+  mSmooth = true;
+
+  std::vector<char> data;
+  ref<VirtualFile> file = defFileSystem()->locateFile( font_file );
+  if ( file && file->load(data) && !data.empty() )
+    mFontFileMD5.compute( &data[0], (int)data.size() );
+  else
+    Log::error( Say("DistanceFieldAtlas: could not read font file '%s'.\n") << font_file );
+}
+//-----------------------------------------------------------------------------
+DistanceFieldAtlas::~DistanceFieldAtlas()
+{
+}
+//-----------------------------------------------------------------------------
+Font* DistanceFieldAtlas::sourceFont()
+{
+  if (!mSourceFont)
+  {
+    mSourceFont = new Font( mFontManager, filePath(), referenceSize() * upsampling() );
+    if (!mSourceFont->mFT_Face)
+    {
+      mSourceFont = NULL;
+      return NULL;
+    }
+  }
+  return mSourceFont.get();
+}
+//-----------------------------------------------------------------------------
+void DistanceFieldAtlas::releaseFreeTypeData()
+{
+  if (mSourceFont)
+  {
+    mSourceFont->releaseFreeTypeData();
+    mSourceFont = NULL;
+  }
+}
+//-----------------------------------------------------------------------------
+const DistanceFieldAtlas::GlyphInfo* DistanceFieldAtlas::glyphInfo(int character)
+{
+  std::map<int, GlyphInfo>::const_iterator it = mGlyphs.find(character);
+  if ( it == mGlyphs.end() )
+  {
+    generateGlyphs( std::vector<int>(1, character) );
+    it = mGlyphs.find(character);
+  }
+  return it != mGlyphs.end() ? &it->second : NULL;
+}
+//-----------------------------------------------------------------------------
+void DistanceFieldAtlas::generateGlyphs(const String& characters)
+{
+  std::vector<int> chars;
+  for(int i=0; i<characters.length(); ++i)
+    chars.push_back( characters[i] );
+  generateGlyphs(chars);
+}
+//-----------------------------------------------------------------------------
+void DistanceFieldAtlas::generateGlyphs(const std::vector<int>& characters)
+{
+  // FreeType is not thread safe: the glyphs are rasterized serially
+  std::vector<DistanceFieldJob> jobs;
+  std::set<int> queued;
+  Font* font = NULL;
+  for(size_t i=0; i<characters.size(); ++i)
+  {
+    if ( mGlyphs.find(characters[i]) != mGlyphs.end() || !queued.insert(characters[i]).second )
+      continue;
+
+    if ( !font && !(font = sourceFont()) )
+      return;
+
+    Font::Bitmap bitmap;
+    if ( !font->rasterize(characters[i], bitmap, 0) )
+      continue;
+
+    jobs.push_back( DistanceFieldJob() );
+    DistanceFieldJob& job = jobs.back();
+    job.mCharacter = characters[i];
+    job.mAlpha.swap( bitmap.mAlpha );
+    job.mWidth  = bitmap.mWidth;
+    job.mHeight = bitmap.mHeight;
+    job.mLeft   = bitmap.mLeft;
+    job.mTop    = bitmap.mTop;
+    job.mInfo.mGlyphIndex = bitmap.mGlyphIndex;
+    job.mInfo.mAdvance = bitmap.mAdvance / (float)upsampling();
+  }
+
+  if (jobs.empty())
+    return;
+
+  mLineHeight = font->mHeight / upsampling();
+
+  // the distance transforms take most of the time
+  DistanceFieldTask task( jobs, upsampling(), spread() );
+  parallelFor( 0, (int)jobs.size(), &task );
+
+  for(size_t i=0; i<jobs.size(); ++i)
+    addGlyph( jobs[i].mCharacter, jobs[i].mInfo, jobs[i].mCell.empty() ? NULL : &jobs[i].mCell[0] );
+}
+//-----------------------------------------------------------------------------
+void DistanceFieldAtlas::addGlyph(int character, GlyphInfo& info, const unsigned char* cell)
+{
+  info.mPage = -1;
+  if ( cell && !addCell(info.mCellWidth, info.mCellHeight, cell, info.mPage, info.mX, info.mY) )
+  {
+    Log::error( Say("DistanceFieldAtlas error (%s): could not allocate the glyph in the atlas.\n") << filePath() );
+    info.mPage = -1;
+    return;
+  }
+  mGlyphs[character] = info;
+}
+//-----------------------------------------------------------------------------
+String DistanceFieldAtlas::cacheFileName() const
+{
+  return Say("%s-%n-%n.vlsdf") << fontFileMD5().toStdString().c_str() << referenceSize() << spread();
+}
+//-----------------------------------------------------------------------------
+bool DistanceFieldAtlas::saveCache(VirtualFile* file) const
+{
+  if ( !file->open(OM_WriteOnly) )
+  {
+    Log::error( Say("DistanceFieldAtlas::saveCache(): could not open '%s' for writing.\n") << file->path() );
+    return false;
+  }
+
+  const long long header_size = 8 + 4 + 16 + 4*3 + 4 + 4;
+  const long long glyph_size  = 4*10;
+  long long expected = header_size;
+  long long bytes = file->write( CacheMagic, 8 );
+  bytes += file->writeUInt32( CacheVersion );
+  bytes += file->write( fontFileMD5().md5(), 16 );
+  bytes += file->writeSInt32( referenceSize() );
+  bytes += file->writeSInt32( spread() );
+  bytes += file->writeSInt32( upsampling() );
+  bytes += file->writeFloat( lineHeight() );
+  bytes += file->writeUInt32( (unsigned int)mGlyphs.size() );
+
+  std::vector<unsigned char> cell;
+  for(std::map<int, GlyphInfo>::const_iterator it = mGlyphs.begin(); it != mGlyphs.end(); ++it)
+  {
+    const GlyphInfo& info = it->second;
+    expected += glyph_size;
+    bytes += file->writeSInt32( it->first );
+    bytes += file->writeUInt32( info.mGlyphIndex );
+    bytes += file->writeFloat( info.mAdvance.x() );
+    bytes += file->writeFloat( info.mAdvance.y() );
+    bytes += file->writeSInt32( info.mLeft );
+    bytes += file->writeSInt32( info.mTop );
+    bytes += file->writeSInt32( info.mWidth );
+    bytes += file->writeSInt32( info.mHeight );
+    bytes += file->writeSInt32( info.mPage >= 0 ? info.mCellWidth  : 0 );
+    bytes += file->writeSInt32( info.mPage >= 0 ? info.mCellHeight : 0 );
+    if (info.mPage >= 0)
+    {
+      cell.resize( info.mCellWidth * info.mCellHeight );
+      cellAlpha( info.mPage, info.mX, info.mY, info.mCellWidth, info.mCellHeight, &cell[0] );
+      bytes += file->write( &cell[0], cell.size() );
+      expected += cell.size();
+    }
+  }
+
+  file->close();
+  if (bytes != expected)
+  {
+    Log::error( Say("DistanceFieldAtlas::saveCache(): error writing '%s'.\n") << file->path() );
+    return false;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool DistanceFieldAtlas::loadCache(VirtualFile* file)
+{
+  if ( !file->open(OM_ReadOnly) )
+  {
+    Log::error( Say("DistanceFieldAtlas::loadCache(): could not open '%s' for reading.\n") << file->path() );
+    return false;
+  }
+
+  // the cache must match the font file and the parameters
+  char magic[8] = { 0 };
+  unsigned char md5[16] = { 0 };
+  file->read( magic, 8 );
+  bool ok = memcmp( magic, CacheMagic, 8 ) == 0 && file->readUInt32() == CacheVersion;
+  ok = ok && file->read( md5, 16 ) == 16 && memcmp( md5, fontFileMD5().md5(), 16 ) == 0;
+  ok = ok && file->readSInt32() == referenceSize();
+  ok = ok && file->readSInt32() == spread();
+  ok = ok && file->readSInt32() == upsampling();
+  if (!ok)
+  {
+    Log::debug( Say("DistanceFieldAtlas::loadCache(): '%s' does not match '%s'.\n") << file->path() << filePath() );
+    file->close();
+    return false;
+  }
+
+  float line_height = file->readFloat();
+  unsigned int count = file->readUInt32();
+
+  // every glyph takes at least 40 bytes and its cell must fit in an atlas page
+  const long long glyph_size = 4*10;
+  const long long remaining = file->size() - file->position();
+  ok = remaining >= 0 && (long long)count <= remaining / glyph_size;
+
+  // the whole file is validated before committing any glyph
+  std::vector<int> characters;
+  std::vector<GlyphInfo> infos;
+  std::vector<size_t> offsets;
+  std::vector<unsigned char> cells;
+  for(unsigned int i=0; i<count && ok; ++i)
+  {
+    GlyphInfo info;
+    int character = file->readSInt32();
+    info.mGlyphIndex = file->readUInt32();
+    info.mAdvance.x() = file->readFloat();
+    info.mAdvance.y() = file->readFloat();
+    info.mLeft   = file->readSInt32();
+    info.mTop    = file->readSInt32();
+    info.mWidth  = file->readSInt32();
+    info.mHeight = file->readSInt32();
+    info.mCellWidth  = file->readSInt32();
+    info.mCellHeight = file->readSInt32();
+    ok = info.mCellWidth >= 0 && info.mCellHeight >= 0 && info.mCellWidth <= maxPageSize() && info.mCellHeight <= maxPageSize();
+    if (!ok)
+      break;
+    const size_t offset = cells.size();
+    const size_t cell_size = (size_t)info.mCellWidth * info.mCellHeight;
+    ok = (long long)cell_size <= file->size() - file->position();
+    if (ok && cell_size)
+    {
+      cells.resize( offset + cell_size );
+      ok = file->read( &cells[offset], cell_size ) == (long long)cell_size;
+    }
+    characters.push_back(character);
+    infos.push_back(info);
+    offsets.push_back(offset);
+  }
+  file->close();
+
+  if (!ok)
+  {
+    Log::error( Say("DistanceFieldAtlas::loadCache(): '%s' is corrupted.\n") << file->path() );
+    return false;
+  }
+
+  for(size_t i=0; i<infos.size(); ++i)
+  {
+    // the glyphs already generated are kept
+    const bool has_cell = infos[i].mCellWidth * infos[i].mCellHeight > 0;
+    if ( mGlyphs.find(characters[i]) == mGlyphs.end() )
+      addGlyph( characters[i], infos[i], has_cell ? &cells[offsets[i]] : NULL );
+  }
+  mLineHeight = line_height;
+  return true;
+}
+//-----------------------------------------------------------------------------
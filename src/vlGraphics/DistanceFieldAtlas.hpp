@@ -0,0 +1,155 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef DistanceFieldAtlas_INCLUDE_ONCE
+#define DistanceFieldAtlas_INCLUDE_ONCE
+
+#include <vlGraphics/GlyphAtlas.hpp>
+#include <vlCore/MD5CheckSum.hpp>
+#include <vlCore/String.hpp>
+#include <vlCore/Vector2.hpp>
+#include <map>
+
+namespace vl
+{
+  class Font;
+  class FontManager;
+  class VirtualFile;
+
+  //-----------------------------------------------------------------------------
+  // DistanceFieldAtlas
+  //-----------------------------------------------------------------------------
+  /**
+   * A GlyphAtlas containing the signed distance fields of the glyphs of a font file, shared by all the sizes of the font.
+   *
+   * The glyphs are rasterized by FreeType at upsampling() times the referenceSize(), then the exact euclidean distance transform 
+   * of the binarized glyph is computed and averaged down to the reference size. The distance is clamped to +/- spread() pixels at 
+   * the reference size and mapped to the alpha channel, the outline of the glyph being at 0.5. Since the distance is interpolated 
+   * linearly the same cells can be magnified and minified with little loss of quality, see Font::setDistanceFieldAtlas().
+   *
+   * The glyphs are generated on demand or in batches with generateGlyphs(), in which case the distance transforms are computed 
+   * in parallel using vl::parallelFor(). The atlas can be saved to and loaded from a cache file identified by the MD5 of the font file
+   * so that no FreeType rasterization is needed on the next runs, see FontManager::setDistanceFieldCacheDirectory().
+   * \sa Font, FontManager::acquireDistanceFieldFont()
+  */
+  class VLGRAPHICS_EXPORT DistanceFieldAtlas: public GlyphAtlas
+  {
+    VL_INSTRUMENT_CLASS(vl::DistanceFieldAtlas, GlyphAtlas)
+
+  public:
+    //! The metrics in pixels of a glyph at the reference size and its cell in the atlas.
+    struct GlyphInfo
+    {
+      GlyphInfo(): mGlyphIndex(0), mLeft(0), mTop(0), mWidth(0), mHeight(0), mPage(-1), mX(0), mY(0), mCellWidth(0), mCellHeight(0) {}
+      unsigned int mGlyphIndex;
+      fvec2 mAdvance;
+      //! The box of the glyph, see Glyph::left(), Glyph::top(), Glyph::width() and Glyph::height().
+      int mLeft;
+      int mTop;
+      int mWidth;
+      int mHeight;
+      //! The atlas page or -1 for glyphs without an image such as the space.
+      int mPage;
+      //! The cell contains the glyph's box enlarged by the spread on every side.
+      int mX;
+      int mY;
+      int mCellWidth;
+      int mCellHeight;
+    };
+
+  public:
+    //! Constructor: the glyphs are generated from the given font file rendered at \p reference_size 
+    //! with a distance range of +/- \p spread pixels.
+    DistanceFieldAtlas(FontManager* fm, const String& font_file, int reference_size=32, int spread=4);
+
+    ~DistanceFieldAtlas();
+
+    //! The font file the glyphs are generated from.
+    const String& filePath() const { return mFilePath; }
+
+    //! The MD5 of the font file, used to identify the cache files.
+    const MD5CheckSum& fontFileMD5() const { return mFontFileMD5; }
+
+    //! The size of the font at which the distance fields are stored, see Font::size().
+    int referenceSize() const { return mReferenceSize; }
+
+    //! The distance range in pixels at the reference size.
+    int spread() const { return mSpread; }
+
+    //! The glyphs are rasterized at upsampling() times the reference size (default 4).
+    int upsampling() const { return mUpsampling; }
+
+    //! The line height in pixels at the reference size.
+    float lineHeight() const { return mLineHeight; }
+
+    //! Returns (and eventually generates) the GlyphInfo of the given character, NULL if the glyph could not be generated.
+    const GlyphInfo* glyphInfo(int character);
+
+    //! Generates at once the glyphs of the given characters which are not in the atlas yet.
+    void generateGlyphs(const std::vector<int>& characters);
+
+    //! Generates at once the glyphs of the given characters which are not in the atlas yet.
+    void generateGlyphs(const String& characters);
+
+    //! The glyphs generated so far.
+    const std::map<int, GlyphInfo>& glyphs() const { return mGlyphs; }
+
+    //! The name of the cache file, made of the MD5 of the font file, the reference size and the spread.
+    String cacheFileName() const;
+
+    //! Writes the metrics and the distance fields of all the glyphs to the given file.
+    bool saveCache(VirtualFile* file) const;
+
+    //! Adds the glyphs stored in the given file, generated by saveCache(). Returns false if the file was not generated 
+    //! from the same font file and with the same parameters, in which case nothing is loaded.
+    bool loadCache(VirtualFile* file);
+
+    //! Releases the Font used to rasterize the glyphs, which is recreated on demand.
+    void releaseFreeTypeData();
+
+  protected:
+    Font* sourceFont();
+    void addGlyph(int character, GlyphInfo& info, const unsigned char* cell);
+
+  protected:
+    FontManager* mFontManager;
+    String mFilePath;
+    MD5CheckSum mFontFileMD5;
+    ref<Font> mSourceFont;
+    std::map<int, GlyphInfo> mGlyphs;
+    int mReferenceSize;
+    int mSpread;
+    int mUpsampling;
+    float mLineHeight;
+  };
+}
+
+#endif
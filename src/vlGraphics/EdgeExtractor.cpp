@@ -36,31 +36,159 @@
 #include <vlCore/Log.hpp>
 #include <vlGraphics/Array.hpp>
 #include <vlGraphics/Geometry.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/Say.hpp>
 
 using namespace vl;
 
-//-----------------------------------------------------------------------------
-void EdgeExtractor::addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n)
+namespace
 {
-  std::set<EdgeExtractor::Edge>::iterator it = edges.find(e);
-  if (it != edges.end())
+  // the half-edges are partitioned by hash in a fixed number of buckets processed in parallel
+  const int BucketBits = 8;
+  const int BucketCount = 1 << BucketBits;
+
+  const unsigned long long InvalidKey = ~0ULL;
+
+  // 64 bits finalizer of MurmurHash3
+  inline unsigned long long mixBits(unsigned long long k)
   {
-    VL_CHECK(!it->normal1().isNull())
-    if (mWarnNonManifold && !it->normal2().isNull())
-      vl::Log::error("EdgeExtractor: non-manifold mesh detected!\n");
-      EdgeExtractor::Edge edge = e;
-      edge.setNormal1(it->normal1());
-      edge.setNormal2(n);
-      edges.erase( it );
-      edges.insert(edge);
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
   }
-  else
+
+  inline unsigned long long hashPosition(const fvec3& v)
   {
-    VL_CHECK(!n.isNull());
-    EdgeExtractor::Edge edge = e;
-    edge.setNormal1(n);
-    edges.insert(edge);
+    unsigned int b[3];
+    // adding 0 turns -0 into +0 which compares equal
+    float f[] = { v.x() + 0.0f, v.y() + 0.0f, v.z() + 0.0f };
+    memcpy(b, f, sizeof(b));
+    return mixBits( ((unsigned long long)b[0] << 32 | b[1]) ^ mixBits(b[2]) );
   }
+
+  inline int tableSize(int count)
+  {
+    int size = 16;
+    while(size < count * 2)
+      size <<= 1;
+    return size;
+  }
+
+  struct HalfEdge
+  {
+    // the welded vertex ids of the edge, the smallest in the upper 32 bits
+    unsigned long long mKey;
+    int mTriangle;
+  };
+
+  //-----------------------------------------------------------------------------
+  class HalfEdgeTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int itri=begin; itri<end; ++itri)
+      {
+        const int* tri = &(*mTriangles)[itri*3];
+        const int id[] = { (*mWelded)[tri[0]], (*mWelded)[tri[1]], (*mWelded)[tri[2]] };
+        HalfEdge* he = &(*mHalfEdges)[itri*3];
+        // compute normal
+        fvec3 v0 = (*mPositions)[id[0]];
+        fvec3 n  = cross((*mPositions)[id[1]] - v0, (*mPositions)[id[2]] - v0).normalize();
+        (*mNormals)[itri] = n;
+        for(int k=0; k<3; ++k)
+        {
+          unsigned long long a = id[k];
+          unsigned long long b = id[(k+1)%3];
+          he[k].mKey = n.isNull() ? InvalidKey : a < b ? a << 32 | b : b << 32 | a;
+          he[k].mTriangle = itri;
+        }
+      }
+    }
+
+  public:
+    const std::vector<int>* mTriangles;
+    const std::vector<int>* mWelded;
+    const std::vector<fvec3>* mPositions;
+    std::vector<fvec3>* mNormals;
+    std::vector<HalfEdge>* mHalfEdges;
+  };
+  //-----------------------------------------------------------------------------
+  class EdgeBucketTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      std::vector<int> table;
+      std::vector<unsigned long long> keys;
+      for(int ib=begin; ib<end; ++ib)
+      {
+        int first = (*mBucketStart)[ib];
+        int last  = (*mBucketStart)[ib+1];
+        std::vector<EdgeExtractor::Edge>& edges = (*mBucketEdges)[ib];
+        edges.clear();
+        keys.clear();
+        if (first == last)
+          continue;
+
+        // maps the edge keys to the edges of the bucket, the half-edges are visited in triangle order
+        int mask = tableSize(last - first) - 1;
+        table.assign(mask + 1, -1);
+        for(int i=first; i<last; ++i)
+        {
+          const HalfEdge& he = (*mHalfEdges)[i];
+          const fvec3& n = (*mNormals)[he.mTriangle];
+          int slot = (int)(mixBits(he.mKey) & mask);
+          while(table[slot] >= 0 && keys[table[slot]] != he.mKey)
+            slot = (slot + 1) & mask;
+          if (table[slot] >= 0)
+          {
+            EdgeExtractor::Edge& edge = edges[table[slot]];
+            if (!edge.normal2().isNull())
+              ++(*mNonManifold)[ib];
+            edge.setNormal2(n);
+          }
+          else
+          {
+            table[slot] = (int)edges.size();
+            keys.push_back(he.mKey);
+            edges.push_back( EdgeExtractor::Edge( (*mPositions)[(int)(he.mKey >> 32)], (*mPositions)[(int)(he.mKey & 0xFFFFFFFF)] ) );
+            edges.back().setNormal1(n);
+          }
+        }
+
+        for(size_t i=0; i<edges.size(); ++i)
+        {
+          EdgeExtractor::Edge& e = edges[i];
+          // boundary edge
+          if (e.normal2().isNull())
+            e.setIsCrease(true);
+          else
+          // crease edge
+          {
+            float cos1 = dot(e.normal1(), e.normal2());
+            cos1 = vl::clamp(cos1,-1.0f,+1.0f);
+            // return value in the interval [0,pi] radians
+            float a1 = acos(cos1) / fPi * 180.0f;
+            if( a1 > mCreaseAngle )
+              e.setIsCrease(true);
+          }
+        }
+      }
+    }
+
+  public:
+    const std::vector<int>* mBucketStart;
+    const std::vector<HalfEdge>* mHalfEdges;
+    const std::vector<fvec3>* mNormals;
+    const std::vector<fvec3>* mPositions;
+    std::vector< std::vector<EdgeExtractor::Edge> >* mBucketEdges;
+    std::vector<int>* mNonManifold;
+    float mCreaseAngle;
+  };
 }
 //-----------------------------------------------------------------------------
 //! Extracts the edges from the given Geometry and appends them to edges().
@@ -68,60 +196,103 @@ void EdgeExtractor::extractEdges(Geometry* geom)
 {
   ArrayAbstract* verts = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
 
-  // mic fixme:
-  // here the bottle-neck seems to be the continuous allocation/deallocation and insertion/search time,
-  // maybe a memory-pool-managed hash table would help?
   if (!verts)
   {
     vl::Log::error("EdgeExtractor::extractEdges(geom): 'geom' must have a vertex array of type ArrayFloat3.\n");
     return;
   }
 
-  std::set<Edge> edges;
+  // weld the vertices sharing the same position
+  std::vector<fvec3> positions;
+  std::vector<int> welded( verts->size() );
+  {
+    int mask = tableSize((int)verts->size()) - 1;
+    std::vector<int> table(mask + 1, -1);
+    for(size_t i=0; i<verts->size(); ++i)
+    {
+      fvec3 v = (fvec3)verts->getAsVec3(i);
+      int slot = (int)(hashPosition(v) & mask);
+      while(table[slot] >= 0 && positions[table[slot]] != v)
+        slot = (slot + 1) & mask;
+      if (table[slot] < 0)
+      {
+        table[slot] = (int)positions.size();
+        positions.push_back(v);
+      }
+      welded[i] = table[slot];
+    }
+  }
 
-  // iterate all primitives
+  // collect the non degenerate triangles of all the draw calls
+  std::vector<int> triangles;
   for(int iprim=0; iprim<geom->drawCalls()->size(); ++iprim)
   {
     DrawCall* prim = geom->drawCalls()->at(iprim);
     // iterate triangles (if present)
     for(TriangleIterator trit = prim->triangleIterator(); trit.hasNext(); trit.next())
     {
-      size_t a = trit.a();
-      size_t b = trit.b();
-      size_t c = trit.c();
+      int a = trit.a();
+      int b = trit.b();
+      int c = trit.c();
       if (a == b || b == c || c == a)
         continue;
-      // compute normal
-      fvec3 v0 = (fvec3)verts->getAsVec3(a);
-      fvec3 v1 = (fvec3)verts->getAsVec3(b) - v0;
-      fvec3 v2 = (fvec3)verts->getAsVec3(c) - v0;
-      fvec3 n = cross(v1,v2).normalize();
-      if (n.isNull())
-        continue;
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(a), (fvec3)verts->getAsVec3(b) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(b), (fvec3)verts->getAsVec3(c) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(c), (fvec3)verts->getAsVec3(a) ), n );
+      triangles.push_back(a);
+      triangles.push_back(b);
+      triangles.push_back(c);
     }
   }
+  int tri_count = (int)triangles.size() / 3;
+  if (!tri_count)
+    return;
 
-  for(std::set<Edge>::iterator it = edges.begin(); it != edges.end(); ++it)
+  // compute the triangle normals and the half-edges
+  std::vector<fvec3> normals(tri_count);
+  std::vector<HalfEdge> half_edges(tri_count * 3);
+  HalfEdgeTask he_task;
+  he_task.mTriangles = &triangles;
+  he_task.mWelded    = &welded;
+  he_task.mPositions = &positions;
+  he_task.mNormals   = &normals;
+  he_task.mHalfEdges = &half_edges;
+  parallelFor(0, tri_count, &he_task, 4096);
+
+  // partition the half-edges by hash, preserving the triangle order within each bucket
+  std::vector<int> bucket_start(BucketCount + 1, 0);
+  for(size_t i=0; i<half_edges.size(); ++i)
+    if (half_edges[i].mKey != InvalidKey)
+      ++bucket_start[ (mixBits(half_edges[i].mKey) >> (64 - BucketBits)) + 1 ];
+  for(int ib=0; ib<BucketCount; ++ib)
+    bucket_start[ib+1] += bucket_start[ib];
+  std::vector<HalfEdge> partitioned( bucket_start[BucketCount] );
   {
-    Edge e = *it;
-    // boundary edge
-    if (e.normal2().isNull())
-      e.setIsCrease(true);
-    else
-    // crease edge
-    {
-      float cos1 = dot(e.normal1(), e.normal2());
-      cos1 = vl::clamp(cos1,-1.0f,+1.0f);
-      // return value in the interval [0,pi] radians
-      float a1 = acos(cos1) / fPi * 180.0f;
-      if( a1 > creaseAngle() )
-        e.setIsCrease(true);
-    }
-    mEdges.push_back(e);
+    std::vector<int> offset(bucket_start.begin(), bucket_start.end() - 1);
+    for(size_t i=0; i<half_edges.size(); ++i)
+      if (half_edges[i].mKey != InvalidKey)
+        partitioned[ offset[ mixBits(half_edges[i].mKey) >> (64 - BucketBits) ]++ ] = half_edges[i];
+  }
+
+  // build the edges of each bucket
+  std::vector< std::vector<Edge> > bucket_edges(BucketCount);
+  std::vector<int> non_manifold(BucketCount, 0);
+  EdgeBucketTask edge_task;
+  edge_task.mBucketStart = &bucket_start;
+  edge_task.mHalfEdges   = &partitioned;
+  edge_task.mNormals     = &normals;
+  edge_task.mPositions   = &positions;
+  edge_task.mBucketEdges = &bucket_edges;
+  edge_task.mNonManifold = &non_manifold;
+  edge_task.mCreaseAngle = creaseAngle();
+  parallelFor(0, BucketCount, &edge_task);
+
+  int non_manifold_count = 0;
+  for(int ib=0; ib<BucketCount; ++ib)
+  {
+    mEdges.insert(mEdges.end(), bucket_edges[ib].begin(), bucket_edges[ib].end());
+    non_manifold_count += non_manifold[ib];
   }
+
+  if (mWarnNonManifold && non_manifold_count)
+    vl::Log::error( Say("EdgeExtractor: non-manifold mesh detected! (%n edges shared by more than two triangles)\n") << non_manifold_count );
 }
 //-----------------------------------------------------------------------------
 ref<Geometry> EdgeExtractor::generateEdgeGeometry() const
@@ -36,7 +36,6 @@
 #include <vlCore/Vector3.hpp>
 #include <vlGraphics/link_config.hpp>
 #include <vector>
-#include <set>
 
 namespace vl
 {
@@ -65,6 +64,9 @@ namespace vl
   - Assign a new EdgeUpdateCallback to the previously created Actor, using the Actor::renderEventCallbacks() method.
   - Initialize the previously created EdgeUpdateCallback edges with the edges extracted by the EdgeExtractor, 
     that is, assign EdgeExtractor::edges() to EdgeUpdateCallback::edges().
+
+  The vertices sharing the same position are welded and the edges are matched using hash tables. The triangles are processed in parallel
+  using defThreadPool(), the order of the extracted edges is not specified.
  
   \sa 
   - \ref pagGuideEdgeRendering "Edge Enhancement and Wireframe Rendering Tutorial"
@@ -159,9 +161,6 @@ namespace vl
     bool warnNonManifold() const { return mWarnNonManifold; }
     void setWarnNonManifold(bool warn_on) { mWarnNonManifold = warn_on; }
 
-  protected:
-    void addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n);
-
   protected:
     std::vector<Edge> mEdges;
     float mCreaseAngle;
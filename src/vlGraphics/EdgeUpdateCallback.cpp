@@ -0,0 +1,349 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/EdgeUpdateCallback.hpp>
+#include <vlGraphics/DrawArrays.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <algorithm>
+
+#if VL_SSE2
+  #include <emmintrin.h>
+#endif
+
+using namespace vl;
+
+namespace
+{
+  // number of edges per cluster, must be a multiple of 4
+  const int ClusterSize = 64;
+  // number of clusters per group
+  const int GroupSize = 16;
+  // number of edges above which the update is multithreaded
+  const int ParallelThreshold = 16384;
+
+  // interleaves the lower 10 bits of x, y and z
+  inline unsigned int morton3D(unsigned int x, unsigned int y, unsigned int z)
+  {
+    unsigned int code = 0;
+    for(int i=0; i<10; ++i)
+      code |= ((x >> i) & 1) << (3*i) | ((y >> i) & 1) << (3*i+1) | ((z >> i) & 1) << (3*i+2);
+    return code;
+  }
+
+  //-----------------------------------------------------------------------------
+  // Returns true if the faces of all the edges of the cluster face the same way as seen from 'eye', in which case none of them is a silhouette.
+  inline bool isClusterCulled(const EdgeUpdateCallback::Cluster& cluster, const fvec3& eye)
+  {
+    if (cluster.mCosAngle <= 0)
+      return false;
+    // s = dot(n, p - eye) is bounded by dot(n, w) +/- mRadius with n inside the cone
+    fvec3 w = cluster.mCenter - eye;
+    float aw = dot(cluster.mAxis, w);
+    float perp = sqrt( std::max(0.0f, dot(w, w) - aw*aw) );
+    return aw * cluster.mCosAngle - perp * cluster.mSinAngle >  cluster.mRadius ||
+           aw * cluster.mCosAngle + perp * cluster.mSinAngle < -cluster.mRadius;
+  }
+
+  //-----------------------------------------------------------------------------
+  class SilhouetteTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int igroup=begin; igroup<end; ++igroup)
+      {
+        const EdgeUpdateCallback::Cluster& group = (*mGroups)[igroup];
+        if (mWrite)
+          write(group, (*mGroupVisible)[igroup]);
+        else
+          (*mGroupVisible)[igroup] = classify(group);
+      }
+    }
+
+    int classify(const EdgeUpdateCallback::Cluster& group)
+    {
+      bool group_culled = isClusterCulled(group, mEye);
+      int visible = 0;
+      for(int icluster=group.mFirst; icluster<group.mFirst+group.mCount; ++icluster)
+      {
+        const EdgeUpdateCallback::Cluster& cluster = (*mClusters)[icluster];
+        int first = cluster.mFirst;
+        int last  = cluster.mFirst + cluster.mCount;
+        if (group_culled || isClusterCulled(cluster, mEye))
+        {
+          for(int i=first; i<last; ++i)
+          {
+            mVisible[i] = mShowCreases & mIsCrease[i];
+            visible += mVisible[i];
+          }
+          continue;
+        }
+
+        int i = first;
+#if VL_SSE2
+        const __m128 ex = _mm_set1_ps(mEye.x());
+        const __m128 ey = _mm_set1_ps(mEye.y());
+        const __m128 ez = _mm_set1_ps(mEye.z());
+        const __m128 zero = _mm_setzero_ps();
+        for(; i<last; i+=4)
+        {
+          // s = d - dot(n, eye) is the signed distance of the eye from the plane of the face
+          __m128 s1 = _mm_sub_ps( _mm_loadu_ps(mPlanes[3]+i), _mm_add_ps( _mm_add_ps( _mm_mul_ps(_mm_loadu_ps(mPlanes[0]+i), ex), _mm_mul_ps(_mm_loadu_ps(mPlanes[1]+i), ey) ), _mm_mul_ps(_mm_loadu_ps(mPlanes[2]+i), ez) ) );
+          __m128 s2 = _mm_sub_ps( _mm_loadu_ps(mPlanes[7]+i), _mm_add_ps( _mm_add_ps( _mm_mul_ps(_mm_loadu_ps(mPlanes[4]+i), ex), _mm_mul_ps(_mm_loadu_ps(mPlanes[5]+i), ey) ), _mm_mul_ps(_mm_loadu_ps(mPlanes[6]+i), ez) ) );
+          int mask = _mm_movemask_ps( _mm_cmplt_ps( _mm_mul_ps(s1, s2), zero ) );
+          for(int k=0; k<4; ++k)
+          {
+            mVisible[i+k] = (char)((mask >> k) & 1) | (mShowCreases & mIsCrease[i+k]);
+            visible += mVisible[i+k];
+          }
+        }
+#endif
+        for(; i<last; ++i)
+        {
+          float s1 = mPlanes[3][i] - (mPlanes[0][i]*mEye.x() + mPlanes[1][i]*mEye.y() + mPlanes[2][i]*mEye.z());
+          float s2 = mPlanes[7][i] - (mPlanes[4][i]*mEye.x() + mPlanes[5][i]*mEye.y() + mPlanes[6][i]*mEye.z());
+          mVisible[i] = (char)(s1 * s2 < 0) | (mShowCreases & mIsCrease[i]);
+          visible += mVisible[i];
+        }
+      }
+      return visible;
+    }
+
+    void write(const EdgeUpdateCallback::Cluster& group, int offset)
+    {
+      int first = (*mClusters)[group.mFirst].mFirst;
+      int last  = (*mClusters)[group.mFirst + group.mCount - 1].mFirst + (*mClusters)[group.mFirst + group.mCount - 1].mCount;
+      fvec3* out = mVerts + offset * 2;
+      for(int i=first; i<last; ++i)
+      {
+        if (mVisible[i])
+        {
+          const EdgeExtractor::Edge& edge = (*mEdges)[ mOrder[i] ];
+          *out++ = edge.vertex1();
+          *out++ = edge.vertex2();
+        }
+      }
+    }
+
+  public:
+    const std::vector<EdgeUpdateCallback::Cluster>* mGroups;
+    const std::vector<EdgeUpdateCallback::Cluster>* mClusters;
+    const std::vector<EdgeExtractor::Edge>* mEdges;
+    std::vector<int>* mGroupVisible;
+    const float* mPlanes[8];
+    const int* mOrder;
+    const char* mIsCrease;
+    char* mVisible;
+    fvec3* mVerts;
+    fvec3 mEye;
+    char mShowCreases;
+    bool mWrite;
+  };
+
+  //-----------------------------------------------------------------------------
+  // Computes the normal cone and the bounding sphere of the edges in [first, last).
+  EdgeUpdateCallback::Cluster computeCluster(const std::vector<float>* planes, const std::vector<fvec3>& mids, int first, int last)
+  {
+    EdgeUpdateCallback::Cluster cluster;
+    cluster.mFirst = first;
+    cluster.mCount = last - first;
+
+    AABB aabb;
+    fvec3 axis;
+    for(int i=first; i<last; ++i)
+    {
+      aabb.addPoint((vec3)mids[i]);
+      axis += fvec3(planes[0][i], planes[1][i], planes[2][i]) + fvec3(planes[4][i], planes[5][i], planes[6][i]);
+    }
+    cluster.mCenter = (fvec3)aabb.center();
+    cluster.mRadius = 0;
+    for(int i=first; i<last; ++i)
+      cluster.mRadius = std::max(cluster.mRadius, (mids[i] - cluster.mCenter).length());
+
+    cluster.mAxis = axis.normalize();
+    cluster.mCosAngle = axis.isNull() ? -1.0f : 1.0f;
+    for(int i=first; i<last && cluster.mCosAngle > 0; ++i)
+    {
+      // null normals (padding and boundary edges) never generate silhouettes
+      fvec3 n1(planes[0][i], planes[1][i], planes[2][i]);
+      fvec3 n2(planes[4][i], planes[5][i], planes[6][i]);
+      if (!n1.isNull())
+        cluster.mCosAngle = std::min(cluster.mCosAngle, dot(n1, cluster.mAxis));
+      if (!n2.isNull())
+        cluster.mCosAngle = std::min(cluster.mCosAngle, dot(n2, cluster.mAxis));
+    }
+    // a tiny margin protects from the rounding errors
+    cluster.mCosAngle = cluster.mCosAngle > 0 ? cluster.mCosAngle - 1e-4f : -1.0f;
+    cluster.mSinAngle = sqrt( std::max(0.0f, 1.0f - cluster.mCosAngle*cluster.mCosAngle) );
+    cluster.mRadius *= 1.0001f;
+    return cluster;
+  }
+}
+//-----------------------------------------------------------------------------
+void EdgeUpdateCallback::prepareEdgeData()
+{
+  mEdgeDataDirty = false;
+
+  int count = (int)mEdges.size();
+  int padded = (count + 3) & ~3;
+
+  // sort the edges by the orientation of their faces and then spatially
+  AABB aabb;
+  for(int i=0; i<count; ++i)
+    aabb.addPoint( (vec3)((mEdges[i].vertex1() + mEdges[i].vertex2()) * 0.5f) );
+  fvec3 box_min = (fvec3)aabb.minCorner();
+  fvec3 box_size = (fvec3)(aabb.maxCorner() - aabb.minCorner());
+  std::vector< std::pair<unsigned int, int> > keys(count);
+  for(int i=0; i<count; ++i)
+  {
+    const EdgeExtractor::Edge& e = mEdges[i];
+    fvec3 mid = (e.vertex1() + e.vertex2()) * 0.5f;
+    unsigned int q[3];
+    for(int k=0; k<3; ++k)
+      q[k] = box_size[k] > 0 ? (unsigned int)std::min(1023.0f, (mid[k] - box_min[k]) / box_size[k] * 1024.0f) : 0;
+    fvec3 n = e.normal1() + e.normal2();
+    int axis = fabs(n.x()) > fabs(n.y()) ? (fabs(n.x()) > fabs(n.z()) ? 0 : 2) : (fabs(n.y()) > fabs(n.z()) ? 1 : 2);
+    unsigned int face = axis * 2 + (n[axis] < 0 ? 1 : 0);
+    keys[i] = std::pair<unsigned int, int>(face << 30 | morton3D(q[0], q[1], q[2]), i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // structure of arrays of the face planes
+  mOrder.assign(padded, 0);
+  mIsCrease.assign(padded, 0);
+  for(int k=0; k<8; ++k)
+    mPlanes[k].assign(padded, 0.0f);
+  std::vector<fvec3> mids(padded);
+  for(int i=0; i<count; ++i)
+  {
+    const EdgeExtractor::Edge& e = mEdges[ keys[i].second ];
+    fvec3 mid = (e.vertex1() + e.vertex2()) * 0.5f;
+    mOrder[i] = keys[i].second;
+    mIsCrease[i] = e.isCrease();
+    mids[i] = mid;
+    // boundary edges have a null normal2 and are never silhouettes
+    mPlanes[0][i] = e.normal1().x();
+    mPlanes[1][i] = e.normal1().y();
+    mPlanes[2][i] = e.normal1().z();
+    mPlanes[3][i] = dot(e.normal1(), mid);
+    mPlanes[4][i] = e.normal2().x();
+    mPlanes[5][i] = e.normal2().y();
+    mPlanes[6][i] = e.normal2().z();
+    mPlanes[7][i] = dot(e.normal2(), mid);
+  }
+  for(int i=count; i<padded; ++i)
+    mids[i] = count ? mids[count-1] : fvec3();
+
+  // two levels hierarchy of clusters
+  mClusters.clear();
+  for(int first=0; first<padded; first+=ClusterSize)
+    mClusters.push_back( computeCluster(mPlanes, mids, first, std::min(padded, first+ClusterSize)) );
+  mGroups.clear();
+  for(int first=0; first<(int)mClusters.size(); first+=GroupSize)
+  {
+    int last = std::min((int)mClusters.size(), first+GroupSize);
+    Cluster group = computeCluster(mPlanes, mids, mClusters[first].mFirst, mClusters[last-1].mFirst + mClusters[last-1].mCount);
+    group.mFirst = first;
+    group.mCount = last - first;
+    mGroups.push_back(group);
+  }
+  mGroupVisible.resize(mGroups.size());
+  mVisible.resize(padded);
+}
+//-----------------------------------------------------------------------------
+void EdgeUpdateCallback::onActorRenderStarted(Actor* act, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
+{
+  if (pass != 0)
+    return;
+
+  if (mEdgeDataDirty)
+    prepareEdgeData();
+
+  // the silhouette test is done in object space: the faces of a silhouette edge lie on opposite sides of the eye
+  mat4 vmat = cam->viewMatrix();
+  if (act->transform())
+    vmat = vmat * act->transform()->worldMatrix();
+  fvec3 eye = (fvec3)vmat.getInverse().getT();
+
+  ref<Geometry> geom = cast<Geometry>(renderable);
+  ref<ArrayFloat3> vert_array = cast<ArrayFloat3>(geom->vertexArray());
+  if (!vert_array || vert_array->size() < mEdges.size()*2)
+    return;
+
+  SilhouetteTask task;
+  task.mGroups       = &mGroups;
+  task.mClusters     = &mClusters;
+  task.mEdges        = &mEdges;
+  task.mGroupVisible = &mGroupVisible;
+  for(int k=0; k<8; ++k)
+    task.mPlanes[k]  = mPlanes[k].empty() ? NULL : &mPlanes[k][0];
+  task.mOrder        = mOrder.empty() ? NULL : &mOrder[0];
+  task.mIsCrease     = mIsCrease.empty() ? NULL : &mIsCrease[0];
+  task.mVisible      = mVisible.empty() ? NULL : &mVisible[0];
+  task.mVerts        = vert_array->begin();
+  task.mEye          = eye;
+  task.mShowCreases  = showCreases() ? 1 : 0;
+
+  bool parallel = (int)mEdges.size() >= ParallelThreshold;
+  int group_count = (int)mGroups.size();
+
+  // classify the edges
+  task.mWrite = false;
+  if (parallel)
+    parallelFor(0, group_count, &task);
+  else
+    task.run(0, group_count, 0);
+
+  // compact the visible edges at the beginning of the vertex array
+  mVisibleEdgeCount = 0;
+  for(int i=0; i<group_count; ++i)
+  {
+    int visible = mGroupVisible[i];
+    mGroupVisible[i] = mVisibleEdgeCount;
+    mVisibleEdgeCount += visible;
+  }
+  task.mWrite = true;
+  if (parallel)
+    parallelFor(0, group_count, &task);
+  else
+    task.run(0, group_count, 0);
+
+  DrawArrays* draw_arrays = geom->drawCalls()->empty() ? NULL : cast<DrawArrays>(geom->drawCalls()->at(0));
+  if (draw_arrays)
+    draw_arrays->setCount(mVisibleEdgeCount * 2);
+  else
+  {
+    // degenerate
+    for(size_t i=mVisibleEdgeCount*2; i<mEdges.size()*2; ++i)
+      vert_array->at(i) = fvec3();
+  }
+}
+//-----------------------------------------------------------------------------
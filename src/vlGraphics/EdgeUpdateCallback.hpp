@@ -40,18 +40,44 @@
 namespace vl
 {
   //! The EdgeUpdateCallback class updates at every frame the edges of an Actor for the purpose of edge-enhancement.
+  //!
+  //! The silhouette test is performed in the Actor's object space on a structure-of-arrays copy of the edges, using SSE2 when available
+  //! and defThreadPool() for large edge sets. The edges are grouped in spatially coherent clusters bounded by a sphere and by a cone
+  //! containing the normals of their faces, clusters that cannot contain any silhouette edge from the current point of view are skipped
+  //! at once. The visible edges are compacted at the beginning of the vertex array and, if the first draw call is a DrawArrays, its count 
+  //! is updated accordingly.
   //! \sa EdgeExtractor
-  class EdgeUpdateCallback: public ActorEventCallback
+  class VLGRAPHICS_EXPORT EdgeUpdateCallback: public ActorEventCallback
   {
     VL_INSTRUMENT_CLASS(vl::EdgeUpdateCallback, ActorEventCallback)
 
   public:
-    EdgeUpdateCallback(): mShowCreases(true) 
+    //! A cluster of edges, see EdgeUpdateCallback.
+    struct Cluster
+    {
+      //! The axis of the cone containing the normals of the faces of the edges.
+      fvec3 mAxis;
+      //! The sine of the cone's half-angle.
+      float mSinAngle;
+      //! The center of the sphere bounding the edges' midpoints.
+      fvec3 mCenter;
+      //! The cosine of the cone's half-angle, -1 if the normals are not contained in a cone narrower than 180 degrees.
+      float mCosAngle;
+      //! The radius of the sphere bounding the edges' midpoints.
+      float mRadius;
+      //! The first edge of the cluster.
+      int mFirst;
+      //! The number of edges or subclusters contained in the cluster.
+      int mCount;
+    };
+
+  public:
+    EdgeUpdateCallback(): mVisibleEdgeCount(0), mShowCreases(true), mEdgeDataDirty(true)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
-    EdgeUpdateCallback(const std::vector<EdgeExtractor::Edge>& edge): mEdges(edge), mShowCreases(false) 
+    EdgeUpdateCallback(const std::vector<EdgeExtractor::Edge>& edge): mEdges(edge), mVisibleEdgeCount(0), mShowCreases(false), mEdgeDataDirty(true)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
@@ -63,51 +89,31 @@ namespace vl
 
     virtual void onActorDelete(Actor*) {}
 
-    virtual void onActorRenderStarted(Actor* act, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
-    {
-      if (pass != 0)
-        return;
+    virtual void onActorRenderStarted(Actor* act, real frame_clock, const Camera* cam, Renderable* renderable, const Shader*, int pass);
 
-      fmat4 vmat = (fmat4)cam->viewMatrix();
-      if (act->transform())
-        vmat = vmat * (fmat4)act->transform()->worldMatrix();
-      fmat4 nmat = vmat.as3x3();
-      nmat = nmat.getInverse().transpose();
+    const std::vector<EdgeExtractor::Edge>& edges() const { return mEdges; }
+    //! Returns the edges to be updated, the internal clusters are rebuilt at the next rendering.
+    std::vector<EdgeExtractor::Edge>& edges() { mEdgeDataDirty = true; return mEdges; }
 
-      ref<Geometry> geom = cast<Geometry>(renderable);
-      ref<ArrayFloat3> vert_array = cast<ArrayFloat3>(geom->vertexArray());
-      // VL_CHECK(vert_array->size() == edges().size()*2);
-      for(unsigned i=0; i<edges().size(); ++i)
-      {
-        bool insert_edge = edges()[i].isCrease() && showCreases();
-        if (!insert_edge)
-        {
-          fvec3 v1 = vmat * edges()[i].vertex1();
-          fvec3 v2 = vmat * edges()[i].vertex2();
-          fvec3 v  = ((v1+v2) * 0.5f).normalize();
-          fvec3 n1 = nmat * edges()[i].normal1();
-          fvec3 n2 = nmat * edges()[i].normal2();
-          insert_edge = dot(n1, v) * dot(n2, v) < 0;
-        }
-        if ( insert_edge )
-        {
-          vert_array->at(i*2+0) = edges()[i].vertex1();
-          vert_array->at(i*2+1) = edges()[i].vertex2();
-        }
-        else
-        {
-          // degenerate
-          vert_array->at(i*2+0) = vert_array->at(i*2+1);
-        }
-      }
-    }
+    //! The number of edges rendered at the last update.
+    int visibleEdgeCount() const { return mVisibleEdgeCount; }
 
-    const std::vector<EdgeExtractor::Edge>& edges() const { return mEdges; }
-    std::vector<EdgeExtractor::Edge>& edges() { return mEdges; }
+  protected:
+    void prepareEdgeData();
 
   private:
     std::vector<EdgeExtractor::Edge> mEdges;
+    // the edges in cluster order: face planes in the form (normal, distance from the origin) as 8 arrays padded to a multiple of 4
+    std::vector<float> mPlanes[8];
+    std::vector<int> mOrder;
+    std::vector<char> mIsCrease;
+    std::vector<Cluster> mClusters;
+    std::vector<Cluster> mGroups;
+    std::vector<int> mGroupVisible;
+    std::vector<char> mVisible;
+    int mVisibleEdgeCount;
     bool mShowCreases;
+    bool mEdgeDataDirty;
   };
 
 }
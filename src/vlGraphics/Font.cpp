@@ -71,7 +71,8 @@ const char* get_ft_error_message(int error)
 //-----------------------------------------------------------------------------
 Glyph::~Glyph()
 {
-  if (mTextureHandle)
+  // atlas pages are owned by the atlas
+  if (mTextureHandle && mAtlasPage < 0)
   {
     glDeleteTextures(1, &mTextureHandle);
     mTextureHandle = 0;
@@ -88,6 +89,10 @@ Font::Font(FontManager* fm)
   mFT_Face = NULL;
   mSmooth  = false;
   mFreeTypeLoadForceAutoHint = true;
+  mGlyphsTick = 0;
+  mAtlas = new GlyphAtlas;
+  mAtlasTick = mAtlas->tick();
+  mAtlasGeneration = mAtlas->generation();
   setSize(14);
 }
 //-----------------------------------------------------------------------------
@@ -99,12 +104,17 @@ Font::Font(FontManager* fm, const String& font_file, int size)
   mFT_Face = NULL;
   mSmooth  = false;
   mFreeTypeLoadForceAutoHint = true;
+  mGlyphsTick = 0;
+  mAtlas = new GlyphAtlas;
+  mAtlasTick = mAtlas->tick();
+  mAtlasGeneration = mAtlas->generation();
   loadFont(font_file);
   setSize(size);
 }
 //-----------------------------------------------------------------------------
 Font::~Font()
 {
+  releaseGlyphs();
   releaseFreeTypeData();
 }
 //-----------------------------------------------------------------------------
@@ -131,8 +141,75 @@ void Font::setSize(int size)
   {
     mSize = size;
     // removes all the cached glyphs
+    releaseGlyphs();
+  }
+}
+//-----------------------------------------------------------------------------
+const GlyphAtlas* Font::atlas() const
+{
+  if (mDistanceFieldAtlas)
+    return mDistanceFieldAtlas.get();
+  else
+    return mAtlas.get();
+}
+//-----------------------------------------------------------------------------
+void Font::setDistanceFieldAtlas(DistanceFieldAtlas* atlas)
+{
+  if (atlas == mDistanceFieldAtlas)
+    return;
+
+  long long tick = glyphsTick();
+  mDistanceFieldAtlas = atlas;
+  releaseGlyphs(tick);
+}
+//-----------------------------------------------------------------------------
+void Font::releaseGlyphs()
+{
+  releaseGlyphs( glyphsTick() );
+}
+//-----------------------------------------------------------------------------
+void Font::releaseGlyphs(long long glyphs_tick)
+{
+  mGlyphMap.clear();
+  mAtlas->releasePages();
+  // glyphsTick() must keep increasing even if the atlas changed
+  mGlyphsTick = glyphs_tick + 1 - atlas()->tick();
+  mAtlasTick = atlas()->tick();
+  mAtlasGeneration = atlas()->generation();
+}
+//-----------------------------------------------------------------------------
+void Font::syncAtlas()
+{
+  if (mAtlasGeneration != atlas()->generation())
+  {
+    // the atlas has been released: the glyphs are recreated on demand
     mGlyphMap.clear();
   }
+  else
+  {
+    // a page grew: the glyphs keep their cells but their texture coordinates changed
+    std::map<int, ref<Glyph> >::iterator it = mGlyphMap.begin();
+    for(; it != mGlyphMap.end(); ++it )
+    {
+      if (it->second && it->second->atlasPage() >= 0)
+        updateTexCoords( it->second.get() );
+    }
+  }
+  mAtlasTick = atlas()->tick();
+  mAtlasGeneration = atlas()->generation();
+}
+//-----------------------------------------------------------------------------
+void Font::updateTexCoords(Glyph* glyph) const
+{
+  const Image* img = atlas()->pageImage( glyph->atlasPage() );
+  float w = (float)img->width();
+  float h = (float)img->height();
+
+  // tex coords DO include the whole cell and lie exactly on the texel edges
+  glyph->setS0( glyph->atlasX() / w );
+  glyph->setT0( (glyph->atlasY() + glyph->atlasHeight()) / h );
+  glyph->setS1( (glyph->atlasX() + glyph->atlasWidth()) / w );
+  glyph->setT1( glyph->atlasY() / h );
 }
 //-----------------------------------------------------------------------------
 void Font::loadFont(const String& path)
@@ -141,8 +218,15 @@ void Font::loadFont(const String& path)
     return;
 
   mFilePath = path;
+  // the distance field glyphs belong to another font file
+  if (mDistanceFieldAtlas && mDistanceFieldAtlas->filePath() != path)
+  {
+    long long tick = glyphsTick();
+    mDistanceFieldAtlas = NULL;
+    releaseGlyphs(tick);
+  }
   // removes all the cached glyphs
-  mGlyphMap.clear();
+  releaseGlyphs();
 
   // remove FreeType font face object
   if (mFT_Face)
@@ -182,6 +266,10 @@ void Font::loadFont(const String& path)
 //-----------------------------------------------------------------------------
 Glyph* Font::glyph(int character)
 {
+  // the atlas might be shared with other Fonts
+  if (mAtlasTick != atlas()->tick())
+    syncAtlas();
+
   ref<Glyph>& glyph = mGlyphMap[character];
 
   if (glyph.get() == NULL)
@@ -189,292 +277,258 @@ Glyph* Font::glyph(int character)
     glyph = new Glyph;
     glyph->setFont(this);
 
-    // create the glyph
-
-    FT_Error error = 0;
-
-    error = FT_Set_Char_Size(
-              mFT_Face, /* handle to face object           */
-              0,        /* char_width in 1/64th of points  */
-              mSize*64, /* char_height in 1/64th of points */
-              96,       /* horizontal device resolution    */
-              96 );     /* vertical device resolution      */
-
-    if(error)
-    {
-      // Log::error(Say("FT_Set_Char_Size error: %s\n") << get_ft_error_message(error) );
-      if ( (mFT_Face->face_flags & FT_FACE_FLAG_SCALABLE) == 0 && mFT_Face->num_fixed_sizes)
-      {
-        // look for the size which is less or equal to the given size
+    if (mDistanceFieldAtlas)
+      createDistanceFieldGlyph(glyph.get(), character);
+    else
+      createGlyph(glyph.get(), character);
 
-        int best_match_index = -1;
-        int best_match_size  = 0;
-        for( int i=0; i < mFT_Face->num_fixed_sizes; ++i )
-        {
-          int size = mFT_Face->available_sizes[i].y_ppem/64;
-          // skip bigger characters
-          if (size <= mSize)
-          {
-            if (best_match_index == -1 || (mSize - size) < (mSize - best_match_size) )
-            {
-              best_match_index = i;
-              best_match_size  = size;
-            }
-          }
-        }
+    // the glyph's font is NULL if it could not be created
+    if (!glyph->font())
+      glyph = NULL;
+    else
+    if (mAtlasTick != atlas()->tick())
+      syncAtlas();
+    else
+    if (glyph->atlasPage() >= 0)
+      updateTexCoords( glyph.get() );
+  }
 
-        if (best_match_index == -1)
-          best_match_index = 0;
+  return glyph.get();
+}
+//-----------------------------------------------------------------------------
+void Font::createGlyph(Glyph* glyph, int character)
+{
+  const int margin = 1;
+  Bitmap bitmap;
+  if ( !rasterize(character, bitmap, margin) )
+  {
+    glyph->setFont(NULL);
+    return;
+  }
 
-        error = FT_Select_Size(mFT_Face, best_match_index);
-        if (error)
-          Log::error(Say("FT_Select_Size error (%s): %s\n") << filePath() << get_ft_error_message(error) );
-        VL_CHECK(!error)
-      }
-      // else
-      {
-        Log::error(Say("FT_Set_Char_Size error (%s): %s\n") << filePath() << get_ft_error_message(error) );
-        VL_TRAP()
-        return glyph.get();
-      }
-    }
+  glyph->setGlyphIndex( bitmap.mGlyphIndex );
+  glyph->setAdvance( bitmap.mAdvance );
 
-    mHeight = mFT_Face->size->metrics.height / 64.0f;
-
-    // using FT_Load_Char instead of FT_Get_Char_Index + FT_Load_Glyph works better, probably
-    // FreeType performs some extra tricks internally to better support less reliable fonts...
-
-    // FT_UInt glyph_index = FT_Load_Char( mFT_Face, character, FT_LOAD_DEFAULT );
-    // glyph->glyphIndex() = glyph_index;
-    //FT_UInt glyph_index = FT_Get_Char_Index( mFT_Face, character );
-    //glyph->glyphIndex() = glyph_index;
-    //// we need to render it in order to have the transformed glyph_left and glyph_top
-    //FT_Int32 load_flags = FT_LOAD_DEFAULT;
-    //error = FT_Load_Glyph(
-    //          mFT_Face,         /* handle to face object */
-    //          glyph_index,  /* glyph index           */
-    //          load_flags ); /* load flags, see below */
-    //if(error)
-    //{
-    //  Log::error(Say("FT_Load_Glyph error: %s") << get_ft_error_message(error) );
-    //  VL_TRAP()
-    //  return glyph;
-    //}
-
-    // Note with FT 2.3.9 FT_LOAD_DEFAULT worked well, with FT 2.4 instead we ned FT_LOAD_FORCE_AUTOHINT
-    // This might work well with VL's font but it might be suboptimal for other fonts.
-
-    error = FT_Load_Char( mFT_Face, character, freeTypeLoadForceAutoHint() ? FT_LOAD_FORCE_AUTOHINT : FT_LOAD_DEFAULT );
-
-    if(error)
+  if ( !bitmap.mAlpha.empty() )
+  {
+    glyph->setWidth ( bitmap.mWidth );
+    glyph->setHeight( bitmap.mHeight );
+    glyph->setLeft  ( bitmap.mLeft );
+    glyph->setTop   ( bitmap.mTop );
+
+    // packs the glyph in its cell leaving a 1px margin
+    int page = 0, x = 0, y = 0;
+    if ( !mAtlas->addCell(glyph->width() + margin*2, glyph->height() + margin*2, &bitmap.mAlpha[0], page, x, y) )
     {
-      Log::error(Say("FT_Load_Char error (%s): %s\n") << filePath() << get_ft_error_message(error) );
+      Log::error( Say("Font::glyph() error (%s): could not allocate the glyph in the atlas.\n") << filePath() );
       VL_TRAP()
-      glyph = NULL;
-      return glyph.get();
+      return;
     }
 
-    glyph->setGlyphIndex( FT_Get_Char_Index( mFT_Face, character ) );
+    glyph->mAtlasPage = page;
+    glyph->mAtlasX = x;
+    glyph->mAtlasY = y;
+    glyph->mAtlasWidth  = glyph->width()  + margin*2;
+    glyph->mAtlasHeight = glyph->height() + margin*2;
+    glyph->setTextureHandle( mAtlas->pageTexture(page) );
+  }
+}
+//-----------------------------------------------------------------------------
+void Font::createDistanceFieldGlyph(Glyph* glyph, int character)
+{
+  const DistanceFieldAtlas::GlyphInfo* info = mDistanceFieldAtlas->glyphInfo(character);
+  if (!info)
+  {
+    glyph->setFont(NULL);
+    return;
+  }
 
-    error = FT_Render_Glyph(
-              mFT_Face->glyph,  /* glyph slot */
-              FT_RENDER_MODE_NORMAL ); /* render mode: FT_RENDER_MODE_MONO or FT_RENDER_MODE_NORMAL */
+  // the face is used only for kerning
+  if (mFT_Face)
+    FT_Set_Char_Size( mFT_Face, 0, mSize*64, 96, 96 );
 
-    // fonts like webdings.ttf generate an error when an unsupported char code is requested instead of
-    // reverting to char code 0, so we have to do it by hand...
+  float scale = (float)mSize / mDistanceFieldAtlas->referenceSize();
+  mHeight = mDistanceFieldAtlas->lineHeight() * scale;
 
-    if(error)
-    {
-      // Log::error(Say("FT_Render_Glyph error: %s") << get_ft_error_message(error) );
-      // VL_TRAP()
-      error = FT_Load_Glyph(
-                mFT_Face,/* handle to face object */
-                0,       /* glyph index           */
-                FT_LOAD_DEFAULT ); /* load flags, see below */
-      glyph->setGlyphIndex(0);
-
-      error = FT_Render_Glyph(
-                mFT_Face->glyph,  /* glyph slot */
-                FT_RENDER_MODE_NORMAL ); /* render mode: FT_RENDER_MODE_MONO or FT_RENDER_MODE_NORMAL */
-    }
+  glyph->setGlyphIndex( info->mGlyphIndex );
+  glyph->setAdvance( info->mAdvance * scale );
+
+  if ( info->mPage >= 0 )
+  {
+    // the quad covers the whole cell, i.e. the glyph plus the spread, and the 1px margin is implicit as for the rasterized glyphs
+    int spread = mDistanceFieldAtlas->spread();
+    int x0 = (int)floor( (info->mLeft - spread) * scale + 0.5f );
+    int x1 = (int)floor( (info->mLeft + info->mWidth + spread) * scale + 0.5f );
+    int y0 = (int)floor( (info->mTop - info->mHeight - spread) * scale + 0.5f );
+    int y1 = (int)floor( (info->mTop + spread) * scale + 0.5f );
+    glyph->setLeft  ( x0 + 1 );
+    glyph->setWidth ( x1 - x0 - 2 );
+    glyph->setTop   ( y1 - 1 );
+    glyph->setHeight( y1 - y0 - 2 );
+
+    glyph->mAtlasPage = info->mPage;
+    glyph->mAtlasX = info->mX;
+    glyph->mAtlasY = info->mY;
+    glyph->mAtlasWidth  = info->mCellWidth;
+    glyph->mAtlasHeight = info->mCellHeight;
+    glyph->setTextureHandle( mDistanceFieldAtlas->pageTexture(info->mPage) );
+  }
+}
+//-----------------------------------------------------------------------------
+bool Font::rasterize(int character, Bitmap& bitmap, int margin)
+{
+  FT_Error error = 0;
 
-    if(error)
+  error = FT_Set_Char_Size(
+            mFT_Face, /* handle to face object           */
+            0,        /* char_width in 1/64th of points  */
+            mSize*64, /* char_height in 1/64th of points */
+            96,       /* horizontal device resolution    */
+            96 );     /* vertical device resolution      */
+
+  if(error)
+  {
+    // Log::error(Say("FT_Set_Char_Size error: %s\n") << get_ft_error_message(error) );
+    if ( (mFT_Face->face_flags & FT_FACE_FLAG_SCALABLE) == 0 && mFT_Face->num_fixed_sizes)
     {
-      Log::error(Say("FT_Render_Glyph error (%s): %s\n") << filePath() << get_ft_error_message(error) );
-      VL_TRAP()
-      glyph = NULL;
-      return glyph.get();
-    }
+      // look for the size which is less or equal to the given size
+
+      int best_match_index = -1;
+      int best_match_size  = 0;
+      for( int i=0; i < mFT_Face->num_fixed_sizes; ++i )
+      {
+        int size = mFT_Face->available_sizes[i].y_ppem/64;
+        // skip bigger characters
+        if (size <= mSize)
+        {
+          if (best_match_index == -1 || (mSize - size) < (mSize - best_match_size) )
+          {
+            best_match_index = i;
+            best_match_size  = size;
+          }
+        }
+      }
 
-    bool ok_format = mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY || mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO;
-    ok_format &= mFT_Face->glyph->bitmap.palette_mode == 0;
-    ok_format &= mFT_Face->glyph->bitmap.pitch > 0 || mFT_Face->glyph->bitmap.buffer == NULL;
+      if (best_match_index == -1)
+        best_match_index = 0;
 
-    if (!ok_format)
+      error = FT_Select_Size(mFT_Face, best_match_index);
+      if (error)
+        Log::error(Say("FT_Select_Size error (%s): %s\n") << filePath() << get_ft_error_message(error) );
+      VL_CHECK(!error)
+    }
+    // else
     {
-      Log::error( Say("Font::glyph() error (%s): glyph format not supported. Visualization Library currently supports only FT_PIXEL_MODE_GRAY and FT_PIXEL_MODE_MONO.\n") << filePath() );
+      Log::error(Say("FT_Set_Char_Size error (%s): %s\n") << filePath() << get_ft_error_message(error) );
       VL_TRAP()
-      return glyph.get();
+      return true;
     }
+  }
 
-    if ( mFT_Face->glyph->bitmap.buffer )
-    {
-      if (mHeight == 0)
-        mHeight = (float)mFT_Face->glyph->bitmap.rows;
+  mHeight = mFT_Face->size->metrics.height / 64.0f;
 
-      glyph->setWidth ( mFT_Face->glyph->bitmap.width);
-      glyph->setHeight( mFT_Face->glyph->bitmap.rows);
-      glyph->setLeft  ( mFT_Face->glyph->bitmap_left);
-      glyph->setTop   ( mFT_Face->glyph->bitmap_top);
+  // using FT_Load_Char instead of FT_Get_Char_Index + FT_Load_Glyph works better, probably
+  // FreeType performs some extra tricks internally to better support less reliable fonts...
 
-      VL_CHECK( mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY || mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO )
-      VL_CHECK( mFT_Face->glyph->bitmap.palette_mode == 0 )
-      VL_CHECK( mFT_Face->glyph->bitmap.pitch > 0 )
+  // Note with FT 2.3.9 FT_LOAD_DEFAULT worked well, with FT 2.4 instead we ned FT_LOAD_FORCE_AUTOHINT
+  // This might work well with VL's font but it might be suboptimal for other fonts.
 
-      unsigned int texhdl;
-      glGenTextures( 1, &texhdl );
-      glyph->setTextureHandle(texhdl);
-      VL_glActiveTexture(GL_TEXTURE0);
-      glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
+  error = FT_Load_Char( mFT_Face, character, freeTypeLoadForceAutoHint() ? FT_LOAD_FORCE_AUTOHINT : FT_LOAD_DEFAULT );
 
-      int texsize[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 0 };
-      int max_tex_size = 0;
-      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
+  if(error)
+  {
+    Log::error(Say("FT_Load_Char error (%s): %s\n") << filePath() << get_ft_error_message(error) );
+    VL_TRAP()
+    return false;
+  }
 
-      int w=0, h=0, margin = 1;
+  bitmap.mGlyphIndex = FT_Get_Char_Index( mFT_Face, character );
 
-      for(int i=0; texsize[i]; ++i)
-      {
-        if ( (texsize[i] >= glyph->width() + margin*2 && texsize[i] >= glyph->height() + margin*2) || texsize[i+1] > max_tex_size )
-        {
-          w = texsize[i];
-          h = texsize[i];
-          break;
-        }
-      }
-      VL_CHECK(w)
-      VL_CHECK(h)
-
-#if(1)
-      // tex coords DO include the border
-      glyph->setS0( 0 );
-      glyph->setT0( 1 );
-      glyph->setS1((margin*2 + glyph->width() ) /(float)(w-1) );
-      glyph->setT1( 1 -(margin*2 + glyph->height() ) /(float)(h-1) );
-
-      // tex coords DO NOT include the border
-      //glyph->setS0((float)margin /(float)(w-1));
-      //glyph->setT0( 1 -(float)margin /(float)(h-1));
-      //glyph->setS1(((float)margin + glyph->width() ) /(float)(w-1));
-      //glyph->setT1( 1 -((float)margin + glyph->height() ) /(float)(h-1));
-#else
-      glyph->setS0((float)margin /(float)w);
-      glyph->setT0( 1 -(float)margin /(float)h);
-      glyph->setS1(((float)margin + glyph->width() ) /(float)w);
-      glyph->setT1( 1 -((float)margin + glyph->height() ) /(float)h);
-#endif
-
-      ref<Image> img = new Image;
-      img->allocate2D(w, h, 1, IF_RGBA, IT_UNSIGNED_BYTE);
-
-      // init to all transparent white
-      for(unsigned char *px = img->pixels(), *end = px + img->requiredMemory(); px<end; px+=4)
-      {
-        px[0] = 0xFF;
-        px[1] = 0xFF;
-        px[2] = 0xFF;
-        px[3] = 0x0;
-      }
+  error = FT_Render_Glyph(
+            mFT_Face->glyph,  /* glyph slot */
+            FT_RENDER_MODE_NORMAL ); /* render mode: FT_RENDER_MODE_MONO or FT_RENDER_MODE_NORMAL */
 
-      // maps the glyph on the texture leaving a 1px margin
+  // fonts like webdings.ttf generate an error when an unsupported char code is requested instead of
+  // reverting to char code 0, so we have to do it by hand...
 
-      for(int y=0; y<glyph->height(); y++)
-      {
-        for(int x=0; x<glyph->width(); x++)
-        {
-          int offset_1 = (x+margin) * 4 + (w-1-y-margin) * img->pitch();
-          int offset_2 = 0;
-          if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
-            offset_2 = x / 8 + y * ::abs(mFT_Face->glyph->bitmap.pitch);
-          else
-            offset_2 = x + y * mFT_Face->glyph->bitmap.pitch;
-
-#if (1)
-          if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
-            img->pixels()[ offset_1+3 ] = (mFT_Face->glyph->bitmap.buffer[ offset_2 ] >> (7-x%8)) & 0x1 ? 0xFF : 0x0;
-          else
-            img->pixels()[ offset_1+3 ] = mFT_Face->glyph->bitmap.buffer[ offset_2 ];
-#else
-          // debug code
-          img->pixels()[ offset_1+0 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+1 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+2 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+3 ] = 0xFF; // face->glyph->bitmap.buffer[ offset_2 ];
-#endif
-        }
-      }
+  if(error)
+  {
+    // Log::error(Say("FT_Render_Glyph error: %s") << get_ft_error_message(error) );
+    // VL_TRAP()
+    error = FT_Load_Glyph(
+              mFT_Face,/* handle to face object */
+              0,       /* glyph index           */
+              FT_LOAD_DEFAULT ); /* load flags, see below */
+    bitmap.mGlyphIndex = 0;
 
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img->width(), img->height(), 0, img->format(), img->type(), img->pixels() ); VL_CHECK_OGL();
+    error = FT_Render_Glyph(
+              mFT_Face->glyph,  /* glyph slot */
+              FT_RENDER_MODE_NORMAL ); /* render mode: FT_RENDER_MODE_MONO or FT_RENDER_MODE_NORMAL */
+  }
 
-      if ( smooth() )
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-      }
-      else
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-      }
+  if(error)
+  {
+    Log::error(Say("FT_Render_Glyph error (%s): %s\n") << filePath() << get_ft_error_message(error) );
+    VL_TRAP()
+    return false;
+  }
+
+  bool ok_format = mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY || mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO;
+  ok_format &= mFT_Face->glyph->bitmap.palette_mode == 0;
+  ok_format &= mFT_Face->glyph->bitmap.pitch > 0 || mFT_Face->glyph->bitmap.buffer == NULL;
+
+  if (!ok_format)
+  {
+    Log::error( Say("Font::glyph() error (%s): glyph format not supported. Visualization Library currently supports only FT_PIXEL_MODE_GRAY and FT_PIXEL_MODE_MONO.\n") << filePath() );
+    VL_TRAP()
+    return true;
+  }
 
-      // sets anisotropy to the maximum supported
-      if (Has_GL_EXT_texture_filter_anisotropic)
+  bitmap.mAdvance = fvec2( (float)mFT_Face->glyph->advance.x / 64.0f, (float)mFT_Face->glyph->advance.y / 64.0f );
+
+  if ( mFT_Face->glyph->bitmap.buffer )
+  {
+    if (mHeight == 0)
+      mHeight = (float)mFT_Face->glyph->bitmap.rows;
+
+    bitmap.mWidth  = mFT_Face->glyph->bitmap.width;
+    bitmap.mHeight = mFT_Face->glyph->bitmap.rows;
+    bitmap.mLeft   = mFT_Face->glyph->bitmap_left;
+    bitmap.mTop    = mFT_Face->glyph->bitmap_top;
+
+    VL_CHECK( mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY || mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO )
+    VL_CHECK( mFT_Face->glyph->bitmap.palette_mode == 0 )
+    VL_CHECK( mFT_Face->glyph->bitmap.pitch > 0 )
+
+    // copies the glyph leaving a transparent margin around it
+    int pitch = bitmap.mWidth + margin*2;
+    bitmap.mAlpha.resize( pitch * (bitmap.mHeight + margin*2), 0 );
+    for(int gy=0; gy<bitmap.mHeight; gy++)
+    {
+      for(int gx=0; gx<bitmap.mWidth; gx++)
       {
-        float max_anisotropy;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+        int offset_1 = (margin+gx) + (margin+gy) * pitch;
+        int offset_2 = 0;
+        if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+          offset_2 = gx / 8 + gy * ::abs(mFT_Face->glyph->bitmap.pitch);
+        else
+          offset_2 = gx + gy * mFT_Face->glyph->bitmap.pitch;
+
+        if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+          bitmap.mAlpha[ offset_1 ] = (mFT_Face->glyph->bitmap.buffer[ offset_2 ] >> (7-gx%8)) & 0x1 ? 0xFF : 0x0;
+        else
+          bitmap.mAlpha[ offset_1 ] = mFT_Face->glyph->bitmap.buffer[ offset_2 ];
       }
-
-      VL_CHECK_OGL();
-      glBindTexture( GL_TEXTURE_2D, 0 );
     }
-
-    glyph->setAdvance( fvec2( (float)mFT_Face->glyph->advance.x / 64.0f, (float)mFT_Face->glyph->advance.y / 64.0f ) );
   }
 
-  return glyph.get();
+  return true;
 }
 //-----------------------------------------------------------------------------
 void Font::setSmooth(bool smooth)
 {
   mSmooth = smooth;
-  std::map<int, ref<Glyph> >::iterator it = mGlyphMap.begin();
-  for(; it != mGlyphMap.end(); ++it )
-  {
-    const ref<Glyph>& glyph = it->second;
-    if (glyph->textureHandle() == 0)
-      continue;
-
-    glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-    if (smooth)
-    {
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-    }
-    else
-    {
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-    }
-  }
-  glBindTexture( GL_TEXTURE_2D, 0 );
+  // the DistanceFieldAtlas is always smooth
+  mAtlas->setSmooth(smooth);
 }
 //-----------------------------------------------------------------------------
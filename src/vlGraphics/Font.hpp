@@ -35,6 +35,9 @@
 #include <vlCore/Object.hpp>
 #include <vlCore/Vector4.hpp>
 #include <vlCore/String.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vlCore/Image.hpp>
+#include <vlGraphics/DistanceFieldAtlas.hpp>
 #include <vlGraphics/link_config.hpp>
 #include <map>
 
@@ -56,6 +59,8 @@ namespace vl
   {
     VL_INSTRUMENT_CLASS(vl::Glyph, Object)
 
+    friend class Font;
+
   private:
     Glyph(const Glyph& other): Object(other)  
     {
@@ -64,7 +69,8 @@ namespace vl
     void operator=(const Glyph&){}
 
   public:
-    Glyph(): mFont(NULL), mS0(0), mT0(0), mS1(0), mT1(0), mGlyphIndex(0), mTextureHandle(0), mWidth(0), mHeight(0), mLeft(0), mTop(0) {}
+    Glyph(): mFont(NULL), mS0(0), mT0(0), mS1(0), mT1(0), mGlyphIndex(0), mTextureHandle(0), mWidth(0), mHeight(0), mLeft(0), mTop(0), 
+      mAtlasPage(-1), mAtlasX(0), mAtlasY(0), mAtlasWidth(0), mAtlasHeight(0) {}
 
     ~Glyph();
 
@@ -104,6 +110,22 @@ namespace vl
     const Font* font() const { return mFont; }
     void setFont(Font* font) { mFont = font; }
 
+    //! The index of the page of Font::atlas() containing the glyph or -1 if the glyph does not belong to an atlas.
+    //! When the glyph belongs to an atlas textureHandle() is the texture of the page, which is owned by the atlas.
+    int atlasPage() const { return mAtlasPage; }
+
+    //! The horizontal position in pixels of the glyph's cell in its atlas page.
+    int atlasX() const { return mAtlasX; }
+
+    //! The vertical position in pixels of the glyph's cell in its atlas page, from the bottom.
+    int atlasY() const { return mAtlasY; }
+
+    //! The width in pixels of the glyph's cell: the glyph plus 1 pixel margin or, for distance field fonts, the glyph plus the spread at the reference size.
+    int atlasWidth() const { return mAtlasWidth; }
+
+    //! The height in pixels of the glyph's cell: the glyph plus 1 pixel margin or, for distance field fonts, the glyph plus the spread at the reference size.
+    int atlasHeight() const { return mAtlasHeight; }
+
   protected:
     Font* mFont;
     fvec2 mAdvance;
@@ -117,12 +139,26 @@ namespace vl
     int mHeight;
     int mLeft;
     int mTop;
+    int mAtlasPage;
+    int mAtlasX;
+    int mAtlasY;
+    int mAtlasWidth;
+    int mAtlasHeight;
   };
   //-----------------------------------------------------------------------------
   // Font
   //-----------------------------------------------------------------------------
   /**
    * A font to be used with a Text renderable.
+   *
+   * The glyphs are packed on demand in a GlyphAtlas made of one or more pages: each page is filled shelf by shelf, 
+   * it is doubled in size when full until it reaches atlasPageSize() after which a new page is started. 
+   * This way a whole text can be rendered with one draw call per page, see Text and TextBatch.
+   *
+   * When a DistanceFieldAtlas is set, see setDistanceFieldAtlas() and FontManager::acquireDistanceFieldFont(), the Font does not
+   * rasterize its glyphs but scales the signed distance field glyphs of the atlas to its size: the atlas is shared by all the sizes 
+   * of the same font file. The distance field glyphs are thresholded using the fixed function texture environment unless a GLSLProgram 
+   * is active, in which case the program is responsible for it, see GlyphQuads::render() and data/glsl/text_distance_field.fs.
   */
   class VLGRAPHICS_EXPORT Font: public Object
   {
@@ -130,7 +166,9 @@ namespace vl
 
     friend class CoreText;
     friend class Text;
+    friend class TextBatch;
     friend class FontManager;
+    friend class DistanceFieldAtlas;
     
     //! Assignment operator
     void operator=(const Font&) { VL_TRAP() } // should never get used
@@ -172,12 +210,47 @@ namespace vl
     //! Returns (and eventually creates) the Glyph* associated to the given character.
     Glyph* glyph(int character);
     
-    //! Whether the font rendering should use linear filtering or not.
+    //! Whether the font rendering should use linear filtering or not. Distance field fonts always use linear filtering.
     void setSmooth(bool smooth);
     
-    //! Whether the font rendering should use linear filtering or not.
+    //! Whether the font rendering should use linear filtering or not. Distance field fonts always use linear filtering.
     bool smooth() const { return mSmooth; }
 
+    //! The maximum width and height in pixels of an atlas page (default 1024), see GlyphAtlas::setMaxPageSize().
+    void setAtlasPageSize(int size) { mAtlas->setMaxPageSize(size); }
+
+    //! The maximum width and height in pixels of an atlas page (default 1024), see GlyphAtlas::maxPageSize().
+    int atlasPageSize() const { return mAtlas->maxPageSize(); }
+
+    //! The number of atlas pages currently allocated.
+    int atlasPageCount() const { return atlas()->pageCount(); }
+
+    //! The texture handle of the given atlas page.
+    unsigned int atlasPageTexture(int page) const { return atlas()->pageTexture(page); }
+
+    //! The atlas containing the glyphs: the distanceFieldAtlas() if any, otherwise the Font's own one.
+    const GlyphAtlas* atlas() const;
+
+    //! Uses the signed distance field glyphs of the given atlas, which must have been created from the same font file, 
+    //! instead of rasterizing the glyphs. Pass NULL to go back to rasterized glyphs.
+    void setDistanceFieldAtlas(DistanceFieldAtlas* atlas);
+
+    //! The DistanceFieldAtlas used by the Font, if any.
+    const DistanceFieldAtlas* distanceFieldAtlas() const { return mDistanceFieldAtlas.get(); }
+
+    //! The DistanceFieldAtlas used by the Font, if any.
+    DistanceFieldAtlas* distanceFieldAtlas() { return mDistanceFieldAtlas.get(); }
+
+    //! Returns true if the Font uses a DistanceFieldAtlas.
+    bool isDistanceField() const { return mDistanceFieldAtlas.get() != NULL; }
+
+    //! Incremented every time the glyphs are released or their texture coordinates change, i.e. when an atlas page grows.
+    //! Used by Text and TextBatch to know when their cached glyph quads must be rebuilt.
+    long long glyphsTick() const { return mGlyphsTick + atlas()->tick(); }
+
+    //! Releases all the glyphs and the Font's own atlas pages. The glyphs are recreated on demand.
+    void releaseGlyphs();
+
     //! Releases the FreeType's FT_Face used by a Font.
     void releaseFreeTypeData();
 
@@ -198,10 +271,37 @@ namespace vl
     //! There isn't a "best" option for all the fonts, the results can be better or worse depending on the particular font loaded.
     void setFreeTypLoadForceAutoHint(bool enable) { mFreeTypeLoadForceAutoHint = enable; }
 
+  protected:
+    //! A glyph rendered by FreeType.
+    struct Bitmap
+    {
+      Bitmap(): mGlyphIndex(0), mWidth(0), mHeight(0), mLeft(0), mTop(0) {}
+      //! The alpha values, row by row from the top one, including the margin.
+      std::vector<unsigned char> mAlpha;
+      fvec2 mAdvance;
+      unsigned int mGlyphIndex;
+      int mWidth;
+      int mHeight;
+      int mLeft;
+      int mTop;
+    };
+
+    bool rasterize(int character, Bitmap& bitmap, int margin);
+    void createGlyph(Glyph* glyph, int character);
+    void createDistanceFieldGlyph(Glyph* glyph, int character);
+    void releaseGlyphs(long long glyphs_tick);
+    void updateTexCoords(Glyph* glyph) const;
+    void syncAtlas();
+
   protected:
     FontManager* mFontManager;
     String mFilePath;
     std::map< int, ref<Glyph> > mGlyphMap;
+    ref<GlyphAtlas> mAtlas;
+    ref<DistanceFieldAtlas> mDistanceFieldAtlas;
+    long long mGlyphsTick;
+    long long mAtlasTick;
+    long long mAtlasGeneration;
     FT_Face mFT_Face;
     std::vector<char> mMemoryFile;
     int mSize;
@@ -30,6 +30,7 @@
 /**************************************************************************************/
 
 #include <vlGraphics/FontManager.hpp>
+#include <vlCore/DiskFile.hpp>
 #include <vlCore/Log.hpp>
 #include <algorithm>
 
@@ -69,7 +70,7 @@ Font* FontManager::acquireFont(const String& path, int size, bool smooth)
 {
   ref<Font> font;
   for(unsigned i=0; !font && i<mFonts.size(); ++i)
-    if (fonts()[i]->filePath() == path && fonts()[i]->size() == size && fonts()[i]->smooth() == smooth)
+    if (fonts()[i]->filePath() == path && fonts()[i]->size() == size && fonts()[i]->smooth() == smooth && !fonts()[i]->isDistanceField())
       font = fonts()[i];
 
   if (!font)
@@ -84,6 +85,60 @@ Font* FontManager::acquireFont(const String& path, int size, bool smooth)
   return font.get();
 }
 //-----------------------------------------------------------------------------
+Font* FontManager::acquireDistanceFieldFont(const String& path, int size)
+{
+  ref<Font> font;
+  for(unsigned i=0; !font && i<mFonts.size(); ++i)
+    if (fonts()[i]->filePath() == path && fonts()[i]->size() == size && fonts()[i]->isDistanceField())
+      font = fonts()[i];
+
+  if (!font)
+  {
+    DistanceFieldAtlas* atlas = acquireDistanceFieldAtlas(path);
+    font = new Font(this);
+    font->loadFont(path);
+    font->setSize(size);
+    font->setDistanceFieldAtlas(atlas);
+    mFonts.push_back( font );
+  }
+
+  return font.get();
+}
+//-----------------------------------------------------------------------------
+DistanceFieldAtlas* FontManager::acquireDistanceFieldAtlas(const String& path)
+{
+  for(unsigned i=0; i<mDistanceFieldAtlases.size(); ++i)
+    if (mDistanceFieldAtlases[i]->filePath() == path)
+      return mDistanceFieldAtlases[i].get();
+
+  ref<DistanceFieldAtlas> atlas = new DistanceFieldAtlas(this, path);
+  if ( !distanceFieldCacheDirectory().empty() )
+  {
+    ref<DiskFile> file = new DiskFile( distanceFieldCacheDirectory() + "/" + atlas->cacheFileName() );
+    if ( file->exists() )
+      atlas->loadCache( file.get() );
+  }
+  mDistanceFieldAtlases.push_back( atlas );
+  return atlas.get();
+}
+//-----------------------------------------------------------------------------
+bool FontManager::saveDistanceFieldCaches() const
+{
+  if ( distanceFieldCacheDirectory().empty() )
+  {
+    Log::error("FontManager::saveDistanceFieldCaches(): no cache directory specified.\n");
+    return false;
+  }
+
+  bool ok = true;
+  for(unsigned i=0; i<mDistanceFieldAtlases.size(); ++i)
+  {
+    ref<DiskFile> file = new DiskFile( distanceFieldCacheDirectory() + "/" + mDistanceFieldAtlases[i]->cacheFileName() );
+    ok &= mDistanceFieldAtlases[i]->saveCache( file.get() );
+  }
+  return ok;
+}
+//-----------------------------------------------------------------------------
 void FontManager::releaseFont(Font* font)
 { 
   std::vector< ref<Font> >::iterator it = std::find(mFonts.begin(), mFonts.end(), font);
@@ -95,5 +150,7 @@ void FontManager::releaseAllFonts()
 { 
   for(unsigned i=0; i<mFonts.size(); ++i)
     mFonts[i]->releaseFreeTypeData(); 
+  for(unsigned i=0; i<mDistanceFieldAtlases.size(); ++i)
+    mDistanceFieldAtlases[i]->releaseFreeTypeData(); 
 }
 //-----------------------------------------------------------------------------
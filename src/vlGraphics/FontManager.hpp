@@ -37,6 +37,10 @@
 namespace vl
 {
   /** The FontManager class keeps a map associating a font path, size and smoothing flag to a Font object.
+   *
+   * Distance field Fonts, see acquireDistanceFieldFont(), share one DistanceFieldAtlas per font file regardless of their size.
+   * If a distanceFieldCacheDirectory() is set the atlases are loaded from their cache files, when present, and can be saved
+   * with saveDistanceFieldCaches(), typically before the application exits or as an offline step.
    * \sa
    * - Font
    * - Text
@@ -58,6 +62,25 @@ namespace vl
     //! Creates or returns an already created Font.
     Font* acquireFont(const String& font, int size, bool smooth=false);
 
+    //! Creates or returns an already created Font of the given size using the signed distance field glyphs of acquireDistanceFieldAtlas().
+    Font* acquireDistanceFieldFont(const String& font, int size);
+
+    //! Creates or returns the DistanceFieldAtlas shared by the distance field Fonts of the given font file.
+    //! A new atlas is loaded from its cache file if found in distanceFieldCacheDirectory().
+    DistanceFieldAtlas* acquireDistanceFieldAtlas(const String& font);
+
+    //! Returns the list of DistanceFieldAtlas[es] created till now.
+    const std::vector< ref<DistanceFieldAtlas> >& distanceFieldAtlases() const { return mDistanceFieldAtlases; }
+
+    //! The directory where the DistanceFieldAtlas cache files are looked for and saved, empty by default (no caching).
+    void setDistanceFieldCacheDirectory(const String& dir) { mDistanceFieldCacheDirectory = dir; }
+
+    //! The directory where the DistanceFieldAtlas cache files are looked for and saved, empty by default (no caching).
+    const String& distanceFieldCacheDirectory() const { return mDistanceFieldCacheDirectory; }
+
+    //! Saves the cache files of all the DistanceFieldAtlas[es] in distanceFieldCacheDirectory(). Returns false if any of them could not be saved.
+    bool saveDistanceFieldCaches() const;
+
     //! Returns the list of Fonts created till now.
     const std::vector< ref<Font> >& fonts() const { return mFonts; }
 
@@ -79,6 +102,8 @@ namespace vl
 
   protected:
     std::vector< ref<Font> > mFonts;
+    std::vector< ref<DistanceFieldAtlas> > mDistanceFieldAtlases;
+    String mDistanceFieldCacheDirectory;
     void* mFreeTypeLibrary;
   };
 
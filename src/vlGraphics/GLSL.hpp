@@ -148,8 +148,8 @@ namespace vl
     GLSLVertexShader(const String& source=String()): GLSLShader(ST_VERTEX_SHADER, source)
     {
       #ifndef NDEBUG
-        if (mObjectName.empty())
-          mObjectName = className();
+        if (objectName().empty())
+          setObjectName(className());
       #endif
     }
   };
@@ -166,8 +166,8 @@ namespace vl
     GLSLFragmentShader(const String& source=String()): GLSLShader(ST_FRAGMENT_SHADER, source)
     {
       #ifndef NDEBUG
-        if (mObjectName.empty())
-          mObjectName = className();
+        if (objectName().empty())
+          setObjectName(className());
       #endif
     }
   };
@@ -184,8 +184,8 @@ namespace vl
     GLSLGeometryShader(const String& source=String()): GLSLShader(ST_GEOMETRY_SHADER, source)
     {
       #ifndef NDEBUG
-        if (mObjectName.empty())
-          mObjectName = className();
+        if (objectName().empty())
+          setObjectName(className());
       #endif
     }
   };
@@ -202,8 +202,8 @@ namespace vl
     GLSLTessControlShader(const String& source=String()): GLSLShader(ST_TESS_CONTROL_SHADER, source)
     {
       #ifndef NDEBUG
-        if (mObjectName.empty())
-          mObjectName = className();
+        if (objectName().empty())
+          setObjectName(className());
       #endif
     }
   };
@@ -220,8 +220,8 @@ namespace vl
     GLSLTessEvaluationShader(const String& source=String()): GLSLShader(ST_TESS_EVALUATION_SHADER, source)
     {
       #ifndef NDEBUG
-        if (mObjectName.empty())
-          mObjectName = className();
+        if (objectName().empty())
+          setObjectName(className());
       #endif
     }
   };
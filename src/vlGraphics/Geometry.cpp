@@ -95,6 +95,17 @@ void Geometry::computeBounds_Implementation()
   setBoundingSphere( Sphere(center, radius) );
 }
 //-----------------------------------------------------------------------------
+const TriangleBVH* Geometry::triangleBVH()
+{
+  if (boundsDirty())
+    computeBounds();
+  if (!mTriangleBVH)
+    mTriangleBVH = new TriangleBVH;
+  if (!mTriangleBVH->isUpToDate(this))
+    mTriangleBVH->build(this);
+  return mTriangleBVH.get();
+}
+//-----------------------------------------------------------------------------
 ref<Geometry> Geometry::deepCopy() const
 {
   ref<Geometry> geom = new Geometry;
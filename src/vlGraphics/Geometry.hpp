@@ -45,6 +45,7 @@
 #include <vlGraphics/DrawArrays.hpp>
 #include <vlCore/Collection.hpp>
 #include <vlGraphics/VertexAttribInfo.hpp>
+#include <vlGraphics/TriangleBVH.hpp>
 
 namespace vl
 {
@@ -332,6 +333,14 @@ namespace vl
 
     const Collection<VertexAttribInfo>* vertexAttribArrays() const { return &mVertexAttribArrays; }
 
+    /** Returns the bounding volume hierarchy of the triangles of the Geometry used to accelerate ray intersections, see RayIntersector.
+      * The hierarchy is built the first time it is requested and rebuilt whenever the bounds of the Geometry are recomputed, 
+      * the vertex array or the number of draw calls changes. After modifying the vertices in place call setBoundsDirty(true). */
+    const TriangleBVH* triangleBVH();
+
+    /** Releases the memory used by the bounding volume hierarchy returned by triangleBVH(). */
+    void releaseTriangleBVH() { mTriangleBVH = NULL; }
+
   protected:
     virtual void computeBounds_Implementation();
     
@@ -351,6 +360,8 @@ namespace vl
     Collection<TextureArray> mTexCoordArrays;
     // generic vertex attributes
     Collection<VertexAttribInfo> mVertexAttribArrays;
+    // ray intersection acceleration structure
+    ref<TriangleBVH> mTriangleBVH;
   };
   //------------------------------------------------------------------------------
 }
@@ -0,0 +1,282 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/GlyphAtlas.hpp>
+#include <vlGraphics/OpenGL.hpp>
+
+#include <cstring>
+
+using namespace vl;
+
+namespace
+{
+  void setGlyphTextureParameters(bool smooth)
+  {
+    if ( smooth )
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+    }
+    else
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+    }
+  }
+
+  void setMaxAnisotropy()
+  {
+    // sets anisotropy to the maximum supported
+    if (Has_GL_EXT_texture_filter_anisotropic)
+    {
+      float max_anisotropy;
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+    }
+  }
+
+  // init to all transparent white
+  void clearToTransparentWhite(Image* img)
+  {
+    for(unsigned char *px = img->pixels(), *end = px + img->requiredMemory(); px<end; px+=4)
+    {
+      px[0] = 0xFF;
+      px[1] = 0xFF;
+      px[2] = 0xFF;
+      px[3] = 0x0;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+// GlyphAtlas
+//-----------------------------------------------------------------------------
+GlyphAtlas::GlyphAtlas()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mTick = 0;
+  mGeneration = 0;
+  mMaxPageSize = 1024;
+  mSmooth = false;
+}
+//-----------------------------------------------------------------------------
+GlyphAtlas::~GlyphAtlas()
+{
+  releasePages();
+}
+//-----------------------------------------------------------------------------
+void GlyphAtlas::releasePages()
+{
+  for(size_t i=0; i<mPages.size(); ++i)
+  {
+    if (mPages[i].mTexture)
+      glDeleteTextures( 1, &mPages[i].mTexture );
+  }
+  mPages.clear();
+  ++mTick;
+  ++mGeneration;
+}
+//-----------------------------------------------------------------------------
+void GlyphAtlas::setSmooth(bool smooth)
+{
+  mSmooth = smooth;
+  for(size_t i=0; i<mPages.size(); ++i)
+  {
+    glBindTexture( GL_TEXTURE_2D, mPages[i].mTexture );
+    setGlyphTextureParameters(smooth);
+  }
+  glBindTexture( GL_TEXTURE_2D, 0 );
+}
+//-----------------------------------------------------------------------------
+void GlyphAtlas::createPage(int size)
+{
+  mPages.push_back( Page() );
+  Page& page = mPages.back();
+
+  page.mImage = new Image;
+  page.mImage->allocate2D(size, size, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+  clearToTransparentWhite( page.mImage.get() );
+
+  glGenTextures( 1, &page.mTexture );
+  VL_glActiveTexture(GL_TEXTURE0);
+  glBindTexture( GL_TEXTURE_2D, page.mTexture );
+  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.mImage->pixels() ); VL_CHECK_OGL();
+  setGlyphTextureParameters( smooth() );
+  setMaxAnisotropy();
+  glBindTexture( GL_TEXTURE_2D, 0 );
+}
+//-----------------------------------------------------------------------------
+void GlyphAtlas::growPage(Page& page, int max_size)
+{
+  ref<Image> old_img = page.mImage;
+  int size = old_img->width() * 2 < max_size ? old_img->width() * 2 : max_size;
+
+  // the cells keep their pixel position, the shelves simply get longer and more shelves fit on top
+  page.mImage = new Image;
+  page.mImage->allocate2D(size, size, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+  clearToTransparentWhite( page.mImage.get() );
+  for(int row=0; row<old_img->height(); ++row)
+    memcpy( page.mImage->pixels() + row*page.mImage->pitch(), old_img->pixels() + row*old_img->pitch(), old_img->width()*4 );
+
+  VL_glActiveTexture(GL_TEXTURE0);
+  glBindTexture( GL_TEXTURE_2D, page.mTexture );
+  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.mImage->pixels() ); VL_CHECK_OGL();
+  glBindTexture( GL_TEXTURE_2D, 0 );
+
+  // the texture coordinates of the cells changed
+  ++mTick;
+}
+//-----------------------------------------------------------------------------
+bool GlyphAtlas::allocateCell(Page& page, int width, int height, int& x, int& y)
+{
+  // the cells are separated by 1 empty pixel to avoid bleeding when using linear filtering
+  int cell_w = width  + 1;
+  int cell_h = height + 1;
+  int page_w = page.mImage->width();
+  int page_h = page.mImage->height();
+
+  // look for the shelf wasting less space
+  int best = -1;
+  for(int i=0; i<(int)page.mShelves.size(); ++i)
+  {
+    const ivec3& shelf = page.mShelves[i];
+    if (shelf.x() + cell_w <= page_w && shelf.z() >= cell_h && (best == -1 || shelf.z() < page.mShelves[best].z()))
+      best = i;
+  }
+
+  // the topmost shelf can grow in height
+  if (best == -1 && !page.mShelves.empty())
+  {
+    ivec3& top = page.mShelves.back();
+    if (top.x() + cell_w <= page_w && top.y() + cell_h <= page_h)
+    {
+      top.z() = cell_h > top.z() ? cell_h : top.z();
+      best = (int)page.mShelves.size() - 1;
+    }
+  }
+
+  // start a new shelf
+  if (best == -1)
+  {
+    int top = page.mShelves.empty() ? 0 : page.mShelves.back().y() + page.mShelves.back().z();
+    if (cell_w > page_w || top + cell_h > page_h)
+      return false;
+    page.mShelves.push_back( ivec3(0, top, cell_h) );
+    best = (int)page.mShelves.size() - 1;
+  }
+
+  ivec3& shelf = page.mShelves[best];
+  x = shelf.x();
+  y = shelf.y();
+  shelf.x() += cell_w;
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool GlyphAtlas::allocateCell(int width, int height, int& page, int& x, int& y)
+{
+  int max_tex_size = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
+  int max_size = max_tex_size > 0 && max_tex_size < maxPageSize() ? max_tex_size : maxPageSize();
+
+  // fill the holes of the older pages first, then grow the last one
+  for(int i=0; i<(int)mPages.size(); ++i)
+  {
+    Page& atlas = mPages[i];
+    for(;;)
+    {
+      if ( allocateCell(atlas, width, height, x, y) )
+      {
+        page = i;
+        return true;
+      }
+      if ( i != (int)mPages.size()-1 || atlas.mImage->width() >= max_size )
+        break;
+      growPage(atlas, max_size);
+    }
+  }
+
+  // start a new page, cells bigger than max_size get a page on their own
+  int size = 256 < max_size ? 256 : max_size;
+  while( size < width+1 || size < height+1 )
+    size *= 2;
+  if ( max_tex_size > 0 && size > max_tex_size )
+    return false;
+
+  createPage(size);
+  page = (int)mPages.size() - 1;
+  return allocateCell(mPages.back(), width, height, x, y);
+}
+//-----------------------------------------------------------------------------
+bool GlyphAtlas::addCell(int width, int height, const unsigned char* alpha, int& page, int& x, int& y)
+{
+  if ( !allocateCell(width, height, page, x, y) )
+    return false;
+
+  // the image rows go from the bottom to the top, the rest of the page is already transparent white
+  Image* img = mPages[page].mImage.get();
+  std::vector<unsigned char> cell( width * height * 4 );
+  for(int row=0; row<height; ++row)
+  {
+    unsigned char* px = &cell[row*width*4];
+    const unsigned char* src = alpha + (height-1-row)*width;
+    for(int col=0; col<width; ++col, px+=4)
+    {
+      px[0] = 0xFF;
+      px[1] = 0xFF;
+      px[2] = 0xFF;
+      px[3] = src[col];
+    }
+    memcpy( img->pixels() + x*4 + (y+row)*img->pitch(), &cell[row*width*4], width*4 );
+  }
+
+  // uploads only the new cell
+  VL_glActiveTexture(GL_TEXTURE0);
+  glBindTexture( GL_TEXTURE_2D, mPages[page].mTexture );
+  glTexSubImage2D( GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &cell[0] ); VL_CHECK_OGL();
+  glBindTexture( GL_TEXTURE_2D, 0 );
+  return true;
+}
+//-----------------------------------------------------------------------------
+void GlyphAtlas::cellAlpha(int page, int x, int y, int width, int height, unsigned char* alpha) const
+{
+  const Image* img = mPages[page].mImage.get();
+  for(int row=0; row<height; ++row)
+  {
+    const unsigned char* px = img->pixels() + x*4 + (y+row)*img->pitch();
+    unsigned char* dst = alpha + (height-1-row)*width;
+    for(int col=0; col<width; ++col, px+=4)
+      dst[col] = px[3];
+  }
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,126 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef GlyphAtlas_INCLUDE_ONCE
+#define GlyphAtlas_INCLUDE_ONCE
+
+#include <vlCore/Object.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vlCore/Image.hpp>
+#include <vlGraphics/link_config.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // GlyphAtlas
+  //-----------------------------------------------------------------------------
+  /**
+   * A texture atlas made of one or more pages in which the glyphs of one or more Font[s] are packed.
+   *
+   * Each page is filled shelf by shelf, it is doubled in size when full until it reaches maxPageSize() after which a new page is started. 
+   * The cells are separated by a 1 pixel transparent gutter. The textures are RGBA: the color is white and the glyph is stored in the alpha channel.
+   * \sa Font, DistanceFieldAtlas
+  */
+  class VLGRAPHICS_EXPORT GlyphAtlas: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::GlyphAtlas, Object)
+
+  public:
+    GlyphAtlas();
+
+    //! Destructor: deletes the page textures.
+    ~GlyphAtlas();
+
+    //! The maximum width and height in pixels of a page (default 1024). The value is clamped to GL_MAX_TEXTURE_SIZE.
+    //! Cells bigger than this are given a page of their own.
+    void setMaxPageSize(int size) { mMaxPageSize = size; }
+
+    //! The maximum width and height in pixels of a page (default 1024). The value is clamped to GL_MAX_TEXTURE_SIZE.
+    int maxPageSize() const { return mMaxPageSize; }
+
+    //! Whether the pages use linear filtering or not.
+    void setSmooth(bool smooth);
+
+    //! Whether the pages use linear filtering or not.
+    bool smooth() const { return mSmooth; }
+
+    //! The number of pages currently allocated.
+    int pageCount() const { return (int)mPages.size(); }
+
+    //! The texture handle of the given page.
+    unsigned int pageTexture(int page) const { return mPages[page].mTexture; }
+
+    //! The CPU copy of the given page.
+    const Image* pageImage(int page) const { return mPages[page].mImage.get(); }
+
+    //! Allocates a cell of \p width x \p height pixels and uploads the given alpha values into it, given row by row from the top one.
+    //! On success \p page, \p x and \p y receive the position of the cell in pixels, \p y being its bottom row.
+    bool addCell(int width, int height, const unsigned char* alpha, int& page, int& x, int& y);
+
+    //! Copies the alpha values of the given cell into \p alpha, row by row from the top one. The inverse of addCell().
+    void cellAlpha(int page, int x, int y, int width, int height, unsigned char* alpha) const;
+
+    //! Incremented every time the pages are released or a page grows, i.e. when the texture coordinates of the cells change.
+    long long tick() const { return mTick; }
+
+    //! Incremented every time the pages are released, i.e. when the cells allocated so far become invalid.
+    long long generation() const { return mGeneration; }
+
+    //! Deletes all the pages.
+    void releasePages();
+
+  protected:
+    //! A page of the atlas. The CPU copy of the texture is kept to grow the page.
+    struct Page
+    {
+      Page(): mTexture(0) {}
+      unsigned int mTexture;
+      ref<Image> mImage;
+      //! y = position, z = height, x = horizontal cursor.
+      std::vector<ivec3> mShelves;
+    };
+
+    bool allocateCell(int width, int height, int& page, int& x, int& y);
+    bool allocateCell(Page& page, int width, int height, int& x, int& y);
+    void createPage(int size);
+    void growPage(Page& page, int max_size);
+
+  protected:
+    std::vector<Page> mPages;
+    long long mTick;
+    long long mGeneration;
+    int mMaxPageSize;
+    bool mSmooth;
+  };
+}
+
+#endif
@@ -0,0 +1,270 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/GlyphQuads.hpp>
+#include <vlGraphics/Font.hpp>
+#include <vlGraphics/OpenGL.hpp>
+
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  struct BucketLess
+  {
+    BucketLess(const std::vector<GlyphQuads::Bucket>& buckets): mBuckets(buckets) {}
+
+    bool operator()(int a, int b) const
+    {
+      if (mBuckets[a].mLayer != mBuckets[b].mLayer)
+        return mBuckets[a].mLayer < mBuckets[b].mLayer;
+      else
+        return mBuckets[a].mTexture < mBuckets[b].mTexture;
+    }
+
+    const std::vector<GlyphQuads::Bucket>& mBuckets;
+  };
+
+  // thresholds the signed distance of the glyphs using the fixed function pipeline
+  void setDistanceFieldState(unsigned int texture)
+  {
+    if (!Has_GL_Version_1_3)
+    {
+      // the outline of the glyphs is at 0.5
+      glEnable(GL_ALPHA_TEST);
+      glAlphaFunc(GL_GEQUAL, 0.5f);
+      return;
+    }
+
+    // unit #0: alpha = 4 * (distance - 0.375) i.e. a ramp of +/- 1 pixel at the reference size around the outline
+    const float ramp_start[] = { 1.0f, 1.0f, 1.0f, 0.375f };
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PRIMARY_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_SUBTRACT);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_TEXTURE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_CONSTANT);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA);
+    glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, ramp_start);
+    glTexEnvf(GL_TEXTURE_ENV, GL_RGB_SCALE, 1.0f);
+    glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 4.0f);
+
+    // unit #1: modulates by the vertex alpha, the texture is bound only to make the unit complete
+    VL_glActiveTexture(GL_TEXTURE1);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_PRIMARY_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA);
+    glTexEnvf(GL_TEXTURE_ENV, GL_RGB_SCALE, 1.0f);
+    glTexEnvf(GL_TEXTURE_ENV, GL_ALPHA_SCALE, 1.0f);
+    VL_glActiveTexture(GL_TEXTURE0);
+    VL_CHECK_OGL();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void GlyphQuads::clear()
+{
+  // the buckets are kept to reuse their memory
+  for(size_t i=0; i<mBuckets.size(); ++i)
+    mBuckets[i].mVertices.clear();
+  mVertices.clear();
+  mRuns.clear();
+  mBufferDirty = true;
+}
+//-----------------------------------------------------------------------------
+void GlyphQuads::addQuad(const Glyph* glyph, const fvec3* corners, const ubvec4& color, int layer, const fvec3& offset)
+{
+  Vertex v[6];
+  v[0].mPosition = corners[0] + offset; v[0].mTexCoord = fvec2(glyph->s0(), glyph->t1());
+  v[1].mPosition = corners[1] + offset; v[1].mTexCoord = fvec2(glyph->s1(), glyph->t1());
+  v[2].mPosition = corners[2] + offset; v[2].mTexCoord = fvec2(glyph->s1(), glyph->t0());
+  v[3] = v[0];
+  v[4] = v[2];
+  v[5].mPosition = corners[3] + offset; v[5].mTexCoord = fvec2(glyph->s0(), glyph->t0());
+  for(int i=0; i<6; ++i)
+    v[i].mColor = color;
+  addQuad(glyph->textureHandle(), v, layer, glyph->font() && glyph->font()->isDistanceField());
+}
+//-----------------------------------------------------------------------------
+void GlyphQuads::addQuad(unsigned int texture, const Vertex* vertices, int layer, bool distance_field)
+{
+  // few buckets are expected, one per layer and atlas page
+  Bucket* bucket = NULL;
+  Bucket* unused = NULL;
+  for(size_t i=0; i<mBuckets.size() && !bucket; ++i)
+  {
+    if (mBuckets[i].mTexture == texture && mBuckets[i].mLayer == layer)
+      bucket = &mBuckets[i];
+    else
+    if (!unused && mBuckets[i].mVertices.empty())
+      unused = &mBuckets[i];
+  }
+
+  if (!bucket)
+  {
+    if (!unused)
+    {
+      mBuckets.push_back( Bucket() );
+      unused = &mBuckets.back();
+    }
+    bucket = unused;
+    bucket->mTexture = texture;
+    bucket->mLayer = layer;
+    bucket->mDistanceField = distance_field;
+  }
+
+  bucket->mVertices.insert( bucket->mVertices.end(), vertices, vertices+6 );
+  mBufferDirty = true;
+}
+//-----------------------------------------------------------------------------
+void GlyphQuads::finalize()
+{
+  std::vector<int> order;
+  for(int i=0; i<(int)mBuckets.size(); ++i)
+  {
+    if (!mBuckets[i].mVertices.empty())
+      order.push_back(i);
+  }
+  std::sort( order.begin(), order.end(), BucketLess(mBuckets) );
+
+  for(size_t i=0; i<order.size(); ++i)
+  {
+    Bucket& bucket = mBuckets[order[i]];
+    Run run;
+    run.mTexture = bucket.mTexture;
+    run.mLayer = bucket.mLayer;
+    run.mFirst = (int)mVertices.size();
+    run.mCount = (int)bucket.mVertices.size();
+    run.mDistanceField = bucket.mDistanceField;
+    mRuns.push_back(run);
+    mVertices.insert( mVertices.end(), bucket.mVertices.begin(), bucket.mVertices.end() );
+    bucket.mVertices.clear();
+  }
+}
+//-----------------------------------------------------------------------------
+ubvec4 GlyphQuads::packColor(const fvec4& color)
+{
+  ubvec4 c;
+  for(int i=0; i<4; ++i)
+    c[i] = (unsigned char)( color[i] <= 0 ? 0 : color[i] >= 1 ? 255 : color[i] * 255.0f + 0.5f );
+  return c;
+}
+//-----------------------------------------------------------------------------
+void GlyphQuads::render(bool fixed_function) const
+{
+  if (mVertices.empty())
+    return;
+
+  const unsigned char* base = NULL;
+  if (Has_BufferObject)
+  {
+    if (!mBufferObject)
+      mBufferObject = new BufferObject;
+    if (mBufferDirty || !mBufferObject->handle())
+      mBufferObject->setBufferData( (GLsizeiptr)(mVertices.size() * sizeof(Vertex)), &mVertices[0], BU_STATIC_DRAW );
+    VL_glBindBuffer( GL_ARRAY_BUFFER, mBufferObject->handle() ); VL_CHECK_OGL();
+  }
+  else
+    base = (const unsigned char*)&mVertices[0];
+  mBufferDirty = false;
+
+  VL_glActiveTexture( GL_TEXTURE0 );
+  glEnable(GL_TEXTURE_2D);
+  VL_glClientActiveTexture( GL_TEXTURE0 );
+
+  glEnableClientState( GL_VERTEX_ARRAY );
+  glVertexPointer( 3, GL_FLOAT, sizeof(Vertex), base );
+  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+  glTexCoordPointer( 2, GL_FLOAT, sizeof(Vertex), base + sizeof(fvec3) );
+  glEnableClientState( GL_COLOR_ARRAY );
+  glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + sizeof(fvec3) + sizeof(fvec2) );
+  VL_CHECK_OGL();
+
+  // consecutive runs using the same texture are contiguous and can be drawn at once
+  bool distance_field = false;
+  for(size_t i=0; i<mRuns.size(); )
+  {
+    int first = mRuns[i].mFirst;
+    int count = 0;
+    unsigned int texture = mRuns[i].mTexture;
+
+    // the state changed to render the distance field glyphs is restored for the other runs
+    if (fixed_function && mRuns[i].mDistanceField != distance_field)
+    {
+      if (distance_field)
+        glPopAttrib();
+      else
+        glPushAttrib(GL_TEXTURE_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+      distance_field = !distance_field;
+    }
+
+    for(; i<mRuns.size() && mRuns[i].mTexture == texture; ++i)
+      count += mRuns[i].mCount;
+    glBindTexture( GL_TEXTURE_2D, texture );
+    if (distance_field)
+      setDistanceFieldState(texture);
+    glDrawArrays( GL_TRIANGLES, first, count ); VL_CHECK_OGL();
+  }
+
+  if (distance_field)
+    glPopAttrib();
+  VL_CHECK_OGL();
+
+  glDisableClientState( GL_VERTEX_ARRAY );
+  glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+  glDisableClientState( GL_COLOR_ARRAY );
+
+  if (Has_BufferObject)
+    VL_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+  VL_CHECK_OGL();
+
+  glDisable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+//-----------------------------------------------------------------------------
+void GlyphQuads::deleteBufferObject()
+{
+  if (mBufferObject)
+    mBufferObject->deleteBufferObject();
+  mBufferDirty = true;
+}
+//-----------------------------------------------------------------------------
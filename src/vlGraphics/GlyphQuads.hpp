@@ -0,0 +1,132 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef GlyphQuads_INCLUDE_ONCE
+#define GlyphQuads_INCLUDE_ONCE
+
+#include <vlGraphics/BufferObject.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vector>
+
+namespace vl
+{
+  class Glyph;
+
+  //-----------------------------------------------------------------------------
+  // GlyphQuads
+  //-----------------------------------------------------------------------------
+  /**
+   * A list of colored and textured glyph quads used by Text, CoreText and TextBatch to render whole texts with one draw call per Font atlas page.
+   *
+   * The quads are sorted by layer and then by texture. Layers are rendered in increasing order, which is used to 
+   * render the shadow, the outline and the text in the right order, while consecutive runs using the same 
+   * texture are merged in a single draw call. The vertices are uploaded once to a BufferObject, when available, 
+   * and reused until the quads are rebuilt.
+   *
+   * Usage: clear(), addQuad() for every glyph, finalize(), then render() as many times as needed.
+  */
+  class VLGRAPHICS_EXPORT GlyphQuads
+  {
+  public:
+    //! A vertex of a glyph quad.
+    struct Vertex
+    {
+      fvec3 mPosition;
+      fvec2 mTexCoord;
+      ubvec4 mColor;
+    };
+
+    //! A sequence of vertices in vertices() sharing the same layer and texture.
+    struct Run
+    {
+      unsigned int mTexture;
+      int mLayer;
+      int mFirst;
+      int mCount;
+      //! Whether the texture contains signed distance field glyphs, see DistanceFieldAtlas.
+      bool mDistanceField;
+    };
+
+    //! The quads added with the same layer and texture, see finalize().
+    struct Bucket
+    {
+      unsigned int mTexture;
+      int mLayer;
+      bool mDistanceField;
+      std::vector<Vertex> mVertices;
+    };
+
+  public:
+    GlyphQuads(): mBufferDirty(true) {}
+
+    //! Removes all the quads.
+    void clear();
+
+    //! Adds the quad of the given glyph. The corners are given counter-clockwise starting from the bottom-left one and are translated by \p offset.
+    void addQuad(const Glyph* glyph, const fvec3* corners, const ubvec4& color, int layer=0, const fvec3& offset=fvec3());
+
+    //! Adds the two triangles (6 vertices) of a quad using the given texture. 
+    //! \p distance_field specifies whether the texture contains signed distance field glyphs.
+    void addQuad(unsigned int texture, const Vertex* vertices, int layer=0, bool distance_field=false);
+
+    //! Sorts the quads added since the last clear() by layer and texture, must be called before render(), vertices() and runs().
+    void finalize();
+
+    //! The vertices of the quads, 6 per quad, sorted by layer and texture.
+    const std::vector<Vertex>& vertices() const { return mVertices; }
+
+    //! The sequences of vertices sharing the same layer and texture, sorted by layer.
+    const std::vector<Run>& runs() const { return mRuns; }
+
+    //! Returns true if there are no quads to render.
+    bool empty() const { return mVertices.empty(); }
+
+    //! Converts a floating point color to the format used by the vertices.
+    static ubvec4 packColor(const fvec4& color);
+
+    //! Renders the quads with GL_TEXTURE_2D enabled on texture unit #0. The current color is modified.
+    //! If \p fixed_function is true the signed distance field glyphs are thresholded using texture units #0 and #1
+    //! or, with OpenGL < 1.3, with an alpha test. Otherwise the active GLSLProgram is expected to threshold the distance.
+    void render(bool fixed_function=true) const;
+
+    //! Deletes the BufferObject used to render the quads.
+    void deleteBufferObject();
+
+  protected:
+    std::vector<Vertex> mVertices;
+    std::vector<Run> mRuns;
+    std::vector<Bucket> mBuckets;
+    mutable ref<BufferObject> mBufferObject;
+    mutable bool mBufferDirty;
+  };
+}
+
+#endif
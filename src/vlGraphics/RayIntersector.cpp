@@ -31,9 +31,38 @@
 
 #include <vlGraphics/RayIntersector.hpp>
 #include <vlGraphics/SceneManager.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <cfloat>
 
 using namespace vl;
 
+namespace
+{
+  const int StackSize = 128;
+
+  class ClosestHitTask: public ParallelForTask
+  {
+  public:
+    typedef ref<RayIntersectionGeometry> (RayIntersector::*ClosestHitMethod)(const Ray&) const;
+
+    void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+        (*mHits)[i] = (mIntersector->*mMethod)((*mRays)[i]);
+    }
+
+  public:
+    const RayIntersector* mIntersector;
+    ClosestHitMethod mMethod;
+    const std::vector<Ray>* mRays;
+    std::vector< ref<RayIntersectionGeometry> >* mHits;
+  };
+
+  inline fvec3 reciprocal(const fvec3& v)
+  {
+    return fvec3(1.0f / v.x(), 1.0f / v.y(), 1.0f / v.z());
+  }
+}
 //-----------------------------------------------------------------------------
 void RayIntersector::intersect(const Ray& ray, SceneManager* scene_manager)
 {
@@ -46,83 +75,192 @@ void RayIntersector::intersect(const Ray& ray, SceneManager* scene_manager)
 void RayIntersector::intersect()
 {
   mIntersections.clear();
-  for(int i=0; i<actors()->size(); ++i)
+  prepare();
+
+  if (closestHitOnly())
   {
-    if (!frustum().cull(actors()->at(i)->boundingBox()))
-    {
-      intersect(actors()->at(i));
-    }
+    ref<RayIntersectionGeometry> hit = closestHit(ray());
+    if (hit)
+      mIntersections.push_back(hit);
   }
+  else
+  {
+    allHits(ray(), mIntersections);
+    std::sort( mIntersections.begin(), mIntersections.end(), sorter );
+  }
+}
+//-----------------------------------------------------------------------------
+void RayIntersector::intersect(const std::vector<Ray>& rays, std::vector< ref<RayIntersectionGeometry> >& hits)
+{
+  hits.clear();
+  hits.resize(rays.size());
+  prepare();
 
-  std::sort( mIntersections.begin(), mIntersections.end(), sorter );
+  ClosestHitTask task;
+  task.mIntersector = this;
+  task.mMethod = &RayIntersector::closestHit;
+  task.mRays = &rays;
+  task.mHits = &hits;
+  parallelFor(0, (int)rays.size(), &task, 16);
 }
 //-----------------------------------------------------------------------------
-void RayIntersector::intersect(Actor* act)
+void RayIntersector::prepare()
 {
-  Geometry* geom = cast<Geometry>(act->lod(0));
-  if (geom)
-    intersectGeometry(act, geom);
+  mCandidates.clear();
+  std::vector<fvec3> box_min, box_max;
+  for(int i=0; i<actors()->size(); ++i)
+  {
+    Actor* act = actors()->at(i);
+    const AABB& aabb = act->boundingBox();
+    if (aabb.isNull() || frustum().cull(aabb))
+      continue;
+    Geometry* geom = cast<Geometry>(act->lod(0));
+    if (!geom)
+      continue;
+
+    Candidate cand;
+    cand.mActor = act;
+    cand.mGeometry = geom;
+    cand.mBVH = geom->triangleBVH();
+    cand.mHasTransform = act->transform() != NULL;
+    if (cand.mHasTransform)
+      cand.mInverseMatrix = act->transform()->worldMatrix().getInverse();
+    mCandidates.push_back(cand);
+    box_min.push_back( (fvec3)aabb.minCorner() );
+    box_max.push_back( (fvec3)aabb.maxCorner() );
+  }
+
+  if (mCandidates.empty())
+    mActorNodes.clear();
+  else
+    buildBVH(mActorNodes, mActorOrder, &box_min[0], &box_max[0], (int)mCandidates.size(), 2);
 }
 //-----------------------------------------------------------------------------
-void RayIntersector::intersectGeometry(Actor* act, Geometry* geom)
+ref<RayIntersectionGeometry> RayIntersector::closestHit(const Ray& ray) const
 {
-  ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
-  if (posarr)
+  if (mActorNodes.empty())
+    return NULL;
+
+  const fvec3 orig = (fvec3)ray.origin();
+  const fvec3 inv_dir = reciprocal((fvec3)ray.direction());
+  float best = FLT_MAX;
+  int best_candidate = -1;
+  TriangleBVH::Hit best_hit;
+
+  int stack[StackSize];
+  int top = 0;
+  stack[top++] = 0;
+  while(top)
   {
-    mat4 matrix = act->transform() ? act->transform()->worldMatrix() : mat4();
-    for(int i=0; i<geom->drawCalls()->size(); ++i)
+    const BVHNode& node = mActorNodes[stack[--top]];
+    float t_near;
+    if (!node.intersect(orig, inv_dir, best, t_near))
+      continue;
+    if (node.isLeaf())
     {
-      DrawCall* prim = geom->drawCalls()->at(i);
-      int itri = 0;
-      for(TriangleIterator trit = prim->triangleIterator(); trit.hasNext(); trit.next(), ++itri)
+      for(int i=node.mIndex; i<node.mIndex+node.mCount; ++i)
       {
-        int ia = trit.a();
-        int ib = trit.b();
-        int ic = trit.c();
-        vec3 a = posarr->getAsVec3(ia);
-        vec3 b = posarr->getAsVec3(ib);
-        vec3 c = posarr->getAsVec3(ic);
-        if (act->transform())
+        const Candidate& cand = mCandidates[mActorOrder[i]];
+        fvec3 o = orig;
+        fvec3 d = (fvec3)ray.direction();
+        if (cand.mHasTransform)
         {
-          a = matrix * a;
-          b = matrix * b;
-          c = matrix * c;
+          // the ray parameter is preserved by the transformation since the direction is not normalized
+          o = (fvec3)(cand.mInverseMatrix * ray.origin());
+          d = (fvec3)(cand.mInverseMatrix.get3x3() * ray.direction());
         }
-        intersectTriangle(a, b, c, ia, ib, ic, act, geom, prim, itri);
+        TriangleBVH::Hit hit;
+        if (cand.mBVH->closestHit(o, d, best, hit))
+        {
+          best = hit.mDistance;
+          best_hit = hit;
+          best_candidate = mActorOrder[i];
+        }
+      }
+    }
+    else
+    {
+      // visit the nearest child first
+      int left = (int)(&node - &mActorNodes[0]) + 1;
+      int right = node.mIndex;
+      float t_left = FLT_MAX, t_right = FLT_MAX;
+      bool hit_left  = mActorNodes[left].intersect(orig, inv_dir, best, t_left);
+      bool hit_right = mActorNodes[right].intersect(orig, inv_dir, best, t_right);
+      if (hit_left && hit_right)
+      {
+        stack[top++] = t_left < t_right ? right : left;
+        stack[top++] = t_left < t_right ? left : right;
       }
+      else
+      if (hit_left)
+        stack[top++] = left;
+      else
+      if (hit_right)
+        stack[top++] = right;
     }
   }
+
+  if (best_candidate < 0)
+    return NULL;
+  return makeIntersection(ray, mCandidates[best_candidate], best_hit);
 }
 //-----------------------------------------------------------------------------
-template<class T>
-void RayIntersector::intersectTriangle(const T& a, const T& b, const T& c, int ia, int ib, int ic, Actor* act, Geometry* geom, DrawCall* prim, int tri_idx)
+void RayIntersector::allHits(const Ray& ray, std::vector< ref<RayIntersection> >& hits) const
 {
-  T v1 = b-a;
-  T v2 = c-a;
-  T n = cross(v1,v2).normalize();
-  real det = (real)dot(n,(T)ray().direction());
-  if(det == 0)
-    return;
-  real t = (real)dot(n, a-(T)ray().origin()) / det;
-  if (t<0)
+  if (mActorNodes.empty())
     return;
-  vec3  rp = ray().origin() + ray().direction() * t;
-  T fp = (T)rp;
-  T pts[] = { a, b, c, a };
-  for(int i=0; i<3; ++i)
+
+  const fvec3 orig = (fvec3)ray.origin();
+  const fvec3 inv_dir = reciprocal((fvec3)ray.direction());
+  std::vector<TriangleBVH::Hit> tri_hits;
+
+  int stack[StackSize];
+  int top = 0;
+  stack[top++] = 0;
+  while(top)
   {
-    T bi_norm = -cross(pts[i+1]-pts[i],n).normalize();
-    if (dot(fp-pts[i],bi_norm) < 0)
-      return;
+    int inode = stack[--top];
+    const BVHNode& node = mActorNodes[inode];
+    float t_near;
+    if (!node.intersect(orig, inv_dir, FLT_MAX, t_near))
+      continue;
+    if (node.isLeaf())
+    {
+      for(int i=node.mIndex; i<node.mIndex+node.mCount; ++i)
+      {
+        const Candidate& cand = mCandidates[mActorOrder[i]];
+        fvec3 o = orig;
+        fvec3 d = (fvec3)ray.direction();
+        if (cand.mHasTransform)
+        {
+          o = (fvec3)(cand.mInverseMatrix * ray.origin());
+          d = (fvec3)(cand.mInverseMatrix.get3x3() * ray.direction());
+        }
+        tri_hits.clear();
+        cand.mBVH->allHits(o, d, tri_hits);
+        for(size_t j=0; j<tri_hits.size(); ++j)
+          hits.push_back( makeIntersection(ray, cand, tri_hits[j]) );
+      }
+    }
+    else
+    {
+      stack[top++] = node.mIndex;
+      stack[top++] = inode + 1;
+    }
   }
+}
+//-----------------------------------------------------------------------------
+ref<RayIntersectionGeometry> RayIntersector::makeIntersection(const Ray& ray, const Candidate& cand, const TriangleBVH::Hit& hit)
+{
+  const TriangleBVH::Triangle& tri = cand.mBVH->triangles()[hit.mTriangle];
   ref<RayIntersectionGeometry> record = new vl::RayIntersectionGeometry;
-  record->setIntersectionPoint( rp );
-  record->setTriangleIndex(tri_idx);
-  record->setTriangle(ia, ib, ic);
-  record->setActor(act);
-  record->setGeometry(geom);
-  record->setPrimitives(prim);
-  record->setDistance( t );
-  mIntersections.push_back(record);
+  record->setIntersectionPoint( ray.origin() + ray.direction() * (real)hit.mDistance );
+  record->setTriangleIndex(tri.mIndex);
+  record->setTriangle(tri.mA, tri.mB, tri.mC);
+  record->setActor(cand.mActor);
+  record->setGeometry(cand.mGeometry);
+  record->setPrimitives(cand.mGeometry->drawCalls()->at(tri.mDrawCall));
+  record->setDistance( hit.mDistance );
+  return record;
 }
 //-----------------------------------------------------------------------------
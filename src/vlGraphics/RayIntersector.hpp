@@ -129,13 +129,19 @@ namespace vl
   // RayIntersector
   //-----------------------------------------------------------------------------
   /** The RayIntersector class is used to detect the intersection points between a Ray and a set of Actor[s]
+   *
+   * The Actor[s] are organized in a bounding volume hierarchy built at every intersect() call, while the triangles of their
+   * Geometry are tested using the hierarchy cached by Geometry::triangleBVH(), which is built once and rebuilt only when the 
+   * Geometry changes. The rays are transformed in the Actor's object space, so that the triangles never need to be transformed.
+   * Use setClosestHitOnly() when only the closest intersection is needed, for example for picking and hover highlighting, and
+   * the intersect(const std::vector<Ray>&, std::vector< ref<RayIntersectionGeometry> >&) overload to process many rays at once.
    */
   class VLGRAPHICS_EXPORT RayIntersector: public Object
   {
     VL_INSTRUMENT_CLASS(vl::RayIntersector, Object)
 
   public:
-    RayIntersector()
+    RayIntersector(): mClosestHitOnly(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
       mActors = new ActorCollection;
@@ -156,6 +162,11 @@ namespace vl
     //! The frustum in world coordinates used to cull the objects.
     void setFrustum(const Frustum& frustum) { mFrustum = frustum; }
 
+    //! If true intersect() computes only the closest intersection, which is much faster than computing all of them (default is false).
+    void setClosestHitOnly(bool closest_only) { mClosestHitOnly = closest_only; }
+    //! If true intersect() computes only the closest intersection, which is much faster than computing all of them (default is false).
+    bool closestHitOnly() const { return mClosestHitOnly; }
+
     //! The intersection points detected by the last intersect() call sorted according to their distance (the first one is the closest).
     const std::vector< ref<RayIntersection> >& intersections() const { return mIntersections; }
 
@@ -176,21 +187,45 @@ namespace vl
       */
     void intersect(const Ray& ray, SceneManager* scene_manager);
 
+    /** Computes the closest intersection of each of the given rays with the actors(), ignoring ray() and closestHitOnly().
+      * The rays are processed in parallel using defThreadPool(). \p hits[i] receives the closest intersection 
+      * of \p rays[i] or NULL if the ray does not intersect any Actor. The same notes of intersect() apply. */
+    void intersect(const std::vector<Ray>& rays, std::vector< ref<RayIntersectionGeometry> >& hits);
+
   protected:
     static bool sorter(const ref<RayIntersection>& a, const ref<RayIntersection>& b) { return a->distance() < b->distance(); }
 
-    void intersect(Actor* act);
-    void intersectGeometry(Actor* act, Geometry* geom);
+    //! An Actor taking part to the intersection tests.
+    struct Candidate
+    {
+      Actor* mActor;
+      Geometry* mGeometry;
+      const TriangleBVH* mBVH;
+      mat4 mInverseMatrix;
+      bool mHasTransform;
+    };
+
+    //! Culls the actors() against the frustum(), updates their triangle hierarchies and builds the Actor hierarchy.
+    void prepare();
+
+    //! Returns the closest intersection between the given ray and the Actor[s] selected by prepare().
+    ref<RayIntersectionGeometry> closestHit(const Ray& ray) const;
+
+    //! Appends to \p hits all the intersections between the given ray and the Actor[s] selected by prepare().
+    void allHits(const Ray& ray, std::vector< ref<RayIntersection> >& hits) const;
 
-    // T should be either fvec3-4 or dvec3-4
-    template<class T>
-    void intersectTriangle(const T& a, const T& b, const T& c, int ia, int ib, int ic, Actor*, Geometry* geom, DrawCall* prim, int prim_idx);
+    //! Creates the intersection record of the given triangle hierarchy hit.
+    static ref<RayIntersectionGeometry> makeIntersection(const Ray& ray, const Candidate& cand, const TriangleBVH::Hit& hit);
 
   protected:
     Frustum mFrustum;
     std::vector< ref<RayIntersection> > mIntersections;
     ref<ActorCollection> mActors;
     Ray mRay;
+    std::vector<Candidate> mCandidates;
+    std::vector<BVHNode> mActorNodes;
+    std::vector<int> mActorOrder;
+    bool mClosestHitOnly;
   };
 }
 
@@ -96,18 +96,19 @@ namespace vl
     {
       if (sorter->mightNeedZCameraDistance())
       {
+        // only the Z row of the view matrix is needed
+        const mat4& view = camera->viewMatrix();
+        const vec4 zrow( view.e(2,0), view.e(2,1), view.e(2,2), view.e(2,3) );
         for(int i=0; i<size(); ++i)
         {
           RenderToken* tok = at(i);
-          vec3 center = tok->mRenderable->boundingBox().isNull() ? vec3(0,0,0) : tok->mRenderable->boundingBox().center();
           if ( sorter->confirmZCameraDistanceNeed(tok) )
           {
+            vec3 center = tok->mRenderable->boundingBox().isNull() ? vec3(0,0,0) : tok->mRenderable->boundingBox().center();
             if (tok->mActor->transform())
-              // tok->mCameraDistance = ( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).lengthSquared();
-              tok->mCameraDistance = -( camera->viewMatrix() * (tok->mActor->transform()->worldMatrix() * center) ).z();
-            else
-              // tok->mCameraDistance = ( camera->viewMatrix() * /* I* */ center ).lengthSquared();
-              tok->mCameraDistance = -( camera->viewMatrix() * /* I* */ center ).z();
+              center = tok->mActor->transform()->worldMatrix() * center;
+            // tok->mCameraDistance = ( camera->viewMatrix() * center ).lengthSquared();
+            tok->mCameraDistance = -( zrow.x()*center.x() + zrow.y()*center.y() + zrow.z()*center.z() + zrow.w() );
           }
           else
             tok->mCameraDistance = 0;
@@ -47,6 +47,7 @@ namespace vl
   class RenderToken: public Object
   {
     VL_INSTRUMENT_CLASS(vl::RenderToken, Object)
+    VL_POOLED_ALLOCATION(vl::RenderToken)
 
   public:
     RenderToken(): mNextPass(NULL), mActor(NULL), mShader(NULL), mEffectRenderRank(0), mCameraDistance(0.0)
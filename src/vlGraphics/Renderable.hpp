@@ -114,9 +114,10 @@ namespace vl
     }
 
     //! Recomputes the bounding box and bounding sphere of a Renderable.
-    void computeBounds() { computeBounds_Implementation(); setBoundsDirty(false); }
+    void computeBounds() { computeBounds_Implementation(); ++mBoundsUpdateTick; setBoundsDirty(false); }
 
-    //! Returns the bounds-update-tick which is a counter incremented every time the bounding box or bounding sphere is updated.
+    //! Returns the bounds-update-tick which is a counter incremented every time the bounding box or bounding sphere is updated or recomputed.
+    //! Since computeBounds() is invoked after the vertices change it is also used to detect changes of the geometry, see Geometry::triangleBVH().
     long long boundsUpdateTick() const { return mBoundsUpdateTick; }
     
     //! Marks the bounding box and bounding sphere as dirty in order to be recomputed at the next rendering.
@@ -33,6 +33,7 @@
 #include <vlGraphics/OpenGLContext.hpp>
 #include <vlGraphics/Renderer.hpp>
 #include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/SceneManagerActorBoundsTable.hpp>
 #include <vlGraphics/RenderQueue.hpp>
 #include <vlGraphics/GLSL.hpp>
 #include <vlCore/Log.hpp>
@@ -70,6 +71,7 @@ Rendering& Rendering::operator=(const Rendering& other)
   mNearFarClippingPlanesOptimized = other.mNearFarClippingPlanesOptimized;
 
   mRenderQueueSorter   = other.mRenderQueueSorter;
+  mOcclusionCuller     = other.mOcclusionCuller;
   /*mActorQueue        = other.mActorQueue;*/
   /*mRenderQueue       = other.mRenderQueue;*/
   *mSceneManagers      = *other.mSceneManagers;
@@ -194,6 +196,9 @@ void Rendering::render()
                                              camera()->modelingMatrix().getZ());
   }
 
+  // the ranges of the actor queue filled by a SceneManagerActorBoundsTable, whose bounds are read from its ActorBoundsTable
+  std::vector< std::pair<int, const SceneManagerActorBoundsTable*> > bounds_table_ranges;
+
   actorQueue()->clear();
   for(int i=0; i<sceneManagers()->size(); ++i)
   {
@@ -207,19 +212,44 @@ void Rendering::render()
         bool visible = !camera()->frustum().cull(sceneManagers()->at(i)->boundingSphere()) && 
                        !camera()->frustum().cull(sceneManagers()->at(i)->boundingBox());
         if ( visible )
+        {
+          int first = actorQueue()->size();
           sceneManagers()->at(i)->extractVisibleActors( *actorQueue(), camera() );
+          const SceneManagerActorBoundsTable* table_sm = cast_const<SceneManagerActorBoundsTable>( sceneManagers()->at(i) );
+          if (table_sm)
+            bounds_table_ranges.push_back( std::make_pair(first, table_sm) );
+        }
       }
       else
         sceneManagers()->at(i)->extractActors( *actorQueue() );
     }
   }
 
+  // software occlusion culling
+
+  if (cullingEnabled() && occlusionCuller())
+  {
+    occlusionCuller()->rasterizeOccluders( camera() );
+    occlusionCuller()->cull( *actorQueue() );
+    // the actor queue has been compacted and the ranges are no longer valid
+    bounds_table_ranges.clear();
+  }
+
   // collect near/far clipping planes optimization information
   if (nearFarClippingPlanesOptimized())
   {
     Sphere world_bounding_sphere;
-    for(int i=0; i<actorQueue()->size(); ++i)
-      world_bounding_sphere += actorQueue()->at(i)->boundingSphere();
+    int next = 0;
+    for(size_t r=0; r<bounds_table_ranges.size(); ++r)
+    {
+      for(; next<bounds_table_ranges[r].first; ++next)
+        world_bounding_sphere += actorQueue()->at(next)->boundingSphere();
+      const SceneManagerActorBoundsTable* table_sm = bounds_table_ranges[r].second;
+      world_bounding_sphere += table_sm->visibleBoundingSphere();
+      next += (int)table_sm->visibleSlots().size();
+    }
+    for(; next<actorQueue()->size(); ++next)
+      world_bounding_sphere += actorQueue()->at(next)->boundingSphere();
 
     // compute the optimized
     camera()->computeNearFarOptimizedProjMatrix(world_bounding_sphere);
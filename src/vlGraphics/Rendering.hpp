@@ -40,6 +40,7 @@
 #include <vlGraphics/Framebuffer.hpp>
 #include <vlGraphics/Camera.hpp>
 #include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/SoftwareOcclusionCuller.hpp>
 #include <vlCore/Transform.hpp>
 #include <vlCore/Collection.hpp>
 
@@ -53,6 +54,7 @@ namespace vl
   -# recursively computes the world matrix of the installed Transform hierarchy
   -# setups the Camera transform and the Viewport
   -# extracts all the visible Actor[s] from the installed SceneManager[s]
+  -# removes the Actor[s] hidden by the occluders of the installed SoftwareOcclusionCuller, if any
   -# compiles and sorts the RenderQueue using the installed RenderQueueSorter
   -# uses the installed Renderer to perform the rendering of the RenderQueue
   -# dispatches the onRenderingFinished() event (see RenderEventCallback class).
@@ -173,6 +175,16 @@ namespace vl
     /** Whether the installed SceneManager[s] should perform Actor culling or not in order to maximize the rendering performances. */
     bool cullingEnabled() const { return mCullingEnabled; }
 
+    /** The SoftwareOcclusionCuller used to remove the occluded Actor[s] after frustum culling and before filling the render queue (default is NULL). 
+      * Occlusion culling is performed only if cullingEnabled() is true. */
+    void setOcclusionCuller(SoftwareOcclusionCuller* culler) { mOcclusionCuller = culler; }
+
+    /** The SoftwareOcclusionCuller used to remove the occluded Actor[s] after frustum culling and before filling the render queue (default is NULL). */
+    const SoftwareOcclusionCuller* occlusionCuller() const { return mOcclusionCuller.get(); }
+
+    /** The SoftwareOcclusionCuller used to remove the occluded Actor[s] after frustum culling and before filling the render queue (default is NULL). */
+    SoftwareOcclusionCuller* occlusionCuller() { return mOcclusionCuller.get(); }
+
     /** Whether OpenGL resources such as textures and GLSL programs should be automatically initialized when first used. 
       * Enabling this features forces VL to keep track of which resources are used for each rendering, which might slighly impact the 
       * rendering time, thus to obtain the maximum performances disable this option and manually initialize your textures and GLSL shaders. */
@@ -217,6 +229,7 @@ namespace vl
     ref<RenderQueue> mRenderQueue;
     std::vector< ref<Renderer> > mRenderers;
     ref<Camera> mCamera;
+    ref<SoftwareOcclusionCuller> mOcclusionCuller;
     ref<Transform> mTransform;
     ref<Collection<SceneManager> > mSceneManagers;
     std::map<unsigned int, ref<Effect> > mEffectOverrideMask;
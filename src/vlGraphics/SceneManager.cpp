@@ -49,6 +49,20 @@ SceneManager::SceneManager()
   mEnableMask = 0xFFFFFFFF;
 }
 //-----------------------------------------------------------------------------
+void SceneManager::extractActorsInFrustum(ActorCollection& list, const Frustum& frustum)
+{
+  ActorCollection actors;
+  extractActors(actors);
+  for(int i=0; i<actors.size(); ++i)
+  {
+    if (!isEnabled(actors.at(i)))
+      continue;
+    actors.at(i)->computeBounds();
+    if (!frustum.cull(actors.at(i)->boundingBox()))
+      list.push_back(actors.at(i));
+  }
+}
+//-----------------------------------------------------------------------------
 void SceneManager::computeBounds()
 {
   ActorCollection actors;
@@ -41,6 +41,7 @@ namespace vl
   class Actor;
   class ActorCollection;
   class Camera;
+  class Frustum;
 
 //-------------------------------------------------------------------------------------------------------------------------------------------
 // SceneManager
@@ -84,6 +85,10 @@ namespace vl
     //! Appends all the Actor[s] contained in the scene manager without performing frustum culling or checking enable masks.
     virtual void extractActors(ActorCollection& list) = 0;
 
+    //! Appends to the given ActorCollection the enabled Actor[s] whose bounds are not culled by the given frustum, regardless of cullingEnabled().
+    //! Used to perform selection queries, see VolumeSelector. The default implementation tests the Actor[s] returned by extractActors() one by one.
+    virtual void extractActorsInFrustum(ActorCollection& list, const Frustum& frustum);
+
     //! Computes the bounding box and bounding sphere of the scene manager and of all the Actor[s] contained in the SceneManager.
     virtual void computeBounds();
 
@@ -0,0 +1,90 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/SceneManagerActorBoundsTable.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// SceneManagerActorBoundsTable
+//-----------------------------------------------------------------------------
+void SceneManagerActorBoundsTable::addActor(Actor* actor)
+{
+  if (mBoundsTable->addActor(actor) == -1)
+    Log::error("SceneManagerActorBoundsTable::addActor(): the Actor already belongs to another ActorBoundsTable.\n");
+  setBoundsDirty(true);
+}
+//-----------------------------------------------------------------------------
+Actor* SceneManagerActorBoundsTable::addActor(Renderable* renderable, Effect* eff, Transform* tr)
+{
+  ref<Actor> act = new Actor(renderable, eff, tr);
+  addActor(act.get());
+  return act.get();
+}
+//-----------------------------------------------------------------------------
+void SceneManagerActorBoundsTable::extractVisibleActors(ActorCollection& list, const Camera* camera)
+{
+  mBoundsTable->updateBounds();
+  mVisibleSlots.clear();
+  if (cullingEnabled())
+    mBoundsTable->cull(mVisibleSlots, camera->frustum(), enableMask());
+  else
+  {
+    mVisibleSlots.resize(mBoundsTable->size());
+    for(int i=0; i<mBoundsTable->size(); ++i)
+      mVisibleSlots[i] = i;
+  }
+  for(size_t i=0; i<mVisibleSlots.size(); ++i)
+    list.push_back(mBoundsTable->actor(mVisibleSlots[i]));
+}
+//-----------------------------------------------------------------------------
+void SceneManagerActorBoundsTable::extractActors(ActorCollection& list)
+{
+  for(int i=0; i<mBoundsTable->size(); ++i)
+    list.push_back(mBoundsTable->actor(i));
+}
+//-----------------------------------------------------------------------------
+void SceneManagerActorBoundsTable::extractActorsInFrustum(ActorCollection& list, const Frustum& frustum)
+{
+  mBoundsTable->updateBounds();
+  mBoundsTable->extractVisibleActors(list, frustum, enableMask());
+}
+//-----------------------------------------------------------------------------
+void SceneManagerActorBoundsTable::computeBounds()
+{
+  mBoundsTable->updateBounds();
+  mBoundsTable->computeBounds(mAABB, mSphere);
+  setBoundsDirty(false);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef SceneManagerActorBoundsTable_INCLUDE_ONCE
+#define SceneManagerActorBoundsTable_INCLUDE_ONCE
+
+#include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/ActorBoundsTable.hpp>
+
+namespace vl
+{
+  //-------------------------------------------------------------------------------------------------------------------------------------------
+  // SceneManagerActorBoundsTable
+  //-------------------------------------------------------------------------------------------------------------------------------------------
+  /**
+   * A flat SceneManager that keeps the bounds of its Actor[s] in an ActorBoundsTable and performs frustum culling
+   * and bounds computation iterating linearly over contiguous arrays instead of following Actor pointers.
+   *
+   * Best suited for scenes with a very large number of small, mostly static or independently moving Actor[s], 
+   * where maintaining a bounding volume hierarchy would be more expensive than a linear pass.
+   * When the near/far clipping planes optimization is enabled, Rendering computes the bounding sphere of the Actor[s]
+   * extracted by this scene manager with visibleBoundingSphere() instead of reading each Actor's bounds.
+   *
+   * \sa
+   * - ActorBoundsTable
+   * - SceneManager
+   * - SceneManagerActorTree
+   * - SceneManagerActorKdTree
+   */
+  class VLGRAPHICS_EXPORT SceneManagerActorBoundsTable: public SceneManager
+  {
+    VL_INSTRUMENT_CLASS(vl::SceneManagerActorBoundsTable, SceneManager)
+
+  public:
+    SceneManagerActorBoundsTable()
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+      mBoundsTable = new ActorBoundsTable;
+    }
+
+    //! Adds an Actor to the scene manager, the Actor must not belong to any other ActorBoundsTable.
+    void addActor(Actor* actor);
+
+    //! Creates and adds an Actor to the scene manager.
+    Actor* addActor(Renderable* renderable, Effect* eff, Transform* tr=NULL);
+
+    //! Removes an Actor from the scene manager.
+    bool eraseActor(Actor* actor) { setBoundsDirty(true); return mBoundsTable->eraseActor(actor); }
+
+    //! Removes all the Actor[s] from the scene manager.
+    void eraseAllActors() { setBoundsDirty(true); mBoundsTable->clear(); }
+
+    //! The ActorBoundsTable holding the Actor[s] of the scene manager.
+    ActorBoundsTable* boundsTable() { return mBoundsTable.get(); }
+
+    //! The ActorBoundsTable holding the Actor[s] of the scene manager.
+    const ActorBoundsTable* boundsTable() const { return mBoundsTable.get(); }
+
+    virtual void extractVisibleActors(ActorCollection& list, const Camera* camera);
+
+    //! The slots of the Actor[s] appended to the list by the last extractVisibleActors() call, in the same order.
+    const std::vector<int>& visibleSlots() const { return mVisibleSlots; }
+
+    //! The bounding sphere of the Actor[s] appended to the list by the last extractVisibleActors() call, computed from the ActorBoundsTable.
+    Sphere visibleBoundingSphere() const { return mBoundsTable->computeBoundingSphere(mVisibleSlots); }
+
+    virtual void extractActors(ActorCollection& list);
+
+    virtual void extractActorsInFrustum(ActorCollection& list, const Frustum& frustum);
+
+    virtual void computeBounds();
+
+  protected:
+    ref<ActorBoundsTable> mBoundsTable;
+    std::vector<int> mVisibleSlots;
+  };
+}
+
+#endif
@@ -79,6 +79,12 @@ namespace vl
       tree()->extractActors(list);
     }
 
+    virtual void extractActorsInFrustum(ActorCollection& list, const Frustum& frustum)
+    {
+      // culls the hierarchical volume tree against the frustum
+      tree()->extractVisibleActors(list, frustum, enableMask());
+    }
+
   protected:
     ref<T> mBoundingVolumeTree;
   };
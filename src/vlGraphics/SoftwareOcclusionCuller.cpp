@@ -0,0 +1,444 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/SoftwareOcclusionCuller.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+
+#if VL_SSE2
+  #include <emmintrin.h>
+#endif
+
+using namespace vl;
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // Rasterizes the triangles overlapping a set of bands of TileSize rows and computes the farthest depth of each tile.
+  class RasterizeBandTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int band=begin; band<end; ++band)
+        rasterizeBand(band);
+    }
+
+    void rasterizeBand(int band)
+    {
+      const int y0 = band * mTileSize;
+      const int y1 = y0 + mTileSize;
+      float* depth = mDepth + y0 * mWidth;
+      std::fill(depth, depth + mTileSize * mWidth, 1.0f);
+
+      for(size_t itri=0; itri<mTriangles->size(); ++itri)
+      {
+        const SoftwareOcclusionCuller::ScreenTriangle& tri = (*mTriangles)[itri];
+        if (tri.mMaxY < y0 || tri.mMinY >= y1)
+          continue;
+        rasterizeTriangle(tri, std::max(y0, tri.mMinY), std::min(y1-1, tri.mMaxY));
+      }
+
+      // farthest depth of each tile of the band
+      const int tiles_x = mWidth / mTileSize;
+      for(int tx=0; tx<tiles_x; ++tx)
+      {
+        float max_depth = 0;
+        for(int y=0; y<mTileSize; ++y)
+        {
+          const float* row = depth + y * mWidth + tx * mTileSize;
+          int x = 0;
+#if VL_SSE2
+          __m128 max4 = _mm_setzero_ps();
+          for(; x+4<=mTileSize; x+=4)
+            max4 = _mm_max_ps(max4, _mm_loadu_ps(row+x));
+          max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1,0,3,2)));
+          max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2,3,0,1)));
+          max_depth = std::max(max_depth, _mm_cvtss_f32(max4));
+#endif
+          for(; x<mTileSize; ++x)
+            max_depth = std::max(max_depth, row[x]);
+        }
+        mTileMaxDepth[tx + band * tiles_x] = max_depth;
+      }
+    }
+
+    void rasterizeTriangle(const SoftwareOcclusionCuller::ScreenTriangle& tri, int ymin, int ymax)
+    {
+      float x0 = tri.mX[0], y0 = tri.mY[0], z0 = tri.mZ[0];
+      float x1 = tri.mX[1], y1 = tri.mY[1], z1 = tri.mZ[1];
+      float x2 = tri.mX[2], y2 = tri.mY[2], z2 = tri.mZ[2];
+
+      float area = (x1-x0)*(y2-y0) - (y1-y0)*(x2-x0);
+      if (area == 0)
+        return;
+      if (area < 0)
+      {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        std::swap(z1, z2);
+        area = -area;
+      }
+
+      int xmin = std::max(0, (int)floor(std::min(x0, std::min(x1, x2))));
+      int xmax = std::min(mWidth-1, (int)ceil(std::max(x0, std::max(x1, x2))));
+      if (xmin > xmax)
+        return;
+
+      // edge functions, each one is positive inside the triangle and proportional to the barycentric coordinate of the opposite vertex
+      const float e0_dx = -(y2-y1), e0_dy = x2-x1;
+      const float e1_dx = -(y0-y2), e1_dy = x0-x2;
+      const float e2_dx = -(y1-y0), e2_dy = x1-x0;
+
+      // depth plane
+      const float inv_area = 1.0f / area;
+      const float z_dx = (e0_dx*z0 + e1_dx*z1 + e2_dx*z2) * inv_area;
+      const float z_dy = (e0_dy*z0 + e1_dy*z1 + e2_dy*z2) * inv_area;
+
+      // Conservative coverage: the edge functions are evaluated at the pixel centers minus their smallest value over the
+      // pixel, so that a pixel is covered only if its whole square is inside the triangle, and the depth written is the
+      // farthest one over the pixel. An occludee peeking out of an occluder by less than a pixel is thus never culled.
+      const float e0_bias = 0.5f * (fabs(e0_dx) + fabs(e0_dy));
+      const float e1_bias = 0.5f * (fabs(e1_dx) + fabs(e1_dy));
+      const float e2_bias = 0.5f * (fabs(e2_dx) + fabs(e2_dy));
+      const float z_bias  = 0.5f * (fabs(z_dx)  + fabs(z_dy));
+
+      const float px = xmin + 0.5f;
+      for(int y=ymin; y<=ymax; ++y)
+      {
+        const float py = y + 0.5f;
+        const float e0 = (x2-x1)*(py-y1) - (y2-y1)*(px-x1);
+        const float e1 = (x0-x2)*(py-y2) - (y0-y2)*(px-x2);
+        const float e2 = (x1-x0)*(py-y0) - (y1-y0)*(px-x0);
+        const float z  = (e0*z0 + e1*z1 + e2*z2) * inv_area + z_bias;
+        const float e0_row = e0 - e0_bias;
+        const float e1_row = e1 - e1_bias;
+        const float e2_row = e2 - e2_bias;
+        float* row = mDepth + y * mWidth;
+        // the values are computed from the start of the row and not accumulated, so that the SSE2 and the scalar paths give the same results
+        int x = xmin;
+#if VL_SSE2
+        const __m128 ramp = _mm_set_ps(3, 2, 1, 0);
+        const __m128 zero = _mm_setzero_ps();
+        for(; x+3<=xmax; x+=4)
+        {
+          const __m128 dx = _mm_add_ps(_mm_set1_ps((float)(x-xmin)), ramp);
+          const __m128 c0 = _mm_add_ps(_mm_set1_ps(e0_row), _mm_mul_ps(dx, _mm_set1_ps(e0_dx)));
+          const __m128 c1 = _mm_add_ps(_mm_set1_ps(e1_row), _mm_mul_ps(dx, _mm_set1_ps(e1_dx)));
+          const __m128 c2 = _mm_add_ps(_mm_set1_ps(e2_row), _mm_mul_ps(dx, _mm_set1_ps(e2_dx)));
+          const __m128 zz = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(dx, _mm_set1_ps(z_dx)));
+          const __m128 d  = _mm_loadu_ps(row+x);
+          __m128 mask = _mm_and_ps(_mm_cmpge_ps(c0, zero), _mm_cmpge_ps(c1, zero));
+          mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(c2, zero), _mm_cmplt_ps(zz, d)));
+          _mm_storeu_ps(row+x, _mm_or_ps(_mm_and_ps(mask, zz), _mm_andnot_ps(mask, d)));
+        }
+#endif
+        for(; x<=xmax; ++x)
+        {
+          const float dx = (float)(x-xmin);
+          const float zz = z + dx*z_dx;
+          const bool inside = e0_row + dx*e0_dx >= 0 && e1_row + dx*e1_dx >= 0 && e2_row + dx*e2_dx >= 0 && zz < row[x];
+          row[x] = inside ? zz : row[x];
+        }
+      }
+    }
+
+  public:
+    const std::vector<SoftwareOcclusionCuller::ScreenTriangle>* mTriangles;
+    float* mDepth;
+    float* mTileMaxDepth;
+    int mWidth;
+    int mTileSize;
+  };
+  //-----------------------------------------------------------------------------
+  class CullTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+      {
+        const Actor* act = mActors->at(i);
+        mOccluded[i] = !std::binary_search(mOccluderSet->begin(), mOccluderSet->end(), act) && mCuller->isOccluded(act->boundingBox());
+      }
+    }
+
+  public:
+    const SoftwareOcclusionCuller* mCuller;
+    const ActorCollection* mActors;
+    const std::vector<const Actor*>* mOccluderSet;
+    char* mOccluded;
+  };
+}
+//-----------------------------------------------------------------------------
+// SoftwareOcclusionCuller
+//-----------------------------------------------------------------------------
+SoftwareOcclusionCuller::SoftwareOcclusionCuller()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mOccluders = new ActorCollection;
+  mOccluderEnableMask = 0xFFFFFFFF;
+  mWidth = 0;
+  mHeight = 0;
+  mStatsTotalObjects = 0;
+  mStatsOccludedObjects = 0;
+  setResolution(256, 128);
+}
+//-----------------------------------------------------------------------------
+void SoftwareOcclusionCuller::setResolution(int width, int height)
+{
+  VL_CHECK(width > 0 && height > 0)
+  mWidth  = (std::max(width,  1) + TileSize - 1) / TileSize * TileSize;
+  mHeight = (std::max(height, 1) + TileSize - 1) / TileSize * TileSize;
+  mDepth.assign(mWidth * mHeight, 1.0f);
+  mTileMaxDepth.assign((mWidth / TileSize) * (mHeight / TileSize), 1.0f);
+}
+//-----------------------------------------------------------------------------
+void SoftwareOcclusionCuller::rasterizeOccluders(const Camera* camera)
+{
+  mViewProjMatrix = (fmat4)(camera->projectionMatrix() * camera->viewMatrix());
+  mTriangles.clear();
+
+  // transform, clip and project the occluders' triangles
+  for(int i=0; i<occluders()->size(); ++i)
+  {
+    const Actor* act = occluders()->at(i);
+    if ((act->enableMask() & occluderEnableMask()) == 0)
+      continue;
+    const Geometry* geom = cast_const<Geometry>(act->lod(0));
+    if (!geom)
+      continue;
+    const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(VA_Position) ? geom->vertexAttribArray(VA_Position)->data() : NULL;
+    if (!posarr)
+      continue;
+
+    fmat4 matrix = act->transform() ? mViewProjMatrix * (fmat4)act->transform()->worldMatrix() : mViewProjMatrix;
+    for(int j=0; j<geom->drawCalls()->size(); ++j)
+    {
+      const DrawCall* dc = geom->drawCalls()->at(j);
+      if (!dc->isEnabled())
+        continue;
+      for(TriangleIterator trit = dc->triangleIterator(); trit.hasNext(); trit.next())
+      {
+        fvec4 a = matrix * fvec4((fvec3)posarr->getAsVec3(trit.a()), 1);
+        fvec4 b = matrix * fvec4((fvec3)posarr->getAsVec3(trit.b()), 1);
+        fvec4 c = matrix * fvec4((fvec3)posarr->getAsVec3(trit.c()), 1);
+        addTriangle(a, b, c);
+      }
+    }
+  }
+
+  // rasterize bands of TileSize rows in parallel
+  RasterizeBandTask task;
+  task.mTriangles    = &mTriangles;
+  task.mDepth        = &mDepth[0];
+  task.mTileMaxDepth = &mTileMaxDepth[0];
+  task.mWidth        = mWidth;
+  task.mTileSize     = TileSize;
+  parallelFor(0, mHeight / TileSize, &task);
+}
+//-----------------------------------------------------------------------------
+void SoftwareOcclusionCuller::addTriangle(const fvec4& a, const fvec4& b, const fvec4& c)
+{
+  // clip against the near plane, z + w >= 0
+  const fvec4 in[] = { a, b, c };
+  float d[3];
+  int inside = 0;
+  for(int i=0; i<3; ++i)
+  {
+    d[i] = in[i].z() + in[i].w();
+    inside += d[i] >= 0 ? 1 : 0;
+  }
+
+  if (inside == 3)
+  {
+    addClippedTriangle(in);
+    return;
+  }
+  if (inside == 0)
+    return;
+
+  fvec4 out[4];
+  int count = 0;
+  for(int i=0; i<3; ++i)
+  {
+    int j = (i+1) % 3;
+    if (d[i] >= 0)
+      out[count++] = in[i];
+    if ((d[i] >= 0) != (d[j] >= 0))
+    {
+      float t = d[i] / (d[i] - d[j]);
+      out[count++] = in[i] + (in[j] - in[i]) * t;
+    }
+  }
+  addClippedTriangle(out);
+  if (count == 4)
+  {
+    const fvec4 tri[] = { out[0], out[2], out[3] };
+    addClippedTriangle(tri);
+  }
+}
+//-----------------------------------------------------------------------------
+void SoftwareOcclusionCuller::addClippedTriangle(const fvec4* v)
+{
+  ScreenTriangle tri;
+  float min_x = (float)mWidth, max_x = 0, min_y = (float)mHeight, max_y = 0;
+  for(int i=0; i<3; ++i)
+  {
+    // the near plane clipping guarantees w > 0 for perspective projections, w == 1 for orthographic ones
+    if (v[i].w() <= 0)
+      return;
+    float inv_w = 1.0f / v[i].w();
+    tri.mX[i] = (v[i].x() * inv_w * 0.5f + 0.5f) * mWidth;
+    tri.mY[i] = (v[i].y() * inv_w * 0.5f + 0.5f) * mHeight;
+    tri.mZ[i] =  v[i].z() * inv_w * 0.5f + 0.5f;
+    min_x = std::min(min_x, tri.mX[i]);
+    max_x = std::max(max_x, tri.mX[i]);
+    min_y = std::min(min_y, tri.mY[i]);
+    max_y = std::max(max_y, tri.mY[i]);
+  }
+
+  // discard triangles outside the screen
+  if (max_x < 0 || min_x > mWidth || max_y < 0 || min_y > mHeight)
+    return;
+
+  tri.mMinY = std::max(0, (int)floor(min_y));
+  tri.mMaxY = std::min(mHeight-1, (int)ceil(max_y));
+  mTriangles.push_back(tri);
+}
+//-----------------------------------------------------------------------------
+bool SoftwareOcclusionCuller::isOccluded(const AABB& aabb) const
+{
+  if (aabb.isNull())
+    return false;
+
+  const fvec3 minc = (fvec3)aabb.minCorner();
+  const fvec3 maxc = (fvec3)aabb.maxCorner();
+  float min_x = (float)mWidth, max_x = 0, min_y = (float)mHeight, max_y = 0, min_z = 1;
+  for(int i=0; i<8; ++i)
+  {
+    fvec4 corner( i & 1 ? maxc.x() : minc.x(), i & 2 ? maxc.y() : minc.y(), i & 4 ? maxc.z() : minc.z(), 1 );
+    fvec4 v = mViewProjMatrix * corner;
+    // boxes crossing the near plane are always visible
+    if (v.z() + v.w() < 0 || v.w() <= 0)
+      return false;
+    float inv_w = 1.0f / v.w();
+    float x = (v.x() * inv_w * 0.5f + 0.5f) * mWidth;
+    float y = (v.y() * inv_w * 0.5f + 0.5f) * mHeight;
+    float z =  v.z() * inv_w * 0.5f + 0.5f;
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y);
+    max_y = std::max(max_y, y);
+    min_z = std::min(min_z, z);
+  }
+
+  // boxes outside the screen are left to the frustum culling
+  int x0 = std::max(0, (int)floor(min_x));
+  int x1 = std::min(mWidth-1, (int)floor(max_x));
+  int y0 = std::max(0, (int)floor(min_y));
+  int y1 = std::min(mHeight-1, (int)floor(max_y));
+  if (x0 > x1 || y0 > y1)
+    return false;
+
+  // visit the tiles overlapping the rectangle, the pixels are tested only if the tile is not entirely in front of the box
+  const int tiles_x = mWidth / TileSize;
+  for(int ty=y0/TileSize; ty<=y1/TileSize; ++ty)
+  {
+    for(int tx=x0/TileSize; tx<=x1/TileSize; ++tx)
+    {
+      if (mTileMaxDepth[tx + ty*tiles_x] < min_z)
+        continue;
+      int px0 = std::max(x0, tx*TileSize);
+      int px1 = std::min(x1, tx*TileSize + TileSize - 1);
+      int py0 = std::max(y0, ty*TileSize);
+      int py1 = std::min(y1, ty*TileSize + TileSize - 1);
+      for(int y=py0; y<=py1; ++y)
+      {
+        const float* row = &mDepth[y * mWidth];
+        int x = px0;
+#if VL_SSE2
+        const __m128 minz4 = _mm_set1_ps(min_z);
+        for(; x+3<=px1; x+=4)
+          if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row+x), minz4)))
+            return false;
+#endif
+        for(; x<=px1; ++x)
+          if (row[x] >= min_z)
+            return false;
+      }
+    }
+  }
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+int SoftwareOcclusionCuller::cull(ActorCollection& actors)
+{
+  mOccluderSet.resize(occluders()->size());
+  for(int i=0; i<occluders()->size(); ++i)
+    mOccluderSet[i] = occluders()->at(i);
+  std::sort(mOccluderSet.begin(), mOccluderSet.end());
+
+  mOccluded.resize(actors.size());
+  if (actors.empty())
+  {
+    mStatsTotalObjects = mStatsOccludedObjects = 0;
+    return 0;
+  }
+
+  CullTask task;
+  task.mCuller      = this;
+  task.mActors      = &actors;
+  task.mOccluderSet = &mOccluderSet;
+  task.mOccluded    = &mOccluded[0];
+  parallelFor(0, actors.size(), &task, 64);
+
+  // compact the visible actors preserving their order
+  int count = 0;
+  for(int i=0; i<actors.size(); ++i)
+  {
+    if (!mOccluded[i])
+    {
+      if (count != i)
+        actors.set(count, actors.at(i));
+      ++count;
+    }
+  }
+
+  mStatsTotalObjects    = actors.size();
+  mStatsOccludedObjects = actors.size() - count;
+  actors.resize(count);
+  return mStatsOccludedObjects;
+}
+//-----------------------------------------------------------------------------
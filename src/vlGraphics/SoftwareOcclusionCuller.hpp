@@ -0,0 +1,161 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef SoftwareOcclusionCuller_INCLUDE_ONCE
+#define SoftwareOcclusionCuller_INCLUDE_ONCE
+
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vector>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // SoftwareOcclusionCuller
+  //------------------------------------------------------------------------------
+  /** Performs occlusion culling on the CPU by rasterizing a set of occluder Actor[s] into a low resolution depth buffer.
+    *
+    * Unlike OcclusionCullRenderer, which relies on OpenGL occlusion queries whose results are available only at the
+    * next frame, the SoftwareOcclusionCuller computes its results within the same frame and does not need any OpenGL
+    * context, so it can also be used for headless visibility computations.
+    *
+    * At every frame rasterizeOccluders() renders the triangles of the occluders() into a depth buffer of width() x height()
+    * pixels, split in horizontal bands of tileSize() rows processed in parallel by defThreadPool(). For each tile of
+    * tileSize() x tileSize() pixels the farthest depth is also stored, so that isOccluded() can reject or accept large
+    * areas of the screen without visiting every pixel. isOccluded() tests the screen space rectangle of an AABB at the
+    * depth of its nearest corner, which makes the test conservative: an object is considered occluded only if its whole
+    * rectangle lies behind the occluders. The occluders' coverage is conservative as well: a pixel is written only if it
+    * lies entirely inside an occluder triangle and it receives the farthest depth of the triangle over the pixel.
+    * The rasterization and the depth tests use SSE2 when VL_SSE2 is enabled.
+    *
+    * Good occluders are few, large and simple objects such as walls, floors and big machinery, possibly simplified
+    * versions of the actual geometry which must be contained in the rendered one. Only the lod(0) Geometry of an occluder
+    * is considered and its vertex array or VA_Position vertex attribute array is used.
+    *
+    * Install it using Rendering::setOcclusionCuller() to remove the occluded Actor[s] before the render queue is filled.
+    * \sa OcclusionCullRenderer, Rendering, \ref pagGuideOcclusionCulling */
+  class VLGRAPHICS_EXPORT SoftwareOcclusionCuller: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::SoftwareOcclusionCuller, Object)
+
+  public:
+    /** Constructor. */
+    SoftwareOcclusionCuller();
+
+    /** The resolution of the depth buffer, which is rounded up to a multiple of tileSize(). Default is 256 x 128.
+      * The aspect ratio should roughly match the one of the viewport. */
+    void setResolution(int width, int height);
+
+    /** The width of the depth buffer in pixels. */
+    int width() const { return mWidth; }
+
+    /** The height of the depth buffer in pixels. */
+    int height() const { return mHeight; }
+
+    /** The size in pixels of the square tiles of the depth hierarchy and the height of the bands rasterized in parallel. */
+    static int tileSize() { return TileSize; }
+
+    /** The Actor[s] rasterized into the depth buffer. Occluders are never culled by cull(). */
+    ActorCollection* occluders() { return mOccluders.get(); }
+
+    /** The Actor[s] rasterized into the depth buffer. Occluders are never culled by cull(). */
+    const ActorCollection* occluders() const { return mOccluders.get(); }
+
+    /** Only the occluders whose enable mask matches \p mask are rasterized (default is 0xFFFFFFFF). */
+    void setOccluderEnableMask(unsigned int mask) { mOccluderEnableMask = mask; }
+
+    /** Only the occluders whose enable mask matches \p mask are rasterized (default is 0xFFFFFFFF). */
+    unsigned int occluderEnableMask() const { return mOccluderEnableMask; }
+
+    /** Clears the depth buffer and rasterizes the occluders() as seen by the given camera.
+      * The camera's view and projection matrices must be up to date. */
+    void rasterizeOccluders(const Camera* camera);
+
+    /** Returns true if the given world space AABB is completely hidden by the occluders rasterized by the last call to rasterizeOccluders().
+      * Null boxes and boxes crossing the near clipping plane are never considered occluded. */
+    bool isOccluded(const AABB& aabb) const;
+
+    /** Removes from \p actors the ones hidden by the occluders and returns their number.
+      * The Actor[s] are tested in parallel using their current boundingBox(), see Actor::computeBounds(). */
+    int cull(ActorCollection& actors);
+
+    /** The depth buffer computed by rasterizeOccluders(), width() x height() values in the range [0,1] where 1 is the far plane. */
+    const std::vector<float>& depthBuffer() const { return mDepth; }
+
+    /** The depth stored at the given pixel. */
+    float depth(int x, int y) const { return mDepth[x + y*mWidth]; }
+
+    /** The farthest depth stored in each tile, (width()/tileSize()) x (height()/tileSize()) values. */
+    const std::vector<float>& tileDepthBuffer() const { return mTileMaxDepth; }
+
+    /** The number of triangles rasterized by the last rasterizeOccluders() call, after near plane clipping. */
+    int statsOccluderTriangles() const { return (int)mTriangles.size(); }
+
+    /** The number of objects tested by the last cull() call. */
+    int statsTotalObjects() const { return mStatsTotalObjects; }
+
+    /** The number of objects removed by the last cull() call. */
+    int statsOccludedObjects() const { return mStatsOccludedObjects; }
+
+  public:
+    //! A screen space triangle ready to be rasterized.
+    struct ScreenTriangle
+    {
+      float mX[3];
+      float mY[3];
+      float mZ[3];
+      int mMinY;
+      int mMaxY;
+    };
+
+  protected:
+    void addTriangle(const fvec4& a, const fvec4& b, const fvec4& c);
+    void addClippedTriangle(const fvec4* v);
+
+  protected:
+    enum { TileSize = 8 };
+    ref<ActorCollection> mOccluders;
+    fmat4 mViewProjMatrix;
+    std::vector<float> mDepth;
+    std::vector<float> mTileMaxDepth;
+    std::vector<ScreenTriangle> mTriangles;
+    std::vector<const Actor*> mOccluderSet;
+    std::vector<char> mOccluded;
+    unsigned int mOccluderEnableMask;
+    int mWidth;
+    int mHeight;
+    int mStatsTotalObjects;
+    int mStatsOccludedObjects;
+  };
+  //------------------------------------------------------------------------------
+}
+
+#endif
@@ -0,0 +1,808 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/StreamingTerrain.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlGraphics/Effect.hpp>
+#include <vlCore/DiskFile.hpp>
+#include <vlCore/Time.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  bool isValidTileSize(int tile_size)
+  {
+    return tile_size >= 4 && tile_size <= 128 && (tile_size & (tile_size-1)) == 0;
+  }
+
+  // Index in the grid of the k-th vertex of the border of a tile, walking the border counter-clockwise as seen from above.
+  int borderVertex(int n, int k)
+  {
+    int side = k / n;
+    int t = k % n;
+    switch(side)
+    {
+    case 0:  return 0 + t * (n+1);           // x = 0, z increasing
+    case 1:  return t + n * (n+1);           // z = n, x increasing
+    case 2:  return n + (n-t) * (n+1);       // x = n, z decreasing
+    default: return (n-t);                   // z = 0, x decreasing
+    }
+  }
+
+  String tileFileName(const String& directory, const String& extension, int level, int x, int z)
+  {
+    return Say("%s/%n_%n_%n.%s") << directory << level << x << z << extension;
+  }
+}
+//-----------------------------------------------------------------------------
+// ImageTerrainTileSource
+//-----------------------------------------------------------------------------
+ImageTerrainTileSource::ImageTerrainTileSource(const Image* heightmap, int tile_size): mWidth(0), mHeight(0), mTileSize(tile_size), mLevelCount(1)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  if (!isValidTileSize(tile_size))
+  {
+    Log::error( Say("ImageTerrainTileSource: invalid tile size %n, must be a power of 2 between 4 and 128.\n") << tile_size );
+    mTileSize = 64;
+  }
+
+  if (!heightmap || heightmap->width() < 2 || heightmap->height() < 2)
+  {
+    Log::error("ImageTerrainTileSource: invalid heightmap.\n");
+    return;
+  }
+
+  mWidth  = heightmap->width();
+  mHeight = heightmap->height();
+  mSamples.resize( mWidth * mHeight );
+  for(int y=0; y<mHeight; ++y)
+    for(int x=0; x<mWidth; ++x)
+      mSamples[x + y*mWidth] = heightmap->sample(x, y).r();
+
+  int size = mWidth > mHeight ? mWidth : mHeight;
+  while( (mTileSize << (mLevelCount-1)) + 1 < size )
+    ++mLevelCount;
+}
+//-----------------------------------------------------------------------------
+bool ImageTerrainTileSource::readTile(int level, int x, int z, float* heights)
+{
+  if ( mSamples.empty() || level < 0 || level >= mLevelCount || x < 0 || z < 0 || x >= (1<<level) || z >= (1<<level) )
+    return false;
+
+  int n = mTileSize;
+  int step = 1 << (mLevelCount-1-level);
+  double grid = (double)(n << (mLevelCount-1));
+  double sx = (mWidth-1)  / grid;
+  double sz = (mHeight-1) / grid;
+  for(int j=0; j<=n; ++j)
+  {
+    double fz = ((z*n + j) * step) * sz;
+    int z0 = (int)fz;
+    int z1 = z0+1 < mHeight ? z0+1 : z0;
+    float tz = (float)(fz - z0);
+    const float* row0 = &mSamples[z0*mWidth];
+    const float* row1 = &mSamples[z1*mWidth];
+    for(int i=0; i<=n; ++i)
+    {
+      double fx = ((x*n + i) * step) * sx;
+      int x0 = (int)fx;
+      int x1 = x0+1 < mWidth ? x0+1 : x0;
+      float tx = (float)(fx - x0);
+      float a = row0[x0] + (row0[x1] - row0[x0]) * tx;
+      float b = row1[x0] + (row1[x1] - row1[x0]) * tx;
+      heights[i + j*(n+1)] = a + (b - a) * tz;
+    }
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+// DirectoryTerrainTileSource
+//-----------------------------------------------------------------------------
+DirectoryTerrainTileSource::DirectoryTerrainTileSource(const String& directory, const String& extension, int tile_size, int level_count):
+  mDirectory(directory), mExtension(extension), mTileSize(tile_size), mLevelCount(level_count)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  if (!isValidTileSize(tile_size))
+  {
+    Log::error( Say("DirectoryTerrainTileSource: invalid tile size %n, must be a power of 2 between 4 and 128.\n") << tile_size );
+    mTileSize = 64;
+  }
+  if (mLevelCount < 1)
+    mLevelCount = 1;
+}
+//-----------------------------------------------------------------------------
+String DirectoryTerrainTileSource::tilePath(int level, int x, int z) const
+{
+  return tileFileName(mDirectory, mExtension, level, x, z);
+}
+//-----------------------------------------------------------------------------
+bool DirectoryTerrainTileSource::readTile(int level, int x, int z, float* heights)
+{
+  ref<DiskFile> file = new DiskFile( tilePath(level, x, z) );
+  if (!file->exists())
+  {
+    Log::error( Say("DirectoryTerrainTileSource: tile '%s' not found.\n") << file->path() );
+    return false;
+  }
+
+  ref<Image> img = loadImage(file.get());
+  if (!img)
+    return false;
+
+  int n = mTileSize;
+  if (img->width() != n+1 || img->height() != n+1)
+  {
+    Log::error( Say("DirectoryTerrainTileSource: tile '%s' must be %nx%n pixels.\n") << file->path() << n+1 << n+1 );
+    return false;
+  }
+
+  for(int j=0; j<=n; ++j)
+    for(int i=0; i<=n; ++i)
+      heights[i + j*(n+1)] = img->sample(i, j).r();
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool DirectoryTerrainTileSource::writeTiles(TerrainTileSource* source, const String& directory, const String& extension)
+{
+  int n = source->tileSize();
+  std::vector<float> heights( (n+1) * (n+1) );
+  ref<Image> img = new Image;
+  img->allocate2D(n+1, n+1, 1, IF_LUMINANCE, IT_UNSIGNED_SHORT);
+  for(int level=0; level<source->levelCount(); ++level)
+  {
+    for(int z=0; z<(1<<level); ++z)
+    {
+      for(int x=0; x<(1<<level); ++x)
+      {
+        if (!source->readTile(level, x, z, &heights[0]))
+        {
+          Log::error( Say("DirectoryTerrainTileSource::writeTiles(): could not read tile %n %n %n.\n") << level << x << z );
+          return false;
+        }
+        for(int j=0; j<=n; ++j)
+        {
+          unsigned short* row = (unsigned short*)(img->pixels() + j*img->pitch());
+          for(int i=0; i<=n; ++i)
+          {
+            float h = heights[i + j*(n+1)];
+            h = h < 0 ? 0 : h > 1 ? 1 : h;
+            row[i] = (unsigned short)(h * 65535.0f + 0.5f);
+          }
+        }
+        if (!saveImage(img.get(), tileFileName(directory, extension, level, x, z)))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+// StreamingTerrain
+//-----------------------------------------------------------------------------
+StreamingTerrain::Tile::Tile(Tile* parent, int level, int x, int z):
+  mParent(parent), mLevel(level), mX(x), mZ(z), mState(TS_Unloaded), mMinHeight(0), mMaxHeight(0), mMorphError(0), mSkirtDepth(0),
+  mError(0), mErrorExact(false), mMeasured(false), mMorph(0), mAppliedMorph(0), mLastUsedFrame(-1), mLastRenderedFrame(-1), mRequestFrame(-1), mBytes(0)
+{
+  mChildren[0] = mChildren[1] = mChildren[2] = mChildren[3] = NULL;
+}
+//-----------------------------------------------------------------------------
+StreamingTerrain::Tile::~Tile()
+{
+  for(int i=0; i<4; ++i)
+    delete mChildren[i];
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::LoadJob::run(int begin, int end, int)
+{
+  for(int i=begin; i<end; ++i)
+    mTerrain->loadTile(mTiles[i]);
+}
+//-----------------------------------------------------------------------------
+StreamingTerrain::StreamingTerrain():
+  mRoot(NULL), mLoaderThreadCount(2), mLoadId(0), mWidth(0), mHeight(0), mDepth(0), mPixelError(2), mMemoryBudget(256*1024*1024), mMemoryUsed(0), mTileBytes(0),
+  mMaxConcurrentLoads(16), mMorphTime(0.5f), mLastTime(-1), mFrameTime(0), mScreenFactor(0), mOrthographic(false), mFrame(0), mRenderedCount(0)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mLoadJob.mTerrain = this;
+  mEffect = new Effect;
+  mEffect->shader()->enable(EN_DEPTH_TEST);
+  mEffect->shader()->enable(EN_CULL_FACE);
+  mEffect->shader()->enable(EN_LIGHTING);
+}
+//-----------------------------------------------------------------------------
+StreamingTerrain::~StreamingTerrain()
+{
+  clear();
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::clear()
+{
+  if (mLoadId)
+  {
+    mLoaderPool->waitAsync(mLoadId);
+    mLoadId = 0;
+  }
+  mLoadJob.mTiles.clear();
+  mRequests.clear();
+  mResidentTiles.clear();
+  delete mRoot;
+  mRoot = NULL;
+  mMemoryUsed = 0;
+  mRenderedCount = 0;
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::init()
+{
+  clear();
+
+  if (mWidth <= 0 || mHeight <= 0 || mDepth <= 0 || !mSource)
+  {
+    Log::error(
+        Say("StreamingTerrain initialization failed: invalid parameters.\n"
+             "width = %n\n"
+             "height = %n\n"
+             "depth = %n\n"
+             "source = %s\n")
+        << mWidth << mHeight << mDepth << (mSource ? "valid" : "NULL")
+      );
+    return;
+  }
+
+  int n = mSource->tileSize();
+  if (!isValidTileSize(n) || mSource->levelCount() < 1)
+  {
+    Log::error( Say("StreamingTerrain initialization failed: invalid tile size %n or level count %n.\n") << n << mSource->levelCount() );
+    return;
+  }
+
+  // the index buffer shared by all the tiles: the grid followed by the skirts
+  int grid = (n+1) * (n+1);
+  mDrawCall = new DrawElementsUShort(PT_TRIANGLES);
+  mDrawCall->indexBuffer()->resize( n*n*6 + 4*n*6 );
+  int idx = 0;
+  for(int j=0; j<n; ++j)
+  {
+    for(int i=0; i<n; ++i)
+    {
+      int a = i+0 + (n+1)*(j+1);
+      int b = i+1 + (n+1)*(j+1);
+      int c = i+1 + (n+1)*(j+0);
+      int d = i+0 + (n+1)*(j+0);
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)a;
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)b;
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)c;
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)a;
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)c;
+      mDrawCall->indexBuffer()->at(idx++) = (GLushort)d;
+    }
+  }
+  for(int k=0; k<4*n; ++k)
+  {
+    int a  = borderVertex(n, k);
+    int b  = borderVertex(n, (k+1) % (4*n));
+    int sa = grid + k;
+    int sb = grid + (k+1) % (4*n);
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)a;
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)sa;
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)sb;
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)a;
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)sb;
+    mDrawCall->indexBuffer()->at(idx++) = (GLushort)b;
+  }
+
+  // vertices, normals and texture coordinates plus the two height arrays
+  mTileBytes = (long long)(grid + 4*n) * (12 + 12 + 8) + grid * 8;
+
+  mRoot = new Tile(NULL, 0, 0, 0);
+  loadTile(mRoot);
+  finishTile(mRoot);
+  mLastTime = -1;
+  setBoundsDirty(true);
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::setEffect(Effect* effect)
+{
+  mEffect = effect;
+  for(size_t i=0; i<mResidentTiles.size(); ++i)
+    mResidentTiles[i]->mActor->setEffect(effect);
+}
+//-----------------------------------------------------------------------------
+dvec3 StreamingTerrain::tileSize(int level) const
+{
+  return dvec3(mWidth / (1<<level), mHeight, mDepth / (1<<level));
+}
+//-----------------------------------------------------------------------------
+dvec3 StreamingTerrain::tileCenter(const Tile* tile) const
+{
+  dvec3 size = tileSize(tile->mLevel);
+  return dvec3(-mWidth/2.0 + (tile->mX + 0.5) * size.x(), 0, -mDepth/2.0 + (tile->mZ + 0.5) * size.z()) + (dvec3)mOrigin;
+}
+//-----------------------------------------------------------------------------
+AABB StreamingTerrain::tileBounds(const Tile* tile) const
+{
+  // tiles that are not loaded use the height range of their nearest loaded ancestor
+  const Tile* ranged = tile;
+  while(ranged->mParent && ranged->mState != TS_Resident)
+    ranged = ranged->mParent;
+  dvec3 c = tileCenter(tile);
+  dvec3 s = tileSize(tile->mLevel) * 0.5;
+  AABB aabb;
+  aabb.setMinCorner( (real)(c.x() - s.x()), (real)(c.y() + ranged->mMinHeight), (real)(c.z() - s.z()) );
+  aabb.setMaxCorner( (real)(c.x() + s.x()), (real)(c.y() + ranged->mMaxHeight), (real)(c.z() + s.z()) );
+  return aabb;
+}
+//-----------------------------------------------------------------------------
+real StreamingTerrain::tileDistance(const Tile* tile, const vec3& eye) const
+{
+  AABB aabb = tileBounds(tile);
+  vec3 p = eye;
+  for(int i=0; i<3; ++i)
+  {
+    if (p[i] < aabb.minCorner()[i]) p[i] = aabb.minCorner()[i];
+    if (p[i] > aabb.maxCorner()[i]) p[i] = aabb.maxCorner()[i];
+  }
+  return (p - eye).length();
+}
+//-----------------------------------------------------------------------------
+bool StreamingTerrain::hasLiveChildren(const Tile* tile) const
+{
+  for(int i=0; i<4; ++i)
+    if (tile->mChildren[i] && (tile->mChildren[i]->mState == TS_Resident || tile->mChildren[i]->mState == TS_Loading))
+      return true;
+  return false;
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::loadTile(Tile* tile)
+{
+  // called by the worker threads: only the loader's fields of the tile are written.
+  int n = mSource->tileSize();
+  int grid = (n+1) * (n+1);
+  std::vector<float> samples(grid);
+  if (!mSource->readTile(tile->mLevel, tile->mX, tile->mZ, &samples[0]))
+    return;
+
+  std::vector<float>& h = tile->mHeights;
+  std::vector<float>& m = tile->mMorphHeights;
+  h.resize(grid);
+  m.resize(grid);
+  float min_h = (float)mHeight;
+  float max_h = 0;
+  for(int i=0; i<grid; ++i)
+  {
+    h[i] = samples[i] * (float)mHeight;
+    min_h = h[i] < min_h ? h[i] : min_h;
+    max_h = h[i] > max_h ? h[i] : max_h;
+  }
+
+  // the shape of the parent: the odd samples are interpolated along the edges and diagonals of the parent's triangles
+  float morph_error = 0;
+  for(int j=0; j<=n; ++j)
+  {
+    for(int i=0; i<=n; ++i)
+    {
+      int v = i + j*(n+1);
+      if ((i&1) && (j&1))
+        m[v] = (h[v - 1 + (n+1)] + h[v + 1 - (n+1)]) * 0.5f;
+      else
+      if (i&1)
+        m[v] = (h[v - 1] + h[v + 1]) * 0.5f;
+      else
+      if (j&1)
+        m[v] = (h[v - (n+1)] + h[v + (n+1)]) * 0.5f;
+      else
+        m[v] = h[v];
+      float d = fabs(h[v] - m[v]);
+      morph_error = d > morph_error ? d : morph_error;
+    }
+  }
+  // the root has no parent to morph from
+  if (tile->mLevel == 0)
+    m = h;
+
+  dvec3 size = tileSize(tile->mLevel);
+  float sx = (float)(size.x() / n);
+  float sz = (float)(size.z() / n);
+  float skirt = morph_error * 4.0f;
+  skirt = skirt > sx ? skirt : sx;
+  skirt = skirt > sz ? skirt : sz;
+
+  ref<ArrayFloat3> verts   = new ArrayFloat3;
+  ref<ArrayFloat3> normals = new ArrayFloat3;
+  ref<ArrayFloat2> uv      = new ArrayFloat2;
+  verts->resize(grid + 4*n);
+  normals->resize(grid + 4*n);
+  uv->resize(grid + 4*n);
+  float du = 1.0f / (float)(n << tile->mLevel);
+  for(int j=0; j<=n; ++j)
+  {
+    for(int i=0; i<=n; ++i)
+    {
+      int v = i + j*(n+1);
+      verts->at(v) = fvec3( (i - n*0.5f) * sx, m[v], (j - n*0.5f) * sz );
+      float dx = (i < n ? h[v+1] : h[v]) - (i > 0 ? h[v-1] : h[v]);
+      float dz = (j < n ? h[v+(n+1)] : h[v]) - (j > 0 ? h[v-(n+1)] : h[v]);
+      dx /= sx * ( (i > 0 && i < n) ? 2 : 1 );
+      dz /= sz * ( (j > 0 && j < n) ? 2 : 1 );
+      normals->at(v) = fvec3(-dx, 1, -dz).normalize();
+      uv->at(v) = fvec2( (tile->mX*n + i) * du, (tile->mZ*n + j) * du );
+    }
+  }
+  for(int k=0; k<4*n; ++k)
+  {
+    int v = borderVertex(n, k);
+    verts->at(grid + k)   = verts->at(v) - fvec3(0, skirt, 0);
+    normals->at(grid + k) = normals->at(v);
+    uv->at(grid + k)      = uv->at(v);
+  }
+
+  tile->mVertices   = verts;
+  tile->mNormals    = normals;
+  tile->mTexCoords  = uv;
+  tile->mMinHeight  = min_h - skirt;
+  tile->mMaxHeight  = max_h;
+  tile->mMorphError = morph_error;
+  tile->mSkirtDepth = skirt;
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::finishTile(Tile* tile)
+{
+  if (!tile->mVertices)
+  {
+    Log::error( Say("StreamingTerrain: could not load tile %n %n %n.\n") << tile->mLevel << tile->mX << tile->mZ );
+    tile->mState = TS_Failed;
+    return;
+  }
+
+  dvec3 size = tileSize(tile->mLevel);
+  AABB aabb;
+  aabb.setMinCorner( (real)(-size.x()/2), tile->mMinHeight, (real)(-size.z()/2) );
+  aabb.setMaxCorner( (real)(+size.x()/2), tile->mMaxHeight, (real)(+size.z()/2) );
+
+  tile->mGeometry = new Geometry;
+  tile->mGeometry->setVertexArray(tile->mVertices.get());
+  tile->mGeometry->setNormalArray(tile->mNormals.get());
+  tile->mGeometry->setTexCoordArray(0, tile->mTexCoords.get());
+  tile->mGeometry->drawCalls()->push_back(mDrawCall.get());
+  tile->mGeometry->setBoundingBox(aabb);
+  tile->mGeometry->setBoundingSphere(aabb);
+  tile->mGeometry->setBoundsDirty(false);
+
+  ref<Transform> transform = new Transform;
+  transform->setLocalAndWorldMatrix( mat4::getTranslation( (vec3)tileCenter(tile) ) );
+  tile->mActor = new Actor(tile->mGeometry.get(), mEffect.get(), transform.get());
+  tile->mActor->computeBounds();
+
+  tile->mBytes = (long long)(tile->mVertices->bytesUsed() + tile->mNormals->bytesUsed() + tile->mTexCoords->bytesUsed()) +
+                 (long long)(tile->mHeights.size() + tile->mMorphHeights.size()) * sizeof(float);
+  mMemoryUsed += tile->mBytes;
+  mResidentTiles.push_back(tile);
+
+  tile->mState = TS_Resident;
+  tile->mMeasured = true;
+  tile->mMorph = tile->mAppliedMorph = tile->mLevel == 0 ? 1.0f : 0.0f;
+  tile->mLastUsedFrame = mFrame;
+  updateError(tile);
+  if (tile->mParent)
+    updateError(tile->mParent);
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::updateError(Tile* tile)
+{
+  if (tile->mErrorExact)
+    return;
+
+  if (tile->mLevel == mSource->levelCount()-1)
+  {
+    tile->mError = 0;
+    tile->mErrorExact = true;
+    return;
+  }
+
+  // the exact error is the largest difference between the children and the shape they morph from, i.e. this tile
+  float error = 0;
+  bool exact = true;
+  for(int i=0; i<4; ++i)
+  {
+    if (tile->mChildren[i] && tile->mChildren[i]->mMeasured)
+      error = tile->mChildren[i]->mMorphError > error ? tile->mChildren[i]->mMorphError : error;
+    else
+      exact = false;
+  }
+
+  if (!exact)
+  {
+    // the detail lost at each level roughly halves, the parent's error prevents flat looking tiles from hiding their detail
+    float estimate = tile->mMorphError * 0.5f;
+    if (tile->mParent)
+      estimate = tile->mParent->mError * 0.25f > estimate ? tile->mParent->mError * 0.25f : estimate;
+    error = estimate > error ? estimate : error;
+  }
+
+  tile->mError = error;
+  tile->mErrorExact = exact;
+
+  // the estimates of the children depend on this tile's error
+  if (exact)
+    for(int i=0; i<4; ++i)
+      if (tile->mChildren[i] && tile->mChildren[i]->mMeasured)
+        updateError(tile->mChildren[i]);
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::applyMorph(Tile* tile, float morph)
+{
+  int n = mSource->tileSize();
+  int grid = (n+1) * (n+1);
+  fvec3* verts = tile->mVertices->begin();
+  const float* h = &tile->mHeights[0];
+  const float* m = &tile->mMorphHeights[0];
+  for(int v=0; v<grid; ++v)
+    verts[v].y() = m[v] + (h[v] - m[v]) * morph;
+  for(int k=0; k<4*n; ++k)
+    verts[grid + k].y() = verts[borderVertex(n, k)].y() - tile->mSkirtDepth;
+  tile->mVertices->setBufferObjectDirty(true);
+  tile->mGeometry->setBufferObjectDirty(true);
+  tile->mAppliedMorph = morph;
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::requestLoad(Tile* tile, const Camera* camera)
+{
+  if (tile->mState != TS_Unloaded || tile->mRequestFrame == mFrame)
+    return;
+  tile->mRequestFrame = mFrame;
+  mRequests.push_back( LoadRequest(tile, tileDistance(tile, camera->modelingMatrix().getT())) );
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::traverse(Tile* tile, float parent_sse, ActorCollection& list, const Camera* camera)
+{
+  // the tiles reached by the traversal are kept in memory even if culled, so that their parent can still be refined
+  tile->mLastUsedFrame = mFrame;
+
+  AABB aabb = tileBounds(tile);
+  if (cullingEnabled() && camera->frustum().cull(aabb))
+    return;
+
+  float sse = tile->mError * (float)mScreenFactor;
+  if (!mOrthographic)
+  {
+    real distance = tileDistance(tile, camera->modelingMatrix().getT());
+    sse = distance > 0 ? sse / (float)distance : FLT_MAX;
+  }
+
+  if (sse > mPixelError && tile->mLevel+1 < mSource->levelCount())
+  {
+    bool ready = true;
+    bool failed = false;
+    for(int i=0; i<4; ++i)
+    {
+      if (!tile->mChildren[i])
+        tile->mChildren[i] = new Tile(tile, tile->mLevel+1, tile->mX*2 + (i&1), tile->mZ*2 + (i>>1));
+      Tile* child = tile->mChildren[i];
+      child->mLastUsedFrame = mFrame;
+      ready &= child->mState == TS_Resident;
+      failed |= child->mState == TS_Failed;
+    }
+
+    if (ready)
+    {
+      for(int i=0; i<4; ++i)
+        traverse(tile->mChildren[i], sse, list, camera);
+      return;
+    }
+
+    if (!failed)
+      for(int i=0; i<4; ++i)
+        requestLoad(tile->mChildren[i], camera);
+  }
+
+  // geomorphing: the tile looks like its parent when the parent has just been refined and reaches its own shape
+  // when the parent's error is twice the threshold. Tiles that just appeared morph in over morphTime() seconds.
+  float target = 1;
+  if (tile->mParent)
+  {
+    target = (parent_sse - mPixelError) / mPixelError;
+    target = target < 0 ? 0 : target > 1 ? 1 : target;
+  }
+  if (tile->mLastRenderedFrame != mFrame-1)
+    tile->mMorph = tile->mParent ? 0.0f : 1.0f;
+  if (target > tile->mMorph)
+  {
+    float step = mMorphTime > 0 ? (float)(mFrameTime / mMorphTime) : 1.0f;
+    tile->mMorph = tile->mMorph + step < target ? tile->mMorph + step : target;
+  }
+  else
+    tile->mMorph = target;
+  if ( fabs(tile->mMorph - tile->mAppliedMorph) > 1.0f/256.0f || ((tile->mMorph == 0 || tile->mMorph == 1) && tile->mMorph != tile->mAppliedMorph) )
+    applyMorph(tile, tile->mMorph);
+  tile->mLastRenderedFrame = mFrame;
+
+  ++mRenderedCount;
+  if (isEnabled(tile->mActor.get()))
+    list.push_back(tile->mActor.get());
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::integrateLoads()
+{
+  for(size_t i=0; i<mLoadJob.mTiles.size(); ++i)
+    finishTile(mLoadJob.mTiles[i]);
+  mLoadJob.mTiles.clear();
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::finishLoads()
+{
+  if (mLoadId)
+  {
+    mLoaderPool->waitAsync(mLoadId);
+    mLoadId = 0;
+  }
+  integrateLoads();
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::setLoaderThreadCount(int count)
+{
+  finishLoads();
+  mLoaderThreadCount = count < 0 ? 0 : count;
+  mLoaderPool = NULL;
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::startLoads()
+{
+  if (!mLoadJob.mTiles.empty() || mRequests.empty())
+    return;
+
+  // nearest tiles first, without exceeding the memory budget
+  std::sort(mRequests.begin(), mRequests.end());
+  long long available = mMemoryBudget - mMemoryUsed;
+  for(size_t i=0; i<mRequests.size() && (int)mLoadJob.mTiles.size() < mMaxConcurrentLoads && available >= mTileBytes; ++i)
+  {
+    mRequests[i].mTile->mState = TS_Loading;
+    mLoadJob.mTiles.push_back(mRequests[i].mTile);
+    available -= mTileBytes;
+  }
+  if (mLoadJob.mTiles.empty())
+    return;
+
+  int count = (int)mLoadJob.mTiles.size();
+  if (mLoaderThreadCount == 0)
+  {
+    // no loader threads: load the tiles now
+    mLoadJob.run(0, count, 0);
+    integrateLoads();
+    return;
+  }
+
+  // parallelForAsync() runs on the worker threads only, the calling thread does not count
+  if (!mLoaderPool)
+    mLoaderPool = new ThreadPool(mLoaderThreadCount + 1);
+  mLoadId = mLoaderPool->parallelForAsync(0, count, &mLoadJob, mSource->isThreadSafe() ? 1 : count);
+  if (!mLoadId)
+  {
+    // the loader threads are busy: the tiles are requested again by the next frame instead of being loaded by the rendering thread
+    for(int i=0; i<count; ++i)
+      mLoadJob.mTiles[i]->mState = TS_Unloaded;
+    mLoadJob.mTiles.clear();
+  }
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::releaseTile(Tile* tile)
+{
+  mMemoryUsed -= tile->mBytes;
+  tile->mBytes = 0;
+  tile->mActor = NULL;
+  tile->mGeometry = NULL;
+  tile->mVertices = NULL;
+  tile->mNormals = NULL;
+  tile->mTexCoords = NULL;
+  std::vector<float>().swap(tile->mHeights);
+  std::vector<float>().swap(tile->mMorphHeights);
+  tile->mState = TS_Unloaded;
+  mResidentTiles.erase( std::find(mResidentTiles.begin(), mResidentTiles.end(), tile) );
+}
+//-----------------------------------------------------------------------------
+namespace
+{
+  struct LessRecentlyUsed
+  {
+    template<class T>
+    bool operator()(const T* a, const T* b) const { return a->mLastUsedFrame < b->mLastUsedFrame; }
+  };
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::evictTiles()
+{
+  while(mMemoryUsed > mMemoryBudget)
+  {
+    // only the leaves of the resident quadtree not used by this frame can go, evicting them might turn their parent into a leaf
+    std::vector<Tile*> candidates;
+    for(size_t i=0; i<mResidentTiles.size(); ++i)
+    {
+      Tile* tile = mResidentTiles[i];
+      if (tile != mRoot && tile->mLastUsedFrame != mFrame && !hasLiveChildren(tile))
+        candidates.push_back(tile);
+    }
+    if (candidates.empty())
+      break;
+
+    std::sort(candidates.begin(), candidates.end(), LessRecentlyUsed());
+    for(size_t i=0; i<candidates.size() && mMemoryUsed > mMemoryBudget; ++i)
+      releaseTile(candidates[i]);
+  }
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::extractVisibleActors(ActorCollection& list, const Camera* camera)
+{
+  mRenderedCount = 0;
+  if (!mRoot || mRoot->mState != TS_Resident)
+    return;
+
+  ++mFrame;
+  real now = Time::currentTime();
+  mFrameTime = mLastTime >= 0 ? now - mLastTime : 0;
+  mLastTime = now;
+
+  if (mLoadId && mLoaderPool->asyncDone(mLoadId))
+    finishLoads();
+
+  // pixels per world unit at unit distance, or per world unit for orthographic projections
+  const mat4& proj = camera->projectionMatrix();
+  mOrthographic = proj.e(3,3) == 1;
+  mScreenFactor = (camera->viewport() ? camera->viewport()->height() : 0) * proj.e(1,1) / 2;
+
+  mRequests.clear();
+  traverse(mRoot, 0, list, camera);
+  evictTiles();
+  startLoads();
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::extractActors(ActorCollection& list)
+{
+  for(size_t i=0; i<mResidentTiles.size(); ++i)
+    list.push_back(mResidentTiles[i]->mActor.get());
+}
+//-----------------------------------------------------------------------------
+void StreamingTerrain::computeBounds()
+{
+  if (mRoot && mRoot->mState == TS_Resident)
+    mAABB = tileBounds(mRoot);
+  else
+  {
+    mAABB.setMinCorner( mOrigin + vec3((real)(-mWidth/2), 0, (real)(-mDepth/2)) );
+    mAABB.setMaxCorner( mOrigin + vec3((real)(+mWidth/2), (real)mHeight, (real)(+mDepth/2)) );
+  }
+  mSphere = mAABB;
+  setBoundsDirty(false);
+}
+//-----------------------------------------------------------------------------
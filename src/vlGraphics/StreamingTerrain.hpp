@@ -0,0 +1,359 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef StreamingTerrain_INCLUDE_ONCE
+#define StreamingTerrain_INCLUDE_ONCE
+
+#include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <vlGraphics/DrawElements.hpp>
+#include <vlCore/Image.hpp>
+#include <vlCore/ThreadPool.hpp>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // TerrainTileSource
+  //------------------------------------------------------------------------------
+  /**
+   * Provides on demand the height samples of the tiles of a StreamingTerrain.
+   *
+   * The terrain is organized as a quadtree of levelCount() levels: level 0 is a single tile covering the whole terrain,
+   * level L has 2^L x 2^L tiles. Every tile has (tileSize()+1) x (tileSize()+1) samples, adjacent tiles share their border
+   * samples and the samples of a tile at level L are the even samples of its children at level L+1.
+   * The full resolution heightmap is thus tileSize() * 2^(levelCount()-1) + 1 samples per side.
+   *
+   * \sa ImageTerrainTileSource, DirectoryTerrainTileSource
+   */
+  class VLGRAPHICS_EXPORT TerrainTileSource: public Object
+  {
+    VL_INSTRUMENT_ABSTRACT_CLASS(vl::TerrainTileSource, Object)
+
+  public:
+    //! The number of quads per side of a tile, a power of 2 between 4 and 128.
+    virtual int tileSize() const = 0;
+
+    //! The number of levels of the quadtree.
+    virtual int levelCount() const = 0;
+
+    //! Fills \p heights with the (tileSize()+1)^2 samples of the given tile, x fastest, in the range [0,1].
+    //! Called by the loader threads of the StreamingTerrain, see isThreadSafe() and StreamingTerrain::setLoaderThreadCount().
+    virtual bool readTile(int level, int x, int z, float* heights) = 0;
+
+    //! If true readTile() can be called concurrently for different tiles, otherwise the tiles are read one at a time.
+    virtual bool isThreadSafe() const { return false; }
+
+    //! Returns the number of samples per side of the full resolution heightmap.
+    int sampleCount() const { return (tileSize() << (levelCount()-1)) + 1; }
+  };
+  //------------------------------------------------------------------------------
+  // ImageTerrainTileSource
+  //------------------------------------------------------------------------------
+  /**
+   * A TerrainTileSource sampling a heightmap Image kept in memory, mainly useful for datasets of moderate size and
+   * to generate the tiles used by a DirectoryTerrainTileSource, see DirectoryTerrainTileSource::writeTiles().
+   *
+   * The number of levels is the minimum needed to represent the image at full resolution. When the size of the
+   * image is not of the form tile_size * 2^n + 1 the image is bilinearly resampled to the nearest such size.
+   * The red channel of the image is used, see Image::sample().
+   */
+  class VLGRAPHICS_EXPORT ImageTerrainTileSource: public TerrainTileSource
+  {
+    VL_INSTRUMENT_CLASS(vl::ImageTerrainTileSource, TerrainTileSource)
+
+  public:
+    ImageTerrainTileSource(const Image* heightmap, int tile_size=64);
+
+    virtual int tileSize() const { return mTileSize; }
+
+    virtual int levelCount() const { return mLevelCount; }
+
+    virtual bool readTile(int level, int x, int z, float* heights);
+
+    virtual bool isThreadSafe() const { return true; }
+
+  protected:
+    std::vector<float> mSamples;
+    int mWidth;
+    int mHeight;
+    int mTileSize;
+    int mLevelCount;
+  };
+  //------------------------------------------------------------------------------
+  // DirectoryTerrainTileSource
+  //------------------------------------------------------------------------------
+  /**
+   * A TerrainTileSource loading each tile from its own image file, allowing to display heightmaps that do not fit in memory.
+   *
+   * The tile at level L and position x, z is stored in the file "<directory>/L_x_z.<extension>" as an IF_LUMINANCE image,
+   * preferably 16 bits, of (tileSize()+1) x (tileSize()+1) pixels. Use writeTiles() to generate the tiles from another TerrainTileSource.
+   */
+  class VLGRAPHICS_EXPORT DirectoryTerrainTileSource: public TerrainTileSource
+  {
+    VL_INSTRUMENT_CLASS(vl::DirectoryTerrainTileSource, TerrainTileSource)
+
+  public:
+    DirectoryTerrainTileSource(const String& directory, const String& extension, int tile_size, int level_count);
+
+    virtual int tileSize() const { return mTileSize; }
+
+    virtual int levelCount() const { return mLevelCount; }
+
+    virtual bool readTile(int level, int x, int z, float* heights);
+
+    //! The path of the file containing the given tile.
+    String tilePath(int level, int x, int z) const;
+
+    const String& directory() const { return mDirectory; }
+
+    const String& extension() const { return mExtension; }
+
+    //! Writes all the tiles of \p source to \p directory as 16 bits images in the format given by \p extension, e.g. "png" or "tif".
+    static bool writeTiles(TerrainTileSource* source, const String& directory, const String& extension="png");
+
+  protected:
+    String mDirectory;
+    String mExtension;
+    int mTileSize;
+    int mLevelCount;
+  };
+  //------------------------------------------------------------------------------
+  // StreamingTerrain
+  //------------------------------------------------------------------------------
+  /**
+   * A SceneManager rendering a height field too large to be kept in memory as a quadtree of tiles streamed from a TerrainTileSource.
+   *
+   * Unlike Terrain, which loads the whole heightmap and renders every chunk at full resolution, StreamingTerrain keeps
+   * in memory only the tiles needed by the current view:
+   * - Every frame the quadtree is traversed from the root and a tile is refined into its 4 children when its geometric error,
+   *   projected on the screen, is larger than pixelError(). The geometric error of a tile is the maximum height difference
+   *   between the tile and its children, it is estimated until the children have been loaded.
+   * - Missing tiles are read and turned into vertex arrays by loaderThreadCount() threads of a ThreadPool owned by the StreamingTerrain
+   *   while rendering continues with the coarser tiles already available, the nearest tiles to the camera being requested first.
+   *   At most maxConcurrentLoads() tiles are loaded at once. The loader threads do not belong to defThreadPool(), so loading
+   *   tiles never serializes the vl::parallelFor() calls issued while rendering. With loaderThreadCount() == 0 the tiles are
+   *   loaded by the rendering thread.
+   * - Each tile geomorphs between the shape of its parent and its own shape as its parent's screen space error goes from
+   *   pixelError() to twice pixelError(), and a newly loaded tile morphs in over morphTime() seconds, so that changes of
+   *   level are not noticeable. The cracks between tiles at different levels are hidden by skirts.
+   * - When the memory used by the tiles exceeds memoryBudget() the least recently used tiles that are not needed by
+   *   the current frame are evicted, starting from the leaves of the quadtree.
+   *
+   * The terrain is centered on origin() and spans width() along x, depth() along z and height() along y, the heights of
+   * the source being in the range [0,1]. All the tiles share effect(), which by default enables depth test, back face culling
+   * and lighting, and have a normal array and a texture coordinate array on unit 0 spanning the whole terrain from 0 to 1.
+   *
+   * The level of detail is selected by extractVisibleActors(): when several cameras render the same StreamingTerrain the last one wins.
+   * \sa TerrainTileSource, Terrain
+   */
+  class VLGRAPHICS_EXPORT StreamingTerrain: public SceneManager
+  {
+    VL_INSTRUMENT_CLASS(vl::StreamingTerrain, SceneManager)
+
+  public:
+    StreamingTerrain();
+
+    ~StreamingTerrain();
+
+    //! Releases all the tiles and loads the root tile of the source, call it after changing the source or the terrain dimensions.
+    void init();
+
+    void setSource(TerrainTileSource* source) { mSource = source; }
+    const TerrainTileSource* source() const { return mSource.get(); }
+    TerrainTileSource* source() { return mSource.get(); }
+
+    void setWidth(double w)  { mWidth = w; }
+    void setDepth(double d)  { mDepth = d; }
+    void setHeight(double h) { mHeight = h; }
+    void setOrigin(const vec3& origin) { mOrigin = origin; }
+    double width() const { return mWidth; }
+    double depth() const { return mDepth; }
+    double height() const { return mHeight; }
+    const vec3& origin() const { return mOrigin; }
+
+    //! The maximum screen space error in pixels of the rendered tiles (default 2).
+    void setPixelError(float pixels) { mPixelError = pixels; }
+    //! The maximum screen space error in pixels of the rendered tiles (default 2).
+    float pixelError() const { return mPixelError; }
+
+    //! The maximum memory in bytes used by the tiles (default 256MB). The tiles needed by the current frame are never evicted.
+    void setMemoryBudget(long long bytes) { mMemoryBudget = bytes; }
+    //! The maximum memory in bytes used by the tiles (default 256MB).
+    long long memoryBudget() const { return mMemoryBudget; }
+
+    //! The maximum number of tiles loaded at once by the worker threads (default 16).
+    void setMaxConcurrentLoads(int count) { mMaxConcurrentLoads = count; }
+    //! The maximum number of tiles loaded at once by the worker threads (default 16).
+    int maxConcurrentLoads() const { return mMaxConcurrentLoads; }
+
+    //! The number of threads dedicated to loading the tiles (default 2), 0 to load the tiles on the rendering thread.
+    //! Waits for the tiles being loaded before changing the loader threads.
+    void setLoaderThreadCount(int count);
+    //! The number of threads dedicated to loading the tiles (default 2).
+    int loaderThreadCount() const { return mLoaderThreadCount; }
+
+    //! The time in seconds taken by a newly loaded tile to morph from the shape of its parent to its own shape (default 0.5).
+    void setMorphTime(real seconds) { mMorphTime = seconds; }
+    //! The time in seconds taken by a newly loaded tile to morph from the shape of its parent to its own shape (default 0.5).
+    real morphTime() const { return mMorphTime; }
+
+    //! The Effect shared by all the tiles.
+    void setEffect(Effect* effect);
+    //! The Effect shared by all the tiles.
+    Effect* effect() { return mEffect.get(); }
+    //! The Effect shared by all the tiles.
+    const Effect* effect() const { return mEffect.get(); }
+
+    //! The memory in bytes currently used by the tiles.
+    long long memoryUsed() const { return mMemoryUsed; }
+
+    //! The number of tiles currently in memory.
+    int residentTileCount() const { return (int)mResidentTiles.size(); }
+
+    //! The number of tiles being loaded.
+    int loadingTileCount() const { return (int)mLoadJob.mTiles.size(); }
+
+    //! The number of tiles rendered by the last call to extractVisibleActors().
+    int renderedTileCount() const { return mRenderedCount; }
+
+    //! Waits for the tiles being loaded and makes them available to the next frame.
+    void finishLoads();
+
+    virtual void extractVisibleActors(ActorCollection& list, const Camera* camera);
+
+    virtual void extractActors(ActorCollection& list);
+
+    virtual void computeBounds();
+
+  protected:
+    enum ETileState { TS_Unloaded, TS_Loading, TS_Resident, TS_Failed };
+
+    struct Tile
+    {
+      Tile(Tile* parent, int level, int x, int z);
+      ~Tile();
+
+      Tile* mParent;
+      Tile* mChildren[4];
+      int mLevel;
+      int mX;
+      int mZ;
+      ETileState mState;
+      // written by the loader
+      std::vector<float> mHeights;
+      std::vector<float> mMorphHeights;
+      ref<ArrayFloat3> mVertices;
+      ref<ArrayFloat3> mNormals;
+      ref<ArrayFloat2> mTexCoords;
+      float mMinHeight;
+      float mMaxHeight;
+      float mMorphError;
+      float mSkirtDepth;
+      // managed by the rendering thread
+      ref<Geometry> mGeometry;
+      ref<Actor> mActor;
+      float mError;
+      bool mErrorExact;
+      bool mMeasured;
+      float mMorph;
+      float mAppliedMorph;
+      long long mLastUsedFrame;
+      long long mLastRenderedFrame;
+      long long mRequestFrame;
+      long long mBytes;
+    };
+
+    struct LoadJob: public ParallelForTask
+    {
+      LoadJob(): mTerrain(NULL) {}
+      virtual void run(int begin, int end, int thread_index);
+      StreamingTerrain* mTerrain;
+      std::vector<Tile*> mTiles;
+    };
+
+    struct LoadRequest
+    {
+      LoadRequest(): mTile(NULL), mDistance(0) {}
+      LoadRequest(Tile* tile, real distance): mTile(tile), mDistance(distance) {}
+      bool operator<(const LoadRequest& other) const { return mDistance < other.mDistance; }
+      Tile* mTile;
+      real mDistance;
+    };
+
+    void clear();
+    void loadTile(Tile* tile);
+    void finishTile(Tile* tile);
+    void integrateLoads();
+    void startLoads();
+    void evictTiles();
+    void releaseTile(Tile* tile);
+    void updateError(Tile* tile);
+    void applyMorph(Tile* tile, float morph);
+    void traverse(Tile* tile, float parent_sse, ActorCollection& list, const Camera* camera);
+    void requestLoad(Tile* tile, const Camera* camera);
+    AABB tileBounds(const Tile* tile) const;
+    real tileDistance(const Tile* tile, const vec3& eye) const;
+    dvec3 tileSize(int level) const;
+    dvec3 tileCenter(const Tile* tile) const;
+    bool hasLiveChildren(const Tile* tile) const;
+
+  protected:
+    ref<TerrainTileSource> mSource;
+    ref<Effect> mEffect;
+    ref<DrawElementsUShort> mDrawCall;
+    Tile* mRoot;
+    LoadJob mLoadJob;
+    ref<ThreadPool> mLoaderPool;
+    int mLoaderThreadCount;
+    int mLoadId;
+    std::vector<LoadRequest> mRequests;
+    std::vector<Tile*> mResidentTiles;
+    double mWidth;
+    double mHeight;
+    double mDepth;
+    vec3 mOrigin;
+    float mPixelError;
+    long long mMemoryBudget;
+    long long mMemoryUsed;
+    long long mTileBytes;
+    int mMaxConcurrentLoads;
+    real mMorphTime;
+    real mLastTime;
+    real mFrameTime;
+    real mScreenFactor;
+    bool mOrthographic;
+    long long mFrame;
+    int mRenderedCount;
+  };
+}
+
+#endif
@@ -0,0 +1,287 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/SweepLineTessellator.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  inline bool isInside(ETessellationWinding rule, int winding)
+  {
+    switch(rule)
+    {
+    case TW_TESS_WINDING_ODD:         return (winding & 1) != 0;
+    case TW_TESS_WINDING_NONZERO:     return winding != 0;
+    case TW_TESS_WINDING_POSITIVE:    return winding > 0;
+    case TW_TESS_WINDING_NEGATIVE:    return winding < 0;
+    case TW_TESS_WINDING_ABS_GEQ_TWO: return winding >= 2 || winding <= -2;
+    default: return false;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+SweepLineTessellator::SweepLineTessellator()
+{
+  mNormal = dvec3(0,0,0);
+  mWindingRule = TW_TESS_WINDING_ODD;
+  mEpsilon = 0;
+}
+//-----------------------------------------------------------------------------
+/*
+ * Sweeps a horizontal line across the polygon (projected on the plane orthogonal to the dominant axis of the normal) 
+ * stopping at every vertex and at every intersection between edges. Between two stops the edges do not cross and
+ * the winding number of each interval between consecutive edges is constant, so the inside intervals are trapezoids. 
+ * Trapezoids spanning several stops between the same pair of edges are merged before being emitted as triangles.
+ */
+void SweepLineTessellator::tessellate(const int* contours, int contour_count, const dvec3* verts, std::vector<fvec3>& tris)
+{
+  // projection normal
+  dvec3 normal = mNormal;
+  if (normal.isNull())
+  {
+    // Newell's method
+    for(int cont=0, idx=0; cont<contour_count; idx+=contours[cont], ++cont)
+    {
+      for(int i=0; i<contours[cont]; ++i)
+      {
+        const dvec3& a = verts[idx + i];
+        const dvec3& b = verts[idx + (i+1) % contours[cont]];
+        normal.x() += (a.y() - b.y()) * (a.z() + b.z());
+        normal.y() += (a.z() - b.z()) * (a.x() + b.x());
+        normal.z() += (a.x() - b.x()) * (a.y() + b.y());
+      }
+    }
+    if (normal.isNull())
+      normal = dvec3(0,0,1);
+  }
+
+  // drop the dominant axis keeping the orientation so that counter-clockwise contours have positive winding
+  int ax_u = 0, ax_v = 1;
+  double nx = fabs(normal.x()), ny = fabs(normal.y()), nz = fabs(normal.z());
+  if (nz >= nx && nz >= ny)
+  {
+    ax_u = normal.z() >= 0 ? 0 : 1;
+    ax_v = normal.z() >= 0 ? 1 : 0;
+  }
+  else
+  if (nx >= ny)
+  {
+    ax_u = normal.x() >= 0 ? 1 : 2;
+    ax_v = normal.x() >= 0 ? 2 : 1;
+  }
+  else
+  {
+    ax_u = normal.y() >= 0 ? 2 : 0;
+    ax_v = normal.y() >= 0 ? 0 : 2;
+  }
+
+  // collect the edges, horizontal edges do not affect the winding numbers
+  mEdges.clear();
+  mEventY.clear();
+  double min_u = 0, max_u = 0, min_v = 0, max_v = 0;
+  for(int cont=0, idx=0; cont<contour_count; idx+=contours[cont], ++cont)
+  {
+    for(int i=0; i<contours[cont]; ++i)
+    {
+      const dvec3& a = verts[idx + i];
+      const dvec3& b = verts[idx + (i+1) % contours[cont]];
+      dvec2 pa(a.ptr()[ax_u], a.ptr()[ax_v]);
+      dvec2 pb(b.ptr()[ax_u], b.ptr()[ax_v]);
+      if (mEventY.empty())
+      {
+        min_u = max_u = pa.x();
+        min_v = max_v = pa.y();
+      }
+      min_u = pa.x() < min_u ? pa.x() : min_u;
+      max_u = pa.x() > max_u ? pa.x() : max_u;
+      min_v = pa.y() < min_v ? pa.y() : min_v;
+      max_v = pa.y() > max_v ? pa.y() : max_v;
+      mEventY.push_back(pa.y());
+      if (pa.y() == pb.y())
+        continue;
+      SweepEdge edge;
+      bool up = pa.y() < pb.y();
+      edge.mA  = up ? pa : pb;
+      edge.mB  = up ? pb : pa;
+      edge.mA3 = up ? a : b;
+      edge.mB3 = up ? b : a;
+      edge.mDir = up ? -1 : +1;
+      edge.mDxDy = (edge.mB.x() - edge.mA.x()) / (edge.mB.y() - edge.mA.y());
+      mEdges.push_back(edge);
+    }
+  }
+  if (mEdges.empty())
+    return;
+
+  mEpsilon = ((max_u - min_u) + (max_v - min_v)) * 1e-12;
+  std::sort(mEventY.begin(), mEventY.end());
+  mEventY.erase(std::unique(mEventY.begin(), mEventY.end()), mEventY.end());
+  std::sort(mEdges.begin(), mEdges.end());
+
+  int edge_count = (int)mEdges.size();
+  mActive.clear();
+  mOpenList.clear();
+  mOpenRight.assign(edge_count, -1);
+  mOpenY.resize(edge_count);
+  mOpenStamp.assign(edge_count, -1);
+  int stamp = 0;
+  int next_edge = 0;
+  const double eps = mEpsilon;
+
+  for(size_t iev=0; iev+1<mEventY.size(); ++iev)
+  {
+    double y0 = mEventY[iev];
+    const double y_end = mEventY[iev+1];
+
+    // update the active edges
+    size_t keep = 0;
+    for(size_t i=0; i<mActive.size(); ++i)
+      if (mEdges[mActive[i]].mB.y() > y0)
+        mActive[keep++] = mActive[i];
+    mActive.resize(keep);
+    while(next_edge < edge_count && mEdges[next_edge].mA.y() <= y0)
+      mActive.push_back(next_edge++);
+
+    while(y0 < y_end)
+    {
+      double y1 = y_end;
+
+      // sort by x at y0 and by slope, insertion sort is fast since the order changes little from one stop to the next
+      for(size_t i=1; i<mActive.size(); ++i)
+      {
+        int e = mActive[i];
+        double x = mEdges[e].xAt(y0);
+        double s = mEdges[e].mDxDy;
+        size_t j = i;
+        for(; j>0; --j)
+        {
+          const SweepEdge& prev = mEdges[mActive[j-1]];
+          double px = prev.xAt(y0);
+          if ( fabs(px - x) > eps ? px < x : prev.mDxDy <= s )
+            break;
+          mActive[j] = mActive[j-1];
+        }
+        mActive[j] = e;
+      }
+
+      // the first intersection above y0 is between two adjacent edges: stop there
+      for(size_t i=0; i+1<mActive.size(); ++i)
+      {
+        const SweepEdge& a = mEdges[mActive[i]];
+        const SweepEdge& b = mEdges[mActive[i+1]];
+        double ds = a.mDxDy - b.mDxDy;
+        if (ds > 0)
+        {
+          double yc = y0 + (b.xAt(y0) - a.xAt(y0)) / ds;
+          if (yc > y0 + eps && yc < y1 - eps)
+            y1 = yc;
+        }
+      }
+
+      // inside intervals
+      mIntervals.clear();
+      int winding = 0;
+      for(size_t i=0; i+1<mActive.size(); ++i)
+      {
+        winding += mEdges[mActive[i]].mDir;
+        if (isInside(mWindingRule, winding))
+        {
+          mIntervals.push_back(mActive[i]);
+          mIntervals.push_back(mActive[i+1]);
+        }
+      }
+
+      // continue, close or open the trapezoids
+      ++stamp;
+      for(size_t i=0; i<mIntervals.size(); i+=2)
+      {
+        int left  = mIntervals[i];
+        int right = mIntervals[i+1];
+        mOpenStamp[left] = stamp;
+        if (mOpenRight[left] == right)
+          continue;
+        if (mOpenRight[left] != -1)
+          emitTrapezoid(left, mOpenRight[left], mOpenY[left], y0, tris);
+        mOpenRight[left] = right;
+        mOpenY[left] = y0;
+      }
+      for(size_t i=0; i<mOpenList.size(); ++i)
+      {
+        int left = mOpenList[i];
+        if (mOpenStamp[left] != stamp && mOpenRight[left] != -1)
+        {
+          emitTrapezoid(left, mOpenRight[left], mOpenY[left], y0, tris);
+          mOpenRight[left] = -1;
+        }
+      }
+      mOpenList.clear();
+      for(size_t i=0; i<mIntervals.size(); i+=2)
+        mOpenList.push_back(mIntervals[i]);
+
+      y0 = y1;
+    }
+  }
+
+  // close the remaining trapezoids
+  for(size_t i=0; i<mOpenList.size(); ++i)
+  {
+    int left = mOpenList[i];
+    if (mOpenRight[left] != -1)
+      emitTrapezoid(left, mOpenRight[left], mOpenY[left], mEventY.back(), tris);
+    mOpenRight[left] = -1;
+  }
+}
+//-----------------------------------------------------------------------------
+void SweepLineTessellator::emitTrapezoid(int left, int right, double y0, double y1, std::vector<fvec3>& tris) const
+{
+  if (y1 - y0 <= mEpsilon)
+    return;
+  const SweepEdge& l = mEdges[left];
+  const SweepEdge& r = mEdges[right];
+  // counter-clockwise in the projection plane
+  if (r.xAt(y0) - l.xAt(y0) > mEpsilon)
+  {
+    tris.push_back( (fvec3)l.pointAt(y0) );
+    tris.push_back( (fvec3)r.pointAt(y0) );
+    tris.push_back( (fvec3)r.pointAt(y1) );
+  }
+  if (r.xAt(y1) - l.xAt(y1) > mEpsilon)
+  {
+    tris.push_back( (fvec3)l.pointAt(y0) );
+    tris.push_back( (fvec3)r.pointAt(y1) );
+    tris.push_back( (fvec3)l.pointAt(y1) );
+  }
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef SweepLineTessellator_INCLUDE_ONCE
+#define SweepLineTessellator_INCLUDE_ONCE
+
+#include <vlGraphics/link_config.hpp>
+#include <vlCore/vlnamespace.hpp>
+#include <vlCore/Vector2.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // SweepLineTessellator
+  //-----------------------------------------------------------------------------
+  /**
+   * Tessellates a complex polygon into triangles using a sweep line, without requiring GLU or an OpenGL context.
+   *
+   * Supports all the winding rules and self-intersecting contours. The working memory is reused across tessellations,
+   * so a SweepLineTessellator should not be shared among threads, while different instances can be used concurrently.
+   * The trapezoids generated by the sweep are emitted as triangles, which can form T-junctions along the sweep lines.
+   * This is the native tessellator used by Tessellator, see Tessellator::setNativeTessellation().
+   */
+  class VLGRAPHICS_EXPORT SweepLineTessellator
+  {
+  public:
+    SweepLineTessellator();
+
+    //! The normal of the polygon, see gluTessNormal. If null (default) it is computed from the contours.
+    void setNormal(const dvec3& normal) { mNormal = normal; }
+
+    //! The normal of the polygon, see gluTessNormal. If null (default) it is computed from the contours.
+    const dvec3& normal() const { return mNormal; }
+
+    //! See gluTessProperty documentation (GLU_TESS_WINDING_RULE)
+    void setWindingRule(ETessellationWinding rule) { mWindingRule = rule; }
+
+    //! See gluTessProperty documentation (GLU_TESS_WINDING_RULE)
+    ETessellationWinding windingRule() const { return mWindingRule; }
+
+    //! Tessellates the polygon made of \p contour_count contours whose vertex counts are given by \p contours and whose 
+    //! vertices are stored consecutively in \p verts. The counter-clockwise triangles are appended to \p tris.
+    void tessellate(const int* contours, int contour_count, const dvec3* verts, std::vector<fvec3>& tris);
+
+  protected:
+    //! \internal
+    struct SweepEdge
+    {
+      dvec2 mA, mB;
+      dvec3 mA3, mB3;
+      double mDxDy;
+      int mDir;
+
+      double xAt(double y) const { return mA.x() + (y - mA.y()) * mDxDy; }
+      dvec3 pointAt(double y) const { return mA3 + (mB3 - mA3) * ((y - mA.y()) / (mB.y() - mA.y())); }
+      bool operator<(const SweepEdge& other) const { return mA.y() < other.mA.y(); }
+    };
+
+    void emitTrapezoid(int left, int right, double y0, double y1, std::vector<fvec3>& tris) const;
+
+  protected:
+    dvec3 mNormal;
+    ETessellationWinding mWindingRule;
+    // working memory, reused across tessellations
+    std::vector<SweepEdge> mEdges;
+    std::vector<double> mEventY;
+    std::vector<int> mActive;
+    std::vector<int> mOpenRight;
+    std::vector<double> mOpenY;
+    std::vector<int> mOpenList;
+    std::vector<int> mOpenStamp;
+    std::vector<int> mIntervals;
+    double mEpsilon;
+  };
+}
+
+#endif
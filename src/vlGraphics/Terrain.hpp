@@ -58,7 +58,9 @@ namespace vl
    * fetch" (http://developer.nvidia.com/object/using_vertex_textures.html). This technique allows the application to 
    * save GPU memory and to manage even greater terrain databases at a higher speed.
    *
-   * \sa setTerrainTexture(), setHeightmapTexture(), setDetailTexture()
+   * The whole heightmap is loaded and rendered at full resolution: for datasets too large to be kept in memory see StreamingTerrain.
+   *
+   * \sa setTerrainTexture(), setHeightmapTexture(), setDetailTexture(), StreamingTerrain
    */
   class VLGRAPHICS_EXPORT Terrain: public SceneManagerActorKdTree
   {
@@ -30,6 +30,7 @@
 /**************************************************************************************/
 
 #include <vlGraphics/Tessellator.hpp>
+#include <vlCore/ThreadPool.hpp>
 
 using namespace vl;
 
@@ -42,6 +43,11 @@ Tessellator::Tessellator()
   mTolerance = 0.0;
   mWindingRule = TW_TESS_WINDING_ODD;
   mTessellateIntoSinglePolygon = true;
+#if defined(VL_OPENGL)
+  mNativeTessellation = false;
+#else
+  mNativeTessellation = true;
+#endif
 }
 //-----------------------------------------------------------------------------
 Tessellator::~Tessellator()
@@ -50,6 +56,22 @@ Tessellator::~Tessellator()
 }
 //-----------------------------------------------------------------------------
 bool Tessellator::tessellate(bool append_tessellated_tris)
+{
+  if (nativeTessellation() && !boundaryOnly())
+    return tessellateNative(append_tessellated_tris);
+
+#if defined(VL_OPENGL)
+  return tessellateGLU(append_tessellated_tris);
+#else
+  vl::Log::error("Tessellator::tessellate(): the GLU tessellator is not available, use setNativeTessellation(true) and disable boundaryOnly().\n");
+  mContours.clear();
+  mContourVerts.clear();
+  return false;
+#endif
+}
+#if defined(VL_OPENGL)
+//-----------------------------------------------------------------------------
+bool Tessellator::tessellateGLU(bool append_tessellated_tris)
 {
   if (!append_tessellated_tris)
     mTessellatedTris.clear();
@@ -144,6 +166,109 @@ bool Tessellator::tessellate(bool append_tessellated_tris)
 
   return true;
 }
+#endif
+//-----------------------------------------------------------------------------
+bool Tessellator::tessellateParallel(const std::vector< ref<Tessellator> >& tessellators, bool append_tessellated_tris)
+{
+  // the worker threads only run the sweep line, which never logs: the contours are validated here
+  class TessellateTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+        mTessellators[i]->sweepLine();
+    }
+
+  public:
+    std::vector<Tessellator*> mTessellators;
+  };
+
+  bool ok = true;
+
+  // the GLU tessellator is not reentrant: those are processed serially
+  TessellateTask task;
+  std::vector<Tessellator*> serial;
+  for(size_t i=0; i<tessellators.size(); ++i)
+  {
+    Tessellator* tess = tessellators[i].get_writable();
+    if (tess->nativeTessellation() && !tess->boundaryOnly())
+    {
+      if (!append_tessellated_tris)
+        tess->mTessellatedTris.clear();
+      if (tess->checkContours())
+        task.mTessellators.push_back(tess);
+      else
+        ok = false;
+    }
+    else
+      serial.push_back(tess);
+  }
+  parallelFor(0, (int)task.mTessellators.size(), &task);
+
+  for(size_t i=0; i<serial.size(); ++i)
+    ok &= serial[i]->tessellate(append_tessellated_tris);
+  return ok;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::tessellateNative(bool append_tessellated_tris)
+{
+  if (!append_tessellated_tris)
+    mTessellatedTris.clear();
+  if (!checkContours())
+    return false;
+
+  sweepLine();
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::checkContours()
+{
+  if (mContours.empty() || mContourVerts.empty())
+  {
+    vl::Log::error("Tessellator::tessellate(): no contours specified.\n");
+    return false;
+  }
+
+  size_t vert_count = 0;
+  for(size_t i=0; i<mContours.size(); ++i)
+  {
+    if (mContours[i] <= 0)
+    {
+      vl::Log::error( Say("Tessellator::tessellate(): contour #%n has %n vertices, the contours() must contain positive vertex counts.\n") << i << mContours[i] );
+      mContours.clear();
+      mContourVerts.clear();
+      return false;
+    }
+    vert_count += mContours[i];
+  }
+  if (vert_count > mContourVerts.size())
+  {
+    vl::Log::error("Tessellator::tessellate(): the contours() reference more vertices than those in contourVerts().\n");
+    mContours.clear();
+    mContourVerts.clear();
+    return false;
+  }
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+void Tessellator::sweepLine()
+{
+  mSweepLine.setNormal( (dvec3)tessNormal() );
+  mSweepLine.setWindingRule( windingRule() );
+  if (tessellateIntoSinglePolygon())
+    mSweepLine.tessellate(&mContours[0], (int)mContours.size(), &mContourVerts[0], mTessellatedTris);
+  else
+  {
+    for(int cont=0, idx=0; cont<(int)mContours.size(); idx+=mContours[cont], ++cont)
+      mSweepLine.tessellate(&mContours[cont], 1, &mContourVerts[idx], mTessellatedTris);
+  }
+
+  mContours.clear();
+  mContourVerts.clear();
+}
 //-----------------------------------------------------------------------------
 void Tessellator::freeCombinedVertices()
 {
@@ -169,6 +294,7 @@ ref<Geometry> Tessellator::tessellateGeometry(bool append_tessellated_tris)
   geom->computeNormals();
   return geom;
 }
+#if defined(VL_OPENGL)
 //-----------------------------------------------------------------------------
 // Tessellation callbacks
 //-----------------------------------------------------------------------------
@@ -233,3 +359,4 @@ void CALLBACK Tessellator::tessError( GLenum errno )
   Log::error( Say("Tessellator error: %s.\n") << estring );
 }
 //-----------------------------------------------------------------------------
+#endif
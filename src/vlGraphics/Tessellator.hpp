@@ -32,13 +32,16 @@
 #ifndef Tessellator_INCLUDE_ONCE
 #define Tessellator_INCLUDE_ONCE
 
-#include <vlGraphics/OpenGL.hpp>
 #include <vlGraphics/Geometry.hpp>
+#include <vlGraphics/SweepLineTessellator.hpp>
 #include <vlCore/Vector3.hpp>
 #include <vector>
 
-#ifndef CALLBACK
-#define CALLBACK
+#if defined(VL_OPENGL)
+  #include <vlGraphics/OpenGL.hpp>
+  #ifndef CALLBACK
+  #define CALLBACK
+  #endif
 #endif
 
 namespace vl
@@ -46,12 +49,20 @@ namespace vl
   /**
    * Tessellates a complex polygon defined by a set of outlines into a set of triangles that can be rendered by Visualization Library.
    * For more information see the OpenGL Programmer's Guide chapter #11 "Tessellators and Quadrics".
+   *
+   * On desktop OpenGL the polygon is tessellated by default with the GLU tessellator. Calling setNativeTessellation(true) the
+   * SweepLineTessellator is used instead: it supports all the winding rules and self-intersecting contours and does not require an 
+   * OpenGL context, so it can be used from any thread and many polygons can be tessellated in parallel using tessellateParallel().
+   * Its output ignores tolerance() and can contain T-junctions and more triangles than the GLU tessellator's.
+   * On OpenGL ES, where GLU is not available, the native tessellator is always used and boundaryOnly() is not supported.
    */
   class VLGRAPHICS_EXPORT Tessellator: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Tessellator, Object)
 
+#if defined(VL_OPENGL)
     typedef void (CALLBACK *callback_type)(void);
+#endif
   public:
 
     //! Constructor.
@@ -118,13 +129,33 @@ namespace vl
     void setTessellateIntoSinglePolygon(bool on) { mTessellateIntoSinglePolygon = on; }
 
     bool tessellateIntoSinglePolygon() const { return mTessellateIntoSinglePolygon; }
+
+    //! If enabled the SweepLineTessellator is used instead of the GLU tessellator, see the class documentation.
+    //! Disabled by default on desktop OpenGL, enabled on OpenGL ES where it's the only tessellator available.
+    void setNativeTessellation(bool on) { mNativeTessellation = on; }
+
+    //! If enabled the SweepLineTessellator is used instead of the GLU tessellator, see the class documentation.
+    bool nativeTessellation() const { return mNativeTessellation; }
+
+    //! Tessellates the polygons of the given Tessellator[s] in parallel using defThreadPool() and the native tessellator.
+    //! Returns false if any of the tessellations failed.
+    static bool tessellateParallel(const std::vector< ref<Tessellator> >& tessellators, bool append_tessellated_tris=false);
     
   protected:
+    bool tessellateNative(bool append_tessellated_tris);
+    //! Logs and discards invalid contours, must be called on the thread that invokes tessellate().
+    bool checkContours();
+    //! Runs the SweepLineTessellator on validated contours, safe to call from a worker thread.
+    void sweepLine();
+#if defined(VL_OPENGL)
+    bool tessellateGLU(bool append_tessellated_tris);
+
     static void CALLBACK tessBeginData( GLenum type, Tessellator* tessellator );
     static void CALLBACK tessVertexData( dvec3* vec, Tessellator* tessellator );
     static void CALLBACK tessCombineData( GLdouble coords[3], dvec3 *d[4], GLfloat w[4], dvec3 **dataOut, Tessellator* tessellator );
     static void CALLBACK tessEnd(void);
     static void CALLBACK tessError( GLenum errno );
+#endif
     void freeCombinedVertices();
 
   protected:
@@ -149,6 +180,9 @@ namespace vl
     ETessellationWinding mWindingRule;
     // tessellate into a single polygon
     bool mTessellateIntoSinglePolygon;
+    bool mNativeTessellation;
+    // native tessellator, its working memory is reused across tessellations
+    SweepLineTessellator mSweepLine;
   };
 
 }
@@ -40,7 +40,7 @@
 using namespace vl;
 
 //-----------------------------------------------------------------------------
-void Text::render_Implementation(const Actor* actor, const Shader*, const Camera* camera, OpenGLContext* gl_context) const
+void Text::render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const
 {
   gl_context->bindVAS(NULL, false, false);
 
@@ -52,6 +52,9 @@ void Text::render_Implementation(const Actor* actor, const Shader*, const Camera
   if ( text().empty() )
     return;
 
+  // the glyph quads are rebuilt only when the text, its layout or its font change
+  updateGlyphQuads( camera, actor && actor->transform() );
+
   // Lighting can be enabled or disabled.
   // glDisable(GL_LIGHTING);
 
@@ -87,19 +90,8 @@ void Text::render_Implementation(const Actor* actor, const Shader*, const Camera
 
   // to have the most correct results we should render the text twice one for color and stencil, the other for the z-buffer
 
-  // shadow render
-  if (shadowEnabled())
-    renderText( actor, camera, shadowColor(), shadowVector() );
-  // outline render
-  if (outlineEnabled())
-  {
-    renderText( actor, camera, outlineColor(), fvec2(-1,0) );
-    renderText( actor, camera, outlineColor(), fvec2(+1,0) );
-    renderText( actor, camera, outlineColor(), fvec2(0,-1) );
-    renderText( actor, camera, outlineColor(), fvec2(0,+1) );
-  }
-  // text render
-  renderText( actor, camera, color(), fvec2(0,0) );
+  // shadow, outline and text render: all baked in the glyph quads
+  renderText( actor, shader, camera );
 
   // Pass #2
   // fills the z-buffer (not the stencil buffer): approximated to the text bbox
@@ -142,34 +134,26 @@ void Text::render_Implementation(const Actor* actor, const Shader*, const Camera
   glNormal3fv( gl_context->normal().ptr() );
 }
 //-----------------------------------------------------------------------------
-void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& color, const fvec2& offset) const
+void Text::renderText(const Actor* actor, const Shader* shader, const Camera* camera) const
 {
-  if(!mFont)
-  {
-    Log::error("Text::renderText() error: no Font assigned to the Text object.\n");
-    VL_TRAP()
-    return;
-  }
-
-  if (!font()->mFT_Face)
-  {
-    Log::error("Text::renderText() error: invalid FT_Face: probably you tried to load an unsupported font format.\n");
-    VL_TRAP()
+  if (mGlyphQuads.empty())
     return;
-  }
-
-  int viewport[] = { camera->viewport()->x(), camera->viewport()->y(), camera->viewport()->width(), camera->viewport()->height() };
-
-  if (viewport[2] < 1) viewport[2] = 1;
-  if (viewport[3] < 1) viewport[3] = 1;
 
   // note that we only save and restore the server side states
 
   if (mode() == Text2D)
   {
+    int viewport[] = { camera->viewport()->x(), camera->viewport()->y(), camera->viewport()->width(), camera->viewport()->height() };
+
+    if (viewport[2] < 1) viewport[2] = 1;
+    if (viewport[3] < 1) viewport[3] = 1;
+
+    // actor's transform following in Text2D
+    fmat4 modelview = actor && actor->transform() ? followMatrix( actor->transform(), camera ) : fmat4();
+
     glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
-    glLoadIdentity();
+    glLoadMatrixf(modelview.ptr());
     VL_CHECK_OGL();
 
     glMatrixMode(GL_PROJECTION);
@@ -186,6 +170,79 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
     VL_CHECK_OGL();
   }
 
+  // Constant normal
+  glNormal3f( 0, 0, 1 );
+
+  // a GLSLProgram is expected to handle the distance field glyphs by itself
+  mGlyphQuads.render( !shader || !shader->getGLSLProgram() );
+
+  if (mode() == Text2D)
+  {
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix(); VL_CHECK_OGL()
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix(); VL_CHECK_OGL()
+  }
+}
+//-----------------------------------------------------------------------------
+fmat4 Text::followMatrix(const Transform* transform, const Camera* camera) const
+{
+  vec4 v(0,0,0,1);
+  v = transform->worldMatrix() * v;
+
+  camera->project(v,v);
+
+  // from screen space to viewport space
+  v.x() -= camera->viewport()->x();
+  v.y() -= camera->viewport()->y();
+
+  v.x() = (float)int(v.x());
+  v.y() = (float)int(v.y());
+
+  // clever trick part #2: the z of the glyphs is replaced with the projected z of the transform's origin
+  fmat4 m = fmat4::getTranslation( (float)v.x(), (float)v.y(), float((v.z() - 0.5f) / 0.5f) );
+  m.e(2,2) = 0.0f;
+  return m;
+}
+//-----------------------------------------------------------------------------
+void Text::updateGlyphQuads(const Camera* camera, bool follow) const
+{
+  int w = camera->viewport()->width();
+  int h = camera->viewport()->height();
+
+  if (w < 1) w = 1;
+  if (h < 1) h = 1;
+
+  // the viewport size is used only by the viewport alignment
+  bool viewport_aligned = !follow && mode() == Text2D;
+
+  if ( !mQuadsDirty && mQuadsGlyphsTick == font()->glyphsTick() && mQuadsFollow == follow && 
+       ( !viewport_aligned || (mQuadsViewportWidth == w && mQuadsViewportHeight == h) ) )
+    return;
+
+  // creating new glyphs can grow an atlas page changing the texture coordinates of the glyphs already added
+  long long glyphs_tick = 0;
+  do
+  {
+    glyphs_tick = font()->glyphsTick();
+    mGlyphQuads.clear();
+    generateGlyphQuads(w, h, viewport_aligned);
+  }
+  while( glyphs_tick != font()->glyphsTick() );
+
+  mGlyphQuads.finalize();
+
+  mQuadsDirty = false;
+  mQuadsGlyphsTick = glyphs_tick;
+  mQuadsFollow = follow;
+  mQuadsViewportWidth = w;
+  mQuadsViewportHeight = h;
+  ++mQuadsTick;
+}
+//-----------------------------------------------------------------------------
+void Text::generateGlyphQuads(int w, int h, bool viewport_aligned) const
+{
   AABB rbbox = rawboundingRect( text() ); // for text alignment
   VL_CHECK(rbbox.maxCorner().z() == 0)
   VL_CHECK(rbbox.minCorner().z() == 0)
@@ -195,46 +252,33 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
   VL_CHECK(bbox.maxCorner().z() == 0)
   VL_CHECK(bbox.minCorner().z() == 0)
 
-  // basic render states
-
   fvec2 pen(0,0);
 
-  float texc[] = { 0,0, 0,0, 0,0, 0,0 };
-  VL_glActiveTexture( GL_TEXTURE0 );
-  glEnable(GL_TEXTURE_2D);
-  VL_glClientActiveTexture( GL_TEXTURE0 );
-  glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-  glTexCoordPointer(2, GL_FLOAT, 0, texc);
-
-  // Constant color
-  glColor4f( color.r(), color.g(), color.b(), color.a() );
-
-  // Constant normal
-  glNormal3f( 0, 0, 1 );
-
   fvec3 vect[4];
-  glEnableClientState( GL_VERTEX_ARRAY );
-  glVertexPointer(3, GL_FLOAT, 0, vect[0].ptr());
 
   FT_Long has_kerning = FT_HAS_KERNING( font()->mFT_Face );
   FT_UInt previous = 0;
 
+  // the shadow, outline and text passes are baked in layers #0, #1 and #2.
+  // Their offsets are applied before the text matrix, i.e. they are rotated and scaled along with the text.
+  fvec3 shadow_offset = (mMatrix * fvec4(shadowVector().x(), shadowVector().y(), 0, 0)).xyz();
+  fvec3 outline_offset[] = { 
+    (mMatrix * fvec4(-1, 0, 0, 0)).xyz(), (mMatrix * fvec4(+1, 0, 0, 0)).xyz(), 
+    (mMatrix * fvec4( 0,-1, 0, 0)).xyz(), (mMatrix * fvec4( 0,+1, 0, 0)).xyz() 
+  };
+  ubvec4 shadow_color  = GlyphQuads::packColor( shadowColor() );
+  ubvec4 outline_color = GlyphQuads::packColor( outlineColor() );
+  ubvec4 text_color    = GlyphQuads::packColor( color() );
+
   // viewport alignment
   fmat4 m = mMatrix;
 
-  int w = camera->viewport()->width();
-  int h = camera->viewport()->height();
-
-  if (w < 1) w = 1;
-  if (h < 1) h = 1;
-
-  if ( !(actor && actor->transform()) && mode() == Text2D )
+  if ( viewport_aligned )
   {
     if (viewportAlignment() & AlignHCenter)
     {
       VL_CHECK( !(viewportAlignment() & AlignRight) )
       VL_CHECK( !(viewportAlignment() & AlignLeft) )
-      // vect[i].x() += int((viewport[2]-1.0f) / 2.0f);
       m.translate( (float)int((w-1.0f) / 2.0f), 0, 0);
     }
 
@@ -242,7 +286,6 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
     {
       VL_CHECK( !(viewportAlignment() & AlignHCenter) )
       VL_CHECK( !(viewportAlignment() & AlignLeft) )
-      // vect[i].x() += int(viewport[2]-1.0f);
       m.translate( (float)int(w-1.0f), 0, 0);
     }
 
@@ -250,7 +293,6 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
     {
       VL_CHECK( !(viewportAlignment() & AlignBottom) )
       VL_CHECK( !(viewportAlignment() & AlignVCenter) )
-      // vect[i].y() += int(viewport[3]-1.0f);
       m.translate( 0, (float)int(h-1.0f), 0);
     }
 
@@ -258,7 +300,6 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
     {
       VL_CHECK( !(viewportAlignment() & AlignTop) )
       VL_CHECK( !(viewportAlignment() & AlignBottom) )
-      // vect[i].y() += int((viewport[3]-1.0f) / 2.0f);
       m.translate( 0, (float)int((h-1.0f) / 2.0f), 0);
     }
   }
@@ -366,24 +407,8 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
 
       if (glyph->textureHandle())
       {
-        glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-        texc[0] = glyph->s0();
-        texc[1] = glyph->t1();
-        
-        texc[2] = glyph->s1();
-        texc[3] = glyph->t1();
-
-        texc[4] = glyph->s1();
-        texc[5] = glyph->t0();
-        
-        texc[6] = glyph->s0();
-        texc[7] = glyph->t0();
-
         int left = layout() == RightToLeftText ? -glyph->left() : +glyph->left();
 
-        // triangle strip layout
-
         vect[0].x() = pen.x() + glyph->width()*0 + left -1;
         vect[0].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
 
@@ -396,54 +421,20 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
         vect[3].x() = pen.x() + glyph->width()*0 + left -1;
         vect[3].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
 
-        if (layout() == RightToLeftText)
-        {
-  #if (1)
-          vect[0].x() -= glyph->width()-1 +2;
-          vect[1].x() -= glyph->width()-1 +2;
-          vect[2].x() -= glyph->width()-1 +2;
-          vect[3].x() -= glyph->width()-1 +2;
-  #endif
-        }
-
-        vect[0].y() -= mFont->mHeight;
-        vect[1].y() -= mFont->mHeight;
-        vect[2].y() -= mFont->mHeight;
-        vect[3].y() -= mFont->mHeight;
-
-  #if (1)
-        // normalize coordinate orgin to the bottom/left corner
-        vect[0] -= (fvec3)bbox.minCorner();
-        vect[1] -= (fvec3)bbox.minCorner();
-        vect[2] -= (fvec3)bbox.minCorner();
-        vect[3] -= (fvec3)bbox.minCorner();
-  #endif
-
-  #if (1)
-        vect[0].x() += applied_margin + displace;
-        vect[1].x() += applied_margin + displace;
-        vect[2].x() += applied_margin + displace;
-        vect[3].x() += applied_margin + displace;
-
-        vect[0].y() += applied_margin;
-        vect[1].y() += applied_margin;
-        vect[2].y() += applied_margin;
-        vect[3].y() += applied_margin;
-  #endif
-
-        // apply offset for outline rendering
-        vect[0].x() += offset.x();
-        vect[0].y() += offset.y();
-        vect[1].x() += offset.x();
-        vect[1].y() += offset.y();
-        vect[2].x() += offset.x();
-        vect[2].y() += offset.y();
-        vect[3].x() += offset.x();
-        vect[3].y() += offset.y();
-
-        // alignment
         for(int i=0; i<4; ++i)
         {
+          if (layout() == RightToLeftText)
+            vect[i].x() -= glyph->width()-1 +2;
+
+          vect[i].y() -= mFont->mHeight;
+
+          // normalize coordinate orgin to the bottom/left corner
+          vect[i] -= (fvec3)bbox.minCorner();
+
+          vect[i].x() += applied_margin + displace;
+          vect[i].y() += applied_margin;
+
+          // alignment
           if (alignment() & AlignHCenter)
           {
             VL_CHECK( !(alignment() & AlignRight) )
@@ -471,54 +462,19 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
             VL_CHECK( !(alignment() & AlignBottom) )
             vect[i].y() -= int(bbox.height() / 2.0);
           }
-        }
 
-        // apply text transform
-        vect[0] = m * vect[0];
-        vect[1] = m * vect[1];
-        vect[2] = m * vect[2];
-        vect[3] = m * vect[3];
+          // apply text transform
+          vect[i] = m * vect[i];
+        }
 
-        // actor's transform following in Text2D
-        if ( actor->transform() && mode() == Text2D )
+        if (shadowEnabled())
+          mGlyphQuads.addQuad( glyph, vect, shadow_color, 0, shadow_offset );
+        if (outlineEnabled())
         {
-          vec4 v(0,0,0,1);
-          v = actor->transform()->worldMatrix() * v;
-
-          camera->project(v,v);
-
-          // from screen space to viewport space
-          v.x() -= viewport[0];
-          v.y() -= viewport[1];
-
-          v.x() = (float)int(v.x());
-          v.y() = (float)int(v.y());
-
-          vect[0].x() += (float)v.x();
-          vect[0].y() += (float)v.y();
-          vect[1].x() += (float)v.x();
-          vect[1].y() += (float)v.y();
-          vect[2].x() += (float)v.x();
-          vect[2].y() += (float)v.y();
-          vect[3].x() += (float)v.x();
-          vect[3].y() += (float)v.y();
-
-          // clever trick part #2
-          vect[0].z() = 
-          vect[1].z() = 
-          vect[2].z() = 
-          vect[3].z() = float((v.z() - 0.5f) / 0.5f);
+          for(int i=0; i<4; ++i)
+            mGlyphQuads.addQuad( glyph, vect, outline_color, 1, outline_offset[i] );
         }
-
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4); VL_CHECK_OGL();
-
-        #if (0)
-          glDisable(GL_TEXTURE_2D);
-          glColor3fv(vec3(1,0,0).ptr());
-          glDrawArrays(GL_LINE_LOOP, 0, 4);
-          glColor4fv(color.ptr());
-          glEnable(GL_TEXTURE_2D);
-        #endif
+        mGlyphQuads.addQuad( glyph, vect, text_color, 2 );
       }
 
       if (just_space && lines[iline][c] == ' ' && iline != lines.size()-1)
@@ -552,23 +508,6 @@ void Text::renderText(const Actor* actor, const Camera* camera, const fvec4& col
 
     }
   }
-
-  glDisableClientState( GL_VERTEX_ARRAY ); VL_CHECK_OGL();
-  glDisableClientState( GL_TEXTURE_COORD_ARRAY ); VL_CHECK_OGL();
-
-  VL_CHECK_OGL();
-
-  if (mode() == Text2D)
-  {
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix(); VL_CHECK_OGL()
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix(); VL_CHECK_OGL()
-  }
-
-  glDisable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D,0);
 }
 //-----------------------------------------------------------------------------
 // returns the raw bounding box of the string, i.e. without alignment, margin and matrix transform.
@@ -1007,15 +946,18 @@ AABB Text::boundingRectTransformed(vec3& a, vec3& b, vec3& c, vec3& d, const Cam
 void Text::translate(float x, float y, float z)
 {
   mMatrix.translate(x,y,z);
+  mQuadsDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Text::rotate(float degrees, float x, float y, float z)
 {
   mMatrix.rotate(degrees,x,y,z);
+  mQuadsDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Text::resetMatrix()
 {
   mMatrix.setIdentity();
+  mQuadsDirty = true;
 }
 //-----------------------------------------------------------------------------
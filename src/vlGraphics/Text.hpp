@@ -33,6 +33,7 @@
 #define Text_INCLUDE_ONCE
 
 #include <vlGraphics/Font.hpp>
+#include <vlGraphics/GlyphQuads.hpp>
 #include <vlGraphics/Renderable.hpp>
 #include <vlCore/vlnamespace.hpp>
 #include <vlCore/String.hpp>
@@ -43,7 +44,12 @@ namespace vl
 {
   /**
    * A Renderable that renders text with a given Font.
+   *
+   * The quads of the glyphs, including the ones of the shadow and of the outline, are generated once and cached until 
+   * the text, its layout, its colors, its matrix or its Font change. The text is then rendered with a single draw call per Font atlas page.
+   * Use TextBatch to render many Text objects at once.
    * \sa
+   * - TextBatch
    * - Actor
    * - VectorGraphics
   */
@@ -51,77 +57,80 @@ namespace vl
   {
     VL_INSTRUMENT_CLASS(vl::Text, Renderable)
 
+    friend class TextBatch;
+
   public:
     Text(): mColor(1,1,1,1), mBorderColor(0,0,0,1), mBackgroundColor(1,1,1,1), mOutlineColor(0,0,0,1), mShadowColor(0,0,0,0.5f), mShadowVector(2,-2), 
       mInterlineSpacing(5), mAlignment(AlignBottom|AlignLeft), mViewportAlignment(AlignBottom|AlignLeft), mMargin(5), mMode(Text2D), mLayout(LeftToRightText), mTextAlignment(TextAlignLeft), 
-      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true) 
+      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true), 
+      mQuadsDirty(true), mQuadsFollow(false), mQuadsGlyphsTick(0), mQuadsTick(0), mQuadsViewportWidth(0), mQuadsViewportHeight(0)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
     const String& text() const { return mText; }
-    void setText(const String& text) { mText = text; }
+    void setText(const String& text) { mText = text; mQuadsDirty = true; }
 
     const fvec4& color() const { return mColor; }
-    void setColor(const fvec4& color) { mColor = color; }
+    void setColor(const fvec4& color) { mColor = color; mQuadsDirty = true; }
 
     const fvec4& borderColor() const { return mBorderColor; }
     void setBorderColor(const fvec4& border_color) { mBorderColor = border_color; }
 
     const fvec4& outlineColor() const { return mOutlineColor; }
-    void setOutlineColor(const fvec4& outline_color) { mOutlineColor = outline_color; }
+    void setOutlineColor(const fvec4& outline_color) { mOutlineColor = outline_color; mQuadsDirty = true; }
 
     const fvec4& backgroundColor() const { return mBackgroundColor; }
     void setBackgroundColor(const fvec4& background_color) { mBackgroundColor = background_color; }
 
     const fvec4& shadowColor() const { return mShadowColor; }
-    void setShadowColor(const fvec4& shadow_color) { mShadowColor = shadow_color; }
+    void setShadowColor(const fvec4& shadow_color) { mShadowColor = shadow_color; mQuadsDirty = true; }
 
     const fvec2& shadowVector() const { return mShadowVector; }
-    void setShadowVector(const fvec2& shadow_vector) { mShadowVector = shadow_vector; }
+    void setShadowVector(const fvec2& shadow_vector) { mShadowVector = shadow_vector; mQuadsDirty = true; }
 
     int margin() const { return mMargin; }
-    void setMargin(int margin) { mMargin = margin; }
+    void setMargin(int margin) { mMargin = margin; mQuadsDirty = true; }
 
     const Font* font() const { return mFont.get(); }
     Font* font() { return mFont.get(); }
-    void setFont(Font* font) { mFont = font; }
+    void setFont(Font* font) { mFont = font; mQuadsDirty = true; }
 
     const fmat4 matrix() const { return mMatrix; }
-    void setMatrix(const fmat4& matrix) { mMatrix = matrix; }
+    void setMatrix(const fmat4& matrix) { mMatrix = matrix; mQuadsDirty = true; }
 
     int  alignment() const { return mAlignment; }
-    void setAlignment(int  align) { mAlignment = align; }
+    void setAlignment(int  align) { mAlignment = align; mQuadsDirty = true; }
 
     int  viewportAlignment() const { return mViewportAlignment; }
-    void setViewportAlignment(int  align) { mViewportAlignment = align; }
+    void setViewportAlignment(int  align) { mViewportAlignment = align; mQuadsDirty = true; }
 
     float interlineSpacing() const { return mInterlineSpacing; }
     void setInterlineSpacing(float spacing) { mInterlineSpacing = spacing; }
 
     ETextMode mode() const { return mMode; }
-    void setMode(ETextMode mode) { mMode = mode; }
+    void setMode(ETextMode mode) { mMode = mode; mQuadsDirty = true; }
 
     ETextLayout layout() const { return mLayout; }
-    void setLayout(ETextLayout layout) { mLayout = layout; }
+    void setLayout(ETextLayout layout) { mLayout = layout; mQuadsDirty = true; }
 
     ETextAlign textAlignment() const { return mTextAlignment; }
-    void setTextAlignment(ETextAlign align) { mTextAlignment = align; }
+    void setTextAlignment(ETextAlign align) { mTextAlignment = align; mQuadsDirty = true; }
 
     bool borderEnabled() const { return mBorderEnabled; }
-    void setBorderEnabled(bool border) { mBorderEnabled = border; }
+    void setBorderEnabled(bool border) { mBorderEnabled = border; mQuadsDirty = true; }
 
     bool backgroundEnabled() const { return mBackgroundEnabled; }
-    void setBackgroundEnabled(bool background) { mBackgroundEnabled = background; }
+    void setBackgroundEnabled(bool background) { mBackgroundEnabled = background; mQuadsDirty = true; }
 
     bool kerningEnabled() const { return mKerningEnabled; }
-    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; }
+    void setKerningEnabled(bool kerning) { mKerningEnabled = kerning; mQuadsDirty = true; }
 
     bool outlineEnabled() const { return mOutlineEnabled; }
-    void setOutlineEnabled(bool outline) { mOutlineEnabled = outline; }
+    void setOutlineEnabled(bool outline) { mOutlineEnabled = outline; mQuadsDirty = true; }
 
     bool shadowEnabled() const { return mShadowEnabled; }
-    void setShadowEnabled(bool shadow) { mShadowEnabled = shadow; }
+    void setShadowEnabled(bool shadow) { mShadowEnabled = shadow; mQuadsDirty = true; }
 
     virtual void render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const;
     void computeBounds_Implementation() { setBoundingBox(AABB()); setBoundingSphere(Sphere()); }
@@ -138,10 +147,13 @@ namespace vl
 
     virtual void updateDirtyBufferObject(EBufferObjectUpdateMode) {}
 
-    virtual void deleteBufferObject() {}
+    virtual void deleteBufferObject() { mGlyphQuads.deleteBufferObject(); }
 
   protected:
-    void renderText(const Actor*, const Camera* camera, const fvec4& color, const fvec2& offset) const;
+    void updateGlyphQuads(const Camera* camera, bool follow) const;
+    fmat4 followMatrix(const Transform* transform, const Camera* camera) const;
+    void generateGlyphQuads(int viewport_w, int viewport_h, bool viewport_aligned) const;
+    void renderText(const Actor* actor, const Shader* shader, const Camera* camera) const;
     void renderBackground(const Actor* actor, const Camera* camera) const;
     void renderBorder(const Actor* actor, const Camera* camera) const;
     AABB rawboundingRect(const String& text) const;
@@ -168,6 +180,14 @@ namespace vl
     bool mOutlineEnabled;
     bool mShadowEnabled;
     bool mKerningEnabled;
+    // glyph quads cache
+    mutable GlyphQuads mGlyphQuads;
+    mutable bool mQuadsDirty;
+    mutable bool mQuadsFollow;
+    mutable long long mQuadsGlyphsTick;
+    mutable long long mQuadsTick;
+    mutable int mQuadsViewportWidth;
+    mutable int mQuadsViewportHeight;
   };
 }
 
@@ -0,0 +1,207 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/TextBatch.hpp>
+#include <vlGraphics/OpenGLContext.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlGraphics/Shader.hpp>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+void TextBatch::addText(Text* text, Transform* transform)
+{
+  Entry entry;
+  entry.mText = text;
+  entry.mTransform = transform;
+  mEntries.push_back(entry);
+  mDirty = true;
+}
+//-----------------------------------------------------------------------------
+void TextBatch::removeText(Text* text)
+{
+  for(size_t i=mEntries.size(); i--; )
+  {
+    if (mEntries[i].mText == text)
+      mEntries.erase( mEntries.begin() + i );
+  }
+  mDirty = true;
+}
+//-----------------------------------------------------------------------------
+void TextBatch::clear()
+{
+  mEntries.clear();
+  mDirty = true;
+}
+//-----------------------------------------------------------------------------
+void TextBatch::deleteBufferObject()
+{
+  mQuads2D.deleteBufferObject();
+  mQuads3D.deleteBufferObject();
+}
+//-----------------------------------------------------------------------------
+bool TextBatch::updateEntries(const Camera* camera) const
+{
+  bool changed = mDirty;
+  mEntryStates.resize( mEntries.size() );
+
+  for(size_t i=0; i<mEntries.size(); ++i)
+  {
+    const Text* text = mEntries[i].mText.get();
+    const Transform* tr = mEntries[i].mTransform.get();
+    EntryState state;
+    state.mText = text;
+
+    if ( text && text->font() && text->font()->mFT_Face && !text->text().empty() )
+    {
+      // rebuilds the Text's own glyph quads only if needed
+      text->updateGlyphQuads( camera, tr != NULL );
+      state.mQuadsTick = text->mQuadsTick;
+
+      if (text->mode() == Text2D)
+      {
+        if (tr)
+          state.mMatrix = text->followMatrix( tr, camera );
+      }
+      else
+      if (tr)
+        state.mMatrix = (fmat4)tr->worldMatrix();
+    }
+
+    EntryState& prev = mEntryStates[i];
+    if ( prev.mText != state.mText || prev.mQuadsTick != state.mQuadsTick || prev.mMatrix != state.mMatrix )
+    {
+      prev = state;
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+//-----------------------------------------------------------------------------
+void TextBatch::rebuild() const
+{
+  mQuads2D.clear();
+  mQuads3D.clear();
+
+  GlyphQuads::Vertex quad[6];
+  for(size_t i=0; i<mEntries.size(); ++i)
+  {
+    const EntryState& state = mEntryStates[i];
+    if (state.mQuadsTick < 0)
+      continue;
+
+    const Text* text = state.mText;
+    GlyphQuads& quads = text->mode() == Text2D ? mQuads2D : mQuads3D;
+    const std::vector<GlyphQuads::Vertex>& verts = text->mGlyphQuads.vertices();
+    const std::vector<GlyphQuads::Run>& runs = text->mGlyphQuads.runs();
+
+    // the layers of the Text are kept so that shadows, outlines and texts are rendered in this order
+    for(size_t r=0; r<runs.size(); ++r)
+    {
+      const GlyphQuads::Run& run = runs[r];
+      for(int v=run.mFirst; v<run.mFirst+run.mCount; v+=6)
+      {
+        for(int j=0; j<6; ++j)
+        {
+          quad[j] = verts[v+j];
+          quad[j].mPosition = state.mMatrix * quad[j].mPosition;
+        }
+        quads.addQuad( run.mTexture, quad, run.mLayer, run.mDistanceField );
+      }
+    }
+  }
+
+  mQuads2D.finalize();
+  mQuads3D.finalize();
+  mDirty = false;
+}
+//-----------------------------------------------------------------------------
+void TextBatch::render_Implementation(const Actor*, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const
+{
+  gl_context->bindVAS(NULL, false, false);
+
+  if ( updateEntries(camera) )
+    rebuild();
+
+  if ( mQuads2D.empty() && mQuads3D.empty() )
+    return;
+
+  // disable z-writing, see Text::render_Implementation()
+  GLboolean depth_mask=0;
+  glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+  glDepthMask(GL_FALSE);
+
+  // Constant normal
+  glNormal3f( 0, 0, 1 );
+
+  // a GLSLProgram is expected to handle the distance field glyphs by itself
+  bool fixed_function = !shader || !shader->getGLSLProgram();
+
+  // Text3D are rendered in the Actor's coordinate system
+  mQuads3D.render( fixed_function );
+
+  if ( !mQuads2D.empty() )
+  {
+    int viewport_w = camera->viewport()->width()  < 1 ? 1 : camera->viewport()->width();
+    int viewport_h = camera->viewport()->height() < 1 ? 1 : camera->viewport()->height();
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+
+    // clever trick part #1, see Text::renderText()
+    fmat4 mat = fmat4::getOrtho(-0.5f, viewport_w-0.5f, -0.5f, viewport_h-0.5f, -1, +1);
+    mat.e(2,2) = 1.0f; // preserve the z value from the incoming vertex.
+    mat.e(2,3) = 0.0f;
+    glLoadMatrixf(mat.ptr());
+    VL_CHECK_OGL();
+
+    mQuads2D.render( fixed_function );
+
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix(); VL_CHECK_OGL()
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix(); VL_CHECK_OGL()
+  }
+
+  // restores depth mask
+  glDepthMask(depth_mask);
+
+  // restore the right color and normal since we changed them
+  glColor4fv( gl_context->color().ptr() );
+  glNormal3fv( gl_context->normal().ptr() );
+}
+//-----------------------------------------------------------------------------
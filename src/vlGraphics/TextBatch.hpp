@@ -0,0 +1,122 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef TextBatch_INCLUDE_ONCE
+#define TextBatch_INCLUDE_ONCE
+
+#include <vlGraphics/Text.hpp>
+#include <vector>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // TextBatch
+  //-----------------------------------------------------------------------------
+  /**
+   * A Renderable that renders many Text objects at once, with one draw call per Font atlas page.
+   *
+   * Rendering thousands of labels with one Actor per Text costs at least one draw call per Text. A TextBatch instead
+   * merges the cached glyph quads of all its Text objects in a single vertex buffer which is rebuilt only when a Text
+   * or the position of a Text changes. Text objects using the same Font share the same atlas pages, so a scene using 
+   * a single Font is usually rendered with one draw call for the Text2D and one for the Text3D objects.
+   *
+   * Each Text is added together with an optional Transform which plays the role of the Actor's Transform of a Text rendered on its own:
+   * - a Text2D follows the Transform on the screen, or uses its viewport alignment if no Transform is given.
+   * - a Text3D is placed by the Transform's world matrix in the coordinate system of the TextBatch's Actor, 
+   *   which is the world coordinate system if the Actor has no Transform.
+   *
+   * The shadow, outline and text of all the Text objects are rendered in this order, the background and the border of the Text objects are 
+   * not rendered and the depth buffer is not written. Like for Text the Font, the matrix and the other Text properties can be changed at any time.
+   * \note The Text2D following a Transform are repositioned every time the camera or the Transform moves, which requires rebuilding the vertex buffer.
+   * \sa Text, Font, GlyphQuads
+  */
+  class VLGRAPHICS_EXPORT TextBatch: public Renderable
+  {
+    VL_INSTRUMENT_CLASS(vl::TextBatch, Renderable)
+
+  public:
+    //! A Text rendered by a TextBatch.
+    struct Entry
+    {
+      ref<Text> mText;
+      ref<Transform> mTransform;
+    };
+
+  public:
+    TextBatch(): mDirty(true)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! Adds a Text to the batch, see the TextBatch class documentation for the meaning of \p transform.
+    void addText(Text* text, Transform* transform=NULL);
+
+    //! Removes all the occurrences of the given Text from the batch.
+    void removeText(Text* text);
+
+    //! Removes all the Text objects from the batch.
+    void clear();
+
+    //! The Text objects rendered by the batch.
+    const std::vector<Entry>& texts() const { return mEntries; }
+
+    virtual void render_Implementation(const Actor* actor, const Shader* shader, const Camera* camera, OpenGLContext* gl_context) const;
+    void computeBounds_Implementation() { setBoundingBox(AABB()); setBoundingSphere(Sphere()); }
+
+    // Renderable interface implementation.
+
+    virtual void updateDirtyBufferObject(EBufferObjectUpdateMode) {}
+
+    virtual void deleteBufferObject();
+
+  protected:
+    bool updateEntries(const Camera* camera) const;
+    void rebuild() const;
+
+  protected:
+    //! What an Entry looked like when the vertex buffer was last built.
+    struct EntryState
+    {
+      EntryState(): mText(NULL), mQuadsTick(-1) {}
+      const Text* mText;
+      long long mQuadsTick;
+      fmat4 mMatrix;
+    };
+
+    std::vector<Entry> mEntries;
+    mutable std::vector<EntryState> mEntryStates;
+    mutable GlyphQuads mQuads2D;
+    mutable GlyphQuads mQuads3D;
+    mutable bool mDirty;
+  };
+}
+
+#endif
@@ -1174,7 +1174,23 @@ bool Texture::createTexture()
       else // automatic mipmaps generation
       if (mipmaps.size() == 1)
       {
-        ok = setMipLevel(0, img.get(), true);
+        // without OpenGL 1.4 build the mipmaps on the CPU rather than rescaling to a power of 2 via GLU.
+        // The mipmaps are built on a private copy since the user's Image might be shared.
+        ref<Image> mip_img;
+        if ( !Has_glGenerateMipmaps && !Has_GL_GENERATE_MIPMAP && !isCompressedFormat(img->format()) )
+        {
+          mip_img = new Image(*img);
+          if (!mip_img->buildMipmaps())
+            mip_img = NULL;
+        }
+        if (mip_img)
+        {
+          ok = setMipLevel(0, img.get(), false);
+          for(int i=0; ok && i<(int)mip_img->mipmaps().size(); ++i)
+            ok = setMipLevel(i+1, mip_img->mipmaps()[i].get(), false);
+        }
+        else
+          ok = setMipLevel(0, img.get(), true);
       }
     }
     return ok;
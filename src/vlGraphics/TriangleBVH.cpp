@@ -0,0 +1,439 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/TriangleBVH.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <algorithm>
+#include <cfloat>
+
+using namespace vl;
+
+namespace
+{
+  // beyond this depth the nodes are split at the median to bound the depth of the hierarchy
+  const int MaxSAHDepth = 48;
+  // traversal stack size, enough for MaxSAHDepth levels plus median splits of 2^31 primitives
+  const int StackSize = 128;
+  const int BinCount = 16;
+
+  inline float halfArea(const fvec3& mn, const fvec3& mx)
+  {
+    fvec3 d = mx - mn;
+    return d.x()*d.y() + d.y()*d.z() + d.z()*d.x();
+  }
+
+  inline void growBox(fvec3& mn, fvec3& mx, const fvec3& pmin, const fvec3& pmax)
+  {
+    for(int i=0; i<3; ++i)
+    {
+      mn[i] = std::min(mn[i], pmin[i]);
+      mx[i] = std::max(mx[i], pmax[i]);
+    }
+  }
+
+  inline fvec3 reciprocal(const fvec3& v)
+  {
+    // divisions by zero give infinities which are correctly handled by BVHNode::intersect()
+    return fvec3(1.0f / v.x(), 1.0f / v.y(), 1.0f / v.z());
+  }
+
+  //-----------------------------------------------------------------------------
+  class BVHBuilder
+  {
+  public:
+    struct CentroidLess
+    {
+      CentroidLess(const fvec3* c, int axis): mCentroids(c), mAxis(axis) {}
+      bool operator()(int a, int b) const { return mCentroids[a][mAxis] < mCentroids[b][mAxis]; }
+      const fvec3* mCentroids;
+      int mAxis;
+    };
+
+    void build(int node, int first, int count, int depth)
+    {
+      std::vector<int>& order = *mOrder;
+
+      fvec3 bmin(+FLT_MAX, +FLT_MAX, +FLT_MAX), bmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+      fvec3 cmin = bmin, cmax = bmax;
+      for(int i=first; i<first+count; ++i)
+      {
+        growBox(bmin, bmax, mBoxMin[order[i]], mBoxMax[order[i]]);
+        growBox(cmin, cmax, mCentroids[order[i]], mCentroids[order[i]]);
+      }
+      (*mNodes)[node].mMin = bmin;
+      (*mNodes)[node].mMax = bmax;
+
+      if (count <= mMaxLeafSize)
+      {
+        makeLeaf(node, first, count);
+        return;
+      }
+
+      fvec3 extent = cmax - cmin;
+      int axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2) : (extent.y() > extent.z() ? 1 : 2);
+
+      int left_count = 0;
+      if (extent[axis] > 0 && depth < MaxSAHDepth)
+        left_count = splitSAH(first, count, axis, cmin[axis], extent[axis]);
+
+      // fall back to a median split if the SAH split is not useful or degenerate
+      if (left_count <= 0 || left_count >= count)
+      {
+        left_count = count / 2;
+        std::nth_element(order.begin()+first, order.begin()+first+left_count, order.begin()+first+count, CentroidLess(&mCentroids[0], axis));
+      }
+
+      int left = (int)mNodes->size();
+      mNodes->push_back(BVHNode());
+      build(left, first, left_count, depth+1);
+
+      int right = (int)mNodes->size();
+      mNodes->push_back(BVHNode());
+      (*mNodes)[node].mIndex = right;
+      (*mNodes)[node].mCount = 0;
+      build(right, first+left_count, count-left_count, depth+1);
+    }
+
+    void makeLeaf(int node, int first, int count)
+    {
+      (*mNodes)[node].mIndex = first;
+      (*mNodes)[node].mCount = count;
+    }
+
+    // returns the number of primitives moved to the left side or 0 if splitting is more expensive than not splitting
+    int splitSAH(int first, int count, int axis, float cmin, float extent)
+    {
+      std::vector<int>& order = *mOrder;
+      int bin_count[BinCount];
+      fvec3 bin_min[BinCount], bin_max[BinCount];
+      for(int b=0; b<BinCount; ++b)
+      {
+        bin_count[b] = 0;
+        bin_min[b] = fvec3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+        bin_max[b] = fvec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+      }
+
+      const float scale = BinCount / extent;
+      for(int i=first; i<first+count; ++i)
+      {
+        int b = std::min(BinCount-1, (int)((mCentroids[order[i]][axis] - cmin) * scale));
+        ++bin_count[b];
+        growBox(bin_min[b], bin_max[b], mBoxMin[order[i]], mBoxMax[order[i]]);
+      }
+
+      // right to left sweep
+      float right_area[BinCount];
+      fvec3 mn(+FLT_MAX, +FLT_MAX, +FLT_MAX), mx(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+      for(int b=BinCount-1; b>0; --b)
+      {
+        growBox(mn, mx, bin_min[b], bin_max[b]);
+        right_area[b] = halfArea(mn, mx);
+      }
+
+      // left to right sweep
+      float best_cost = FLT_MAX;
+      int best_split = -1;
+      int lcount = 0;
+      mn = fvec3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
+      mx = fvec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+      for(int b=0; b<BinCount-1; ++b)
+      {
+        lcount += bin_count[b];
+        growBox(mn, mx, bin_min[b], bin_max[b]);
+        if (lcount == 0 || lcount == count)
+          continue;
+        float cost = lcount * halfArea(mn, mx) + (count - lcount) * right_area[b+1];
+        if (cost < best_cost)
+        {
+          best_cost = cost;
+          best_split = b+1;
+        }
+      }
+      if (best_split < 0)
+        return 0;
+
+      std::vector<int>::iterator mid = std::partition(order.begin()+first, order.begin()+first+count, BinLess(&mCentroids[0], axis, cmin, scale, best_split));
+      return (int)(mid - (order.begin()+first));
+    }
+
+    struct BinLess
+    {
+      BinLess(const fvec3* c, int axis, float cmin, float scale, int split): mCentroids(c), mAxis(axis), mMin(cmin), mScale(scale), mSplit(split) {}
+      bool operator()(int i) const { return std::min(BinCount-1, (int)((mCentroids[i][mAxis] - mMin) * mScale)) < mSplit; }
+      const fvec3* mCentroids;
+      int mAxis;
+      float mMin;
+      float mScale;
+      int mSplit;
+    };
+
+  public:
+    std::vector<BVHNode>* mNodes;
+    std::vector<int>* mOrder;
+    std::vector<fvec3> mCentroids;
+    const fvec3* mBoxMin;
+    const fvec3* mBoxMax;
+    int mMaxLeafSize;
+  };
+}
+//-----------------------------------------------------------------------------
+void vl::buildBVH(std::vector<BVHNode>& nodes, std::vector<int>& order, const fvec3* box_min, const fvec3* box_max, int count, int max_leaf_size)
+{
+  nodes.clear();
+  order.resize(count);
+  if (count == 0)
+    return;
+
+  BVHBuilder builder;
+  builder.mNodes = &nodes;
+  builder.mOrder = &order;
+  builder.mBoxMin = box_min;
+  builder.mBoxMax = box_max;
+  builder.mMaxLeafSize = std::max(1, max_leaf_size);
+  builder.mCentroids.resize(count);
+  for(int i=0; i<count; ++i)
+  {
+    order[i] = i;
+    builder.mCentroids[i] = (box_min[i] + box_max[i]) * 0.5f;
+  }
+
+  nodes.reserve(2 * (count / builder.mMaxLeafSize + 1));
+  nodes.push_back(BVHNode());
+  builder.build(0, 0, count, 0);
+}
+//-----------------------------------------------------------------------------
+// TriangleBVH
+//-----------------------------------------------------------------------------
+TriangleBVH::TriangleBVH()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mGeometry = NULL;
+  mVertexArray = NULL;
+  mBoundsUpdateTick = -1;
+  mVertexCount = 0;
+  mDrawCallCount = 0;
+}
+//-----------------------------------------------------------------------------
+void TriangleBVH::clear()
+{
+  std::vector<fvec3>().swap(mPositions);
+  std::vector<Triangle>().swap(mTriangles);
+  std::vector<BVHNode>().swap(mNodes);
+  mGeometry = NULL;
+  mVertexArray = NULL;
+  mBoundsUpdateTick = -1;
+  mVertexCount = 0;
+  mDrawCallCount = 0;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::isUpToDate(const Geometry* geom) const
+{
+  const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(VA_Position) ? geom->vertexAttribArray(VA_Position)->data() : NULL;
+  return mGeometry == geom &&
+         mVertexArray == posarr &&
+         mVertexCount == (posarr ? (int)posarr->size() : 0) &&
+         mDrawCallCount == geom->drawCalls()->size() &&
+         mBoundsUpdateTick == geom->boundsUpdateTick();
+}
+//-----------------------------------------------------------------------------
+void TriangleBVH::build(const Geometry* geom)
+{
+  clear();
+
+  const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(VA_Position) ? geom->vertexAttribArray(VA_Position)->data() : NULL;
+  mGeometry = geom;
+  mVertexArray = posarr;
+  mVertexCount = posarr ? (int)posarr->size() : 0;
+  mDrawCallCount = geom->drawCalls()->size();
+  mBoundsUpdateTick = geom->boundsUpdateTick();
+  if (!posarr)
+    return;
+
+  mPositions.resize(mVertexCount);
+  for(int i=0; i<mVertexCount; ++i)
+    mPositions[i] = (fvec3)posarr->getAsVec3(i);
+
+  std::vector<Triangle> triangles;
+  for(int i=0; i<geom->drawCalls()->size(); ++i)
+  {
+    const DrawCall* dc = geom->drawCalls()->at(i);
+    int itri = 0;
+    for(TriangleIterator trit = dc->triangleIterator(); trit.hasNext(); trit.next(), ++itri)
+    {
+      Triangle tri;
+      tri.mA = trit.a();
+      tri.mB = trit.b();
+      tri.mC = trit.c();
+      tri.mDrawCall = i;
+      tri.mIndex = itri;
+      if (tri.mA < 0 || tri.mA >= mVertexCount || tri.mB < 0 || tri.mB >= mVertexCount || tri.mC < 0 || tri.mC >= mVertexCount)
+        continue;
+      triangles.push_back(tri);
+    }
+  }
+
+  std::vector<fvec3> box_min(triangles.size());
+  std::vector<fvec3> box_max(triangles.size());
+  for(size_t i=0; i<triangles.size(); ++i)
+  {
+    const fvec3& a = mPositions[triangles[i].mA];
+    const fvec3& b = mPositions[triangles[i].mB];
+    const fvec3& c = mPositions[triangles[i].mC];
+    box_min[i] = a;
+    box_max[i] = a;
+    growBox(box_min[i], box_max[i], b, b);
+    growBox(box_min[i], box_max[i], c, c);
+  }
+
+  std::vector<int> order;
+  if (!triangles.empty())
+    buildBVH(mNodes, order, &box_min[0], &box_max[0], (int)triangles.size());
+
+  // store the triangles in leaf order
+  mTriangles.resize(triangles.size());
+  for(size_t i=0; i<order.size(); ++i)
+    mTriangles[i] = triangles[order[i]];
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::intersectTriangle(const Triangle& tri, const fvec3& orig, const fvec3& dir, float& t) const
+{
+  // two sided Moller-Trumbore test
+  const fvec3& a = mPositions[tri.mA];
+  fvec3 e1 = mPositions[tri.mB] - a;
+  fvec3 e2 = mPositions[tri.mC] - a;
+  fvec3 p = cross(dir, e2);
+  float det = dot(e1, p);
+  if (det == 0)
+    return false;
+  float inv_det = 1.0f / det;
+  fvec3 s = orig - a;
+  float u = dot(s, p) * inv_det;
+  if (u < 0 || u > 1)
+    return false;
+  fvec3 q = cross(s, e1);
+  float v = dot(dir, q) * inv_det;
+  if (v < 0 || u + v > 1)
+    return false;
+  t = dot(e2, q) * inv_det;
+  return t >= 0;
+}
+//-----------------------------------------------------------------------------
+bool TriangleBVH::closestHit(const fvec3& orig, const fvec3& dir, float max_distance, Hit& hit) const
+{
+  if (mNodes.empty())
+    return false;
+
+  const fvec3 inv_dir = reciprocal(dir);
+  float best = max_distance;
+  bool found = false;
+  int stack[StackSize];
+  int top = 0;
+  stack[top++] = 0;
+  while(top)
+  {
+    const BVHNode& node = mNodes[stack[--top]];
+    float t_near;
+    if (!node.intersect(orig, inv_dir, best, t_near))
+      continue;
+    if (node.isLeaf())
+    {
+      for(int i=node.mIndex; i<node.mIndex+node.mCount; ++i)
+      {
+        float t;
+        if (intersectTriangle(mTriangles[i], orig, dir, t) && t < best)
+        {
+          best = t;
+          hit.mDistance = t;
+          hit.mTriangle = i;
+          found = true;
+        }
+      }
+    }
+    else
+    {
+      // visit the nearest child first
+      int left = (int)(&node - &mNodes[0]) + 1;
+      int right = node.mIndex;
+      float t_left = FLT_MAX, t_right = FLT_MAX;
+      bool hit_left  = mNodes[left].intersect(orig, inv_dir, best, t_left);
+      bool hit_right = mNodes[right].intersect(orig, inv_dir, best, t_right);
+      if (hit_left && hit_right)
+      {
+        stack[top++] = t_left < t_right ? right : left;
+        stack[top++] = t_left < t_right ? left : right;
+      }
+      else
+      if (hit_left)
+        stack[top++] = left;
+      else
+      if (hit_right)
+        stack[top++] = right;
+    }
+  }
+  return found;
+}
+//-----------------------------------------------------------------------------
+void TriangleBVH::allHits(const fvec3& orig, const fvec3& dir, std::vector<Hit>& hits) const
+{
+  if (mNodes.empty())
+    return;
+
+  const fvec3 inv_dir = reciprocal(dir);
+  int stack[StackSize];
+  int top = 0;
+  stack[top++] = 0;
+  while(top)
+  {
+    int inode = stack[--top];
+    const BVHNode& node = mNodes[inode];
+    float t_near;
+    if (!node.intersect(orig, inv_dir, FLT_MAX, t_near))
+      continue;
+    if (node.isLeaf())
+    {
+      for(int i=node.mIndex; i<node.mIndex+node.mCount; ++i)
+      {
+        Hit h;
+        if (intersectTriangle(mTriangles[i], orig, dir, h.mDistance))
+        {
+          h.mTriangle = i;
+          hits.push_back(h);
+        }
+      }
+    }
+    else
+    {
+      stack[top++] = node.mIndex;
+      stack[top++] = inode + 1;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
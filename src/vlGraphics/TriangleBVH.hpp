@@ -0,0 +1,166 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef TriangleBVH_INCLUDE_ONCE
+#define TriangleBVH_INCLUDE_ONCE
+
+#include <vlGraphics/link_config.hpp>
+#include <vlCore/Object.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace vl
+{
+  class Geometry;
+  class ArrayAbstract;
+
+  //-----------------------------------------------------------------------------
+  // BVHNode
+  //-----------------------------------------------------------------------------
+  /** A node of the flattened bounding volume hierarchies built by buildBVH().
+    * The left child of an inner node immediately follows its parent, the right child is at index mIndex.
+    * A leaf node references the mCount primitives starting at mIndex in the order computed by buildBVH(). */
+  struct BVHNode
+  {
+    fvec3 mMin;
+    int mIndex;
+    fvec3 mMax;
+    int mCount;
+
+    bool isLeaf() const { return mCount > 0; }
+
+    //! Slab test of the node's box against the ray \p orig + t * \p dir, \p inv_dir being the reciprocal of \p dir.
+    //! Returns true if the ray enters the box before \p max_t, in which case \p t_near is set to the entry distance.
+    bool intersect(const fvec3& orig, const fvec3& inv_dir, float max_t, float& t_near) const
+    {
+      float t0 = 0;
+      float t1 = max_t;
+      for(int i=0; i<3; ++i)
+      {
+        float ta = (mMin[i] - orig[i]) * inv_dir[i];
+        float tb = (mMax[i] - orig[i]) * inv_dir[i];
+        if (ta > tb)
+          std::swap(ta, tb);
+        // written so that NaNs, due to zero direction components on the box planes, do not reject the box
+        t0 = ta > t0 ? ta : t0;
+        t1 = tb < t1 ? tb : t1;
+        if (t0 > t1)
+          return false;
+      }
+      t_near = t0;
+      return true;
+    }
+  };
+
+  /** Builds a bounding volume hierarchy over \p count boxes using the surface area heuristic.
+    * \p nodes receives the hierarchy, node #0 being the root, and \p order the permutation of the boxes referenced by the leaves. */
+  VLGRAPHICS_EXPORT void buildBVH(std::vector<BVHNode>& nodes, std::vector<int>& order, const fvec3* box_min, const fvec3* box_max, int count, int max_leaf_size=4);
+
+  //-----------------------------------------------------------------------------
+  // TriangleBVH
+  //-----------------------------------------------------------------------------
+  /** A bounding volume hierarchy over the triangles of a Geometry, used to accelerate ray intersection queries.
+    *
+    * The vertex positions are copied at build time in object space, queries are performed in the Geometry's own
+    * coordinate system and are safe to be executed concurrently from multiple threads.
+    * Use Geometry::triangleBVH() to get a hierarchy that is automatically rebuilt when the Geometry changes.
+    * \sa Geometry::triangleBVH(), RayIntersector */
+  class VLGRAPHICS_EXPORT TriangleBVH: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::TriangleBVH, Object)
+
+  public:
+    //! A triangle of the hierarchy.
+    struct Triangle
+    {
+      //! The vertex indices of the triangle.
+      int mA, mB, mC;
+      //! The index of the DrawCall in Geometry::drawCalls() generating the triangle.
+      int mDrawCall;
+      //! The index of the triangle within its DrawCall, as enumerated by DrawCall::triangleIterator().
+      int mIndex;
+    };
+
+    //! A ray/triangle intersection.
+    struct Hit
+    {
+      Hit(): mDistance(0), mTriangle(-1) {}
+      //! The ray parameter of the intersection.
+      float mDistance;
+      //! The intersected triangle, see triangles().
+      int mTriangle;
+    };
+
+  public:
+    TriangleBVH();
+
+    //! Builds the hierarchy over the triangles of the given Geometry.
+    //! The Geometry's vertexArray() or the VA_Position vertex attribute array is used.
+    void build(const Geometry* geom);
+
+    //! Returns true if the hierarchy was built from the given Geometry and the Geometry has not changed since, see Renderable::boundsUpdateTick().
+    bool isUpToDate(const Geometry* geom) const;
+
+    //! Releases the memory used by the hierarchy.
+    void clear();
+
+    //! Computes the closest intersection between the ray \p orig + t * \p dir and the triangles, with 0 <= t < \p max_distance.
+    bool closestHit(const fvec3& orig, const fvec3& dir, float max_distance, Hit& hit) const;
+
+    //! Appends to \p hits all the intersections between the ray \p orig + t * \p dir and the triangles with t >= 0, in no particular order.
+    void allHits(const fvec3& orig, const fvec3& dir, std::vector<Hit>& hits) const;
+
+    //! The triangles of the hierarchy.
+    const std::vector<Triangle>& triangles() const { return mTriangles; }
+
+    //! The object space vertex positions referenced by the triangles.
+    const std::vector<fvec3>& positions() const { return mPositions; }
+
+    //! The nodes of the hierarchy.
+    const std::vector<BVHNode>& nodes() const { return mNodes; }
+
+  protected:
+    bool intersectTriangle(const Triangle& tri, const fvec3& orig, const fvec3& dir, float& t) const;
+
+  protected:
+    std::vector<fvec3> mPositions;
+    std::vector<Triangle> mTriangles;
+    std::vector<BVHNode> mNodes;
+    const Geometry* mGeometry;
+    const ArrayAbstract* mVertexArray;
+    long long mBoundsUpdateTick;
+    int mVertexCount;
+    int mDrawCallCount;
+  };
+}
+
+#endif
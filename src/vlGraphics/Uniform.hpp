@@ -34,6 +34,7 @@
 
 #include <vlCore/vlnamespace.hpp>
 #include <vlCore/Object.hpp>
+#include <vlCore/SlabAllocator.hpp>
 #include <vlCore/Vector4.hpp>
 #include <vlCore/Matrix4.hpp>
 #include <vlGraphics/OpenGL.hpp>
@@ -59,6 +60,7 @@ namespace vl
   class Uniform: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Uniform, Object)
+    VL_POOLED_ALLOCATION(vl::Uniform)
 
     friend class GLSLProgram;
 
@@ -289,6 +291,57 @@ namespace vl
 
     const void* rawData() const { if (mData.empty()) return NULL; else return &mData[0]; }
 
+  protected:
+    //! Uniform value storage: values up to a 4x4 float matrix are stored in place, bigger arrays are allocated on the heap.
+    class UniformData
+    {
+    public:
+      UniformData(): mPtr(mLocal.mInts), mSize(0), mCapacity(LocalCapacity) {}
+
+      UniformData(const UniformData& other): mPtr(mLocal.mInts), mSize(0), mCapacity(LocalCapacity) { *this = other; }
+
+      ~UniformData() { if (mPtr != mLocal.mInts) delete [] mPtr; }
+
+      UniformData& operator=(const UniformData& other)
+      {
+        if (this != &other)
+        {
+          resize(other.mSize);
+          if (mSize)
+            memcpy(mPtr, other.mPtr, sizeof(int) * mSize);
+        }
+        return *this;
+      }
+
+      void resize(size_t size)
+      {
+        if (size > mCapacity)
+        {
+          int* ptr = new int[size];
+          if (mSize)
+            memcpy(ptr, mPtr, sizeof(int) * mSize);
+          if (mPtr != mLocal.mInts)
+            delete [] mPtr;
+          mPtr = ptr;
+          mCapacity = size;
+        }
+        mSize = size;
+      }
+
+      size_t size() const { return mSize; }
+      bool empty() const { return mSize == 0; }
+      int& operator[](size_t i) { VL_CHECK(i < mSize); return mPtr[i]; }
+      const int& operator[](size_t i) const { VL_CHECK(i < mSize); return mPtr[i]; }
+
+    private:
+      enum { LocalCapacity = 16 };
+      // the double forces the alignment required by the double precision uniforms
+      union { int mInts[LocalCapacity]; double mAlign; } mLocal;
+      int* mPtr;
+      size_t mSize;
+      size_t mCapacity;
+    };
+
   protected:
     VL_COMPILE_TIME_CHECK( sizeof(int) == sizeof(float) )
     void initData(int count) { mData.resize(count); }
@@ -301,7 +354,7 @@ namespace vl
     const unsigned int* uintData() const { VL_CHECK(!mData.empty()); return (unsigned int*)&mData[0]; }
 
     EUniformType mType;
-    std::vector<int> mData;
+    UniformData mData;
     std::string mName;
   };
 }
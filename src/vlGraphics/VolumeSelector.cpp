@@ -0,0 +1,504 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/VolumeSelector.hpp>
+#include <vlGraphics/SceneManager.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <algorithm>
+#include <cfloat>
+
+using namespace vl;
+
+namespace
+{
+  const int StackSize = 128;
+
+  typedef enum { Outside, Partial, Inside } EClassification;
+
+  // the planes are in the form dot(xyz, p) + w, positive outside
+  EClassification classifyBox(const std::vector<fvec4>& planes, const fvec3& mn, const fvec3& mx)
+  {
+    bool inside = true;
+    for(size_t i=0; i<planes.size(); ++i)
+    {
+      const fvec4& p = planes[i];
+      float dmin = p.w(), dmax = p.w();
+      for(int k=0; k<3; ++k)
+      {
+        dmin += p[k] * (p[k] > 0 ? mn[k] : mx[k]);
+        dmax += p[k] * (p[k] > 0 ? mx[k] : mn[k]);
+      }
+      if (dmin > 0)
+        return Outside;
+      if (dmax > 0)
+        inside = false;
+    }
+    return inside ? Inside : Partial;
+  }
+
+  inline float planeDistance(const fvec4& p, const fvec3& v)
+  {
+    return p.x()*v.x() + p.y()*v.y() + p.z()*v.z() + p.w();
+  }
+
+  bool pointInPolygon(const std::vector<fvec2>& poly, const fvec2& p)
+  {
+    bool inside = false;
+    for(size_t i=0, j=poly.size()-1; i<poly.size(); j=i++)
+    {
+      if ( (poly[i].y() > p.y()) != (poly[j].y() > p.y()) &&
+           p.x() < (poly[j].x() - poly[i].x()) * (p.y() - poly[i].y()) / (poly[j].y() - poly[i].y()) + poly[i].x() )
+        inside = !inside;
+    }
+    return inside;
+  }
+
+  inline float orient(const fvec2& a, const fvec2& b, const fvec2& c)
+  {
+    return (b.x()-a.x())*(c.y()-a.y()) - (b.y()-a.y())*(c.x()-a.x());
+  }
+
+  bool segmentsIntersect(const fvec2& a, const fvec2& b, const fvec2& c, const fvec2& d)
+  {
+    float o1 = orient(a, b, c), o2 = orient(a, b, d);
+    float o3 = orient(c, d, a), o4 = orient(c, d, b);
+    return ((o1 > 0) != (o2 > 0)) && ((o3 > 0) != (o4 > 0));
+  }
+
+  bool pointInTriangle(const fvec2* t, const fvec2& p)
+  {
+    float d0 = orient(t[0], t[1], p), d1 = orient(t[1], t[2], p), d2 = orient(t[2], t[0], p);
+    return (d0 >= 0 && d1 >= 0 && d2 >= 0) || (d0 <= 0 && d1 <= 0 && d2 <= 0);
+  }
+
+  // true if the triangle p[3] in viewport coordinates touches the polygon, or lies inside it if contained_only is true
+  bool lassoSelectsTriangle(const std::vector<fvec2>& poly, const fvec2* p, bool contained_only)
+  {
+    if (contained_only)
+      return pointInPolygon(poly, p[0]) && pointInPolygon(poly, p[1]) && pointInPolygon(poly, p[2]);
+
+    if (pointInPolygon(poly, p[0]) || pointInPolygon(poly, p[1]) || pointInPolygon(poly, p[2]) || pointInTriangle(p, poly[0]))
+      return true;
+    for(size_t i=0, j=poly.size()-1; i<poly.size(); j=i++)
+      for(int k=0; k<3; ++k)
+        if (segmentsIntersect(p[k], p[(k+1)%3], poly[j], poly[i]))
+          return true;
+    return false;
+  }
+
+  // lasso test of the projection of a box, returns -1 if the box crosses the plane of the camera
+  int lassoSelectsBox(const std::vector<fvec2>& poly, const mat4& world_to_viewport, const AABB& aabb, bool contained_only)
+  {
+    const vec3& mn = aabb.minCorner();
+    const vec3& mx = aabb.maxCorner();
+    fvec2 p[8];
+    for(int i=0; i<8; ++i)
+    {
+      vec4 c = world_to_viewport * vec4(i & 1 ? mx.x() : mn.x(), i & 2 ? mx.y() : mn.y(), i & 4 ? mx.z() : mn.z(), 1);
+      if (c.w() <= 0)
+        return -1;
+      p[i] = fvec2((float)(c.x() / c.w()), (float)(c.y() / c.w()));
+    }
+
+    if (contained_only)
+    {
+      for(int i=0; i<8; ++i)
+        if (!pointInPolygon(poly, p[i]))
+          return 0;
+      return 1;
+    }
+
+    // the projection of the box is the union of the projections of its faces
+    const int faces[6][4] = { {0,1,3,2}, {4,5,7,6}, {0,1,5,4}, {2,3,7,6}, {0,2,6,4}, {1,3,7,5} };
+    for(int f=0; f<6; ++f)
+    {
+      const fvec2 t0[] = { p[faces[f][0]], p[faces[f][1]], p[faces[f][2]] };
+      const fvec2 t1[] = { p[faces[f][0]], p[faces[f][2]], p[faces[f][3]] };
+      if (lassoSelectsTriangle(poly, t0, false) || lassoSelectsTriangle(poly, t1, false))
+        return 1;
+    }
+    return 0;
+  }
+
+  //-----------------------------------------------------------------------------
+  class SelectTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int i=begin; i<end; ++i)
+      {
+        if ((*mSelected)[i] >= 0)
+          continue;
+        const VolumeSelector::Candidate& cand = (*mCandidates)[i];
+        std::vector<int>* out = mCollect ? &(*mTriangles)[i] : NULL;
+        (*mSelected)[i] = select(cand, out) ? 1 : 0;
+      }
+    }
+
+    bool select(const VolumeSelector::Candidate& cand, std::vector<int>* out) const
+    {
+      const std::vector<BVHNode>& nodes = cand.mBVH->nodes();
+      int stack[StackSize];
+      int top = 0;
+      stack[top++] = 0;
+      while(top)
+      {
+        int inode = stack[--top];
+        const BVHNode& node = nodes[inode];
+        EClassification cls = classifyBox(cand.mPlanes, node.mMin, node.mMax);
+        // a concave lasso can't guarantee that a node inside its bounding frustum is inside the polygon
+        if (cls == Inside && mLasso)
+          cls = Partial;
+
+        if (cls == Outside)
+        {
+          if (mContainedOnly && !out)
+            return false;
+        }
+        else
+        if (cls == Inside)
+        {
+          if (!out)
+          {
+            if (!mContainedOnly)
+              return true;
+          }
+          else
+          {
+            // the triangles of a subtree are contiguous
+            int first = inode, last = inode;
+            while(!nodes[first].isLeaf())
+              first = first + 1;
+            while(!nodes[last].isLeaf())
+              last = nodes[last].mIndex;
+            for(int t=nodes[first].mIndex; t<nodes[last].mIndex+nodes[last].mCount; ++t)
+              out->push_back(t);
+          }
+        }
+        else
+        if (node.isLeaf())
+        {
+          for(int t=node.mIndex; t<node.mIndex+node.mCount; ++t)
+          {
+            bool sel = selectTriangle(cand, cand.mBVH->triangles()[t]);
+            if (out)
+            {
+              if (sel)
+                out->push_back(t);
+            }
+            else
+            if (sel != mContainedOnly)
+              return sel;
+          }
+        }
+        else
+        {
+          stack[top++] = node.mIndex;
+          stack[top++] = inode + 1;
+        }
+      }
+      return out ? !out->empty() : mContainedOnly;
+    }
+
+    bool selectTriangle(const VolumeSelector::Candidate& cand, const TriangleBVH::Triangle& tri) const
+    {
+      const std::vector<fvec3>& pos = cand.mBVH->positions();
+      const fvec3 v[] = { pos[tri.mA], pos[tri.mB], pos[tri.mC] };
+
+      if (mContainedOnly)
+      {
+        for(size_t i=0; i<cand.mPlanes.size(); ++i)
+          for(int k=0; k<3; ++k)
+            if (planeDistance(cand.mPlanes[i], v[k]) > 0)
+              return false;
+      }
+      else
+      {
+        // separated by one of the planes of the volume
+        for(size_t i=0; i<cand.mPlanes.size(); ++i)
+          if (planeDistance(cand.mPlanes[i], v[0]) > 0 && planeDistance(cand.mPlanes[i], v[1]) > 0 && planeDistance(cand.mPlanes[i], v[2]) > 0)
+            return false;
+        // separated by the plane of the triangle
+        if (mHasCorners)
+        {
+          fvec3 n = cross(v[1]-v[0], v[2]-v[0]);
+          int pos = 0, neg = 0;
+          for(int k=0; k<8; ++k)
+          {
+            float d = dot(n, cand.mCorners[k]-v[0]);
+            pos += d > 0 ? 1 : 0;
+            neg += d < 0 ? 1 : 0;
+          }
+          if (pos == 8 || neg == 8)
+            return false;
+        }
+      }
+
+      if (!mLasso)
+        return true;
+
+      // lasso test in viewport coordinates
+      fvec2 p[3];
+      for(int k=0; k<3; ++k)
+      {
+        fvec4 c = cand.mObjectToViewport * fvec4(v[k], 1);
+        // vertices behind the camera: the plane tests above are the best we can do
+        if (c.w() <= 0)
+          return !mContainedOnly;
+        p[k] = fvec2(c.x() / c.w(), c.y() / c.w());
+      }
+
+      return lassoSelectsTriangle(*mLasso, p, mContainedOnly);
+    }
+
+  public:
+    const std::vector<VolumeSelector::Candidate>* mCandidates;
+    std::vector< std::vector<int> >* mTriangles;
+    std::vector<char>* mSelected;
+    const std::vector<fvec2>* mLasso;
+    bool mContainedOnly;
+    bool mHasCorners;
+    bool mCollect;
+  };
+}
+//-----------------------------------------------------------------------------
+// VolumeSelector
+//-----------------------------------------------------------------------------
+VolumeSelector::VolumeSelector()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mHasCorners = false;
+  mContainedOnly = false;
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::setFrustum(const Frustum& frustum)
+{
+  mFrustum = frustum;
+  mHasCorners = false;
+  mLasso.clear();
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::setAABB(const AABB& aabb)
+{
+  const vec3& mn = aabb.minCorner();
+  const vec3& mx = aabb.maxCorner();
+  mFrustum.planes().clear();
+  mFrustum.planes().push_back( Plane(mn, vec3(-1, 0, 0)) );
+  mFrustum.planes().push_back( Plane(mn, vec3( 0,-1, 0)) );
+  mFrustum.planes().push_back( Plane(mn, vec3( 0, 0,-1)) );
+  mFrustum.planes().push_back( Plane(mx, vec3(+1, 0, 0)) );
+  mFrustum.planes().push_back( Plane(mx, vec3( 0,+1, 0)) );
+  mFrustum.planes().push_back( Plane(mx, vec3( 0, 0,+1)) );
+  vec3 corners[8];
+  for(int i=0; i<8; ++i)
+    corners[i] = vec3(i & 1 ? mx.x() : mn.x(), i & 2 ? mx.y() : mn.y(), i & 4 ? mx.z() : mn.z());
+  setCorners(corners);
+  mLasso.clear();
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::setRectangle(Camera* camera, int x0, int y0, int x1, int y1)
+{
+  // same growth of computeRectFrustum() so that the corners match the planes
+  if (x0 == x1)
+  {
+    --x0;
+    ++x1;
+  }
+  if (y0 == y1)
+  {
+    --y0;
+    ++y1;
+  }
+  mFrustum = camera->computeRectFrustum(x0, y0, x1, y1);
+  vec3 corners[8];
+  for(int i=0; i<8; ++i)
+  {
+    vec4 c;
+    camera->unproject( vec3((real)(i & 1 ? x1 : x0), (real)(i & 2 ? y1 : y0), (real)(i & 4 ? 1 : 0)), c );
+    corners[i] = c.xyz();
+  }
+  setCorners(corners);
+  mLasso.clear();
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::setLasso(Camera* camera, const std::vector<fvec2>& polygon)
+{
+  if (polygon.size() < 3)
+  {
+    Log::error("VolumeSelector::setLasso(): the polygon must have at least 3 vertices.\n");
+    return;
+  }
+
+  float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+  for(size_t i=0; i<polygon.size(); ++i)
+  {
+    x0 = std::min(x0, polygon[i].x());
+    y0 = std::min(y0, polygon[i].y());
+    x1 = std::max(x1, polygon[i].x());
+    y1 = std::max(y1, polygon[i].y());
+  }
+  setRectangle(camera, (int)floor(x0), (int)floor(y0), (int)ceil(x1), (int)ceil(y1));
+  mLasso = polygon;
+
+  // maps world coordinates to homogeneous viewport coordinates
+  const Viewport* viewport = camera->viewport();
+  mat4 ndc_to_viewport;
+  ndc_to_viewport.e(0,0) = viewport->width()  * (real)0.5;
+  ndc_to_viewport.e(0,3) = viewport->width()  * (real)0.5 + viewport->x();
+  ndc_to_viewport.e(1,1) = viewport->height() * (real)0.5;
+  ndc_to_viewport.e(1,3) = viewport->height() * (real)0.5 + viewport->y();
+  mViewportMatrix = ndc_to_viewport * camera->projectionMatrix() * camera->viewMatrix();
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::setCorners(const vec3* corners)
+{
+  for(int i=0; i<8; ++i)
+    mCorners[i] = corners[i];
+  mHasCorners = true;
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::prepare(const ActorCollection& actors)
+{
+  std::vector<fvec4> world_planes(mFrustum.planes().size());
+  for(size_t i=0; i<world_planes.size(); ++i)
+    world_planes[i] = fvec4((fvec3)mFrustum.planes()[i].normal(), (float)-mFrustum.planes()[i].origin());
+
+  mCandidates.resize(actors.size());
+  mSelected.resize(actors.size());
+  mTriangles.resize(actors.size());
+  for(int i=0; i<actors.size(); ++i)
+  {
+    Candidate& cand = mCandidates[i];
+    cand.mActor = const_cast<Actor*>(actors.at(i));
+    cand.mGeometry = cast<Geometry>(cand.mActor->lod(0));
+    cand.mBVH = NULL;
+    mTriangles[i].clear();
+
+    // decide using the bounds if possible
+    const AABB& aabb = cand.mActor->boundingBox();
+    EClassification cls = aabb.isNull() ? Outside : classifyBox(world_planes, (fvec3)aabb.minCorner(), (fvec3)aabb.maxCorner());
+    if (cls == Outside || !cand.mGeometry || cand.mGeometry->triangleBVH()->triangles().empty())
+    {
+      mSelected[i] = cls == Inside || (cls == Partial && !mContainedOnly) ? 1 : 0;
+      // the frustum of a lasso is the one of its bounding rectangle: test the projected bounds against the polygon
+      if (cls != Outside && !mLasso.empty())
+      {
+        int lasso = lassoSelectsBox(mLasso, mViewportMatrix, aabb, mContainedOnly);
+        if (lasso >= 0)
+          mSelected[i] = (char)lasso;
+      }
+      continue;
+    }
+    cand.mBVH = cand.mGeometry->triangleBVH();
+    mSelected[i] = -1;
+
+    // transform the volume in object space
+    if (cand.mActor->transform())
+    {
+      const mat4& world = cand.mActor->transform()->worldMatrix();
+      mat4 world_t = world.getTransposed();
+      cand.mPlanes.resize(world_planes.size());
+      for(size_t j=0; j<world_planes.size(); ++j)
+        cand.mPlanes[j] = (fvec4)(world_t * (vec4)world_planes[j]);
+      mat4 inverse = world.getInverse();
+      for(int j=0; j<8; ++j)
+        cand.mCorners[j] = (fvec3)(inverse * mCorners[j]);
+      cand.mObjectToViewport = (fmat4)(mViewportMatrix * world);
+    }
+    else
+    {
+      cand.mPlanes = world_planes;
+      for(int j=0; j<8; ++j)
+        cand.mCorners[j] = (fvec3)mCorners[j];
+      cand.mObjectToViewport = (fmat4)mViewportMatrix;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::run(bool collect_triangles)
+{
+  SelectTask task;
+  task.mCandidates    = &mCandidates;
+  task.mTriangles     = &mTriangles;
+  task.mSelected      = &mSelected;
+  task.mLasso         = mLasso.empty() ? NULL : &mLasso;
+  task.mContainedOnly = mContainedOnly;
+  task.mHasCorners    = mHasCorners;
+  task.mCollect       = collect_triangles;
+  parallelFor(0, (int)mCandidates.size(), &task);
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::selectActors(SceneManager* scene_manager, ActorCollection& selected)
+{
+  ActorCollection candidates;
+  scene_manager->extractActorsInFrustum(candidates, frustum());
+  selectActors(candidates, selected);
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::selectActors(const ActorCollection& actors, ActorCollection& selected)
+{
+  prepare(actors);
+  run(false);
+  for(size_t i=0; i<mCandidates.size(); ++i)
+    if (mSelected[i] > 0)
+      selected.push_back(mCandidates[i].mActor);
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::selectTriangles(SceneManager* scene_manager, std::vector<TriangleSelection>& selected)
+{
+  ActorCollection candidates;
+  scene_manager->extractActorsInFrustum(candidates, frustum());
+  selectTriangles(candidates, selected);
+}
+//-----------------------------------------------------------------------------
+void VolumeSelector::selectTriangles(const ActorCollection& actors, std::vector<TriangleSelection>& selected)
+{
+  prepare(actors);
+  // Actor[s] decided by their bounds must be traversed anyway to collect their triangles
+  for(size_t i=0; i<mCandidates.size(); ++i)
+    if (mSelected[i] > 0 && mCandidates[i].mGeometry && !mCandidates[i].mBVH)
+      mSelected[i] = 0;
+  run(true);
+
+  selected.clear();
+  for(size_t i=0; i<mCandidates.size(); ++i)
+  {
+    if (mSelected[i] <= 0 || mTriangles[i].empty())
+      continue;
+    selected.push_back(TriangleSelection());
+    selected.back().mActor = mCandidates[i].mActor;
+    selected.back().mGeometry = mCandidates[i].mGeometry;
+    selected.back().mTriangles.swap(mTriangles[i]);
+  }
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef VolumeSelector_INCLUDE_ONCE
+#define VolumeSelector_INCLUDE_ONCE
+
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <vlGraphics/Frustum.hpp>
+#include <vlCore/Vector2.hpp>
+#include <vlCore/Matrix4.hpp>
+
+namespace vl
+{
+  class Camera;
+  class SceneManager;
+
+  //-----------------------------------------------------------------------------
+  // VolumeSelector
+  //-----------------------------------------------------------------------------
+  /** The VolumeSelector class selects the Actor[s] and the triangles contained in, or touching, a volume.
+   *
+   * The selection volume can be a screen rectangle (rubber-band selection), a screen polygon (lasso selection),
+   * an arbitrary convex Frustum or an AABB. The queries are performed in two phases:
+   * - broad phase: the candidate Actor[s] are extracted using SceneManager::extractActorsInFrustum(), which uses the
+   *   scene manager's own tree (see ActorTree, ActorKdTree, ActorBoundsTable) to cull whole branches of the scene.
+   * - narrow phase: the triangles of each candidate are tested, in parallel across the Actor[s], traversing the
+   *   hierarchy returned by Geometry::triangleBVH() in the Actor's object space.
+   *
+   * When containedOnly() is \p false (default) an Actor or triangle is selected if it touches the volume, otherwise it must lie
+   * entirely inside of it. The touching test of a triangle against a Frustum or AABB is conservative: a triangle passing very close
+   * to an edge of the volume might be selected even if it does not actually touch it.
+   *
+   * Actor[s] whose lod(0) is not a Geometry are selected according to their bounding box. For lasso selections the projection
+   * of the bounding box is tested against the polygon, unless the box crosses the plane of the camera.
+   * \note As for RayIntersector the transforms and the bounds of the Actor[s] must be up to date and the selection is done on LOD #0.
+   * \sa RayIntersector, Camera::computeRectFrustum()
+   */
+  class VLGRAPHICS_EXPORT VolumeSelector: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VolumeSelector, Object)
+
+  public:
+    //! The triangles selected from an Actor, see selectTriangles().
+    struct TriangleSelection
+    {
+      TriangleSelection(): mActor(NULL), mGeometry(NULL) {}
+      //! The selected Actor.
+      Actor* mActor;
+      //! The Actor's lod(0) Geometry.
+      Geometry* mGeometry;
+      //! The indices of the selected triangles in mGeometry->triangleBVH()->triangles(), see TriangleBVH::Triangle.
+      std::vector<int> mTriangles;
+    };
+
+  public:
+    VolumeSelector();
+
+    //! Selects using the given convex volume in world coordinates, the plane normals pointing outside.
+    void setFrustum(const Frustum& frustum);
+
+    //! Selects using the given box in world coordinates.
+    void setAABB(const AABB& aabb);
+
+    //! Selects using a rectangle in viewport coordinates, see Camera::computeRectFrustum().
+    void setRectangle(Camera* camera, int x0, int y0, int x1, int y1);
+
+    //! Selects using a polygon in viewport coordinates, with the same conventions used by Camera::computeRay(). The polygon can be concave.
+    void setLasso(Camera* camera, const std::vector<fvec2>& polygon);
+
+    //! The convex volume used by the selection. For lasso selections it's the frustum of the polygon's bounding rectangle.
+    const Frustum& frustum() const { return mFrustum; }
+
+    //! If true the Actor[s] and triangles are selected only if they are completely inside the selection volume (default is false).
+    void setContainedOnly(bool contained) { mContainedOnly = contained; }
+
+    //! If true the Actor[s] and triangles are selected only if they are completely inside the selection volume (default is false).
+    bool containedOnly() const { return mContainedOnly; }
+
+    //! Appends to \p selected the Actor[s] of the given SceneManager selected by the volume.
+    void selectActors(SceneManager* scene_manager, ActorCollection& selected);
+
+    //! Appends to \p selected the Actor[s] of \p actors selected by the volume.
+    void selectActors(const ActorCollection& actors, ActorCollection& selected);
+
+    //! Computes the triangles of the Actor[s] of the given SceneManager selected by the volume. Only the Actor[s] with at least one selected triangle are returned.
+    void selectTriangles(SceneManager* scene_manager, std::vector<TriangleSelection>& selected);
+
+    //! Computes the triangles of the given Actor[s] selected by the volume. Only the Actor[s] with at least one selected triangle are returned.
+    void selectTriangles(const ActorCollection& actors, std::vector<TriangleSelection>& selected);
+
+  public:
+    //! The selection volume in the object space of an Actor.
+    struct Candidate
+    {
+      Actor* mActor;
+      Geometry* mGeometry;
+      const TriangleBVH* mBVH;
+      std::vector<fvec4> mPlanes;
+      fvec3 mCorners[8];
+      fmat4 mObjectToViewport;
+    };
+
+  protected:
+    void setCorners(const vec3* corners);
+    void prepare(const ActorCollection& actors);
+    void run(bool collect_triangles);
+
+  protected:
+    Frustum mFrustum;
+    vec3 mCorners[8];
+    bool mHasCorners;
+    std::vector<fvec2> mLasso;
+    mat4 mViewportMatrix;
+    std::vector<Candidate> mCandidates;
+    std::vector< std::vector<int> > mTriangles;
+    std::vector<char> mSelected;
+    bool mContainedOnly;
+  };
+}
+
+#endif
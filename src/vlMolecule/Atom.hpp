@@ -69,7 +69,7 @@ namespace vl
 
     Atom(const Atom& other): Object(other) { *this = other; }
 
-    //! Assignment operator: does not assign the adjacent atoms
+    //! Assignment operator
     Atom& operator=(const Atom& other)
     {
       mId       = other.mId;
@@ -79,24 +79,11 @@ namespace vl
       mColor    = other.mColor;
       mVisible  = other.mVisible;
       mShowAtomName= other.mShowAtomName;
-      // mAdjacentAtoms = other.mAdjacentAtoms; // do not copy
       // mVisited = other.mVisited;             // do not copy
       mAtomName = other.mAtomName;
       return *this;
     }
 
-    // Returns true if \p atom is adjacent to an Atom
-    bool isAtomAdjacent(Atom* atom) const
-    {
-      for(unsigned i=0; i<adjacentAtoms().size(); ++i)
-        if (adjacentAtoms()[i] == atom)
-          return true;
-      return false;
-    }
-
-    const std::vector< Atom* >& adjacentAtoms() const { return mAdjacentAtoms; }
-    std::vector< Atom* >& adjacentAtoms() { return mAdjacentAtoms; }
-
     EAtomType atomType() const { return mAtomType; }
     void setAtomType(EAtomType type) { mAtomType = type; }
 
@@ -131,7 +118,6 @@ namespace vl
     fvec3 mCoordinates;
     EAtomType mAtomType;
     float mRadius;
-    std::vector< Atom* > mAdjacentAtoms;
     std::string mAtomName;
     unsigned int mId;
     // Aid to visit a molecule.
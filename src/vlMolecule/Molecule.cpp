@@ -31,6 +31,7 @@
 
 #include <vlMolecule/Molecule.hpp>
 #include <vlMolecule/RingExtractor.hpp>
+#include <vlCore/AABB.hpp>
 
 using namespace vl;
 
@@ -50,6 +51,7 @@ Molecule::Molecule():
 void Molecule::reset()
 {
   mMoleculeStyle = MS_BallAndStick;
+  mRenderMode = MRM_Actors;
   mBondDetail = 20;
   mAtomDetail = 2;
   mRingOffset = 0.45f;
@@ -71,6 +73,20 @@ void Molecule::reset()
   mActorToAtomMap.clear();
   mBondToActorMap.clear();
   mActorToBondMap.clear();
+  // atom adjacency
+  mAdjacencyOffsets.clear();
+  mAdjacentAtoms.clear();
+  mAdjacentBonds.clear();
+  mAtomIndexTable.clear();
+  mAdjacencyBondCount = 0;
+  mAtomAdjacencyDirty = true;
+  // instance maps
+  mAtomsGeometry = NULL;
+  mBondsGeometry = NULL;
+  mAtomInstances.clear();
+  mBondInstances.clear();
+  mAtomInstanceVertexCount = 0;
+  mBondInstanceVertexCount = 0;
 }
 //-----------------------------------------------------------------------------
 Molecule& Molecule::operator=(const Molecule& other)
@@ -81,6 +97,7 @@ Molecule& Molecule::operator=(const Molecule& other)
   mMoleculeName  = other.mMoleculeName;
   *mTags         = *other.mTags;
   mMoleculeStyle = other.mMoleculeStyle;
+  mRenderMode    = other.mRenderMode;
   mAtomDetail    = other.mAtomDetail;
   mBondDetail    = other.mBondDetail;
   mRingOffset    = other.mRingOffset;
@@ -120,6 +137,7 @@ void Molecule::addAtom(Atom* atom)
 { 
   prepareAtomInsert();
   atoms().push_back(atom); 
+  mAtomAdjacencyDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Molecule::eraseAllAtoms()
@@ -127,6 +145,7 @@ void Molecule::eraseAllAtoms()
   mAtoms.clear();
   mBonds.clear();
   mCycles.clear();
+  mAtomAdjacencyDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Molecule::eraseAtom(int i)
@@ -136,6 +155,7 @@ void Molecule::eraseAtom(int i)
   for(unsigned j=0; j<incident_bonds.size(); ++j)
     eraseBond( incident_bonds[j] );
   atoms().erase(atoms().begin() + i);
+  mAtomAdjacencyDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Molecule::eraseAtom(Atom*a)
@@ -149,6 +169,7 @@ void Molecule::eraseAtom(Atom*a)
       for(unsigned j=0; j<incident_bonds.size(); ++j)
         eraseBond( incident_bonds[j] );
       atoms().erase(atoms().begin() + i);
+      mAtomAdjacencyDirty = true;
       return;
     }
   }
@@ -161,6 +182,7 @@ Bond* Molecule::addBond(Atom* a1, Atom* a2)
   bond->setAtom1(a1);
   bond->setAtom2(a2);
   bonds().push_back(bond);
+  mAtomAdjacencyDirty = true;
   return bond.get();
 }
 //-----------------------------------------------------------------------------
@@ -170,6 +192,17 @@ Bond* Molecule::bond(int index) { return mBonds[index].get(); }
 //-----------------------------------------------------------------------------
 const Bond* Molecule::bond(Atom* a1, Atom* a2) const
 {
+  if (!isAtomAdjacencyDirty())
+  {
+    int i1 = atomIndex(a1);
+    int i2 = atomIndex(a2);
+    if (i1 == -1 || i2 == -1)
+      return NULL;
+    for(int i=0; i<adjacentAtomCount(i1); ++i)
+      if (adjacentAtoms(i1)[i] == i2)
+        return bond(adjacentBonds(i1)[i]);
+    return NULL;
+  }
   for(unsigned i=0; i<bonds().size(); ++i)
     if ( (bond(i)->atom1() == a1 && bond(i)->atom2() == a2) || (bond(i)->atom1() == a2 && bond(i)->atom2() == a1) )
       return bonds()[i].get();
@@ -178,16 +211,14 @@ const Bond* Molecule::bond(Atom* a1, Atom* a2) const
 //-----------------------------------------------------------------------------
 Bond* Molecule::bond(Atom* a1, Atom* a2)
 {
-  for(unsigned i=0; i<bonds().size(); ++i)
-    if ( (bond(i)->atom1() == a1 && bond(i)->atom2() == a2) || (bond(i)->atom1() == a2 && bond(i)->atom2() == a1) )
-      return bonds()[i].get();
-  return NULL;
+  return const_cast<Bond*>( static_cast<const Molecule*>(this)->bond(a1, a2) );
 }
 //-----------------------------------------------------------------------------
 void Molecule::addBond(Bond* bond) 
 { 
   prepareBondInsert();
   bonds().push_back(bond); 
+  mAtomAdjacencyDirty = true;
 }
 //-----------------------------------------------------------------------------
 void Molecule::eraseBond(Bond*b)
@@ -197,14 +228,23 @@ void Molecule::eraseBond(Bond*b)
     if (bond(i) == b)
     {
       bonds().erase(bonds().begin() + i);
+      mAtomAdjacencyDirty = true;
       return;
     }
   }
 }
 //-----------------------------------------------------------------------------
-void Molecule::eraseBond(int bond) { bonds().erase(bonds().begin() + bond); }
+void Molecule::eraseBond(int bond) 
+{ 
+  bonds().erase(bonds().begin() + bond); 
+  mAtomAdjacencyDirty = true;
+}
 //-----------------------------------------------------------------------------
-void Molecule::eraseAllBonds() { bonds().clear(); }
+void Molecule::eraseAllBonds() 
+{ 
+  bonds().clear(); 
+  mAtomAdjacencyDirty = true;
+}
 //-----------------------------------------------------------------------------
 void Molecule::eraseBond(Atom* a1, Atom* a2)
 {
@@ -214,6 +254,7 @@ void Molecule::eraseBond(Atom* a1, Atom* a2)
          (bond(i)->atom1() == a2 && bond(i)->atom2() == a1) )
     {
       bonds().erase(bonds().begin() + i);
+      mAtomAdjacencyDirty = true;
       return;
     }
   }
@@ -223,23 +264,188 @@ void Molecule::eraseBond(int a1, int a2) { eraseBond(atom(a1), atom(a2)); }
 //-----------------------------------------------------------------------------
 void Molecule::computeAtomAdjacency()
 {
+  // atom -> index lookup table
+  mAtomIndexTable.resize(atoms().size());
   for(int i=0; i<atomCount(); ++i)
-    atom(i)->adjacentAtoms().clear();
+    mAtomIndexTable[i] = std::pair<const Atom*, int>(atom(i), i);
+  std::sort(mAtomIndexTable.begin(), mAtomIndexTable.end());
+  mAtomAdjacencyDirty = false;
+  mAdjacencyBondCount = bondCount();
+
+  // bond -> atom indices, bonds whose atoms are not part of the molecule are ignored
+  std::vector<int> bond_atoms(bondCount()*2);
+  mAdjacencyOffsets.assign(atomCount()+1, 0);
   for(int i=0; i<bondCount(); ++i)
   {
-    bond(i)->atom1()->adjacentAtoms().push_back( bond(i)->atom2() );
-    bond(i)->atom2()->adjacentAtoms().push_back( bond(i)->atom1() );
+    int i1 = atomIndex(bond(i)->atom1());
+    int i2 = atomIndex(bond(i)->atom2());
+    if (i1 == -1 || i2 == -1 || i1 == i2)
+      i1 = i2 = -1;
+    else
+    {
+      ++mAdjacencyOffsets[i1+1];
+      ++mAdjacencyOffsets[i2+1];
+    }
+    bond_atoms[i*2+0] = i1;
+    bond_atoms[i*2+1] = i2;
+  }
+
+  // compressed sparse rows
+  for(int i=0; i<atomCount(); ++i)
+    mAdjacencyOffsets[i+1] += mAdjacencyOffsets[i];
+  mAdjacentAtoms.resize(mAdjacencyOffsets.back());
+  mAdjacentBonds.resize(mAdjacencyOffsets.back());
+  std::vector<int> fill(mAdjacencyOffsets.begin(), mAdjacencyOffsets.end()-1);
+  for(int i=0; i<bondCount(); ++i)
+  {
+    int i1 = bond_atoms[i*2+0];
+    int i2 = bond_atoms[i*2+1];
+    if (i1 != -1)
+    {
+      mAdjacentAtoms[fill[i1]] = i2;
+      mAdjacentBonds[fill[i1]++] = i;
+      mAdjacentAtoms[fill[i2]] = i1;
+      mAdjacentBonds[fill[i2]++] = i;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+bool Molecule::isAtomAdjacent(int iatom1, int iatom2) const
+{
+  for(int i=0; i<adjacentAtomCount(iatom1); ++i)
+    if (adjacentAtoms(iatom1)[i] == iatom2)
+      return true;
+  return false;
+}
+//-----------------------------------------------------------------------------
+int Molecule::atomIndex(const Atom* atom) const
+{
+  if (!isAtomAdjacencyDirty())
+  {
+    std::vector< std::pair<const Atom*, int> >::const_iterator it = std::lower_bound(mAtomIndexTable.begin(), mAtomIndexTable.end(), std::pair<const Atom*, int>(atom, -1));
+    return it != mAtomIndexTable.end() && it->first == atom ? it->second : -1;
   }
+  for(int i=0; i<atomCount(); ++i)
+    if (mAtoms[i].get() == atom)
+      return i;
+  return -1;
 }
 //-----------------------------------------------------------------------------
 void Molecule::incidentBonds(std::vector<Bond*>& incident_bonds, Atom* atom)
 {
   incident_bonds.clear();
+  if (!isAtomAdjacencyDirty())
+  {
+    int iatom = atomIndex(atom);
+    if (iatom != -1)
+    {
+      for(int i=0; i<adjacentAtomCount(iatom); ++i)
+        incident_bonds.push_back( bond(adjacentBonds(iatom)[i]) );
+    }
+    return;
+  }
   for(int i=0; i<bondCount(); ++i)
     if(bond(i)->atom1() == atom || bond(i)->atom2() == atom)
       incident_bonds.push_back( bond(i) );
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  inline unsigned int gridHash(int x, int y, int z)
+  {
+    return ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u);
+  }
+}
+//-----------------------------------------------------------------------------
+int Molecule::computeBonds(float tolerance, float min_distance)
+{
+  if (atoms().empty())
+    return 0;
+
+  if (isAtomAdjacencyDirty())
+    computeAtomAdjacency();
+
+  // covalent radii and bounds
+  std::vector<float> radii(atoms().size());
+  float max_radius = 0;
+  AABB aabb;
+  for(int i=0; i<atomCount(); ++i)
+  {
+    double r = atomInfo(atom(i)->atomType()).covalentRadius();
+    if (r <= 0)
+      r = atomInfo(AT_Carbon).covalentRadius();
+    radii[i] = (float)r;
+    max_radius = std::max(max_radius, radii[i]);
+    aabb.addPoint((vec3)atom(i)->coordinates());
+  }
+
+  // spatial hash: the atoms are sorted by the hash of their cell, a table twice as large as the atom count keeps the collisions low
+  const float cell_size = 2*max_radius + tolerance;
+  const fvec3 origin = (fvec3)aabb.minCorner();
+  unsigned int table_size = 1;
+  while(table_size < atoms().size()*2)
+    table_size <<= 1;
+  const unsigned int mask = table_size - 1;
+  std::vector<ivec3> cells(atoms().size());
+  std::vector<unsigned int> atom_bucket(atoms().size());
+  std::vector<int> bucket_start(table_size+1, 0);
+  for(int i=0; i<atomCount(); ++i)
+  {
+    fvec3 p = (atom(i)->coordinates() - origin) / cell_size;
+    cells[i] = ivec3((int)p.x(), (int)p.y(), (int)p.z());
+    atom_bucket[i] = gridHash(cells[i].x(), cells[i].y(), cells[i].z()) & mask;
+    ++bucket_start[atom_bucket[i]+1];
+  }
+  for(unsigned int i=0; i<table_size; ++i)
+    bucket_start[i+1] += bucket_start[i];
+  std::vector<int> bucket_atoms(atoms().size());
+  std::vector<int> fill(bucket_start.begin(), bucket_start.end()-1);
+  for(int i=0; i<atomCount(); ++i)
+    bucket_atoms[fill[atom_bucket[i]]++] = i;
+
+  // search the 27 cells around each atom, each pair is tested once
+  const float min_distance2 = min_distance*min_distance;
+  std::vector< std::pair<int, int> > pairs;
+  for(int i=0; i<atomCount(); ++i)
+  {
+    const fvec3& pi = atom(i)->coordinates();
+    unsigned int visited[27];
+    int visited_count = 0;
+    for(int dz=-1; dz<=1; ++dz)
+    for(int dy=-1; dy<=1; ++dy)
+    for(int dx=-1; dx<=1; ++dx)
+    {
+      unsigned int bucket = gridHash(cells[i].x()+dx, cells[i].y()+dy, cells[i].z()+dz) & mask;
+      // different cells can share a bucket
+      if (std::find(visited, visited+visited_count, bucket) != visited+visited_count)
+        continue;
+      visited[visited_count++] = bucket;
+      for(int k=bucket_start[bucket]; k<bucket_start[bucket+1]; ++k)
+      {
+        int j = bucket_atoms[k];
+        if (j <= i)
+          continue;
+        float max_distance = radii[i] + radii[j] + tolerance;
+        float distance2 = (atom(j)->coordinates() - pi).lengthSquared();
+        if (distance2 < max_distance*max_distance && distance2 > min_distance2 && !isAtomAdjacent(i, j))
+          pairs.push_back( std::pair<int, int>(i, j) );
+      }
+    }
+  }
+
+  bonds().reserve(bonds().size() + pairs.size());
+  for(size_t i=0; i<pairs.size(); ++i)
+  {
+    ref<Bond> bond = new Bond;
+    bond->setAtom1( atom(pairs[i].first) );
+    bond->setAtom2( atom(pairs[i].second) );
+    bond->setBondType( BT_Unknown );
+    bonds().push_back(bond);
+  }
+  computeAtomAdjacency();
+  return (int)pairs.size();
+}
+//-----------------------------------------------------------------------------
 void Molecule::setCPKAtomColors()
 {
   for(unsigned i=0; i<atoms().size(); ++i)
@@ -304,3 +510,91 @@ void Molecule::setAromaticBondsColor(const fvec4& color)
   }
 }
 //-----------------------------------------------------------------------------
+int Molecule::pickAtom(const Ray& ray, real* distance) const
+{
+  const vec3& o = ray.origin();
+  const vec3& d = ray.direction();
+  const real dd = dot(d,d);
+  int picked = -1;
+  real closest = 0;
+  if (dd == 0)
+    return picked;
+  for(int i=0; i<atomCount(); ++i)
+  {
+    const Atom* a = atom(i);
+    if (!a->visible())
+      continue;
+    // solves |o + d*t - center|^2 = radius^2
+    vec3 oc = o - (vec3)a->coordinates();
+    real b = dot(oc,d);
+    real c = dot(oc,oc) - (real)a->radius()*a->radius();
+    real h = b*b - dd*c;
+    if (h < 0)
+      continue;
+    h = ::sqrt(h);
+    real t = (-b - h) / dd;
+    // the ray starts inside the atom
+    if (t < 0)
+      t = (-b + h) / dd;
+    if (t >= 0 && (picked == -1 || t < closest))
+    {
+      picked  = i;
+      closest = t;
+    }
+  }
+  if (distance && picked != -1)
+    *distance = closest;
+  return picked;
+}
+//-----------------------------------------------------------------------------
+int Molecule::pickBond(const Ray& ray, real* distance) const
+{
+  const vec3& o = ray.origin();
+  const vec3& d = ray.direction();
+  const real dd = dot(d,d);
+  int picked = -1;
+  real closest = 0;
+  for(int i=0; i<bondCount(); ++i)
+  {
+    const Bond* b = bond(i);
+    if (!b->visible() || !b->atom1()->visible() || !b->atom2()->visible())
+      continue;
+    // solves |(p - pa) - ba*dot(p - pa, ba)/|ba|^2|^2 = radius^2 for p = o + d*t, with 0 <= dot(p - pa, ba) <= |ba|^2
+    vec3 pa = (vec3)b->atom1()->coordinates();
+    vec3 ba = (vec3)b->atom2()->coordinates() - pa;
+    vec3 oc = o - pa;
+    real r = b->radius();
+    real baba = dot(ba,ba);
+    real bard = dot(ba,d);
+    real baoc = dot(ba,oc);
+    real k2 = baba*dd - bard*bard;
+    real k1 = baba*dot(oc,d) - baoc*bard;
+    real k0 = baba*dot(oc,oc) - baoc*baoc - r*r*baba;
+    // degenerate bond or ray parallel to the bond
+    if (k2 <= 0)
+      continue;
+    real h = k1*k1 - k2*k0;
+    if (h < 0)
+      continue;
+    h = ::sqrt(h);
+    real roots[] = { (-k1 - h) / k2, (-k1 + h) / k2 };
+    for(int j=0; j<2; ++j)
+    {
+      real t = roots[j];
+      real y = baoc + t*bard;
+      if (t >= 0 && y >= 0 && y <= baba)
+      {
+        if (picked == -1 || t < closest)
+        {
+          picked  = i;
+          closest = t;
+        }
+        break;
+      }
+    }
+  }
+  if (distance && picked != -1)
+    *distance = closest;
+  return picked;
+}
+//-----------------------------------------------------------------------------
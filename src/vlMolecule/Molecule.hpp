@@ -39,7 +39,9 @@
 #include <vlGraphics/Actor.hpp>
 #include <vlGraphics/ActorTree.hpp>
 #include <vlGraphics/Text.hpp>
+#include <vlGraphics/GLSL.hpp>
 #include <vlCore/String.hpp>
+#include <vlCore/Ray.hpp>
 #include <vlCore/KeyValues.hpp>
 
 namespace vl
@@ -53,6 +55,18 @@ namespace vl
     MS_Wireframe,
   } EMoleculeStyle;
 
+  //! Defines how Molecule::prepareForRendering() turns the atoms and bonds into Actor[s].
+  typedef enum
+  {
+    //! One Actor and Transform for each atom and bond, see Molecule::atomToActorMap() and Molecule::bondToActorMap().
+    MRM_Actors,
+    //! The atoms and the bonds are merged into one Geometry each and rendered with the fixed function pipeline, see Molecule::atomInstances().
+    //! The memory used grows with Molecule::atomDetail() and Molecule::bondDetail(), for very large molecules prefer MRM_Impostors.
+    MRM_Batched,
+    //! The atoms and the bonds are ray-cast by GLSL shaders on a camera facing quad each, see Molecule::atomInstances() and Molecule::setAtomImpostorGLSL().
+    MRM_Impostors
+  } EMoleculeRenderMode;
+
   /** The Molecule class is used to manage and render 3D molecular structures.
    * \sa
    * - \ref pagGuideMolecule "Molecule Visualization Tutorial"
@@ -109,9 +123,35 @@ namespace vl
     void eraseBond(int a1, int a2);
     void eraseAllBonds();
 
+    /** Computes the adjacency of the atoms from the bonds, stored in compressed sparse row form, see adjacentAtoms() and adjacentBonds().
+     * The methods of Molecule adding or erasing atoms and bonds mark the adjacency out of date. Call this function again
+     * after modifying atoms() and bonds() directly or after changing the atoms of a Bond. */
     void computeAtomAdjacency();
+    //! Returns true if computeAtomAdjacency() needs to be called to update the atom adjacency.
+    bool isAtomAdjacencyDirty() const
+    {
+      return mAtomAdjacencyDirty || (int)mAdjacencyOffsets.size() != atomCount()+1 || mAdjacencyBondCount != bondCount();
+    }
+    //! The number of atoms adjacent to the atom at index \p iatom, requires an up to date adjacency (see computeAtomAdjacency()).
+    int adjacentAtomCount(int iatom) const { return mAdjacencyOffsets[iatom+1] - mAdjacencyOffsets[iatom]; }
+    //! The indices in atoms() of the adjacentAtomCount() atoms adjacent to the atom at index \p iatom, requires an up to date adjacency.
+    const int* adjacentAtoms(int iatom) const { return mAdjacentAtoms.empty() ? NULL : &mAdjacentAtoms[0] + mAdjacencyOffsets[iatom]; }
+    //! The indices in bonds() of the adjacentAtomCount() bonds incident to the atom at index \p iatom, in the same order as adjacentAtoms().
+    const int* adjacentBonds(int iatom) const { return mAdjacentBonds.empty() ? NULL : &mAdjacentBonds[0] + mAdjacencyOffsets[iatom]; }
+    //! Returns true if the atoms at index \p iatom1 and \p iatom2 are bonded, requires an up to date adjacency.
+    bool isAtomAdjacent(int iatom1, int iatom2) const;
+    //! Returns the index of \p atom in atoms() or -1. Uses a binary search if the adjacency is up to date, a linear search otherwise.
+    int atomIndex(const Atom* atom) const;
+    //! Returns the bonds incident to \p atom. Uses the atom adjacency if up to date, a linear search otherwise.
     void incidentBonds(std::vector<Bond*>& inc_bonds, Atom* atom);
 
+    /** Creates a Bond between each pair of atoms closer than the sum of their covalent radii plus \p tolerance, in Angstroms.
+     * Atoms closer than \p min_distance are considered overlapping and are not bonded, pairs of atoms already bonded are skipped.
+     * The atoms are hashed on a uniform grid whose cells are as large as the longest possible bond so that only the 27 cells
+     * around an atom are searched. The covalent radii come from atomInfo(), atoms of unknown radius are treated as carbon atoms.
+     * The new bonds have type BT_Unknown. Returns the number of bonds created and updates the atom adjacency. */
+    int computeBonds(float tolerance=0.45f, float min_distance=0.40f);
+
     //! Returns the i-th cycle
     const std::vector< ref<Atom> >& cycle(int i) const { return mCycles[i]; }
     //! Returns the i-th cycle
@@ -157,6 +197,15 @@ namespace vl
     //! The rendering style of the molecule
     EMoleculeStyle moleculeStyle() const { return mMoleculeStyle; }
 
+    /** How prepareForRendering() turns the atoms and bonds into Actor[s] (default is MRM_Actors).
+     * MRM_Batched and MRM_Impostors generate a few Actor[s] regardless of the size of the molecule and are meant for
+     * large structures. In these modes the atomToActorMap(), actorToAtomMap(), bondToActorMap() and actorToBondMap()
+     * maps are not generated, use atomInstances(), bondInstances(), pickAtom() and pickBond() instead.
+     * The MS_Wireframe style is not affected by the render mode. */
+    void setRenderMode(EMoleculeRenderMode mode) { mRenderMode = mode; }
+    //! How prepareForRendering() turns the atoms and bonds into Actor[s] (default is MRM_Actors).
+    EMoleculeRenderMode renderMode() const { return mRenderMode; }
+
     //! Geometrical detail used to render the atoms, usually between 0 and 3 (default is 2)
     void setAtomDetail(int detail) { mAtomDetail = detail; }
     //! Geometrical detail used to render the atoms, usually between 0 and 3 (default is 2)
@@ -228,6 +277,50 @@ namespace vl
     //! Maps an Actor to it's corresponding Bond
     std::map< ref<Actor>, ref<Bond> >& actorToBondMap() { return mActorToBondMap; }
 
+    //! The Geometry containing all the atoms, generated in MRM_Batched and MRM_Impostors mode, NULL otherwise.
+    Geometry* atomsGeometry() { return mAtomsGeometry.get(); }
+    //! The Geometry containing all the atoms, generated in MRM_Batched and MRM_Impostors mode, NULL otherwise.
+    const Geometry* atomsGeometry() const { return mAtomsGeometry.get(); }
+    //! The Geometry containing all the bonds, generated in MRM_Batched and MRM_Impostors mode, NULL otherwise.
+    Geometry* bondsGeometry() { return mBondsGeometry.get(); }
+    //! The Geometry containing all the bonds, generated in MRM_Batched and MRM_Impostors mode, NULL otherwise.
+    const Geometry* bondsGeometry() const { return mBondsGeometry.get(); }
+
+    //! Maps the i-th atom instance of atomsGeometry() to the index of its Atom in atoms().
+    //! The vertices of the i-th instance go from i*atomInstanceVertexCount() to (i+1)*atomInstanceVertexCount()-1.
+    const std::vector<int>& atomInstances() const { return mAtomInstances; }
+    //! The number of vertices used by each atom instance in atomsGeometry().
+    int atomInstanceVertexCount() const { return mAtomInstanceVertexCount; }
+
+    //! Maps the i-th bond instance of bondsGeometry() to the index of its Bond in bonds().
+    //! The vertices of the i-th instance go from i*bondInstanceVertexCount() to (i+1)*bondInstanceVertexCount()-1.
+    const std::vector<int>& bondInstances() const { return mBondInstances; }
+    //! The number of vertices used by each bond instance in bondsGeometry().
+    int bondInstanceVertexCount() const { return mBondInstanceVertexCount; }
+
+    /** Returns the index in atoms() of the closest visible Atom hit by \p ray, or -1.
+     * The ray is expressed in the coordinate system of the atoms' coordinates and each Atom is tested as a sphere of radius Atom::radius().
+     * If \p distance is not NULL it receives \p t such that the hit point is <tt>ray.origin() + ray.direction() * t</tt>.
+     * Works with any render mode and does not require prepareForRendering(). */
+    int pickAtom(const Ray& ray, real* distance=NULL) const;
+
+    /** Returns the index in bonds() of the closest visible Bond hit by \p ray, or -1.
+     * Each Bond is tested as a cylinder of radius Bond::radius() going from the center of its first atom to the center of its second atom.
+     * See also pickAtom(). */
+    int pickBond(const Ray& ray, real* distance=NULL) const;
+
+    //! The GLSLProgram used to ray-cast the atoms in MRM_Impostors mode. If NULL prepareForRendering() creates one from
+    //! \p "/glsl/molecule_atom_impostor.vs" and \p "/glsl/molecule_atom_impostor.fs".
+    void setAtomImpostorGLSL(GLSLProgram* glsl) { mAtomImpostorGLSL = glsl; }
+    //! The GLSLProgram used to ray-cast the atoms in MRM_Impostors mode.
+    GLSLProgram* atomImpostorGLSL() { return mAtomImpostorGLSL.get(); }
+
+    //! The GLSLProgram used to ray-cast the bonds in MRM_Impostors mode. If NULL prepareForRendering() creates one from
+    //! \p "/glsl/molecule_bond_impostor.vs" and \p "/glsl/molecule_bond_impostor.fs".
+    void setBondImpostorGLSL(GLSLProgram* glsl) { mBondImpostorGLSL = glsl; }
+    //! The GLSLProgram used to ray-cast the bonds in MRM_Impostors mode.
+    GLSLProgram* bondImpostorGLSL() { return mBondImpostorGLSL.get(); }
+
   protected:
     void prepareAtomInsert(int bonus=100)
     {
@@ -243,6 +336,8 @@ namespace vl
     void atomsStyle();
     void ballAndStickStyle();
     void sticksStyle();
+    void batchedStyle();
+    void impostorStyle();
     void generateRings();
     void generateAtomLabels();
     void generateAtomLabel(const Atom* atom, Transform* tr);
@@ -254,16 +349,31 @@ namespace vl
     std::vector< ref<Atom> > mAtoms;
     std::vector< ref<Bond> > mBonds;
     std::vector< std::vector< ref<Atom> > > mCycles; 
+    std::vector<int> mAdjacencyOffsets;
+    std::vector<int> mAdjacentAtoms;
+    std::vector<int> mAdjacentBonds;
+    std::vector< std::pair<const Atom*, int> > mAtomIndexTable;
+    int mAdjacencyBondCount;
+    bool mAtomAdjacencyDirty;
     std::map< ref<Atom>, ref<Actor> > mAtomToActorMap;
     std::map< ref<Actor>, ref<Atom> > mActorToAtomMap;
     std::map< ref<Bond>, ref<Actor> > mBondToActorMap;
     std::map< ref<Actor>, ref<Bond> > mActorToBondMap;
+    ref<Geometry> mAtomsGeometry;
+    ref<Geometry> mBondsGeometry;
+    std::vector<int> mAtomInstances;
+    std::vector<int> mBondInstances;
+    int mAtomInstanceVertexCount;
+    int mBondInstanceVertexCount;
+    ref<GLSLProgram> mAtomImpostorGLSL;
+    ref<GLSLProgram> mBondImpostorGLSL;
     String mMoleculeName;
     ref<KeyValues> mTags;
     ref<Text> mAtomLabelTemplate;
     ref<Effect> mAtomLabelEffect;
     unsigned int mId;
     EMoleculeStyle mMoleculeStyle;
+    EMoleculeRenderMode mRenderMode;
     int mAtomDetail;
     int mBondDetail;
     float mRingOffset;
@@ -33,6 +33,7 @@
 #include <vlGraphics/GeometryPrimitives.hpp>
 #include <vlGraphics/Text.hpp>
 #include <vlGraphics/Light.hpp>
+#include <algorithm>
 
 using namespace vl;
 
@@ -182,17 +183,118 @@ protected:
   float mQuantization;
 };
 //-----------------------------------------------------------------------------
+namespace
+{
+  // Merged capsules used by the MRM_Batched mode, indexed by quantized length and radius.
+  // The top half of a capsule (the one of the second atom) is marked in mTop.
+  class BatchedBondCache
+  {
+  public:
+    struct Capsule
+    {
+      std::vector<fvec3> mVertices;
+      std::vector<fvec3> mNormals;
+      std::vector<bool> mTop;
+      std::vector<GLuint> mTriangles;
+    };
+
+  public:
+    BatchedBondCache(int detail, ECapsuleCap cap): mDetail(detail), mCap(cap) {}
+
+    const Capsule& acquireCapsule(float length, float radius)
+    {
+      // same quantization used by BondGeometryCache
+      float quant_length = int(length*100.0f) / 100.0f;
+      std::pair<float, float> key(quant_length, radius);
+      std::map< std::pair<float, float>, Capsule >::iterator it = mCapsules.find(key);
+      if (it != mCapsules.end())
+        return it->second;
+
+      Capsule& capsule = mCapsules[key];
+      ref<Geometry> geom = makeCapsule( radius, quant_length+2.0f/100.0f, mDetail, mCap, mCap, fvec4(1,1,1,1), fvec4(0,0,0,0) );
+      geom->computeNormals();
+      const ArrayFloat3* verts = cast<const ArrayFloat3>(geom->vertexArray());
+      const ArrayFloat3* norms = cast<const ArrayFloat3>(geom->normalArray());
+      const ArrayFloat4* cols  = cast<const ArrayFloat4>(geom->colorArray());
+      capsule.mVertices.resize(verts->size());
+      capsule.mNormals.resize(verts->size());
+      capsule.mTop.resize(verts->size());
+      for(size_t i=0; i<verts->size(); ++i)
+      {
+        capsule.mVertices[i] = verts->at(i);
+        capsule.mNormals[i]  = norms->at(i);
+        capsule.mTop[i]      = cols->at(i).r() > 0.5f;
+      }
+      for(int i=0; i<geom->drawCalls()->size(); ++i)
+      {
+        for(TriangleIterator trit = geom->drawCalls()->at(i)->triangleIterator(); trit.hasNext(); trit.next())
+        {
+          capsule.mTriangles.push_back(trit.a());
+          capsule.mTriangles.push_back(trit.b());
+          capsule.mTriangles.push_back(trit.c());
+        }
+      }
+      return capsule;
+    }
+
+  protected:
+    std::map< std::pair<float, float>, Capsule > mCapsules;
+    int mDetail;
+    ECapsuleCap mCap;
+  };
+
+  ubvec4 toUByte4(const fvec4& color)
+  {
+    fvec4 c = clamp(color, 0.0f, 1.0f) * 255.0f + fvec4(0.5f,0.5f,0.5f,0.5f);
+    return ubvec4((GLubyte)c.r(), (GLubyte)c.g(), (GLubyte)c.b(), (GLubyte)c.a());
+  }
+
+  void bondColors(const Bond* b, fvec4& c1, fvec4& c2)
+  {
+    c1 = b->color();
+    c2 = b->color();
+    if (b->useAtomColors())
+    {
+      c1 = b->atom1()->color();
+      c2 = b->atom2()->color();
+    }
+  }
+
+  bool isBondVisible(const Bond* b)
+  {
+    return b->visible() && b->atom1()->visible() && b->atom2()->visible();
+  }
+}
+//-----------------------------------------------------------------------------
 void Molecule::prepareForRendering()
 {
   actorTree()->actors()->clear();
   transformTree()->eraseAllChildren();
-
-  switch(moleculeStyle())
+  mAtomsGeometry = NULL;
+  mBondsGeometry = NULL;
+  mAtomInstances.clear();
+  mBondInstances.clear();
+  mAtomInstanceVertexCount = 0;
+  mBondInstanceVertexCount = 0;
+
+  if (renderMode() == MRM_Actors || moleculeStyle() == MS_Wireframe)
+  {
+    switch(moleculeStyle())
+    {
+      case MS_Wireframe:    wireframeStyle();    generateRings(); break;
+      case MS_BallAndStick: ballAndStickStyle(); generateRings(); break;
+      case MS_Sticks:       sticksStyle();       generateRings(); break;
+      case MS_AtomsOnly:    atomsStyle();                         break;
+    }
+  }
+  else
   {
-    case MS_Wireframe:    wireframeStyle();    generateRings(); break;
-    case MS_BallAndStick: ballAndStickStyle(); generateRings(); break;
-    case MS_Sticks:       sticksStyle();       generateRings(); break;
-    case MS_AtomsOnly:    atomsStyle();                         break;
+    if (renderMode() == MRM_Batched)
+      batchedStyle();
+    else
+      impostorStyle();
+    if (moleculeStyle() != MS_AtomsOnly)
+      generateRings();
   }
   generateAtomLabels();
   transformTree()->computeWorldMatrixRecursive();
@@ -234,11 +336,18 @@ void Molecule::generateAtomLabel(const Atom* atom, Transform* tr)
 //-----------------------------------------------------------------------------
 void Molecule::generateAtomLabels()
 {
+  if (!atomLabelTemplate()->font() || !showAtomNames())
+    return;
+
+  // only the atoms actually showing a label get a Transform
   for(unsigned i=0; i<atoms().size(); ++i)
   {
-    ref<Transform> tr = new Transform(mat4::getTranslation((vec3)atoms()[i]->coordinates()));
-    transformTree()->addChild(tr.get());
-    generateAtomLabel(atoms()[i].get(), tr.get());
+    if (atoms()[i]->visible() && atoms()[i]->showAtomName())
+    {
+      ref<Transform> tr = new Transform(mat4::getTranslation((vec3)atoms()[i]->coordinates()));
+      transformTree()->addChild(tr.get());
+      generateAtomLabel(atoms()[i].get(), tr.get());
+    }
   }
 }
 //-----------------------------------------------------------------------------
@@ -513,3 +622,287 @@ void Molecule::generateRings()
   }
 }
 //-----------------------------------------------------------------------------
+void Molecule::batchedStyle()
+{
+  mAtomToActorMap.clear();
+  mActorToAtomMap.clear();
+  mBondToActorMap.clear();
+  mActorToBondMap.clear();
+
+  ref<Effect> fx = new Effect;
+  fx->shader()->enable(EN_DEPTH_TEST);
+  fx->shader()->enable(EN_CULL_FACE);
+  fx->shader()->gocMaterial()->setColorMaterialEnabled(true);
+  fx->shader()->gocLightModel()->setTwoSide(false);
+  fx->shader()->enable(EN_LIGHTING);
+  fx->shader()->setRenderState( new Light, 0 );
+
+  // atoms: a copy of the same unit icosphere for each visible atom
+  if (moleculeStyle() != MS_Sticks)
+  {
+    ref<Geometry> sphere = makeIcosphere( vec3(0,0,0), 2.0f, atomDetail() );
+    const ArrayFloat3* sphere_verts = cast<const ArrayFloat3>(sphere->vertexArray());
+    const ArrayFloat3* sphere_norms = cast<const ArrayFloat3>(sphere->normalArray());
+    std::vector<GLuint> sphere_tris;
+    for(TriangleIterator trit = sphere->drawCalls()->at(0)->triangleIterator(); trit.hasNext(); trit.next())
+    {
+      sphere_tris.push_back(trit.a());
+      sphere_tris.push_back(trit.b());
+      sphere_tris.push_back(trit.c());
+    }
+
+    for(int iatom=0; iatom<atomCount(); ++iatom)
+      if (atom(iatom)->visible())
+        mAtomInstances.push_back(iatom);
+
+    const size_t nv = sphere_verts->size();
+    const size_t nt = sphere_tris.size();
+    ref<ArrayFloat3> verts = new ArrayFloat3;
+    ref<ArrayFloat3> norms = new ArrayFloat3;
+    ref<ArrayUByte4> cols  = new ArrayUByte4;
+    ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES);
+    verts->resize(mAtomInstances.size()*nv);
+    norms->resize(mAtomInstances.size()*nv);
+    cols->resize(mAtomInstances.size()*nv);
+    de->indexBuffer()->resize(mAtomInstances.size()*nt);
+    GLuint* idx = de->indexBuffer()->begin();
+    for(size_t i=0; i<mAtomInstances.size(); ++i)
+    {
+      const Atom* a = atom(mAtomInstances[i]);
+      const ubvec4 col = toUByte4(a->color());
+      const GLuint start = (GLuint)(i*nv);
+      for(size_t j=0; j<nv; ++j)
+      {
+        verts->at(start+j) = a->coordinates() + sphere_verts->at(j) * a->radius();
+        norms->at(start+j) = sphere_norms->at(j);
+        cols->at(start+j)  = col;
+      }
+      for(size_t j=0; j<nt; ++j)
+        *idx++ = start + sphere_tris[j];
+    }
+
+    mAtomsGeometry = new Geometry;
+    mAtomsGeometry->setVertexArray(verts.get());
+    mAtomsGeometry->setNormalArray(norms.get());
+    mAtomsGeometry->setColorArray(cols.get());
+    mAtomsGeometry->drawCalls()->push_back(de.get());
+    mAtomInstanceVertexCount = (int)nv;
+    actorTree()->actors()->push_back( new Actor(mAtomsGeometry.get(), fx.get(), transformTree()) );
+  }
+
+  // bonds: one capsule for each visible bond, rounded for the sticks style
+  if (moleculeStyle() != MS_AtomsOnly)
+  {
+    BatchedBondCache capsule_cache( bondDetail(), moleculeStyle() == MS_Sticks ? CC_RoundedCap : CC_NoCap );
+    std::vector<const BatchedBondCache::Capsule*> capsules;
+    size_t vert_count = 0;
+    size_t index_count = 0;
+    for(int ibond=0; ibond<bondCount(); ++ibond)
+    {
+      const Bond* b = bond(ibond);
+      if (isBondVisible(b))
+      {
+        float len = (b->atom1()->coordinates() - b->atom2()->coordinates()).length();
+        capsules.push_back( &capsule_cache.acquireCapsule(len, b->radius()) );
+        mBondInstances.push_back(ibond);
+        vert_count  += capsules.back()->mVertices.size();
+        index_count += capsules.back()->mTriangles.size();
+      }
+    }
+
+    ref<ArrayFloat3> verts = new ArrayFloat3;
+    ref<ArrayFloat3> norms = new ArrayFloat3;
+    ref<ArrayUByte4> cols  = new ArrayUByte4;
+    ref<DrawElementsUInt> de = new DrawElementsUInt(PT_TRIANGLES);
+    verts->resize(vert_count);
+    norms->resize(vert_count);
+    cols->resize(vert_count);
+    de->indexBuffer()->resize(index_count);
+    GLuint* idx = de->indexBuffer()->begin();
+    GLuint start = 0;
+    for(size_t i=0; i<mBondInstances.size(); ++i)
+    {
+      const Bond* b = bond(mBondInstances[i]);
+      const BatchedBondCache::Capsule& capsule = *capsules[i];
+      fvec4 c1, c2;
+      bondColors(b, c1, c2);
+      const ubvec4 col1 = toUByte4(c1);
+      const ubvec4 col2 = toUByte4(c2);
+      fvec3 center = (b->atom1()->coordinates() + b->atom2()->coordinates()) / 2.0f;
+      fvec3 direction = (b->atom2()->coordinates() - b->atom1()->coordinates()).normalize();
+      fmat4 mat = fmat4::getTranslation(center) * fmat4::getRotation(fvec3(0,1,0), direction);
+      fmat3 nmat = mat.get3x3();
+      for(size_t j=0; j<capsule.mVertices.size(); ++j)
+      {
+        verts->at(start+j) = mat * capsule.mVertices[j];
+        norms->at(start+j) = nmat * capsule.mNormals[j];
+        cols->at(start+j)  = capsule.mTop[j] ? col2 : col1;
+      }
+      for(size_t j=0; j<capsule.mTriangles.size(); ++j)
+        *idx++ = start + capsule.mTriangles[j];
+      start += (GLuint)capsule.mVertices.size();
+    }
+
+    mBondsGeometry = new Geometry;
+    mBondsGeometry->setVertexArray(verts.get());
+    mBondsGeometry->setNormalArray(norms.get());
+    mBondsGeometry->setColorArray(cols.get());
+    mBondsGeometry->drawCalls()->push_back(de.get());
+    mBondInstanceVertexCount = capsules.empty() ? 0 : (int)capsules[0]->mVertices.size();
+    actorTree()->actors()->push_back( new Actor(mBondsGeometry.get(), fx.get(), transformTree()) );
+  }
+}
+//-----------------------------------------------------------------------------
+void Molecule::impostorStyle()
+{
+  mAtomToActorMap.clear();
+  mActorToAtomMap.clear();
+  mBondToActorMap.clear();
+  mActorToBondMap.clear();
+
+  ref<Light> light = new Light;
+
+  // atoms: a quad for each visible atom, or for each atom joining visible bonds in the sticks style
+  if (moleculeStyle() != MS_Sticks || !bonds().empty())
+  {
+    std::vector<float> radii;
+    if (moleculeStyle() == MS_Sticks)
+    {
+      // the sphere capping the sticks at each atom has the radius of its largest bond
+      if (isAtomAdjacencyDirty())
+        computeAtomAdjacency();
+      radii.resize(atoms().size(), 0.0f);
+      for(int iatom=0; iatom<atomCount(); ++iatom)
+      {
+        for(int i=0; i<adjacentAtomCount(iatom); ++i)
+        {
+          const Bond* b = bond(adjacentBonds(iatom)[i]);
+          if (isBondVisible(b))
+            radii[iatom] = std::max(radii[iatom], b->radius());
+        }
+        if (radii[iatom] > 0)
+          mAtomInstances.push_back(iatom);
+      }
+    }
+    else
+    {
+      for(int iatom=0; iatom<atomCount(); ++iatom)
+        if (atom(iatom)->visible())
+          mAtomInstances.push_back(iatom);
+    }
+
+    // each vertex stores the center of the atom, the corner of the quad and the radius of the atom
+    ref<ArrayFloat3> verts = new ArrayFloat3;
+    ref<ArrayFloat3> corners = new ArrayFloat3;
+    ref<ArrayUByte4> cols = new ArrayUByte4;
+    verts->resize(mAtomInstances.size()*4);
+    corners->resize(mAtomInstances.size()*4);
+    cols->resize(mAtomInstances.size()*4);
+    AABB aabb;
+    for(size_t i=0; i<mAtomInstances.size(); ++i)
+    {
+      const Atom* a = atom(mAtomInstances[i]);
+      float r = radii.empty() ? a->radius() : radii[mAtomInstances[i]];
+      ubvec4 col = toUByte4(a->color());
+      aabb.addPoint((vec3)a->coordinates(), r);
+      for(int j=0; j<4; ++j)
+      {
+        verts->at(i*4+j) = a->coordinates();
+        cols->at(i*4+j)  = col;
+      }
+      corners->at(i*4+0) = fvec3(-1,-1,r);
+      corners->at(i*4+1) = fvec3(+1,-1,r);
+      corners->at(i*4+2) = fvec3(+1,+1,r);
+      corners->at(i*4+3) = fvec3(-1,+1,r);
+    }
+
+    mAtomsGeometry = new Geometry;
+    mAtomsGeometry->setVertexArray(verts.get());
+    mAtomsGeometry->setTexCoordArray(0, corners.get());
+    mAtomsGeometry->setColorArray(cols.get());
+    mAtomsGeometry->drawCalls()->push_back( new DrawArrays(PT_QUADS, 0, (int)verts->size()) );
+    // the vertices are the atoms' centers
+    mAtomsGeometry->setBoundingBox(aabb);
+    mAtomsGeometry->setBoundingSphere(aabb);
+    mAtomInstanceVertexCount = 4;
+
+    if (!atomImpostorGLSL())
+    {
+      setAtomImpostorGLSL(new GLSLProgram);
+      atomImpostorGLSL()->attachShader( new GLSLVertexShader( String::loadText("/glsl/molecule_atom_impostor.vs") ) );
+      atomImpostorGLSL()->attachShader( new GLSLFragmentShader( String::loadText("/glsl/molecule_atom_impostor.fs") ) );
+    }
+    ref<Effect> fx = new Effect;
+    fx->shader()->enable(EN_DEPTH_TEST);
+    fx->shader()->setRenderState( light.get(), 0 );
+    fx->shader()->setRenderState( atomImpostorGLSL() );
+    actorTree()->actors()->push_back( new Actor(mAtomsGeometry.get(), fx.get(), transformTree()) );
+  }
+
+  // bonds: a quad for each visible bond
+  if (moleculeStyle() != MS_AtomsOnly)
+  {
+    for(int ibond=0; ibond<bondCount(); ++ibond)
+      if (isBondVisible(bond(ibond)))
+        mBondInstances.push_back(ibond);
+
+    // each vertex stores the two atoms, the corner of the quad along and across the bond, the radius and the colors of the two halves
+    ref<ArrayFloat3> verts = new ArrayFloat3;
+    ref<ArrayFloat3> ends = new ArrayFloat3;
+    ref<ArrayFloat3> corners = new ArrayFloat3;
+    ref<ArrayUByte4> cols1 = new ArrayUByte4;
+    ref<ArrayUByte3> cols2 = new ArrayUByte3;
+    verts->resize(mBondInstances.size()*4);
+    ends->resize(mBondInstances.size()*4);
+    corners->resize(mBondInstances.size()*4);
+    cols1->resize(mBondInstances.size()*4);
+    cols2->resize(mBondInstances.size()*4);
+    AABB aabb;
+    for(size_t i=0; i<mBondInstances.size(); ++i)
+    {
+      const Bond* b = bond(mBondInstances[i]);
+      float r = b->radius();
+      fvec4 c1, c2;
+      bondColors(b, c1, c2);
+      ubvec4 col1 = toUByte4(c1);
+      ubvec4 col2 = toUByte4(c2);
+      aabb.addPoint((vec3)b->atom1()->coordinates(), r);
+      aabb.addPoint((vec3)b->atom2()->coordinates(), r);
+      for(int j=0; j<4; ++j)
+      {
+        verts->at(i*4+j) = b->atom1()->coordinates();
+        ends->at(i*4+j)  = b->atom2()->coordinates();
+        cols1->at(i*4+j) = col1;
+        cols2->at(i*4+j) = ubvec3(col2.r(), col2.g(), col2.b());
+      }
+      corners->at(i*4+0) = fvec3(0,-1,r);
+      corners->at(i*4+1) = fvec3(1,-1,r);
+      corners->at(i*4+2) = fvec3(1,+1,r);
+      corners->at(i*4+3) = fvec3(0,+1,r);
+    }
+
+    mBondsGeometry = new Geometry;
+    mBondsGeometry->setVertexArray(verts.get());
+    mBondsGeometry->setTexCoordArray(0, ends.get());
+    mBondsGeometry->setTexCoordArray(1, corners.get());
+    mBondsGeometry->setColorArray(cols1.get());
+    mBondsGeometry->setSecondaryColorArray(cols2.get());
+    mBondsGeometry->drawCalls()->push_back( new DrawArrays(PT_QUADS, 0, (int)verts->size()) );
+    mBondsGeometry->setBoundingBox(aabb);
+    mBondsGeometry->setBoundingSphere(aabb);
+    mBondInstanceVertexCount = 4;
+
+    if (!bondImpostorGLSL())
+    {
+      setBondImpostorGLSL(new GLSLProgram);
+      bondImpostorGLSL()->attachShader( new GLSLVertexShader( String::loadText("/glsl/molecule_bond_impostor.vs") ) );
+      bondImpostorGLSL()->attachShader( new GLSLFragmentShader( String::loadText("/glsl/molecule_bond_impostor.fs") ) );
+    }
+    ref<Effect> fx = new Effect;
+    fx->shader()->enable(EN_DEPTH_TEST);
+    fx->shader()->setRenderState( light.get(), 0 );
+    fx->shader()->setRenderState( bondImpostorGLSL() );
+    actorTree()->actors()->push_back( new Actor(mBondsGeometry.get(), fx.get(), transformTree()) );
+  }
+}
+//-----------------------------------------------------------------------------
@@ -35,16 +35,22 @@
 #include <vlCore/glsl_math.hpp>
 #include <vector>
 #include <algorithm>
-#include <map>
-#include <set>
+#include <iterator>
 
 namespace vl
 {
-  //! The RingExtractor class traverses a molecule's graph and detects various types of cycles, mainly used for aromatic ring detection.
+  /** The RingExtractor class detects the rings of a molecule's graph, mainly used for aromatic ring detection.
+   * bootstrap() computes the smallest set of smallest rings (SSSR) in time roughly linear with the size of the molecule:
+   * - the atoms not belonging to any ring are pruned and the remaining atoms are split into ring systems.
+   * - for each bond of a ring system the shortest rings through it are found with a breadth-first search that stops as soon as the ring closes.
+   * - these rings, smallest first, are added to the set if linearly independent from the ones already selected, until the set
+   *   contains as many rings as the cyclomatic number of the ring system (bonds - atoms + 1). In the rare cases in which they are
+   *   not enough the candidate rings of Horton's algorithm are used as well.
+   */
   class RingExtractor
   {
   public:
-    RingExtractor(Molecule* mol): mMolecule(mol) {}
+    RingExtractor(Molecule* mol): mMolecule(mol), mPruned(NULL), mCurrentStamp(0), mReducedCount(0) {}
 
     void setMolecule(Molecule* mol) { mMolecule = mol; }
 
@@ -55,54 +61,92 @@ namespace vl
       if (!molecule()->atoms().empty())
       {
         bootstrap();
-        removeDoubles();
-        sortCycles();
-        keepMinimalCycles();
         keepAromaticCycles();
         /*keepPlanarCycles(0.10f);*/
       }
     }
 
+    //! Replaces the molecule's cycles with its smallest set of smallest rings, the atoms of each ring are listed in order.
     void bootstrap()
     {
-      if (!molecule()->atoms().empty())
-      {
+      molecule()->cycles().clear();
+      if (molecule()->atoms().empty())
+        return;
+      if (molecule()->isAtomAdjacencyDirty())
         molecule()->computeAtomAdjacency();
-        for(int i=0; i<molecule()->atomCount(); ++i)
-          molecule()->atom(i)->setVisited(false);
-        std::vector< ref<Atom> > current_path;
-        depthFirstVisit( molecule()->atoms()[0].get(), current_path );
-      }
-    }
 
-    void depthFirstVisit(Atom* atom, std::vector< ref<Atom> >& current_path)
-    {
-      if ( !atom->visited() || current_path.empty())
+      const int atom_count = molecule()->atomCount();
+
+      // prune the atoms with less than two neighbors until only ring systems and the chains joining them are left
+      std::vector<int> degree(atom_count);
+      std::vector<char> pruned(atom_count, 0);
+      std::vector<int> stack;
+      for(int i=0; i<atom_count; ++i)
       {
-        atom->setVisited(true);
-        current_path.push_back(atom);
-        for(unsigned i=0; i<atom->adjacentAtoms().size(); ++i)
-          depthFirstVisit( atom->adjacentAtoms()[i], current_path );
-        current_path.pop_back();
-        atom->setVisited(false);
+        degree[i] = molecule()->adjacentAtomCount(i);
+        if (degree[i] < 2)
+        {
+          pruned[i] = 1;
+          stack.push_back(i);
+        }
+      }
+      while(!stack.empty())
+      {
+        int iatom = stack.back();
+        stack.pop_back();
+        for(int i=0; i<molecule()->adjacentAtomCount(iatom); ++i)
+        {
+          int j = molecule()->adjacentAtoms(iatom)[i];
+          if (!pruned[j] && --degree[j] < 2)
+          {
+            pruned[j] = 1;
+            stack.push_back(j);
+          }
+        }
       }
-      else // cycle found
+
+      // visit each connected component of the remaining atoms
+      mStamp.assign(atom_count, 0);
+      mDistance.resize(atom_count);
+      mCurrentStamp = 0;
+      mPruned = &pruned;
+      std::vector<int> component(atom_count, -1);
+      std::vector<int> edge_index(molecule()->bondCount(), -1);
+      for(int seed=0; seed<atom_count; ++seed)
       {
-        /* condition: atom->visited() && !current_path.empty() */
+        if (pruned[seed] || component[seed] != -1)
+          continue;
 
-        for(size_t i = current_path.size()-1; i--; )
+        // collect the atoms and bonds of the component
+        std::vector<int> atoms;
+        std::vector<int> edges;
+        component[seed] = seed;
+        atoms.push_back(seed);
+        for(size_t k=0; k<atoms.size(); ++k)
         {
-          if ( current_path[i] == atom )
+          int iatom = atoms[k];
+          for(int i=0; i<molecule()->adjacentAtomCount(iatom); ++i)
           {
-            std::vector< ref<Atom> > cycle;
-            for(; i<current_path.size(); ++i)
-              cycle.push_back( current_path[i] );
-            if (cycle.size() > 2)
-              molecule()->cycles().push_back(cycle);
-            break;
+            int j = molecule()->adjacentAtoms(iatom)[i];
+            int b = molecule()->adjacentBonds(iatom)[i];
+            if (pruned[j])
+              continue;
+            if (edge_index[b] == -1)
+            {
+              edge_index[b] = (int)edges.size();
+              edges.push_back(b);
+            }
+            if (component[j] == -1)
+            {
+              component[j] = seed;
+              atoms.push_back(j);
+            }
           }
         }
+
+        extractRings(atoms, edges, edge_index);
       }
+      mPruned = NULL;
     }
 
     void keepAromaticCycles()
@@ -130,28 +174,6 @@ namespace vl
       molecule()->cycles() = kept_cycles;
     }
 
-    void sortCycles()
-    {
-      for(unsigned icycle=0; icycle<molecule()->cycles().size(); ++icycle)
-      {
-        std::vector< ref<Atom> >& cycle = molecule()->cycle(icycle);
-        for(unsigned iatom=0; iatom<cycle.size()-1; ++iatom)
-        {
-          Atom* atom = cycle[iatom].get();
-          for(unsigned j=iatom+1; j<cycle.size(); ++j)
-          {
-            if (atom->isAtomAdjacent(cycle[j].get()))
-            {
-              Atom* tmp = cycle[iatom+1].get();
-              cycle[iatom+1] = cycle[j];
-              cycle[j] = tmp;
-              break;
-            }
-          }
-        }
-      }
-    }
-
     void keepPlanarCycles(float epsilon)
     {
       std::vector< std::vector< ref<Atom> > > kept_cycles;
@@ -191,58 +213,260 @@ namespace vl
       molecule()->cycles() = kept_cycles;
     }
 
-    void removeDoubles()
+  protected:
+    // A candidate ring: its atoms in order and its sorted bonds, indexed within the current ring system.
+    struct Ring
     {
-      for(unsigned icycle=0; icycle<molecule()->cycles().size(); ++icycle)
-        std::stable_sort(molecule()->cycle(icycle).begin(), molecule()->cycle(icycle).end());
-      std::stable_sort(molecule()->cycles().begin(), molecule()->cycles().end());
-      std::vector< std::vector< ref<Atom> > >::iterator new_end = std::unique(molecule()->cycles().begin(), molecule()->cycles().end());
-      std::vector< std::vector< ref<Atom> > > unique_cycles;
-      for(std::vector< std::vector< ref<Atom> > >::iterator it = molecule()->cycles().begin(); it != new_end; ++it)
-        unique_cycles.push_back(*it);
-      molecule()->cycles() = unique_cycles;
-    }
+      std::vector<int> mAtoms;
+      std::vector<int> mEdges;
 
-    void keepMinimalCycles()
+      bool operator<(const Ring& other) const
+      {
+        if (mEdges.size() != other.mEdges.size())
+          return mEdges.size() < other.mEdges.size();
+        return mEdges < other.mEdges;
+      }
+      bool operator==(const Ring& other) const { return mEdges == other.mEdges; }
+    };
+
+    // Selects the smallest set of smallest rings of the ring system made of the given atoms and bonds.
+    void extractRings(const std::vector<int>& atoms, const std::vector<int>& edges, const std::vector<int>& edge_index)
     {
-      std::vector< std::vector< ref<Atom> > > sub_cycles;
+      const int ring_count = (int)edges.size() - (int)atoms.size() + 1;
+      if (ring_count <= 0)
+        return;
 
-      std::map<Atom*, bool> my_atom;
-      for(unsigned j=0; j<molecule()->atoms().size(); ++j)
-        my_atom[molecule()->atoms()[j].get()] = false;
+      std::vector<int> edge_atoms(edges.size()*2);
+      for(size_t e=0; e<edges.size(); ++e)
+      {
+        edge_atoms[e*2+0] = molecule()->atomIndex( molecule()->bond(edges[e])->atom1() );
+        edge_atoms[e*2+1] = molecule()->atomIndex( molecule()->bond(edges[e])->atom2() );
+      }
 
-      for(unsigned icycle=0; icycle<molecule()->cycles().size(); ++icycle)
+      // the shortest rings through each bond
+      std::vector<Ring> candidates;
+      for(size_t e=0; e<edges.size(); ++e)
+        shortestRings(edge_atoms[e*2+0], edge_atoms[e*2+1], edges[e], edge_index, candidates);
+      std::sort(candidates.begin(), candidates.end());
+      candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+      mEdgeUse.assign(edges.size(), 0);
+      mPivotOwner.assign(edges.size(), -1);
+      mBasis.clear();
+      mAccepted.clear();
+      mReducedCount = 0;
+      selectRings(candidates, ring_count);
+
+      // Horton's candidates guarantee a complete set
+      if ((int)mAccepted.size() < ring_count)
       {
-        // init
-        for(unsigned j=0; j<molecule()->cycles()[icycle].size(); ++j)
-          my_atom[ molecule()->cycles()[icycle][j].get() ] = true;
+        hortonRings(atoms, edges, edge_atoms, edge_index, candidates);
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        selectRings(candidates, ring_count);
+      }
+    }
+
+    // Appends the shortest rings passing through the bond \p ibond joining \p from and \p to, at most 8 for each bond.
+    void shortestRings(int from, int to, int ibond, const std::vector<int>& edge_index, std::vector<Ring>& rings)
+    {
+      if (from == -1 || to == -1)
+        return;
 
-        bool is_sup_cycle = false;
-        for(unsigned j=0; j<molecule()->cycles().size(); ++j)
+      // breadth-first search from 'from' not using the bond, stops when 'to' is reached
+      ++mCurrentStamp;
+      mQueue.clear();
+      mQueue.push_back(from);
+      mStamp[from] = mCurrentStamp;
+      mDistance[from] = 0;
+      bool found = false;
+      for(size_t k=0; k<mQueue.size() && !found; ++k)
+      {
+        int iatom = mQueue[k];
+        for(int i=0; i<molecule()->adjacentAtomCount(iatom); ++i)
         {
-          if (j == icycle)
+          int j = molecule()->adjacentAtoms(iatom)[i];
+          if (molecule()->adjacentBonds(iatom)[i] == ibond || (*mPruned)[j] || mStamp[j] == mCurrentStamp)
             continue;
-          unsigned shared_atoms = 0;
-          for(unsigned k=0; k<molecule()->cycles()[j].size(); k++)
-            shared_atoms += my_atom[ molecule()->cycles()[j][k].get() ] ? 1 : 0;
-          if ( shared_atoms == molecule()->cycles()[j].size() )
+          mStamp[j] = mCurrentStamp;
+          mDistance[j] = mDistance[iatom] + 1;
+          if (j == to)
           {
-            is_sup_cycle = true;
+            found = true;
             break;
           }
+          mQueue.push_back(j);
+        }
+      }
+      if (!found)
+        return;
+
+      // enumerates the shortest paths going back from 'to' to 'from'
+      int path_count = 0;
+      std::vector<int> path_atoms(1, to);
+      std::vector<int> path_edges(1, edge_index[ibond]);
+      shortestPaths(from, ibond, edge_index, path_atoms, path_edges, path_count, rings);
+    }
+
+    void shortestPaths(int from, int ibond, const std::vector<int>& edge_index, std::vector<int>& path_atoms, std::vector<int>& path_edges, int& path_count, std::vector<Ring>& rings)
+    {
+      int iatom = path_atoms.back();
+      if (iatom == from)
+      {
+        if (path_atoms.size() > 2)
+        {
+          rings.push_back(Ring());
+          rings.back().mAtoms = path_atoms;
+          rings.back().mEdges = path_edges;
+          std::sort(rings.back().mEdges.begin(), rings.back().mEdges.end());
+        }
+        ++path_count;
+        return;
+      }
+      for(int i=0; i<molecule()->adjacentAtomCount(iatom) && path_count<8; ++i)
+      {
+        int j = molecule()->adjacentAtoms(iatom)[i];
+        int b = molecule()->adjacentBonds(iatom)[i];
+        if (b == ibond || (*mPruned)[j] || mStamp[j] != mCurrentStamp || mDistance[j] != mDistance[iatom]-1)
+          continue;
+        path_atoms.push_back(j);
+        path_edges.push_back(edge_index[b]);
+        shortestPaths(from, ibond, edge_index, path_atoms, path_edges, path_count, rings);
+        path_atoms.pop_back();
+        path_edges.pop_back();
+      }
+    }
+
+    // Horton's candidates: for each atom r and bond (x,y) the ring made of the shortest paths r-x and r-y plus the bond.
+    void hortonRings(const std::vector<int>& atoms, const std::vector<int>& edges, const std::vector<int>& edge_atoms, const std::vector<int>& edge_index, std::vector<Ring>& rings)
+    {
+      rings.clear();
+      std::vector<int> parent_atom(molecule()->atomCount());
+      std::vector<int> parent_bond(molecule()->atomCount());
+      std::vector<int> branch(molecule()->atomCount());
+      for(size_t r=0; r<atoms.size(); ++r)
+      {
+        // shortest path tree from r, 'branch' is the child of r each atom descends from
+        int root = atoms[r];
+        ++mCurrentStamp;
+        mQueue.clear();
+        mQueue.push_back(root);
+        mStamp[root] = mCurrentStamp;
+        parent_atom[root] = -1;
+        parent_bond[root] = -1;
+        branch[root] = root;
+        for(size_t k=0; k<mQueue.size(); ++k)
+        {
+          int iatom = mQueue[k];
+          for(int i=0; i<molecule()->adjacentAtomCount(iatom); ++i)
+          {
+            int j = molecule()->adjacentAtoms(iatom)[i];
+            if ((*mPruned)[j] || mStamp[j] == mCurrentStamp)
+              continue;
+            mStamp[j] = mCurrentStamp;
+            parent_atom[j] = iatom;
+            parent_bond[j] = molecule()->adjacentBonds(iatom)[i];
+            branch[j] = iatom == root ? j : branch[iatom];
+            mQueue.push_back(j);
+          }
         }
-        if (!is_sup_cycle)
-          sub_cycles.push_back( molecule()->cycles()[icycle] );
 
-        // reset
-        for(unsigned j=0; j<molecule()->cycles()[icycle].size(); ++j)
-          my_atom[ molecule()->cycles()[icycle][j].get() ] = false;
+        for(size_t e=0; e<edges.size(); ++e)
+        {
+          int x = edge_atoms[e*2+0];
+          int y = edge_atoms[e*2+1];
+          // the two paths must meet only at r
+          if (parent_bond[x] == edges[e] || parent_bond[y] == edges[e] || branch[x] == branch[y])
+            continue;
+          Ring ring;
+          for(int iatom=x; iatom!=-1; iatom=parent_atom[iatom])
+          {
+            ring.mAtoms.push_back(iatom);
+            if (parent_bond[iatom] != -1)
+              ring.mEdges.push_back(edge_index[parent_bond[iatom]]);
+          }
+          size_t mark = ring.mAtoms.size();
+          for(int iatom=y; iatom!=root; iatom=parent_atom[iatom])
+          {
+            ring.mAtoms.push_back(iatom);
+            ring.mEdges.push_back(edge_index[parent_bond[iatom]]);
+          }
+          std::reverse(ring.mAtoms.begin()+mark, ring.mAtoms.end());
+          ring.mEdges.push_back((int)e);
+          std::sort(ring.mEdges.begin(), ring.mEdges.end());
+          if (ring.mAtoms.size() > 2)
+            rings.push_back(ring);
+        }
+      }
+    }
+
+    // Adds the candidates, smallest first, that are linearly independent over GF(2) from the rings already selected.
+    void selectRings(const std::vector<Ring>& candidates, int ring_count)
+    {
+      for(size_t i=0; i<candidates.size() && (int)mAccepted.size()<ring_count; ++i)
+      {
+        const std::vector<int>& edges = candidates[i].mEdges;
+
+        // a ring using a bond not used by the selected rings is independent from them
+        bool independent = false;
+        for(size_t k=0; k<edges.size() && !independent; ++k)
+          independent = mEdgeUse[edges[k]] == 0;
+
+        // otherwise it's reduced against the basis of the selected rings
+        if (!independent)
+        {
+          while(mReducedCount < mAccepted.size())
+            reduce(mAccepted[mReducedCount++], true);
+          independent = reduce(edges, false);
+        }
+
+        if (independent)
+        {
+          mAccepted.push_back(edges);
+          for(size_t k=0; k<edges.size(); ++k)
+            ++mEdgeUse[edges[k]];
+          std::vector< ref<Atom> > cycle(candidates[i].mAtoms.size());
+          for(size_t k=0; k<cycle.size(); ++k)
+            cycle[k] = molecule()->atom(candidates[i].mAtoms[k]);
+          molecule()->cycles().push_back(cycle);
+        }
+      }
+    }
+
+    // Gaussian elimination over GF(2), each basis vector is identified by its largest bond index.
+    bool reduce(const std::vector<int>& edges, bool insert)
+    {
+      std::vector<int> v = edges;
+      std::vector<int> tmp;
+      while(!v.empty() && mPivotOwner[v.back()] != -1)
+      {
+        const std::vector<int>& w = mBasis[mPivotOwner[v.back()]];
+        tmp.clear();
+        std::set_symmetric_difference(v.begin(), v.end(), w.begin(), w.end(), std::back_inserter(tmp));
+        v.swap(tmp);
+      }
+      if (v.empty())
+        return false;
+      if (insert)
+      {
+        mPivotOwner[v.back()] = (int)mBasis.size();
+        mBasis.push_back(v);
       }
-      molecule()->cycles() = sub_cycles;
+      return true;
     }
 
   protected:
     Molecule* mMolecule;
+    const std::vector<char>* mPruned;
+    std::vector<int> mStamp;
+    std::vector<int> mDistance;
+    std::vector<int> mQueue;
+    int mCurrentStamp;
+    std::vector<int> mEdgeUse;
+    std::vector<int> mPivotOwner;
+    std::vector< std::vector<int> > mBasis;
+    std::vector< std::vector<int> > mAccepted;
+    size_t mReducedCount;
   };
 }
 
@@ -149,6 +149,10 @@ namespace
 	    structure->addBond( bond.get() );
 	  }
 
+    // files without a bond section get the bonds from the distances of the atoms
+    if (structure->bonds().empty())
+      structure->computeBonds();
+
     // by default all the atom radii are set to be covalent
     structure->setCovalentAtomRadii();
 
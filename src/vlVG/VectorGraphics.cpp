@@ -39,6 +39,9 @@ VectorGraphics::VectorGraphics()
   mDefaultEffect = new Effect;
   mDefaultEffect->shader()->enable(EN_BLEND);
   mActors.setAutomaticDelete(false);
+  mBatchCount = 0;
+  mCurrentBatch = NULL;
+  mBatchingEnabled = false;
 }
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::drawLine(double x1, double y1, double x2, double y2)
@@ -51,6 +54,8 @@ Actor* VectorGraphics::drawLine(double x1, double y1, double x2, double y2)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::drawLines(const std::vector<dvec2>& ln)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_LINES, ln, TexGen_Lines);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(ln);
   // generate texture coords
@@ -76,6 +81,8 @@ Actor* VectorGraphics::drawLines(const std::vector<dvec2>& ln)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::drawLineStrip(const std::vector<dvec2>& ln)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_LINE_STRIP, ln, TexGen_Linear);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(ln);
   // generate texture coords
@@ -88,6 +95,8 @@ Actor* VectorGraphics::drawLineStrip(const std::vector<dvec2>& ln)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::drawLineLoop(const std::vector<dvec2>& ln)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_LINE_LOOP, ln, TexGen_Linear);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(ln);
   // generate texture coords
@@ -100,6 +109,8 @@ Actor* VectorGraphics::drawLineLoop(const std::vector<dvec2>& ln)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillPolygon(const std::vector<dvec2>& poly)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_TRIANGLE_FAN, poly, TexGen_Planar);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometryPolyToTriangles(poly);
   // generate texture coords
@@ -112,6 +123,8 @@ Actor* VectorGraphics::fillPolygon(const std::vector<dvec2>& poly)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillTriangles(const std::vector<dvec2>& triangles)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_TRIANGLES, triangles, TexGen_Planar);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(triangles);
   // generate texture coords
@@ -124,6 +137,8 @@ Actor* VectorGraphics::fillTriangles(const std::vector<dvec2>& triangles)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillTriangleFan(const std::vector<dvec2>& fan)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_TRIANGLE_FAN, fan, TexGen_Planar);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(fan);
   // generate texture coords
@@ -136,6 +151,8 @@ Actor* VectorGraphics::fillTriangleFan(const std::vector<dvec2>& fan)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillTriangleStrip(const std::vector<dvec2>& strip)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_TRIANGLE_STRIP, strip, TexGen_Planar);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(strip);
   // generate texture coords
@@ -148,6 +165,8 @@ Actor* VectorGraphics::fillTriangleStrip(const std::vector<dvec2>& strip)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillQuads(const std::vector<dvec2>& quads)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_QUADS, quads, TexGen_Quads);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(quads);
   // generate texture coords
@@ -160,6 +179,8 @@ Actor* VectorGraphics::fillQuads(const std::vector<dvec2>& quads)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::fillQuadStrip(const std::vector<dvec2>& quad_strip)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_QUAD_STRIP, quad_strip, TexGen_Planar);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(quad_strip);
   // generate texture coords
@@ -179,6 +200,8 @@ Actor* VectorGraphics::drawPoint(double x, double y)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::drawPoints(const std::vector<dvec2>& pt)
 {
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_POINTS, pt, TexGen_None);
   // transform the points
   ref<ArrayFloat3> pos_array = new ArrayFloat3;
   pos_array->resize(pt.size());
@@ -242,6 +265,8 @@ Actor* VectorGraphics::fillQuad(double left, double bottom, double right, double
   quad.push_back(dvec2(left,top));
   quad.push_back(dvec2(right,top));
   quad.push_back(dvec2(right,bottom));
+  if (mBatchingEnabled)
+    return batchPrimitive(PT_TRIANGLE_FAN, quad, TexGen_Quads);
   // fill the vertex position array
   ref<Geometry> geom = prepareGeometry(quad);
   // generate texture coords
@@ -254,6 +279,8 @@ Actor* VectorGraphics::fillQuad(double left, double bottom, double right, double
 //-----------------------------------------------------------------------------
 void VectorGraphics::continueDrawing()
 {
+  flushBatch();
+
   /*mActors.clear();*/ // keep the currently drawn actors
 
   /*mVGToEffectMap.clear();*/      // keeps cached resources
@@ -269,6 +296,8 @@ void VectorGraphics::continueDrawing()
 //-----------------------------------------------------------------------------
 void VectorGraphics::endDrawing(bool release_cache)
 {
+  flushBatch();
+
   if (release_cache)
   {
     mVGToEffectMap.clear();
@@ -286,6 +315,10 @@ void VectorGraphics::clear()
   // remove all the actors
   mActors.clear();
 
+  // the batches are kept for reuse
+  mCurrentBatch = NULL;
+  mBatchCount = 0;
+
   // reset everything
   mVGToEffectMap.clear();
   mImageToTextureMap.clear();
@@ -834,8 +867,261 @@ Effect* VectorGraphics::currentEffect(const State& vgs)
 //-----------------------------------------------------------------------------
 Actor* VectorGraphics::addActor(Actor* actor) 
 { 
+  // preserve the rendering order
+  flushBatch();
   actor->setScissor(mScissor.get());
   mActors.push_back(actor);
   return actor;
 }
 //-----------------------------------------------------------------------------
+void VectorGraphics::setBatchingEnabled(bool enabled)
+{
+  if (!enabled)
+    flushBatch();
+  mBatchingEnabled = enabled;
+}
+//-----------------------------------------------------------------------------
+Actor* VectorGraphics::batchPrimitive(EPrimitiveType type, const std::vector<dvec2>& points, ETexGen tex_gen)
+{
+  Effect* effect = currentEffect();
+
+  // start a new batch if the state or the scissor changed
+  if (!mCurrentBatch || mCurrentBatch->mActor->effect() != effect || mCurrentBatch->mActor->scissor() != mScissor.get())
+  {
+    flushBatch();
+    if (mBatchCount == (int)mBatchPool.size())
+    {
+      ref<Batch> batch = new Batch;
+      batch->mGeometry = new Geometry;
+      batch->mVertexArray = new ArrayFloat3;
+      batch->mTexCoordArray = new ArrayFloat2;
+      batch->mActor = new Actor(batch->mGeometry.get(), NULL, NULL);
+      mBatchPool.push_back(batch);
+    }
+    mCurrentBatch = mBatchPool[mBatchCount++].get();
+    mCurrentBatch->mPositions.clear();
+    mCurrentBatch->mTexCoords.clear();
+    mCurrentBatch->mDrawCallCount = 0;
+    mCurrentBatch->mActor->setEffect(effect);
+    mCurrentBatch->mActor->setTransform(NULL);
+    mCurrentBatch->mActor->setScissor(mScissor.get());
+    mActors.push_back(mCurrentBatch->mActor.get());
+  }
+  Batch* batch = mCurrentBatch;
+  int count = (int)points.size();
+
+  // transform done using high precision
+  std::vector<fvec3>& pos = batch->mPointPositions;
+  pos.resize(count);
+  for(int i=0; i<count; ++i)
+  {
+    pos[i] = (fvec3)(matrix() * dvec3(points[i].x(), points[i].y(), 0));
+    // needed for pixel/perfect rendering
+    if (type == PT_POINTS && mState.mPointSize % 2 == 0)
+    {
+      pos[i].s() += 0.5;
+      pos[i].t() += 0.5;
+    }
+  }
+
+  // generate texture coords, same as generate*TexCoords()
+  const Image* img = mState.mImage.get();
+  std::vector<fvec2>& tex = batch->mPointTexCoords;
+  if (img)
+  {
+    tex.resize(count);
+    float u1 = 1.0f / img->width() * 0.5f;
+    float u2 = 1.0f - 1.0f / img->width() * 0.5f;
+    AABB aabb;
+    switch(tex_gen)
+    {
+    case TexGen_None:
+      for(int i=0; i<count; ++i)
+        tex[i] = fvec2(0,0);
+      break;
+    case TexGen_Lines:
+      for(int i=0; i<count; ++i)
+        tex[i] = fvec2(i%2 ? u2 : u1, 0);
+      break;
+    case TexGen_Linear:
+      for(int i=0; i<count; ++i)
+      {
+        float t = count > 1 ? (float)i/(count-1) : 0.0f;
+        tex[i] = fvec2(u1 * (1.0f-t) + u2 * t, 0);
+      }
+      break;
+    case TexGen_Quads:
+      if (mState.mTextureMode == TextureMode_Clamp)
+      {
+        float du = 1.0f / img->width()  / 2.0f;
+        float dv = img->height() ? (1.0f / img->height() / 2.0f) : 0.5f;
+        fvec2 texc[] = { fvec2(du,dv), fvec2(du,1.0f-dv), fvec2(1.0f-du,1.0f-dv), fvec2(1.0f-du,dv) };
+        for(int i=0; i<count; ++i)
+          tex[i] = texc[i%4];
+      }
+      else
+      {
+        for(int i=0; i<count; ++i)
+          aabb.addPoint( (vec3)pos[i] );
+        for(int i=0; i<count; ++i)
+        {
+          tex[i].s() = (float)((pos[i].x()-aabb.minCorner().x()) / img->width() );
+          tex[i].t() = (float)((pos[i].y()-aabb.minCorner().y()) / img->height());
+        }
+      }
+      break;
+    case TexGen_Planar:
+      if (mState.mTextureMode == TextureMode_Clamp)
+      {
+        for(int i=0; i<count; ++i)
+          aabb.addPoint( (vec3)dvec3(points[i],0.0) );
+        for(int i=0; i<count; ++i)
+        {
+          tex[i].s() = aabb.width()  ? float((points[i].x() - aabb.minCorner().x()) / aabb.width() ) : 0;
+          tex[i].t() = aabb.height() ? float((points[i].y() - aabb.minCorner().y()) / aabb.height()) : 0;
+        }
+      }
+      else
+      {
+        for(int i=0; i<count; ++i)
+          aabb.addPoint( (vec3)pos[i]+vec3(0.5f,0.5f,0.0f) );
+        for(int i=0; i<count; ++i)
+        {
+          tex[i].s() = (float)((pos[i].x()-aabb.minCorner().x()) / img->width() );
+          tex[i].t() = (float)((pos[i].y()-aabb.minCorner().y()) / img->height());
+        }
+      }
+      break;
+    }
+  }
+
+  // convert strips, loops and fans to list primitives so that they can be merged in a single draw call
+  std::vector<int>& idx = batch->mIndices;
+  idx.clear();
+  EPrimitiveType batch_type = type;
+  switch(type)
+  {
+  case PT_LINE_STRIP:
+  case PT_LINE_LOOP:
+    // stippled lines keep their type since the stipple pattern would restart at every segment
+    if (mState.mLineStipple != 0xFFFF)
+      break;
+    batch_type = PT_LINES;
+    for(int i=0; i<count-1; ++i)
+    {
+      idx.push_back(i);
+      idx.push_back(i+1);
+    }
+    if (type == PT_LINE_LOOP && count > 2)
+    {
+      idx.push_back(count-1);
+      idx.push_back(0);
+    }
+    break;
+  case PT_TRIANGLE_FAN:
+    batch_type = PT_TRIANGLES;
+    for(int i=1; i<count-1; ++i)
+    {
+      idx.push_back(0);
+      idx.push_back(i);
+      idx.push_back(i+1);
+    }
+    break;
+  case PT_TRIANGLE_STRIP:
+    batch_type = PT_TRIANGLES;
+    for(int i=0; i<count-2; ++i)
+    {
+      // keep a consistent winding
+      idx.push_back(i%2 ? i+1 : i);
+      idx.push_back(i%2 ? i : i+1);
+      idx.push_back(i+2);
+    }
+    break;
+  case PT_QUAD_STRIP:
+    batch_type = PT_QUADS;
+    for(int i=0; i+3<count; i+=2)
+    {
+      idx.push_back(i);
+      idx.push_back(i+1);
+      idx.push_back(i+3);
+      idx.push_back(i+2);
+    }
+    break;
+  default:
+    break;
+  }
+
+  int start = (int)batch->mPositions.size();
+  if (batch_type == type)
+  {
+    // drop incomplete primitives which would otherwise corrupt the ones that follow
+    int n = count;
+    if (type == PT_LINES)     n -= n % 2; else
+    if (type == PT_TRIANGLES) n -= n % 3; else
+    if (type == PT_QUADS)     n -= n % 4;
+    batch->mPositions.insert(batch->mPositions.end(), pos.begin(), pos.begin()+n);
+    if (img)
+      batch->mTexCoords.insert(batch->mTexCoords.end(), tex.begin(), tex.begin()+n);
+  }
+  else
+  {
+    for(size_t i=0; i<idx.size(); ++i)
+    {
+      batch->mPositions.push_back(pos[idx[i]]);
+      if (img)
+        batch->mTexCoords.push_back(tex[idx[i]]);
+    }
+  }
+  int added = (int)batch->mPositions.size() - start;
+  if (!added)
+    return batch->mActor.get();
+
+  // extend the last draw call if possible
+  bool list_type = batch_type == PT_POINTS || batch_type == PT_LINES || batch_type == PT_TRIANGLES || batch_type == PT_QUADS;
+  DrawArrays* last = batch->mDrawCallCount ? batch->mDrawCalls[batch->mDrawCallCount-1].get() : NULL;
+  if (list_type && last && last->primitiveType() == batch_type)
+    last->setCount(last->count() + added);
+  else
+  {
+    if (batch->mDrawCallCount == (int)batch->mDrawCalls.size())
+      batch->mDrawCalls.push_back(new DrawArrays);
+    DrawArrays* da = batch->mDrawCalls[batch->mDrawCallCount++].get();
+    da->setPrimitiveType(batch_type);
+    da->setStart(start);
+    da->setCount(added);
+  }
+
+  return batch->mActor.get();
+}
+//-----------------------------------------------------------------------------
+void VectorGraphics::flushBatch()
+{
+  if (!mCurrentBatch)
+    return;
+  Batch* batch = mCurrentBatch;
+  mCurrentBatch = NULL;
+
+  Geometry* geom = batch->mGeometry.get();
+  // the arrays are reallocated only if their size changed since the last time the batch was used
+  batch->mVertexArray->resize(batch->mPositions.size());
+  if (!batch->mPositions.empty())
+    memcpy(batch->mVertexArray->ptr(), &batch->mPositions[0], batch->mPositions.size()*sizeof(fvec3));
+  geom->setVertexArray(batch->mVertexArray.get());
+  if (!batch->mTexCoords.empty())
+  {
+    batch->mTexCoordArray->resize(batch->mTexCoords.size());
+    memcpy(batch->mTexCoordArray->ptr(), &batch->mTexCoords[0], batch->mTexCoords.size()*sizeof(fvec2));
+    geom->setTexCoordArray(0, batch->mTexCoordArray.get());
+  }
+  else
+    geom->setTexCoordArray(0, NULL);
+
+  geom->drawCalls()->clear();
+  for(int i=0; i<batch->mDrawCallCount; ++i)
+    geom->drawCalls()->push_back( batch->mDrawCalls[i].get() );
+
+  geom->setBoundsDirty(true);
+  geom->setBufferObjectDirty(true);
+  geom->setDisplayListDirty(true);
+}
+//-----------------------------------------------------------------------------
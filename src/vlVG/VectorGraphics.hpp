@@ -101,6 +101,11 @@ namespace vl
    * - Line and point smoothing
    * - Color logic operations
    *
+   * By default every draw or fill call generates its own Actor and Geometry. When many primitives are drawn, for example
+   * when a dashboard is redrawn every frame, enable the batching mode with setBatchingEnabled(): consecutive primitives 
+   * sharing the same state and scissor are then accumulated in a single Actor and rendered with as few draw calls as 
+   * possible, and the Actor[s], Geometry[s] and buffers are reused across startDrawing() / endDrawing() cycles.
+   *
    * For more information please refer to the \ref pagGuideVectorGraphics "2D Vector Graphics" page.
    */
   class VLVG_EXPORT VectorGraphics: public Object
@@ -321,6 +326,27 @@ namespace vl
           return false;
       }
     };
+    //------------------------------------------------------------------------- start internal
+    //! \internal
+    //! The primitives accumulated in batching mode, see setBatchingEnabled().
+    class Batch: public Object
+    {
+    public:
+      ref<Actor> mActor;
+      ref<Geometry> mGeometry;
+      ref<ArrayFloat3> mVertexArray;
+      ref<ArrayFloat2> mTexCoordArray;
+      std::vector< ref<DrawArrays> > mDrawCalls;
+      std::vector<fvec3> mPositions;
+      std::vector<fvec2> mTexCoords;
+      int mDrawCallCount;
+      // per primitive scratch buffers
+      std::vector<fvec3> mPointPositions;
+      std::vector<fvec2> mPointTexCoords;
+      std::vector<int> mIndices;
+    };
+    //! \internal
+    typedef enum { TexGen_None, TexGen_Lines, TexGen_Linear, TexGen_Planar, TexGen_Quads } ETexGen;
     //------------------------------------------------------------------------- end internal
 
   public:    
@@ -395,6 +421,17 @@ namespace vl
     //! Resets the VectorGraphics removing all the graphics objects and resetting its internal state.
     void clear();
 
+    /** Enables or disables the batching mode (disabled by default).
+     * In batching mode consecutive primitives drawn with the same state and scissor are accumulated in the same Actor 
+     * and Geometry: list primitives are merged into a single draw call while strips, fans and polygons are converted 
+     * to lines, triangles and quads. The draw and fill functions then return the Actor shared by the whole batch.
+     * The batch geometry is finalized by endDrawing() or when an Actor that cannot be batched (text, clears etc.) is added.
+     * The Actor[s] and buffers used by the batches are reused across startDrawing() calls. */
+    void setBatchingEnabled(bool enabled);
+
+    //! Whether the batching mode is enabled, see setBatchingEnabled().
+    bool batchingEnabled() const { return mBatchingEnabled; }
+
     //! The current color. Note that the current color also modulates the currently active image.
     void setColor(const fvec4& color) { mState.mColor = color; }
 
@@ -659,6 +696,10 @@ namespace vl
 
     Actor* addActor(Actor* actor) ;
 
+    Actor* batchPrimitive(EPrimitiveType type, const std::vector<dvec2>& points, ETexGen tex_gen);
+
+    void flushBatch();
+
   private:
     // state-machine state variables
     State mState;
@@ -673,6 +714,11 @@ namespace vl
     std::map<RectI, ref<Scissor> > mRectToScissorMap;
     ref<Effect> mDefaultEffect;
     ActorCollection mActors;
+    // batching mode
+    std::vector< ref<Batch> > mBatchPool;
+    int mBatchCount;
+    Batch* mCurrentBatch;
+    bool mBatchingEnabled;
   };
 //-------------------------------------------------------------------------------------------------------------------------------------------
 }
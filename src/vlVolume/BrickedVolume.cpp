@@ -0,0 +1,623 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/BrickedVolume.hpp>
+#include <vlCore/ImageView.hpp>
+#include <vlCore/FileSystem.hpp>
+#include <vlCore/VirtualDirectory.hpp>
+#include <vlCore/ZippedFile.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  //! The size in bytes of a voxel of the given type, 0 if the type is not supported.
+  int voxelSize(EImageType type)
+  {
+    switch(type)
+    {
+    case IT_UNSIGNED_BYTE:
+    case IT_BYTE:           return 1;
+    case IT_UNSIGNED_SHORT:
+    case IT_SHORT:
+    case IT_HALF_FLOAT:     return 2;
+    case IT_UNSIGNED_INT:
+    case IT_INT:
+    case IT_FLOAT:          return 4;
+    default:                return 0;
+    }
+  }
+
+  template<typename T>
+  void rangeT(const void* data, size_t count, Volume::Cube& range)
+  {
+    const T* p = (const T*)data;
+    float vmin = (float)p[0];
+    float vmax = vmin;
+    for(size_t i=1; i<count; ++i)
+    {
+      float v = (float)p[i];
+      if (v < vmin) vmin = v;
+      if (v > vmax) vmax = v;
+    }
+    range.mMin = vmin;
+    range.mMax = vmax;
+  }
+
+  template<typename T>
+  void toFloatT(const void* data, size_t count, float* out)
+  {
+    const T* p = (const T*)data;
+    for(size_t i=0; i<count; ++i)
+      out[i] = (float)p[i];
+  }
+
+  template<> void toFloatT<half>(const void* data, size_t count, float* out)
+  {
+    half::convertHalfToFloat((const half*)data, out, (int)count);
+  }
+
+  //! Computes the min/max values of \p count voxels of the given type.
+  void computeRange(EImageType type, const void* data, size_t count, Volume::Cube& range)
+  {
+    switch(type)
+    {
+    case IT_UNSIGNED_BYTE:  rangeT<unsigned char> (data, count, range); break;
+    case IT_BYTE:           rangeT<GLbyte>        (data, count, range); break;
+    case IT_UNSIGNED_SHORT: rangeT<unsigned short>(data, count, range); break;
+    case IT_SHORT:          rangeT<short>         (data, count, range); break;
+    case IT_UNSIGNED_INT:   rangeT<unsigned int>  (data, count, range); break;
+    case IT_INT:            rangeT<int>           (data, count, range); break;
+    case IT_FLOAT:          rangeT<float>         (data, count, range); break;
+    case IT_HALF_FLOAT:     rangeT<half>          (data, count, range); break;
+    default: break;
+    }
+  }
+
+  //! Converts \p count voxels of the given type to float.
+  void toFloat(EImageType type, const void* data, size_t count, float* out)
+  {
+    switch(type)
+    {
+    case IT_UNSIGNED_BYTE:  toFloatT<unsigned char> (data, count, out); break;
+    case IT_BYTE:           toFloatT<GLbyte>        (data, count, out); break;
+    case IT_UNSIGNED_SHORT: toFloatT<unsigned short>(data, count, out); break;
+    case IT_SHORT:          toFloatT<short>         (data, count, out); break;
+    case IT_UNSIGNED_INT:   toFloatT<unsigned int>  (data, count, out); break;
+    case IT_INT:            toFloatT<int>           (data, count, out); break;
+    case IT_FLOAT:          toFloatT<float>         (data, count, out); break;
+    case IT_HALF_FLOAT:     toFloatT<half>          (data, count, out); break;
+    default: break;
+    }
+  }
+
+  //! Groups the n-th bytes of all the voxels together, which makes multi-byte data much more compressible.
+  void shuffleBytes(const unsigned char* src, unsigned char* dst, size_t count, int voxel_size)
+  {
+    for(int k=0; k<voxel_size; ++k)
+      for(size_t i=0; i<count; ++i)
+        dst[k*count + i] = src[i*voxel_size + k];
+  }
+
+  void unshuffleBytes(const unsigned char* src, unsigned char* dst, size_t count, int voxel_size)
+  {
+    for(int k=0; k<voxel_size; ++k)
+      for(size_t i=0; i<count; ++i)
+        dst[i*voxel_size + k] = src[k*count + i];
+  }
+
+  //! Computes the range of output samples [o0, o1) whose coordinate origin + o*step falls in [lo, hi).
+  void outputRange(int origin, int step, int lo, int hi, int size, int& o0, int& o1)
+  {
+    o0 = lo > origin ? (lo - origin + step - 1) / step : 0;
+    o1 = hi > origin ? (hi - origin + step - 1) / step : 0;
+    if (o1 > size)
+      o1 = size;
+  }
+
+  //! Copies a box of \p dims voxels between two images with rows of \p src_pitch and \p dst_pitch bytes.
+  void copyBox(const unsigned char* src, int src_pitch, int src_height, unsigned char* dst, int dst_pitch, int dst_height, const ivec3& dims, int voxel_size)
+  {
+    for(int z=0; z<dims.z(); ++z)
+      for(int y=0; y<dims.y(); ++y)
+        memcpy(dst + ((size_t)z*dst_height + y)*dst_pitch, src + ((size_t)z*src_height + y)*src_pitch, (size_t)dims.x()*voxel_size);
+  }
+}
+//-----------------------------------------------------------------------------
+// ImageVolumeSource
+//-----------------------------------------------------------------------------
+ImageVolumeSource::ImageVolumeSource(const Image* img)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mImage = const_cast<Image*>(img);
+  if (img && (img->dimension() != ID_3D || !voxelSize(img->type()) || (img->format() != IF_LUMINANCE && img->format() != IF_RED && img->format() != IF_ALPHA)))
+  {
+    Log::error("ImageVolumeSource: the image must be a 3D image with one component of type byte, short, int, half or float.\n");
+    mImage = NULL;
+  }
+}
+//-----------------------------------------------------------------------------
+ivec3 ImageVolumeSource::size() const
+{
+  return mImage ? ivec3(mImage->width(), mImage->height(), mImage->depth()) : ivec3(0,0,0);
+}
+//-----------------------------------------------------------------------------
+EImageType ImageVolumeSource::type() const
+{
+  return mImage ? mImage->type() : IT_UNSIGNED_BYTE;
+}
+//-----------------------------------------------------------------------------
+bool ImageVolumeSource::read(const ivec3& origin, Image* dst)
+{
+  if (!mImage)
+    return false;
+  VL_CHECK(dst->type() == mImage->type())
+  int vsize = voxelSize(mImage->type());
+  const unsigned char* src = mImage->pixels() + ((size_t)origin.z()*mImage->height() + origin.y())*mImage->pitch() + (size_t)origin.x()*vsize;
+  copyBox(src, mImage->pitch(), mImage->height(), dst->pixels(), dst->pitch(), dst->height(), ivec3(dst->width(), dst->height(), dst->depth()), vsize);
+  return true;
+}
+//-----------------------------------------------------------------------------
+// RawVolumeSource
+//-----------------------------------------------------------------------------
+RawVolumeSource::RawVolumeSource(VirtualFile* file, long long file_offset, const ivec3& size, EImageType type)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mFile       = file;
+  mFileOffset = file_offset;
+  mSize       = size;
+  mType       = type;
+  if (!voxelSize(type))
+  {
+    Log::error("RawVolumeSource: unsupported voxel type.\n");
+    mFile = NULL;
+  }
+}
+//-----------------------------------------------------------------------------
+bool RawVolumeSource::read(const ivec3& origin, Image* dst)
+{
+  if (!mFile)
+    return false;
+  if (!mFile->isOpen() && !mFile->open(OM_ReadOnly))
+  {
+    Log::error( Say("RawVolumeSource: could not open '%s'.\n") << mFile->path() );
+    return false;
+  }
+
+  const int vsize = voxelSize(mType);
+  const long long row_bytes = (long long)dst->width() * vsize;
+  for(int z=0; z<dst->depth(); ++z)
+  {
+    for(int y=0; y<dst->height(); )
+    {
+      long long pos = mFileOffset + (((long long)(origin.z()+z)*mSize.y() + origin.y()+y)*mSize.x() + origin.x()) * vsize;
+      unsigned char* ptr = dst->pixels() + ((size_t)z*dst->height() + y)*dst->pitch();
+      // full width bricks are contiguous in the file and can be read with a single call per slice
+      int rows = dst->width() == mSize.x() && dst->pitch() == row_bytes ? dst->height() : 1;
+      if (!mFile->seekSet(pos) || mFile->read(ptr, row_bytes*rows) != row_bytes*rows)
+      {
+        Log::error( Say("RawVolumeSource: error reading '%s'.\n") << mFile->path() );
+        return false;
+      }
+      y += rows;
+    }
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+// SliceVolumeSource
+//-----------------------------------------------------------------------------
+SliceVolumeSource::SliceVolumeSource(const std::vector<String>& slice_paths)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mSlicePaths = slice_paths;
+  mSlices.resize(slice_paths.size());
+  mSliceCacheSize = 64;
+  mSize = ivec3(0,0,0);
+  mType = IT_UNSIGNED_BYTE;
+  if (mSlicePaths.empty())
+    return;
+
+  // the first slice determines the size and type of the volume
+  mSize = ivec3(1, 1, (int)mSlicePaths.size());
+  const Image* img = slice(0);
+  if (img)
+  {
+    mSize = ivec3(img->width(), img->height(), (int)mSlicePaths.size());
+    mType = img->type();
+  }
+  else
+    mSize = ivec3(0,0,0);
+}
+//-----------------------------------------------------------------------------
+ref<SliceVolumeSource> SliceVolumeSource::fromDirectory(const String& dir_path, const String& ext)
+{
+  std::vector<String> paths;
+  ref<VirtualDirectory> dir = defFileSystem()->locateDirectory(dir_path);
+  if (!dir)
+  {
+    Log::error( Say("SliceVolumeSource: directory '%s' not found.\n") << dir_path );
+    return NULL;
+  }
+  std::vector<String> files;
+  dir->listFiles(files);
+  std::sort(files.begin(), files.end());
+  for(unsigned i=0; i<files.size(); ++i)
+  {
+    if (files[i].extractFileExtension().toLowerCase() == ext.toLowerCase())
+      paths.push_back(files[i]);
+  }
+  return new SliceVolumeSource(paths);
+}
+//-----------------------------------------------------------------------------
+const Image* SliceVolumeSource::slice(int z)
+{
+  VL_CHECK(z >= 0 && z < (int)mSlices.size())
+  if (mSlices[z])
+  {
+    mSliceLRU.remove(z);
+    mSliceLRU.push_front(z);
+    return mSlices[z].get();
+  }
+
+  ref<Image> img = loadImage(mSlicePaths[z]);
+  if (!img)
+    return NULL;
+  if (img->format() != IF_LUMINANCE)
+    img = img->convertFormat(IF_LUMINANCE);
+  if (img && z > 0 && img->type() != mType)
+    img = img->convertType(mType);
+  if (!img || !voxelSize(img->type()) || (z > 0 && (img->width() != mSize.x() || img->height() != mSize.y())))
+  {
+    Log::error( Say("SliceVolumeSource: slice '%s' is not compatible with the volume.\n") << mSlicePaths[z] );
+    return NULL;
+  }
+
+  mSlices[z] = img;
+  mSliceLRU.push_front(z);
+  while((int)mSliceLRU.size() > mSliceCacheSize && mSliceLRU.size() > 1)
+  {
+    mSlices[mSliceLRU.back()] = NULL;
+    mSliceLRU.pop_back();
+  }
+  return img.get();
+}
+//-----------------------------------------------------------------------------
+bool SliceVolumeSource::read(const ivec3& origin, Image* dst)
+{
+  const int vsize = voxelSize(mType);
+  for(int z=0; z<dst->depth(); ++z)
+  {
+    const Image* img = slice(origin.z() + z);
+    if (!img)
+      return false;
+    const unsigned char* src = img->pixels() + (size_t)origin.y()*img->pitch() + (size_t)origin.x()*vsize;
+    copyBox(src, img->pitch(), img->height(), dst->pixelsZSlice(z), dst->pitch(), dst->height(), ivec3(dst->width(), dst->height(), 1), vsize);
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+// BrickedVolume
+//-----------------------------------------------------------------------------
+BrickedVolume::BrickedVolume(VolumeSource* source, int brick_size)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mSource = source;
+  mSize = source->size();
+  mType = source->type();
+  mBrickSize = brick_size > 0 ? brick_size : 64;
+  mBrickCount = ivec3(0,0,0);
+  mCacheSize = 512*1024*1024;
+  mCompressedCacheSize = 0;
+  mCacheMemory = 0;
+  mCompressedMemory = 0;
+  mCacheHits = 0;
+  mCacheMisses = 0;
+  mBottomLeft = fvec3(0,0,0);
+  mTopRight = (fvec3)(mSize - ivec3(1,1,1));
+
+  if (!voxelSize(mType) || mSize.x() < 1 || mSize.y() < 1 || mSize.z() < 1)
+  {
+    Log::error("BrickedVolume: invalid volume source.\n");
+    mSize = ivec3(0,0,0);
+    return;
+  }
+
+  mBrickCount = (mSize + ivec3(mBrickSize-1, mBrickSize-1, mBrickSize-1)) / mBrickSize;
+  mBricks.resize(mBrickCount.x() * mBrickCount.y() * mBrickCount.z());
+}
+//-----------------------------------------------------------------------------
+ivec3 BrickedVolume::brickDimensions(int bx, int by, int bz) const
+{
+  ivec3 dims = mSize - brickOrigin(bx, by, bz);
+  return ivec3( dims.x() < mBrickSize ? dims.x() : mBrickSize, 
+                dims.y() < mBrickSize ? dims.y() : mBrickSize, 
+                dims.z() < mBrickSize ? dims.z() : mBrickSize );
+}
+//-----------------------------------------------------------------------------
+bool BrickedVolume::isCached(int bx, int by, int bz) const
+{
+  const BrickEntry& entry = mBricks[brickIndex(bx, by, bz)];
+  return entry.mCached || entry.mCompressedCached;
+}
+//-----------------------------------------------------------------------------
+bool BrickedVolume::brickRange(int bx, int by, int bz, Volume::Cube& range) const
+{
+  const BrickEntry& entry = mBricks[brickIndex(bx, by, bz)];
+  range = entry.mRange;
+  return entry.mRangeValid;
+}
+//-----------------------------------------------------------------------------
+void BrickedVolume::touch(int index)
+{
+  mLRU.splice(mLRU.begin(), mLRU, mBricks[index].mLRU);
+}
+//-----------------------------------------------------------------------------
+ref<Image> BrickedVolume::brick(int bx, int by, int bz)
+{
+  VL_CHECK(bx >= 0 && by >= 0 && bz >= 0 && bx < mBrickCount.x() && by < mBrickCount.y() && bz < mBrickCount.z())
+  const int index = brickIndex(bx, by, bz);
+  BrickEntry& entry = mBricks[index];
+  if (entry.mCached)
+  {
+    ++mCacheHits;
+    touch(index);
+    return entry.mImage;
+  }
+
+  const ivec3 dims = brickDimensions(bx, by, bz);
+  const int vsize = voxelSize(mType);
+  const size_t count = (size_t)dims.x() * dims.y() * dims.z();
+  ref<Image> img = new Image(dims.x(), dims.y(), dims.z(), 1, IF_LUMINANCE, mType);
+
+  if (entry.mCompressedCached)
+  {
+    ++mCacheHits;
+    bool ok;
+    if (vsize > 1)
+    {
+      std::vector<unsigned char> shuffled(count * vsize);
+      ok = decompress(&entry.mCompressed[0], entry.mCompressed.size(), &shuffled[0]);
+      unshuffleBytes(&shuffled[0], img->pixels(), count, vsize);
+    }
+    else
+      ok = decompress(&entry.mCompressed[0], entry.mCompressed.size(), img->pixels());
+    mCompressedMemory -= (long long)entry.mCompressed.size();
+    mCompressedLRU.erase(entry.mCompressedLRU);
+    std::vector<unsigned char>().swap(entry.mCompressed);
+    entry.mCompressedCached = false;
+    if (!ok)
+    {
+      Log::error("BrickedVolume: brick decompression failed.\n");
+      return NULL;
+    }
+  }
+  else
+  {
+    ++mCacheMisses;
+    if (!mSource->read(brickOrigin(bx, by, bz), img.get()))
+    {
+      Log::error( Say("BrickedVolume: could not read brick %n %n %n.\n") << bx << by << bz );
+      return NULL;
+    }
+    if (!entry.mRangeValid)
+    {
+      computeRange(mType, img->pixels(), count, entry.mRange);
+      entry.mRangeValid = true;
+    }
+  }
+
+  entry.mImage = img;
+  entry.mCached = true;
+  mLRU.push_front(index);
+  entry.mLRU = mLRU.begin();
+  mCacheMemory += (long long)count * vsize;
+  trimCache();
+  return img;
+}
+//-----------------------------------------------------------------------------
+void BrickedVolume::trimCache()
+{
+  const int vsize = voxelSize(mType);
+
+  // evict the least recently used bricks, compressing them if requested
+  while(mCacheMemory > mCacheSize && mLRU.size() > 1)
+  {
+    const int index = mLRU.back();
+    mLRU.pop_back();
+    BrickEntry& entry = mBricks[index];
+    Image* img = entry.mImage.get();
+    const size_t count = (size_t)img->width() * img->height() * img->depth();
+    mCacheMemory -= (long long)count * vsize;
+
+    if (mCompressedCacheSize > 0)
+    {
+      bool ok;
+      if (vsize > 1)
+      {
+        std::vector<unsigned char> shuffled(count * vsize);
+        shuffleBytes(img->pixels(), &shuffled[0], count, vsize);
+        ok = compress(&shuffled[0], shuffled.size(), entry.mCompressed, 1);
+      }
+      else
+        ok = compress(img->pixels(), count, entry.mCompressed, 1);
+      if (ok && (long long)entry.mCompressed.size() <= mCompressedCacheSize)
+      {
+        mCompressedLRU.push_front(index);
+        entry.mCompressedLRU = mCompressedLRU.begin();
+        entry.mCompressedCached = true;
+        mCompressedMemory += (long long)entry.mCompressed.size();
+      }
+      else
+        std::vector<unsigned char>().swap(entry.mCompressed);
+    }
+
+    entry.mImage = NULL;
+    entry.mCached = false;
+  }
+
+  while(mCompressedMemory > mCompressedCacheSize && !mCompressedLRU.empty())
+  {
+    BrickEntry& entry = mBricks[mCompressedLRU.back()];
+    mCompressedLRU.pop_back();
+    mCompressedMemory -= (long long)entry.mCompressed.size();
+    std::vector<unsigned char>().swap(entry.mCompressed);
+    entry.mCompressedCached = false;
+  }
+}
+//-----------------------------------------------------------------------------
+void BrickedVolume::clearCache()
+{
+  for(size_t i=0; i<mBricks.size(); ++i)
+  {
+    mBricks[i].mImage = NULL;
+    mBricks[i].mCached = false;
+    mBricks[i].mCompressedCached = false;
+    std::vector<unsigned char>().swap(mBricks[i].mCompressed);
+  }
+  mLRU.clear();
+  mCompressedLRU.clear();
+  mCacheMemory = 0;
+  mCompressedMemory = 0;
+}
+//-----------------------------------------------------------------------------
+void BrickedVolume::computeBrickRanges()
+{
+  for(int bz=0; bz<mBrickCount.z(); ++bz)
+    for(int by=0; by<mBrickCount.y(); ++by)
+      for(int bx=0; bx<mBrickCount.x(); ++bx)
+        if (!mBricks[brickIndex(bx, by, bz)].mRangeValid)
+          brick(bx, by, bz);
+}
+//-----------------------------------------------------------------------------
+float BrickedVolume::value(int x, int y, int z)
+{
+  VL_CHECK(x >= 0 && y >= 0 && z >= 0 && x < mSize.x() && y < mSize.y() && z < mSize.z())
+  ref<Image> img = brick(x / mBrickSize, y / mBrickSize, z / mBrickSize);
+  if (!img)
+    return 0;
+  const int vsize = voxelSize(mType);
+  const unsigned char* ptr = img->pixels() + ((size_t)(z % mBrickSize)*img->height() + y % mBrickSize)*img->pitch() + (size_t)(x % mBrickSize)*vsize;
+  float v = 0;
+  toFloat(mType, ptr, 1, &v);
+  return v;
+}
+//-----------------------------------------------------------------------------
+ref<Image> BrickedVolume::image(const ivec3& origin, const ivec3& size, int step)
+{
+  if (step < 1 || size.x() < 1 || size.y() < 1 || size.z() < 1 ||
+      origin.x() < 0 || origin.y() < 0 || origin.z() < 0 ||
+      origin.x() + (size.x()-1)*step >= mSize.x() || 
+      origin.y() + (size.y()-1)*step >= mSize.y() || 
+      origin.z() + (size.z()-1)*step >= mSize.z())
+  {
+    Log::error("BrickedVolume::image(): the requested region exceeds the volume.\n");
+    return NULL;
+  }
+
+  const int vsize = voxelSize(mType);
+  const ivec3 last = origin + (size - ivec3(1,1,1)) * step;
+  ref<Image> img = new Image(size.x(), size.y(), size.z(), 1, IF_LUMINANCE, mType);
+
+  // bricks are visited in storage order, those not containing any output voxel are not read
+  for(int bz=origin.z()/mBrickSize; bz<=last.z()/mBrickSize; ++bz)
+  {
+    int z0, z1;
+    outputRange(origin.z(), step, bz*mBrickSize, (bz+1)*mBrickSize, size.z(), z0, z1);
+    if (z0 >= z1)
+      continue;
+    for(int by=origin.y()/mBrickSize; by<=last.y()/mBrickSize; ++by)
+    {
+      int y0, y1;
+      outputRange(origin.y(), step, by*mBrickSize, (by+1)*mBrickSize, size.y(), y0, y1);
+      if (y0 >= y1)
+        continue;
+      for(int bx=origin.x()/mBrickSize; bx<=last.x()/mBrickSize; ++bx)
+      {
+        int x0, x1;
+        outputRange(origin.x(), step, bx*mBrickSize, (bx+1)*mBrickSize, size.x(), x0, x1);
+        if (x0 >= x1)
+          continue;
+
+        ref<Image> src_img = brick(bx, by, bz);
+        if (!src_img)
+          return NULL;
+
+        const ivec3 src0 = origin + ivec3(x0, y0, z0) * step - brickOrigin(bx, by, bz);
+        if (step == 1)
+        {
+          const unsigned char* src = src_img->pixels() + ((size_t)src0.z()*src_img->height() + src0.y())*src_img->pitch() + (size_t)src0.x()*vsize;
+          unsigned char* dst = img->pixels() + ((size_t)z0*img->height() + y0)*img->pitch() + (size_t)x0*vsize;
+          copyBox(src, src_img->pitch(), src_img->height(), dst, img->pitch(), img->height(), ivec3(x1-x0, y1-y0, z1-z0), vsize);
+        }
+        else
+        {
+          for(int z=z0, sz=src0.z(); z<z1; ++z, sz+=step)
+          {
+            for(int y=y0, sy=src0.y(); y<y1; ++y, sy+=step)
+            {
+              const unsigned char* src = src_img->pixels() + ((size_t)sz*src_img->height() + sy)*src_img->pitch() + (size_t)src0.x()*vsize;
+              unsigned char* dst = img->pixels() + ((size_t)z*img->height() + y)*img->pitch() + (size_t)x0*vsize;
+              for(int x=x0; x<x1; ++x, src+=step*vsize, dst+=vsize)
+                memcpy(dst, src, vsize);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return img;
+}
+//-----------------------------------------------------------------------------
+ref<Volume> BrickedVolume::volume(const ivec3& min_voxel, const ivec3& max_voxel)
+{
+  ref<Image> img = image(min_voxel, max_voxel - min_voxel + ivec3(1,1,1));
+  if (!img)
+    return NULL;
+
+  const ivec3 slices(img->width(), img->height(), img->depth());
+  fvec3 cell_size = mTopRight - mBottomLeft;
+  for(int i=0; i<3; ++i)
+    cell_size[i] = mSize[i] > 1 ? cell_size[i] / (mSize[i] - 1) : 0;
+  fvec3 bottom_left = mBottomLeft + cell_size * (fvec3)min_voxel;
+  fvec3 top_right   = mBottomLeft + cell_size * (fvec3)max_voxel;
+
+  ref<Volume> vol = new Volume;
+  vol->setup(NULL, false, false, bottom_left, top_right, slices);
+  toFloat(mType, img->pixels(), (size_t)slices.x() * slices.y() * slices.z(), vol->values());
+  return vol;
+}
+//-----------------------------------------------------------------------------
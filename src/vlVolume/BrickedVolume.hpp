@@ -0,0 +1,307 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef BrickedVolume_INCLUDE_ONCE
+#define BrickedVolume_INCLUDE_ONCE
+
+#include <vlVolume/MarchingCubes.hpp>
+#include <vlCore/Image.hpp>
+#include <vlCore/VirtualFile.hpp>
+#include <list>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // VolumeSource
+  //------------------------------------------------------------------------------
+  /**
+   * Provides on demand the voxels of a scalar volume that is possibly too large to fit in memory. 
+   * A VolumeSource is usually used through a BrickedVolume which caches the data read.
+   * \sa ImageVolumeSource, RawVolumeSource, SliceVolumeSource
+   */
+  class VLVOLUME_EXPORT VolumeSource: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VolumeSource, Object)
+
+  public:
+    //! The number of voxels along x, y and z.
+    virtual ivec3 size() const = 0;
+
+    //! The type of the voxels, the format is always IF_LUMINANCE. 
+    virtual EImageType type() const = 0;
+
+    //! Fills \p dst with the voxels starting at \p origin. 
+    //! \p dst is a 3D IF_LUMINANCE Image of type() with byte alignment 1 entirely contained in the volume.
+    virtual bool read(const ivec3& origin, Image* dst) = 0;
+  };
+  //------------------------------------------------------------------------------
+  // ImageVolumeSource
+  //------------------------------------------------------------------------------
+  //! A VolumeSource reading from a 3D Image with a single component per voxel, mainly useful to process in-memory and out-of-core data with the same code.
+  class VLVOLUME_EXPORT ImageVolumeSource: public VolumeSource
+  {
+    VL_INSTRUMENT_CLASS(vl::ImageVolumeSource, VolumeSource)
+
+  public:
+    ImageVolumeSource(const Image* img);
+
+    virtual ivec3 size() const;
+
+    virtual EImageType type() const;
+
+    virtual bool read(const ivec3& origin, Image* dst);
+
+    const Image* image() const { return mImage.get(); }
+
+  protected:
+    ref<Image> mImage;
+  };
+  //------------------------------------------------------------------------------
+  // RawVolumeSource
+  //------------------------------------------------------------------------------
+  //! A VolumeSource reading the voxels from a raw file (x fastest, then y, then z) on demand, see also loadRAW().
+  class VLVOLUME_EXPORT RawVolumeSource: public VolumeSource
+  {
+    VL_INSTRUMENT_CLASS(vl::RawVolumeSource, VolumeSource)
+
+  public:
+    //! \param file The raw file, it is opened when needed and kept open.
+    //! \param file_offset The position in the file of the first voxel.
+    //! \param size The number of voxels along x, y and z.
+    //! \param type The type of the voxels.
+    RawVolumeSource(VirtualFile* file, long long file_offset, const ivec3& size, EImageType type);
+
+    virtual ivec3 size() const { return mSize; }
+
+    virtual EImageType type() const { return mType; }
+
+    virtual bool read(const ivec3& origin, Image* dst);
+
+  protected:
+    ref<VirtualFile> mFile;
+    long long mFileOffset;
+    ivec3 mSize;
+    EImageType mType;
+  };
+  //------------------------------------------------------------------------------
+  // SliceVolumeSource
+  //------------------------------------------------------------------------------
+  /**
+   * A VolumeSource whose Z slices are stored in separate 2D image files (for example DICOM, TIFF or PNG stacks) that are loaded lazily.
+   * 
+   * The most recently used slices are kept in memory, see setSliceCacheSize(). Since a BrickedVolume reads a whole layer of 
+   * bricks before moving to the next one the slice cache should be at least as large as the BrickedVolume brick size, otherwise
+   * the same slices are loaded once for every brick of the layer. Slices that are not IF_LUMINANCE are converted with 
+   * Image::convertFormat(). The size and type of the volume are taken from the first slice.
+   */
+  class VLVOLUME_EXPORT SliceVolumeSource: public VolumeSource
+  {
+    VL_INSTRUMENT_CLASS(vl::SliceVolumeSource, VolumeSource)
+
+  public:
+    SliceVolumeSource(const std::vector<String>& slice_paths);
+
+    //! Creates a SliceVolumeSource with all the files with the given extension found in the given directory in alphabetical order,
+    //! like loadImagesFromDir() but without loading the images.
+    static ref<SliceVolumeSource> fromDirectory(const String& dir_path, const String& ext);
+
+    virtual ivec3 size() const { return mSize; }
+
+    virtual EImageType type() const { return mType; }
+
+    virtual bool read(const ivec3& origin, Image* dst);
+
+    //! Returns the given slice, loading it if needed.
+    const Image* slice(int z);
+
+    const std::vector<String>& slicePaths() const { return mSlicePaths; }
+
+    //! The maximum number of slices kept in memory, default is 64.
+    void setSliceCacheSize(int count) { mSliceCacheSize = count; }
+
+    //! The maximum number of slices kept in memory, default is 64.
+    int sliceCacheSize() const { return mSliceCacheSize; }
+
+  protected:
+    std::vector<String> mSlicePaths;
+    std::vector< ref<Image> > mSlices;
+    std::list<int> mSliceLRU;
+    int mSliceCacheSize;
+    ivec3 mSize;
+    EImageType mType;
+  };
+  //------------------------------------------------------------------------------
+  // BrickedVolume
+  //------------------------------------------------------------------------------
+  /**
+   * A scalar volume stored as a grid of cubic bricks that are read on demand from a VolumeSource and kept in a LRU cache 
+   * of limited size, allowing to process datasets larger than the available memory.
+   *
+   * - brick() returns a brick as a 3D IF_LUMINANCE Image in the native type of the source, brickSize()^3 voxels large 
+   *   except along the far borders of the volume.
+   * - image() and volume() assemble an arbitrary region, possibly subsampled, into an Image (for example to be used as the 
+   *   3D texture of a SlicedVolume or with genGradientNormals() and genRGBAVolume()) or into a Volume for MarchingCubes.
+   * - MarchingCubes::run(BrickedVolume*, float) extracts the isosurface of the whole volume one brick at a time.
+   *
+   * When the least recently used bricks are evicted they can be kept in memory compressed with zlib, which is much 
+   * faster than reading them again from a slow source, see setCompressedCacheSize().
+   * The min/max values of each brick are recorded when the brick is first read and are used to skip the bricks 
+   * that cannot contain an isosurface, see brickRange() and computeBrickRanges().
+   *
+   * Voxel values are the raw values stored in the source converted to float, i.e. they are not normalized.
+   * BrickedVolume is not thread safe: bricks should be requested from a single thread.
+   */
+  class VLVOLUME_EXPORT BrickedVolume: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::BrickedVolume, Object)
+
+  public:
+    //! Constructor.
+    //! \param source The VolumeSource providing the voxels.
+    //! \param brick_size The number of voxels per side of a brick, 32 or 64 are good values.
+    BrickedVolume(VolumeSource* source, int brick_size=64);
+
+    const VolumeSource* source() const { return mSource.get(); }
+
+    VolumeSource* source() { return mSource.get(); }
+
+    //! The number of voxels along x, y and z.
+    const ivec3& size() const { return mSize; }
+
+    //! The type of the voxels.
+    EImageType type() const { return mType; }
+
+    int brickSize() const { return mBrickSize; }
+
+    //! The number of bricks along x, y and z.
+    const ivec3& brickCount() const { return mBrickCount; }
+
+    //! The maximum memory in bytes used by the uncompressed bricks, default is 512MB. At least one brick is always kept.
+    void setCacheSize(long long bytes) { mCacheSize = bytes; trimCache(); }
+
+    //! The maximum memory in bytes used by the uncompressed bricks, default is 512MB.
+    long long cacheSize() const { return mCacheSize; }
+
+    //! The maximum memory in bytes used to keep the bricks evicted from the main cache in compressed form, 0 (default) disables compression.
+    void setCompressedCacheSize(long long bytes) { mCompressedCacheSize = bytes; trimCache(); }
+
+    //! The maximum memory in bytes used to keep the bricks evicted from the main cache in compressed form, 0 (default) disables compression.
+    long long compressedCacheSize() const { return mCompressedCacheSize; }
+
+    //! The memory currently used by the uncompressed bricks.
+    long long cacheMemory() const { return mCacheMemory; }
+
+    //! The memory currently used by the compressed bricks.
+    long long compressedCacheMemory() const { return mCompressedMemory; }
+
+    //! Releases all the cached bricks, the brick ranges are kept.
+    void clearCache();
+
+    //! Returns the brick at the given brick coordinates reading it if necessary, NULL on failure. 
+    //! The returned image stays valid as long as it is referenced even if it is evicted from the cache.
+    ref<Image> brick(int bx, int by, int bz);
+
+    //! Returns true if brick() can return the brick without reading it from the source.
+    bool isCached(int bx, int by, int bz) const;
+
+    //! The position of the first voxel of a brick.
+    ivec3 brickOrigin(int bx, int by, int bz) const { return ivec3(bx, by, bz) * mBrickSize; }
+
+    //! The min/max voxel values of a brick, returns false if the brick has never been read. See also computeBrickRanges().
+    bool brickRange(int bx, int by, int bz, Volume::Cube& range) const;
+
+    //! Reads all the bricks once to compute their min/max values.
+    void computeBrickRanges();
+
+    //! Returns the value of a voxel, convenient but slow, use brick() or image() to process many voxels.
+    float value(int x, int y, int z);
+
+    //! Returns a new 3D IF_LUMINANCE image containing the voxels of the region starting at \p origin taking one voxel every 
+    //! \p step along each axis, \p size is the size of the returned image. Returns NULL if the region exceeds the volume.
+    ref<Image> image(const ivec3& origin, const ivec3& size, int step=1);
+
+    //! Returns a Volume containing the region [\p min_voxel, \p max_voxel] (inclusive) positioned according to bounds().
+    ref<Volume> volume(const ivec3& min_voxel, const ivec3& max_voxel);
+
+    //! The position of the first and last voxel of the volume, used by volume(). Default is (0,0,0) and size()-(1,1,1).
+    void setBounds(const fvec3& bottom_left, const fvec3& top_right) { mBottomLeft = bottom_left; mTopRight = top_right; }
+
+    const fvec3& bottomLeft() const { return mBottomLeft; }
+
+    const fvec3& topRight() const { return mTopRight; }
+
+    //! The number of bricks returned by brick() without reading them from the source.
+    long long cacheHits() const { return mCacheHits; }
+
+    //! The number of bricks read from the source.
+    long long cacheMisses() const { return mCacheMisses; }
+
+  protected:
+    struct BrickEntry
+    {
+      BrickEntry(): mRangeValid(false), mCached(false), mCompressedCached(false) {}
+      ref<Image> mImage;
+      std::vector<unsigned char> mCompressed;
+      std::list<int>::iterator mLRU;
+      std::list<int>::iterator mCompressedLRU;
+      Volume::Cube mRange;
+      bool mRangeValid;
+      bool mCached;
+      bool mCompressedCached;
+    };
+
+    int brickIndex(int bx, int by, int bz) const { return bx + mBrickCount.x() * (by + mBrickCount.y() * bz); }
+    ivec3 brickDimensions(int bx, int by, int bz) const;
+    void trimCache();
+    void touch(int index);
+
+  protected:
+    ref<VolumeSource> mSource;
+    ivec3 mSize;
+    EImageType mType;
+    int mBrickSize;
+    ivec3 mBrickCount;
+    std::vector<BrickEntry> mBricks;
+    std::list<int> mLRU;
+    std::list<int> mCompressedLRU;
+    long long mCacheSize;
+    long long mCompressedCacheSize;
+    long long mCacheMemory;
+    long long mCompressedMemory;
+    long long mCacheHits;
+    long long mCacheMisses;
+    fvec3 mBottomLeft;
+    fvec3 mTopRight;
+  };
+}
+
+#endif
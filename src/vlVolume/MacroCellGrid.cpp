@@ -0,0 +1,357 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/MacroCellGrid.hpp>
+#include <vlCore/ImageView.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  //! Computes the min/max of the cells of a range of cell layers, one layer per item.
+  template<typename T>
+  class CellRangeTask: public ParallelForTask
+  {
+  public:
+    CellRangeTask(const Image* volume, int cell_size, const ivec3& cell_count, const ivec3& min_cell, const ivec3& max_cell, float* cmin, float* cmax):
+      mView(volume), mCellSize(cell_size), mCellCount(cell_count), mMinCell(min_cell), mMaxCell(max_cell), mCellMin(cmin), mCellMax(cmax) 
+    {
+      mScale = (float)(1.0 / ImageComponent<T>::maxValue());
+    }
+
+    virtual void run(int begin, int end, int)
+    {
+      const int cs = mCellSize;
+      for(int cz=begin; cz<end; ++cz)
+      {
+        const int z0 = cz*cs;
+        const int z1 = z0+cs < mView.depth() ? z0+cs : mView.depth()-1;
+        for(int cy=mMinCell.y(); cy<=mMaxCell.y(); ++cy)
+        {
+          const int y0 = cy*cs;
+          const int y1 = y0+cs < mView.height() ? y0+cs : mView.height()-1;
+          float* cmin = mCellMin + mCellCount.x() * (cy + mCellCount.y() * cz);
+          float* cmax = mCellMax + mCellCount.x() * (cy + mCellCount.y() * cz);
+          for(int cx=mMinCell.x(); cx<=mMaxCell.x(); ++cx)
+          {
+            cmin[cx] = +1e30f;
+            cmax[cx] = -1e30f;
+          }
+          for(int z=z0; z<=z1; ++z)
+          {
+            for(int y=y0; y<=y1; ++y)
+            {
+              const T* row = mView.row(y, z);
+              for(int cx=mMinCell.x(); cx<=mMaxCell.x(); ++cx)
+              {
+                const int x0 = cx*cs;
+                const int x1 = x0+cs < mView.width() ? x0+cs : mView.width()-1;
+                float vmin = cmin[cx];
+                float vmax = cmax[cx];
+                for(int x=x0; x<=x1; ++x)
+                {
+                  float v = (float)row[x];
+                  vmin = v < vmin ? v : vmin;
+                  vmax = v > vmax ? v : vmax;
+                }
+                cmin[cx] = vmin;
+                cmax[cx] = vmax;
+              }
+            }
+          }
+          for(int cx=mMinCell.x(); cx<=mMaxCell.x(); ++cx)
+          {
+            cmin[cx] *= mScale;
+            cmax[cx] *= mScale;
+          }
+        }
+      }
+    }
+
+  protected:
+    ConstImageView<T,1> mView;
+    int mCellSize;
+    ivec3 mCellCount;
+    ivec3 mMinCell;
+    ivec3 mMaxCell;
+    float* mCellMin;
+    float* mCellMax;
+    float mScale;
+  };
+
+  template<typename T>
+  bool cellRanges(const Image* volume, int cell_size, const ivec3& cell_count, const ivec3& min_cell, const ivec3& max_cell, float* cmin, float* cmax)
+  {
+    if (!ConstImageView<T,1>::compatible(volume))
+      return false;
+    CellRangeTask<T> task(volume, cell_size, cell_count, min_cell, max_cell, cmin, cmax);
+    parallelFor(min_cell.z(), max_cell.z()+1, &task);
+    return true;
+  }
+
+  //! Computes the occupancy of a range of cell layers, one layer per item.
+  class OccupancyTask: public ParallelForTask
+  {
+  public:
+    OccupancyTask(const MacroCellGrid* grid, const ivec3& min_cell, const ivec3& max_cell, const float* cmin, const float* cmax, 
+                  const std::vector< std::vector<float> >& alpha_table, float threshold, unsigned char* texels, char* changed):
+      mGrid(grid), mMinCell(min_cell), mMaxCell(max_cell), mCellMin(cmin), mCellMax(cmax), mAlphaTable(alpha_table), 
+      mThreshold(threshold), mTexels(texels), mChanged(changed) {}
+
+    //! The max alpha of the transfer function entries [i0, i1].
+    float maxAlpha(int i0, int i1) const
+    {
+      int k = 0;
+      while((2 << k) <= i1 - i0 + 1)
+        ++k;
+      const std::vector<float>& t = mAlphaTable[k];
+      float a = t[i0];
+      float b = t[i1 - (1 << k) + 1];
+      return a > b ? a : b;
+    }
+
+    virtual void run(int begin, int end, int)
+    {
+      const ivec3& count = mGrid->cellCount();
+      const int n = mAlphaTable.empty() ? 0 : (int)mAlphaTable[0].size();
+      for(int cz=begin; cz<end; ++cz)
+      {
+        for(int cy=mMinCell.y(); cy<=mMaxCell.y(); ++cy)
+        {
+          for(int cx=mMinCell.x(); cx<=mMaxCell.x(); ++cx)
+          {
+            const int i = cx + count.x() * (cy + count.y() * cz);
+            const float vmin = mCellMin[i];
+            const float vmax = mCellMax[i];
+
+            bool occupied = true;
+            if (n)
+            {
+              // the transfer function is sampled linearly: include the entries around the range, both if the
+              // texture is sampled directly, i.e. at v*n-0.5, and if it is sampled at the texel centers, i.e. at v*(n-1).
+              const float u0 = vmin * (n-1) < vmin * n - 0.5f ? vmin * (n-1) : vmin * n - 0.5f;
+              const float u1 = vmax * (n-1) > vmax * n - 0.5f ? vmax * (n-1) : vmax * n - 0.5f;
+              int i0 = (int)floor(u0);
+              int i1 = (int)ceil (u1);
+              i0 = i0 < 0 ? 0 : i0 > n-1 ? n-1 : i0;
+              i1 = i1 < 0 ? 0 : i1 > n-1 ? n-1 : i1;
+              occupied = maxAlpha(i0, i1) > mThreshold;
+            }
+
+            unsigned char* texel = mTexels + i*4;
+            float lo = floor(vmin * 255.0f);
+            float hi = ceil (vmax * 255.0f);
+            texel[0] = (unsigned char)(lo < 0 ? 0 : lo > 255 ? 255 : lo);
+            texel[1] = (unsigned char)(hi < 0 ? 0 : hi > 255 ? 255 : hi);
+            unsigned char occ = occupied ? 255 : 0;
+            if (texel[2] != occ)
+            {
+              texel[2] = occ;
+              mChanged[cz] = 1;
+            }
+            texel[3] = 255;
+          }
+        }
+      }
+    }
+
+  protected:
+    const MacroCellGrid* mGrid;
+    ivec3 mMinCell;
+    ivec3 mMaxCell;
+    const float* mCellMin;
+    const float* mCellMax;
+    const std::vector< std::vector<float> >& mAlphaTable;
+    float mThreshold;
+    unsigned char* mTexels;
+    char* mChanged;
+  };
+}
+//-----------------------------------------------------------------------------
+// MacroCellGrid
+//-----------------------------------------------------------------------------
+MacroCellGrid::MacroCellGrid()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mAlphaThreshold = 0;
+  mCellCount = ivec3(0,0,0);
+  mCellSize = 8;
+}
+//-----------------------------------------------------------------------------
+bool MacroCellGrid::build(const Image* volume, int cell_size)
+{
+  mVolume = NULL;
+  mImage = NULL;
+  mCellCount = ivec3(0,0,0);
+  if (!volume || volume->dimension() != ID_3D || cell_size < 1)
+  {
+    Log::error("MacroCellGrid::build(): a 3D image is required.\n");
+    return false;
+  }
+
+  mVolume = const_cast<Image*>(volume);
+  mCellSize = cell_size;
+  // the last voxel layer belongs to the previous cell
+  mCellCount.x() = volume->width()  > 1 ? (volume->width()  - 2) / cell_size + 1 : 1;
+  mCellCount.y() = volume->height() > 1 ? (volume->height() - 2) / cell_size + 1 : 1;
+  mCellCount.z() = volume->depth()  > 1 ? (volume->depth()  - 2) / cell_size + 1 : 1;
+  const int count = mCellCount.x() * mCellCount.y() * mCellCount.z();
+  mMin.resize(count);
+  mMax.resize(count);
+  mImage = new Image(mCellCount.x(), mCellCount.y(), mCellCount.z(), 1, IF_RGBA, IT_UNSIGNED_BYTE);
+  memset(mImage->pixels(), 0, mImage->requiredMemory());
+
+  computeRanges(ivec3(0,0,0), mCellCount - ivec3(1,1,1));
+  if (!mImage)
+    return false;
+  computeOccupancy(ivec3(0,0,0), mCellCount - ivec3(1,1,1));
+  return true;
+}
+//-----------------------------------------------------------------------------
+void MacroCellGrid::computeRanges(const ivec3& min_cell, const ivec3& max_cell)
+{
+  bool ok = false;
+  switch(mVolume->type())
+  {
+  case IT_UNSIGNED_BYTE:  ok = cellRanges<unsigned char> (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_BYTE:           ok = cellRanges<GLbyte>        (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_UNSIGNED_SHORT: ok = cellRanges<unsigned short>(mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_SHORT:          ok = cellRanges<short>         (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_UNSIGNED_INT:   ok = cellRanges<unsigned int>  (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_INT:            ok = cellRanges<int>           (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_FLOAT:          ok = cellRanges<float>         (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  case IT_HALF_FLOAT:     ok = cellRanges<half>          (mVolume.get(), mCellSize, mCellCount, min_cell, max_cell, &mMin[0], &mMax[0]); break;
+  default: break;
+  }
+  if (!ok)
+  {
+    Log::error("MacroCellGrid: the volume must have a single component and a type supported by Image::sample().\n");
+    mVolume = NULL;
+    mImage = NULL;
+    mCellCount = ivec3(0,0,0);
+  }
+}
+//-----------------------------------------------------------------------------
+bool MacroCellGrid::computeOccupancy(const ivec3& min_cell, const ivec3& max_cell)
+{
+  std::vector<char> changed(mCellCount.z(), 0);
+  OccupancyTask task(this, min_cell, max_cell, &mMin[0], &mMax[0], mAlphaTable, mAlphaThreshold, mImage->pixels(), &changed[0]);
+  parallelFor(min_cell.z(), max_cell.z()+1, &task);
+  for(size_t i=0; i<changed.size(); ++i)
+    if (changed[i])
+      return true;
+  return false;
+}
+//-----------------------------------------------------------------------------
+bool MacroCellGrid::update(const ivec3& min_voxel, const ivec3& max_voxel)
+{
+  if (!mImage)
+    return false;
+
+  // a voxel also belongs to the previous cell if it lies on its last layer
+  ivec3 min_cell, max_cell;
+  for(int i=0; i<3; ++i)
+  {
+    min_cell[i] = (min_voxel[i] - 1) / mCellSize;
+    max_cell[i] = max_voxel[i] / mCellSize;
+    min_cell[i] = min_cell[i] < 0 ? 0 : min_cell[i];
+    max_cell[i] = max_cell[i] > mCellCount[i]-1 ? mCellCount[i]-1 : max_cell[i];
+    if (min_cell[i] > max_cell[i])
+      return false;
+  }
+
+  computeRanges(min_cell, max_cell);
+  if (!mImage)
+    return false;
+  return computeOccupancy(min_cell, max_cell);
+}
+//-----------------------------------------------------------------------------
+bool MacroCellGrid::updateOccupancy(const Image* transfer_function, float alpha_threshold)
+{
+  if (!mImage)
+    return false;
+
+  mAlphaThreshold = alpha_threshold;
+  mAlphaTable.clear();
+  const int n = transfer_function ? transfer_function->width() : 0;
+  if (n > 0)
+  {
+    mAlphaTable.push_back( std::vector<float>(n) );
+    for(int i=0; i<n; ++i)
+      mAlphaTable[0][i] = transfer_function->sample(i).a();
+    for(int k=1; (1 << k) <= n; ++k)
+    {
+      mAlphaTable.push_back( std::vector<float>(n - (1 << k) + 1) );
+      const std::vector<float>& prev = mAlphaTable[k-1];
+      std::vector<float>& t = mAlphaTable[k];
+      for(size_t i=0; i<t.size(); ++i)
+        t[i] = prev[i] > prev[i + (1 << (k-1))] ? prev[i] : prev[i + (1 << (k-1))];
+    }
+  }
+
+  return computeOccupancy(ivec3(0,0,0), mCellCount - ivec3(1,1,1));
+}
+//-----------------------------------------------------------------------------
+int MacroCellGrid::occupiedCount() const
+{
+  int count = 0;
+  const int cells = mCellCount.x() * mCellCount.y() * mCellCount.z();
+  for(int i=0; i<cells; ++i)
+    count += mImage->pixels()[i*4+2] != 0;
+  return count;
+}
+//-----------------------------------------------------------------------------
+void MacroCellGrid::cellVoxels(int x, int y, int z, ivec3& min_voxel, ivec3& max_voxel) const
+{
+  min_voxel = ivec3(x, y, z) * mCellSize;
+  max_voxel = min_voxel + ivec3(mCellSize, mCellSize, mCellSize);
+  const ivec3 last(mVolume->width()-1, mVolume->height()-1, mVolume->depth()-1);
+  for(int i=0; i<3; ++i)
+    max_voxel[i] = max_voxel[i] < last[i] ? max_voxel[i] : last[i];
+}
+//-----------------------------------------------------------------------------
+ref<Texture> MacroCellGrid::createTexture() const
+{
+  ref<Texture> tex = new Texture;
+  tex->prepareTexture3D(mImage.get(), TF_RGBA8, false, false);
+  tex->getTexParameter()->setMinFilter(TPF_NEAREST);
+  tex->getTexParameter()->setMagFilter(TPF_NEAREST);
+  tex->getTexParameter()->setWrapS(TPW_CLAMP_TO_EDGE);
+  tex->getTexParameter()->setWrapT(TPW_CLAMP_TO_EDGE);
+  tex->getTexParameter()->setWrapR(TPW_CLAMP_TO_EDGE);
+  return tex;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef MacroCellGrid_INCLUDE_ONCE
+#define MacroCellGrid_INCLUDE_ONCE
+
+#include <vlVolume/link_config.hpp>
+#include <vlCore/Image.hpp>
+#include <vlGraphics/Texture.hpp>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // MacroCellGrid
+  //------------------------------------------------------------------------------
+  /**
+   * A coarse grid of macro cells storing the min/max value of a scalar volume and whether each cell is visible 
+   * according to a transfer function, used by RaycastVolume to skip the empty space.
+   *
+   * Each cell covers cellSize()^3 voxels plus the first voxel layer of the following cells so that all the trilinearly
+   * interpolated samples falling in a cell are within its min/max range. Values are normalized like Image::sample().
+   * A cell is occupied if the maximum alpha of the transfer function in the cell's [min, max] range is greater than 
+   * the alpha threshold. Both build() and updateOccupancy() are computed in parallel using vl::defThreadPool(); when 
+   * the transfer function changes only updateOccupancy() needs to be called, which is much cheaper than build() since 
+   * the volume is not visited again, and when the volume changes update() recomputes only the affected cells.
+   *
+   * The grid is exposed as a 3D IF_RGBA / IT_UNSIGNED_BYTE image, see image() and createTexture(), with one texel per cell 
+   * storing the conservatively rounded min and max values in the red and green components and the occupancy in the 
+   * blue component (0 or 255).
+   *
+   * \sa RaycastVolume::setMacroCellGrid()
+   */
+  class VLVOLUME_EXPORT MacroCellGrid: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::MacroCellGrid, Object)
+
+  public:
+    MacroCellGrid();
+
+    //! Computes the min/max values of the cells of a 3D single component volume, all cells are marked as occupied 
+    //! until updateOccupancy() is called. Supports the types supported by Image::sample(), returns false on failure.
+    bool build(const Image* volume, int cell_size=8);
+
+    //! Recomputes the min/max values and the occupancy of the cells touched by the given region of the volume 
+    //! passed to build(), to be called after the volume has been modified. Returns true if the occupancy of any cell changed.
+    bool update(const ivec3& min_voxel, const ivec3& max_voxel);
+
+    //! Computes the occupancy of the cells using the alpha of \p transfer_function, a 1D or 2D image whose first row 
+    //! maps the normalized values of the volume to colors. Returns true if the occupancy of any cell changed.
+    bool updateOccupancy(const Image* transfer_function, float alpha_threshold=0.0f);
+
+    //! The volume passed to build().
+    const Image* volume() const { return mVolume.get(); }
+
+    //! The number of voxels along each side of a cell.
+    int cellSize() const { return mCellSize; }
+
+    //! The number of cells along x, y and z.
+    const ivec3& cellCount() const { return mCellCount; }
+
+    //! The number of occupied cells.
+    int occupiedCount() const;
+
+    bool isOccupied(int x, int y, int z) const { return mImage->pixels()[ cellIndex(x,y,z)*4 + 2 ] != 0; }
+
+    //! The normalized min value of a cell.
+    float cellMin(int x, int y, int z) const { return mMin[cellIndex(x,y,z)]; }
+
+    //! The normalized max value of a cell.
+    float cellMax(int x, int y, int z) const { return mMax[cellIndex(x,y,z)]; }
+
+    //! The first and last voxel covered by a cell.
+    void cellVoxels(int x, int y, int z, ivec3& min_voxel, ivec3& max_voxel) const;
+
+    //! The grid as a 3D image with one RGBA texel per cell: min, max, occupancy, 255.
+    const Image* image() const { return mImage.get(); }
+
+    //! Returns a new 3D texture of the image() with nearest filtering, to be bound to a TextureSampler again every time the grid changes.
+    ref<Texture> createTexture() const;
+
+  protected:
+    int cellIndex(int x, int y, int z) const { return x + mCellCount.x() * (y + mCellCount.y() * z); }
+    void computeRanges(const ivec3& min_cell, const ivec3& max_cell);
+    bool computeOccupancy(const ivec3& min_cell, const ivec3& max_cell);
+
+  protected:
+    ref<Image> mVolume;
+    ref<Image> mImage;
+    std::vector<float> mMin;
+    std::vector<float> mMax;
+    //! Sparse table of the transfer function alpha, mAlphaTable[k][i] is the max of the entries [i, i+2^k).
+    std::vector< std::vector<float> > mAlphaTable;
+    float mAlphaThreshold;
+    ivec3 mCellCount;
+    int mCellSize;
+  };
+}
+
+#endif
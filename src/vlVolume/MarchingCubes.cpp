@@ -32,8 +32,14 @@
 /* The marching cubes tables are from Cory Bloyd. */
 
 #include <vlVolume/MarchingCubes.hpp>
+#include <vlVolume/BrickedVolume.hpp>
 #include <vlCore/Time.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
+#include <vlCore/ThreadPool.hpp>
+
+#if VL_SSE2
+  #include <emmintrin.h>
+#endif
 
 using namespace vl;
 
@@ -71,16 +77,71 @@ MarchingCubes::MarchingCubes()
 #endif
   mVolumeInfo.setAutomaticDelete(false);
   mHighQualityNormals = true;
+  mMultithreaded = true;
+  mIncremental = false;
 }
 //------------------------------------------------------------------------------
+// MarchingCubes::ComputeEdgesTask
+//------------------------------------------------------------------------------
+class MarchingCubes::ComputeEdgesTask: public ParallelForTask
+{
+public:
+  ComputeEdgesTask(MarchingCubes* mc, Volume* vol, float threshold, VolumeCache& cache, const std::vector<int>& slabs): 
+    mMC(mc), mVolume(vol), mThreshold(threshold), mCache(cache), mSlabs(slabs) {}
+
+  virtual void run(int begin, int end, int)
+  {
+    for(int i=begin; i<end; ++i)
+      mMC->computeEdges(mVolume, mThreshold, mCache, mCache.mSlabs[mSlabs[i]]);
+  }
+
+private:
+  MarchingCubes* mMC;
+  Volume* mVolume;
+  float mThreshold;
+  VolumeCache& mCache;
+  const std::vector<int>& mSlabs;
+};
+//------------------------------------------------------------------------------
+// MarchingCubes::ProcessCubesTask
+//------------------------------------------------------------------------------
+class MarchingCubes::ProcessCubesTask: public ParallelForTask
+{
+public:
+  ProcessCubesTask(MarchingCubes* mc, Volume* vol, float threshold, VolumeCache& cache, const std::vector<int>& slabs): 
+    mMC(mc), mVolume(vol), mThreshold(threshold), mCache(cache), mSlabs(slabs) {}
+
+  virtual void run(int begin, int end, int)
+  {
+    for(int i=begin; i<end; ++i)
+    {
+      Slab& slab = mCache.mSlabs[mSlabs[i]];
+      slab.mIndices.clear();
+      for(size_t j=0; j<slab.mCubes.size(); ++j)
+        mMC->processCube(slab.mCubes[j].x(), slab.mCubes[j].y(), slab.mCubes[j].z(), mVolume, mThreshold, mCache, slab);
+      // the cubes are not needed anymore
+      std::vector<usvec3>().swap(slab.mCubes);
+    }
+  }
+
+private:
+  MarchingCubes* mMC;
+  Volume* mVolume;
+  float mThreshold;
+  VolumeCache& mCache;
+  const std::vector<int>& mSlabs;
+};
+//------------------------------------------------------------------------------
 // MarchingCubes
 //------------------------------------------------------------------------------
-void MarchingCubes::computeEdges(Volume* vol, float threshold)
+void MarchingCubes::computeEdges(Volume* vol, float threshold, VolumeCache& cache, Slab& slab)
 {
-  // mEdges.clear();
-  mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
-  mCubes.clear();
-  mCubes.reserve(1024);
+  slab.mVerts.clear();
+  slab.mNorms.clear();
+  slab.mCubes.clear();
+  slab.mVerts.reserve(1024);
+  slab.mNorms.reserve(1024);
+  slab.mCubes.reserve(1024);
 
   /////////////////////////////////////////////////////////////////////////////////
   // note: this funtion can generate double vertices when the 't' is 0.0 or 1.0
@@ -89,106 +150,131 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
   // Geometry::computeNormals() which is much quicker than computing the gradient.
   /////////////////////////////////////////////////////////////////////////////////
 
+  // note: the vertex indices stored in mEdges are local to the slab, see processCube().
+
+  // A voxel generates the edges starting from it, which are shared by the cubes at x-1..x, y-1..y, z-1..z:
+  // the voxels of a brick need to be visited if any of the bricks at bx-1..bx, by-1..by, bz-1..bz includes the threshold.
+  const int B = Volume::BRICK_SIZE;
+  const ivec3& bc = vol->brickCount();
+  const int vbx = (vol->slices().x() + B - 1) / B;
+  const int vby = (vol->slices().y() + B - 1) / B;
+  const int bz  = slab.mZ0 / B;
+  std::vector<unsigned char> active(vbx*vby, 0);
+  for(int by=0; by<vby; ++by)
+  {
+    for(int bx=0; bx<vbx; ++bx)
+    {
+      for(int k=0; k<8 && !active[bx+vbx*by]; ++k)
+      {
+        int x = bx - (k & 1);
+        int y = by - ((k >> 1) & 1);
+        int z = bz - ((k >> 2) & 1);
+        if (x>=0 && y>=0 && z>=0 && x<bc.x() && y<bc.y() && z<bc.z() && vol->brick(x,y,z).includes(threshold))
+          active[bx+vbx*by] = 1;
+      }
+    }
+  }
+
+  std::vector<Edge>& edges = cache.mEdges;
+  std::vector<fvec3>& verts = slab.mVerts;
+  std::vector<fvec3>& norms = slab.mNorms;
   const float dx = vol->cellSize().x() * 0.25f;
   const float dy = vol->cellSize().y() * 0.25f;
   const float dz = vol->cellSize().z() * 0.25f;
   float v0, v1, v2, v3, t;
-  int iedge = 0;
   int w = vol->slices().x() -1;
   int h = vol->slices().y() -1;
   int d = vol->slices().z() -1;
-  for(unsigned short z = 0; z < vol->slices().z(); ++z)
+  for(unsigned short z = (unsigned short)slab.mZ0; z < slab.mZ1; ++z)
   {
     for(unsigned short y = 0; y < vol->slices().y(); ++y)
     {
-      for(unsigned short x = 0; x < vol->slices().x(); ++x, ++iedge)
+      for(int bx=0; bx<vbx; ++bx)
       {
-        if (x != w && y != h && z != d)
+        if (!active[bx+vbx*(y/B)])
+          continue;
+
+        int xend = (bx+1)*B < vol->slices().x() ? (bx+1)*B : vol->slices().x();
+        int iedge = bx*B + y*vol->slices().x() + z*vol->slices().x()*vol->slices().y();
+        for(unsigned short x = (unsigned short)(bx*B); x < xend; ++x, ++iedge)
         {
-          if (vol->cube(x,y,z).includes(threshold))
+          if (x != w && y != h && z != d)
           {
-            if (mCubes.capacity()-mCubes.size() == 0)
-              mCubes.reserve(mCubes.size()*2);
-            mCubes.push_back( usvec3(x,y,z) );
+            if (vol->cube(x,y,z).includes(threshold))
+              slab.mCubes.push_back( usvec3(x,y,z) );
+            else
+              continue;
           }
-          else
-            continue;
-        }
 
-        if (mVerts.capacity() - mVerts.size() == 0)
-        {
-          mVerts.reserve( mVerts.size() * 2 );
-          mNorms.reserve( mNorms.size() * 2 );
-        }
-
-        v0 = vol->value( x,y,z );
-        fvec3 v0_coord = vol->coordinate(x, y, z);
+          v0 = vol->value( x,y,z );
+          fvec3 v0_coord = vol->coordinate(x, y, z);
 
-        if (x != w)
-        {
-          v1 = vol->value( x + 1, y, z );
-          if (v1!=v0)
+          if (x != w)
           {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0) )
+            v1 = vol->value( x + 1, y, z );
+            if (v1!=v0)
             {
-              t = (threshold-v0)/(v1-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mX = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x + 1, y, z) * t );
-              if (mHighQualityNormals)
+              //if (t>=0 && t<=1.0f)
+              if ( (threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0) )
               {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
+                t = (threshold-v0)/(v1-v0);
+                VL_CHECK(t>=-0.001f && t<=1.001f)
+                // emit vertex
+                edges[iedge].mX = (int)verts.size();
+                // compute vertex and normal position
+                verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x + 1, y, z) * t );
+                if (mHighQualityNormals)
+                {
+                  fvec3 n;
+                  vol->normalHQ(n, verts.back(), dx, dy, dz);
+                  norms.push_back(n);
+                }
               }
             }
           }
-        }
-        if (y != h)
-        {
-          v2 = vol->value( x, y + 1, z );
-          if (v2!=v0)
+          if (y != h)
           {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v2) || (threshold>=v2 && threshold<=v0) )
+            v2 = vol->value( x, y + 1, z );
+            if (v2!=v0)
             {
-              t = (threshold-v0)/(v2-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mY = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y + 1, z) * t );
-              if (mHighQualityNormals)
+              //if (t>=0 && t<=1.0f)
+              if ( (threshold>=v0 && threshold<=v2) || (threshold>=v2 && threshold<=v0) )
               {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
+                t = (threshold-v0)/(v2-v0);
+                VL_CHECK(t>=-0.001f && t<=1.001f)
+                // emit vertex
+                edges[iedge].mY = (int)verts.size();
+                // compute vertex and normal position
+                verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y + 1, z) * t );
+                if (mHighQualityNormals)
+                {
+                  fvec3 n;
+                  vol->normalHQ(n, verts.back(), dx, dy, dz);
+                  norms.push_back(n);
+                }
               }
             }
           }
-        }
-        if (z != d)
-        {
-          v3 = vol->value( x, y, z + 1 );
-          if (v3!=v0)
+          if (z != d)
           {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v3) || (threshold>=v3 && threshold<=v0) )
+            v3 = vol->value( x, y, z + 1 );
+            if (v3!=v0)
             {
-              t = (threshold-v0)/(v3-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mZ = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y, z + 1) * t );
-              if (mHighQualityNormals)
+              //if (t>=0 && t<=1.0f)
+              if ( (threshold>=v0 && threshold<=v3) || (threshold>=v3 && threshold<=v0) )
               {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
+                t = (threshold-v0)/(v3-v0);
+                VL_CHECK(t>=-0.001f && t<=1.001f)
+                // emit vertex
+                edges[iedge].mZ = (int)verts.size();
+                // compute vertex and normal position
+                verts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y, z + 1) * t );
+                if (mHighQualityNormals)
+                {
+                  fvec3 n;
+                  vol->normalHQ(n, verts.back(), dx, dy, dz);
+                  norms.push_back(n);
+                }
               }
             }
           }
@@ -198,7 +284,7 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
   }
 }
 //------------------------------------------------------------------------------
-void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold)
+void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold, VolumeCache& cache, Slab& slab)
 {
   int inner_corners = 0;
 
@@ -239,30 +325,33 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
   int cell5 = x     + y1 + z0;
   int cell6 = x     + y1 + z1;
 
+  // the edges on the z+1 plane belong to the next slab if z+1 is past the end of this slab:
+  // their indices are stored after the ones of this slab and are rebased when the slabs are stitched together.
+  const std::vector<Edge>& edges = cache.mEdges;
+  const int off0 = 0;
+  const int off1 = z+1 < slab.mZ1 ? 0 : (int)slab.mVerts.size();
+
   int edge_ivert[12] =
   {
-    mEdges[cell0].mX,
-    mEdges[cell1].mY,
-    mEdges[cell5].mX,
-    mEdges[cell0].mY,
-
-    mEdges[cell3].mX,
-    mEdges[cell2].mY,
-    mEdges[cell6].mX,
-    mEdges[cell3].mY,
-
-    mEdges[cell0].mZ,
-    mEdges[cell1].mZ,
-    mEdges[cell4].mZ,
-    mEdges[cell5].mZ,
+    edges[cell0].mX + off0,
+    edges[cell1].mY + off0,
+    edges[cell5].mX + off0,
+    edges[cell0].mY + off0,
+
+    edges[cell3].mX + off1,
+    edges[cell2].mY + off1,
+    edges[cell6].mX + off1,
+    edges[cell3].mY + off1,
+
+    edges[cell0].mZ + off0,
+    edges[cell1].mZ + off0,
+    edges[cell4].mZ + off0,
+    edges[cell5].mZ + off0,
   };
 
   int ivertex;
   for(int icorner = 0; mTriangleConnectionTable[inner_corners][icorner]>=0; icorner+=3)
   {
-    if (mIndices.capacity() - mIndices.size() == 0)
-      mIndices.reserve( mIndices.size()*2 );
-
     ivertex = mTriangleConnectionTable[inner_corners][icorner+0];
     int a = edge_ivert[ivertex];
 
@@ -288,9 +377,9 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
         continue;
     #endif
 
-    mIndices.push_back((IndexType)a);
-    mIndices.push_back((IndexType)b);
-    mIndices.push_back((IndexType)c);
+    slab.mIndices.push_back((IndexType)a);
+    slab.mIndices.push_back((IndexType)b);
+    slab.mIndices.push_back((IndexType)c);
   }
 }
 //------------------------------------------------------------------------------
@@ -304,12 +393,94 @@ void MarchingCubes::reset()
   mVerts.clear();
   mNorms.clear();
   mColors.clear();
-  mCubes.clear();
-  mEdges.clear();
+  mCaches.clear();
   mVolumeInfo.clear();
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::run(bool generate_colors)
+{
+  extract(generate_colors);
+  updateArrays(generate_colors);
+}
+//------------------------------------------------------------------------------
+bool MarchingCubes::run(BrickedVolume* bvol, float threshold, bool generate_colors, const fvec4& color)
+{
+  mVerts.clear();
+  mNorms.clear();
+  mIndices.clear();
+  mColors.clear();
+  mCaches.clear();
+
+  const int B = bvol->brickSize();
+  const ivec3& bricks = bvol->brickCount();
+  const ivec3 last = bvol->size() - ivec3(1,1,1);
+
+  MarchingCubes mc;
+  mc.setHighQualityNormals(mHighQualityNormals);
+  mc.setMultithreaded(mMultithreaded);
+
+  bool ok = true;
+  for(int bz=0; bz<bricks.z(); ++bz)
+  {
+    for(int by=0; by<bricks.y(); ++by)
+    {
+      for(int bx=0; bx<bricks.x(); ++bx)
+      {
+        // the block of cubes starting in this brick also reads the first voxels of the following bricks
+        ivec3 min_voxel = bvol->brickOrigin(bx, by, bz);
+        ivec3 max_voxel = min_voxel + ivec3(B, B, B);
+        max_voxel.x() = max_voxel.x() < last.x() ? max_voxel.x() : last.x();
+        max_voxel.y() = max_voxel.y() < last.y() ? max_voxel.y() : last.y();
+        max_voxel.z() = max_voxel.z() < last.z() ? max_voxel.z() : last.z();
+        if (max_voxel.x() <= min_voxel.x() || max_voxel.y() <= min_voxel.y() || max_voxel.z() <= min_voxel.z())
+          continue;
+
+        // skip the block if the ranges of all its bricks are known and exclude the threshold
+        bool skip = true;
+        for(int z=bz; z<=bz+1 && z<bricks.z() && skip; ++z)
+        {
+          for(int y=by; y<=by+1 && y<bricks.y() && skip; ++y)
+          {
+            for(int x=bx; x<=bx+1 && x<bricks.x() && skip; ++x)
+            {
+              Volume::Cube range;
+              if (!bvol->brickRange(x, y, z, range) || range.includes(threshold))
+                skip = false;
+            }
+          }
+        }
+        if (skip)
+          continue;
+
+        ref<Volume> vol = bvol->volume(min_voxel, max_voxel);
+        if (!vol)
+        {
+          Log::error( Say("MarchingCubes::run(): could not read the bricks of the block %n %n %n, the isosurface will have a hole.\n") << bx << by << bz );
+          ok = false;
+          continue;
+        }
+
+        mc.mVolumeInfo.clear();
+        mc.mVolumeInfo.push_back( new VolumeInfo(vol.get(), threshold) );
+        mc.extract(false);
+
+        IndexType offset = (IndexType)mVerts.size();
+        mVerts.insert(mVerts.end(), mc.mVerts.begin(), mc.mVerts.end());
+        mNorms.insert(mNorms.end(), mc.mNorms.begin(), mc.mNorms.end());
+        for(size_t j=0; j<mc.mIndices.size(); ++j)
+          mIndices.push_back((IndexType)(mc.mIndices[j] + offset));
+      }
+    }
+  }
+
+  if (generate_colors)
+    mColors.assign(mVerts.size(), color);
+
+  updateArrays(generate_colors);
+  return ok;
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::extract(bool generate_colors)
 {
   mVerts.clear();
   mNorms.clear();
@@ -321,28 +492,114 @@ void MarchingCubes::run(bool generate_colors)
 
   /*Time time; time.start();*/
 
+  const int thread_count = mMultithreaded ? parallelThreadCount() : 1;
+  const int B = Volume::BRICK_SIZE;
+
+  // collect the dirty regions first since the same volume can be used by more than one VolumeInfo
+  std::vector<ivec3> dirty_min( mVolumeInfo.size() );
+  std::vector<ivec3> dirty_max( mVolumeInfo.size() );
+  std::vector<bool>  dirty( mVolumeInfo.size() );
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    const Volume* vol = mVolumeInfo.at(ivol)->volume();
+    dirty[ivol]     = vol->dataIsDirty();
+    dirty_min[ivol] = vol->dirtyRegionMin();
+    dirty_max[ivol] = vol->dirtyRegionMax();
+  }
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    if (mVolumeInfo.at(ivol)->volume()->dataIsDirty())
+      mVolumeInfo.at(ivol)->volume()->setupInternalData();
+  }
+
+  mCaches.resize( mVolumeInfo.size() );
+
   for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
   {
     Volume* vol     = mVolumeInfo.at(ivol)->volume();
     float threshold = mVolumeInfo.at(ivol)->threshold();
     int start       = (int)mVerts.size();
+    VolumeCache& cache = mCaches[ivol];
+
+    // the volume is partitioned in Z slabs, one per layer of bricks
+    int depth = vol->slices().z();
+    int slab_count = (depth + B - 1) / B;
+
+    bool full_update = !mIncremental || 
+                       cache.mVolume.get() != vol || 
+                       cache.mSlices != vol->slices() || 
+                       cache.mThreshold != threshold || 
+                       cache.mHighQualityNormals != mHighQualityNormals;
 
-    if (vol->dataIsDirty())
-      vol->setupInternalData();
+    std::vector<int> slabs;
+    if (full_update)
+    {
+      cache.mVolume = vol;
+      cache.mSlices = vol->slices();
+      cache.mThreshold = threshold;
+      cache.mHighQualityNormals = mHighQualityNormals;
+      cache.mSlabs.resize(slab_count);
+      for(int i=0; i<slab_count; ++i)
+      {
+        cache.mSlabs[i].mZ0 = i * B;
+        cache.mSlabs[i].mZ1 = (i+1) * B < depth ? (i+1) * B : depth;
+        slabs.push_back(i);
+      }
+      cache.mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
+    }
+    else
+    if (dirty[ivol])
+    {
+      // a changed voxel affects the edges and the normals up to two planes away, plus the slab 
+      // preceeding the first dirty one since its last cubes reference the vertices of the next slab.
+      int z0 = dirty_min[ivol].z() - 2;
+      int z1 = dirty_max[ivol].z() + 2;
+      int s0 = z0 < 0 ? 0 : z0 / B - 1;
+      int s1 = z1 >= depth ? slab_count - 1 : z1 / B;
+      if (s0 < 0)
+        s0 = 0;
+      for(int i=s0; i<=s1; ++i)
+        slabs.push_back(i);
+    }
+
+    if (!slabs.empty())
+    {
+      // note: this step takes the 90% of the time
+      ComputeEdgesTask compute_edges(this, vol, threshold, cache, slabs);
+      if (thread_count > 1)
+        parallelFor(0, (int)slabs.size(), &compute_edges);
+      else
+        compute_edges.run(0, (int)slabs.size(), 0);
 
-    // note: this function takes the 90% of the time
-    computeEdges(vol, threshold);
+      // note: this step takes the remaining 10% of the time
+      ProcessCubesTask process_cubes(this, vol, threshold, cache, slabs);
+      if (thread_count > 1)
+        parallelFor(0, (int)slabs.size(), &process_cubes);
+      else
+        process_cubes.run(0, (int)slabs.size(), 0);
+    }
 
-    // note: this loop takes the remaining 10% of the time
-    //// the z->y->x order is important in order to minimize cache misses
-    //for(int z = 0; z < mVolume->slices().z()-1; ++z)
-    //  for(int y = 0; y < mVolume->slices().y()-1; ++y)
-    //    for(int x = 0; x < mVolume->slices().x()-1; ++x)
-    //      if(vol->cube(x,y,z).includes(threshold))
-    //        processCube(x, y, z, vol, threshold);
+    // stitch the slabs together
+    for(int i=0; i<(int)cache.mSlabs.size(); ++i)
+    {
+      Slab& slab = cache.mSlabs[i];
+      IndexType offset = (IndexType)mVerts.size();
+      mVerts.insert(mVerts.end(), slab.mVerts.begin(), slab.mVerts.end());
+      mNorms.insert(mNorms.end(), slab.mNorms.begin(), slab.mNorms.end());
+      for(size_t j=0; j<slab.mIndices.size(); ++j)
+        mIndices.push_back((IndexType)(slab.mIndices[j] + offset));
+      if (!mIncremental)
+      {
+        // release the memory
+        std::vector<fvec3>().swap(slab.mVerts);
+        std::vector<fvec3>().swap(slab.mNorms);
+        std::vector<IndexType>().swap(slab.mIndices);
+      }
+    }
 
-    for(unsigned int i=0; i<mCubes.size(); ++i)
-      processCube(mCubes[i].x(), mCubes[i].y(), mCubes[i].z(), vol, threshold);
+    // the slabs have been released: invalidate the cache so that a later incremental run rebuilds them all
+    if (!mIncremental)
+      cache.mVolume = NULL;
 
     int count = (int)mVerts.size() - start;
     mVolumeInfo.at(ivol)->setVert0(start);
@@ -356,7 +613,10 @@ void MarchingCubes::run(bool generate_colors)
         mColors[i] = mVolumeInfo.at(ivol)->color();
     }
   }
-
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::updateArrays(bool generate_colors)
+{
   mVertsArray->resize(mVerts.size());
   mVertsArray->setBufferObjectDirty();
   if (mVerts.size())
@@ -384,14 +644,28 @@ void MarchingCubes::run(bool generate_colors)
 
   if (!mHighQualityNormals)
   {
-    ref<Geometry> geom = new Geometry;
-    geom->setVertexArray(mVertsArray.get());
-    geom->drawCalls()->push_back(mDrawElements.get());
-
-    geom->computeNormals();
-    mNormsArray->resize( geom->normalArray()->size() );
+    // same as Geometry::computeNormals() without the temporary Geometry and normal array
+    mNormsArray->resize( mVerts.size() );
     mNormsArray->setBufferObjectDirty();
-    memcpy(mNormsArray->ptr(), geom->normalArray()->ptr(), sizeof(mNormsArray->at(0)) * mNormsArray->size());
+    fvec3* norms = mNormsArray->begin();
+    for(size_t i=0; i<mVerts.size(); ++i)
+      norms[i] = fvec3(0,0,0);
+    for(size_t i=0; i+2<mIndices.size(); i+=3)
+    {
+      IndexType a = mIndices[i+0];
+      IndexType b = mIndices[i+1];
+      IndexType c = mIndices[i+2];
+      vec3 v0 = (vec3)mVerts[a];
+      vec3 v1 = (vec3)mVerts[b] - v0;
+      vec3 v2 = (vec3)mVerts[c] - v0;
+      vec3 n = cross(v1, v2);
+      n.normalize();
+      norms[a] += (fvec3)n;
+      norms[b] += (fvec3)n;
+      norms[c] += (fvec3)n;
+    }
+    for(size_t i=0; i<mVerts.size(); ++i)
+      norms[i].normalize();
   }
 }
 //------------------------------------------------------------------------------
@@ -461,6 +735,50 @@ Volume::Volume()
   setup(NULL, false, false, fvec3(0,0,0), fvec3(1.0f,1.0f,1.0f), ivec3(50,50,50));
 }
 //------------------------------------------------------------------------------
+namespace
+{
+  //! Averages the 2x2x2 blocks of a Volume, one output slice per item.
+  class DownsampleVolumeTask: public ParallelForTask
+  {
+  public:
+    DownsampleVolumeTask(const Volume* src, Volume* dst): mSrc(src), mDst(dst) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      const int w = mDst->slices().x();
+      const int h = mDst->slices().y();
+      for(int z=begin; z<end; ++z)
+      {
+        int z1=z*2;
+        int z2=z*2+1;
+        for(int y=0; y<h; ++y)
+        {
+          int y1=y*2;
+          int y2=y*2+1;
+          for(int x=0; x<w; ++x)
+          {
+            int x1 = x*2;
+            int x2 = x*2+1;
+            float v0 = mSrc->value(x1,y1,z1);
+            float v1 = mSrc->value(x1,y1,z2);
+            float v2 = mSrc->value(x1,y2,z1);
+            float v3 = mSrc->value(x1,y2,z2);
+            float v4 = mSrc->value(x2,y1,z1);
+            float v5 = mSrc->value(x2,y1,z2);
+            float v6 = mSrc->value(x2,y2,z1);
+            float v7 = mSrc->value(x2,y2,z2);
+            mDst->value(x,y,z) = (v0+v1+v2+v3+v4+v5+v6+v7) * (1.0f/8.0f);
+          }
+        }
+      }
+    }
+
+  protected:
+    const Volume* mSrc;
+    Volume* mDst;
+  };
+}
+//------------------------------------------------------------------------------
 ref<Volume> Volume::downsample() const
 {
   ref<Volume> vol = new Volume;
@@ -473,71 +791,199 @@ ref<Volume> Volume::downsample() const
 
   vol->setup(NULL, false, false, bottomLeft(), topRight(), ivec3(w,h,d));
 
-  for(int z=0; z<d; ++z)
+  DownsampleVolumeTask task(this, vol.get());
+  parallelFor(0, d, &task);
+
+  return vol;
+}
+//------------------------------------------------------------------------------
+namespace
+{
+  //! Computes the min/max values of a row of cubes given the 4 rows of values at its corners.
+  void computeCubeRow(Volume::Cube* cubes, int w, const float* r00, const float* r01, const float* r10, const float* r11)
   {
-    int z1=z*2;
-    int z2=z*2+1;
-    for(int y=0; y<h; ++y)
+    int x = 0;
+#if VL_SSE2
+    // process 4 cubes at a time: the column min/max at x and x+1 give the cube min/max
+    for(; x+4 <= w; x+=4)
+    {
+      __m128 c0_min = _mm_min_ps( _mm_min_ps(_mm_loadu_ps(r00+x), _mm_loadu_ps(r01+x)), _mm_min_ps(_mm_loadu_ps(r10+x), _mm_loadu_ps(r11+x)) );
+      __m128 c0_max = _mm_max_ps( _mm_max_ps(_mm_loadu_ps(r00+x), _mm_loadu_ps(r01+x)), _mm_max_ps(_mm_loadu_ps(r10+x), _mm_loadu_ps(r11+x)) );
+      __m128 c1_min = _mm_min_ps( _mm_min_ps(_mm_loadu_ps(r00+x+1), _mm_loadu_ps(r01+x+1)), _mm_min_ps(_mm_loadu_ps(r10+x+1), _mm_loadu_ps(r11+x+1)) );
+      __m128 c1_max = _mm_max_ps( _mm_max_ps(_mm_loadu_ps(r00+x+1), _mm_loadu_ps(r01+x+1)), _mm_max_ps(_mm_loadu_ps(r10+x+1), _mm_loadu_ps(r11+x+1)) );
+      __m128 mn = _mm_min_ps(c0_min, c1_min);
+      __m128 mx = _mm_max_ps(c0_max, c1_max);
+      // interleave into 4 consecutive { mMin, mMax } pairs
+      float* dst = &cubes[x].mMin;
+      _mm_storeu_ps(dst+0, _mm_unpacklo_ps(mn, mx));
+      _mm_storeu_ps(dst+4, _mm_unpackhi_ps(mn, mx));
+    }
+#endif
+    for(; x<w; ++x)
     {
-      int y1=y*2;
-      int y2=y*2+1;
-      for(int x=0; x<w; ++x)
+      float v[] = { r00[x], r01[x], r10[x], r11[x], r00[x+1], r01[x+1], r10[x+1], r11[x+1] };
+      cubes[x].mMin = v[0];
+      cubes[x].mMax = v[0];
+      for(int i=1; i<8; ++i)
       {
-        int x1 = x*2;
-        int x2 = x*2+1;
-        float v0 = value(x1,y1,z1);
-        float v1 = value(x1,y1,z2);
-        float v2 = value(x1,y2,z1);
-        float v3 = value(x1,y2,z2);
-        float v4 = value(x2,y1,z1);
-        float v5 = value(x2,y1,z2);
-        float v6 = value(x2,y2,z1);
-        float v7 = value(x2,y2,z2);
-        vol->value(x,y,z) = (v0+v1+v2+v3+v4+v5+v6+v7) * (1.0f/8.0f);
+        if (cubes[x].mMin > v[i]) cubes[x].mMin = v[i];
+        if (cubes[x].mMax < v[i]) cubes[x].mMax = v[i];
       }
     }
   }
 
-  return vol;
-}
-//------------------------------------------------------------------------------
-void Volume::setupInternalData()
-{
-  mDataIsDirty = false;
-  int w = slices().x() -1;
-  int h = slices().y() -1;
-  int d = slices().z() -1;
-  mCubes.resize(w*h*d);
-  for(int z = 0; z < d; ++z)
+  class SetupCubesTask: public ParallelForTask
   {
-    for(int y = 0; y < h; ++y)
+  public:
+    SetupCubesTask(Volume::Cube* cubes, const float* values, const ivec3& slices, const ivec3& cmin, const ivec3& cmax): 
+      mCubes(cubes), mValues(values), mSlices(slices), mMin(cmin), mMax(cmax) {}
+
+    virtual void run(int begin, int end, int)
     {
-      for(int x = 0; x < w; ++x)
+      int w = mSlices.x() -1;
+      int h = mSlices.y() -1;
+      int row = mSlices.x();
+      int plane = mSlices.x() * mSlices.y();
+      int x = mMin.x();
+      for(int z = begin; z < end; ++z)
       {
-        float v[] = 
+        for(int y = mMin.y(); y <= mMax.y(); ++y)
         {
-          value(x+0,y+0,z+0),
-          value(x+0,y+0,z+1),
-          value(x+0,y+1,z+0),
-          value(x+0,y+1,z+1),
-          value(x+1,y+0,z+0),
-          value(x+1,y+0,z+1),
-          value(x+1,y+1,z+0),
-          value(x+1,y+1,z+1)
-        };
-        int icube = x+w*y+w*h*z;
-        mCubes[icube].mMin = v[0];
-        mCubes[icube].mMax = v[0];
-        for(int i=1; i<8; ++i)
+          const float* r00 = mValues + x + row*(y+0) + plane*(z+0);
+          const float* r01 = mValues + x + row*(y+0) + plane*(z+1);
+          const float* r10 = mValues + x + row*(y+1) + plane*(z+0);
+          const float* r11 = mValues + x + row*(y+1) + plane*(z+1);
+          computeCubeRow(mCubes + x + w*y + w*h*z, mMax.x() - x + 1, r00, r01, r10, r11);
+        }
+      }
+    }
+
+  private:
+    Volume::Cube* mCubes;
+    const float* mValues;
+    ivec3 mSlices;
+    ivec3 mMin;
+    ivec3 mMax;
+  };
+
+  class SetupBricksTask: public ParallelForTask
+  {
+  public:
+    SetupBricksTask(Volume::Cube* bricks, const Volume::Cube* cubes, const ivec3& slices, const ivec3& brick_count, const ivec3& bmin, const ivec3& bmax): 
+      mBricks(bricks), mCubes(cubes), mSlices(slices), mBrickCount(brick_count), mMin(bmin), mMax(bmax) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      const int B = Volume::BRICK_SIZE;
+      int w = mSlices.x() -1;
+      int h = mSlices.y() -1;
+      int d = mSlices.z() -1;
+      for(int bz = begin; bz < end; ++bz)
+      {
+        for(int by = mMin.y(); by <= mMax.y(); ++by)
         {
-          if (mCubes[icube].mMin > v[i]) mCubes[icube].mMin = v[i];
-          if (mCubes[icube].mMax < v[i]) mCubes[icube].mMax = v[i];
+          for(int bx = mMin.x(); bx <= mMax.x(); ++bx)
+          {
+            Volume::Cube& brick = mBricks[ bx + mBrickCount.x()*by + mBrickCount.x()*mBrickCount.y()*bz ];
+            brick = mCubes[ bx*B + w*by*B + w*h*bz*B ];
+            int x1 = (bx+1)*B < w ? (bx+1)*B : w;
+            int y1 = (by+1)*B < h ? (by+1)*B : h;
+            int z1 = (bz+1)*B < d ? (bz+1)*B : d;
+            for(int z=bz*B; z<z1; ++z)
+            {
+              for(int y=by*B; y<y1; ++y)
+              {
+                const Volume::Cube* cube = mCubes + w*y + w*h*z;
+                for(int x=bx*B; x<x1; ++x)
+                {
+                  if (brick.mMin > cube[x].mMin) brick.mMin = cube[x].mMin;
+                  if (brick.mMax < cube[x].mMax) brick.mMax = cube[x].mMax;
+                }
+              }
+            }
+          }
         }
       }
     }
+
+  private:
+    Volume::Cube* mBricks;
+    const Volume::Cube* mCubes;
+    ivec3 mSlices;
+    ivec3 mBrickCount;
+    ivec3 mMin;
+    ivec3 mMax;
+  };
+}
+//------------------------------------------------------------------------------
+void Volume::setDataDirty(const ivec3& min_voxel, const ivec3& max_voxel)
+{
+  if (!mDataIsDirty)
+  {
+    mDirtyMin = min_voxel;
+    mDirtyMax = max_voxel;
+    mDataIsDirty = true;
+  }
+  else
+  {
+    for(int i=0; i<3; ++i)
+    {
+      mDirtyMin[i] = min_voxel[i] < mDirtyMin[i] ? min_voxel[i] : mDirtyMin[i];
+      mDirtyMax[i] = max_voxel[i] > mDirtyMax[i] ? max_voxel[i] : mDirtyMax[i];
+    }
   }
 }
 //------------------------------------------------------------------------------
+void Volume::setupInternalData()
+{
+  const int B = BRICK_SIZE;
+  int w = slices().x() -1;
+  int h = slices().y() -1;
+  int d = slices().z() -1;
+
+  // the cubes touching the dirty voxels
+  ivec3 cmin = mDirtyMin - ivec3(1,1,1);
+  ivec3 cmax = mDirtyMax;
+  for(int i=0; i<3; ++i)
+  {
+    cmin[i] = cmin[i] < 0 ? 0 : cmin[i];
+    cmax[i] = cmax[i] > slices()[i]-2 ? slices()[i]-2 : cmax[i];
+  }
+
+  mDataIsDirty = false;
+  mDirtyMin = ivec3(0,0,0);
+  mDirtyMax = ivec3(-1,-1,-1);
+
+  if (w<1 || h<1 || d<1)
+  {
+    mCubes.clear();
+    mBricks.clear();
+    mBrickCount = ivec3(0,0,0);
+    return;
+  }
+
+  ivec3 brick_count( (w+B-1)/B, (h+B-1)/B, (d+B-1)/B );
+  if ((int)mCubes.size() != w*h*d || brick_count != mBrickCount)
+  {
+    mCubes.resize(w*h*d);
+    mBrickCount = brick_count;
+    mBricks.resize(brick_count.x()*brick_count.y()*brick_count.z());
+    cmin = ivec3(0,0,0);
+    cmax = ivec3(w-1,h-1,d-1);
+  }
+
+  if (cmin.x()>cmax.x() || cmin.y()>cmax.y() || cmin.z()>cmax.z())
+    return;
+
+  SetupCubesTask setup_cubes(&mCubes[0], values(), slices(), cmin, cmax);
+  parallelFor(cmin.z(), cmax.z()+1, &setup_cubes);
+
+  ivec3 bmin( cmin.x()/B, cmin.y()/B, cmin.z()/B );
+  ivec3 bmax( cmax.x()/B, cmax.y()/B, cmax.z()/B );
+  SetupBricksTask setup_bricks(&mBricks[0], &mCubes[0], slices(), mBrickCount, bmin, bmax);
+  parallelFor(bmin.z(), bmax.z()+1, &setup_bricks);
+}
+//------------------------------------------------------------------------------
 void Volume::setup( float* data, bool use_directly, bool copy_data, const fvec3& bottom_left, const fvec3& top_right, const ivec3& slices )
 {
   fvec3 size = top_right-bottom_left;
@@ -570,6 +1016,8 @@ void Volume::setup( float* data, bool use_directly, bool copy_data, const fvec3&
   mMaximum = -1;
   mAverage = 0;
   mDataIsDirty = true;
+  mDirtyMin = ivec3(0,0,0);
+  mDirtyMax = mSlices - ivec3(1,1,1);
 }
 //------------------------------------------------------------------------------
 void Volume::setup(const Volume& volume)
@@ -579,6 +1027,8 @@ void Volume::setup(const Volume& volume)
   mMaximum = -1;
   mAverage = 0;
   mDataIsDirty = true;
+  mDirtyMin = ivec3(0,0,0);
+  mDirtyMax = mSlices - ivec3(1,1,1);
 }
 //------------------------------------------------------------------------------
 float Volume::sampleNearest(float x, float y, float z) const
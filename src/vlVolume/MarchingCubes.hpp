@@ -37,16 +37,27 @@
 
 namespace vl
 {
+  class BrickedVolume;
+
   //------------------------------------------------------------------------------
   // Volume
   //------------------------------------------------------------------------------
   /**
    * Defines the volume data to be used with a MarchingCube object.
+   *
+   * Besides the per-cube min/max values the Volume keeps a coarser table of min/max values for each brick of
+   * BRICK_SIZE x BRICK_SIZE x BRICK_SIZE cubes, which allows MarchingCubes to skip whole bricks that cannot 
+   * contain the isosurface. Use setDataDirty(const ivec3&, const ivec3&) when only a sub-region of the volume
+   * changes so that only the affected cubes and bricks are updated.
    */
   class VLVOLUME_EXPORT Volume: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Volume, Object)
 
+  public:
+    //! The number of cubes per side of a brick.
+    static const int BRICK_SIZE = 8;
+
     /**
      * A Volume cell.
      */
@@ -56,7 +67,7 @@ namespace vl
       float mMin, mMax;
       bool includes(float v) const { return v >= mMin && v <= mMax; }
     };
-  public:
+
     Volume();
 
     //! Setup the volume data with the specified memory management.
@@ -70,6 +81,7 @@ namespace vl
 
     /** Returns a new volume which is half of the size of the original volume in each direction (thus requires up to 1/8th of the memory).
         Use this function when the volume data to be processed is too big or produces too many polygons.
+        The slices are processed in parallel using vl::defThreadPool(), see also VolumePyramid.
      */
     ref<Volume> downsample() const;
 
@@ -127,6 +139,18 @@ namespace vl
       return mCubes[ x + y*(slices().x()-1) + z*(slices().x()-1)*(slices().y()-1) ]; 
     }
 
+    //! Returns the min/max values of the cubes contained in the given brick. See also BRICK_SIZE.
+    const Volume::Cube& brick(int x, int y, int z) const 
+    { 
+      VL_CHECK(x<brickCount().x())
+      VL_CHECK(y<brickCount().y())
+      VL_CHECK(z<brickCount().z())
+      return mBricks[ x + y*brickCount().x() + z*brickCount().x()*brickCount().y() ]; 
+    }
+
+    //! The number of bricks along x, y and z.
+    const ivec3& brickCount() const { return mBrickCount; }
+
     //! Returns the x/y/z size of a cell
     const fvec3& cellSize() const { return mCellSize; }
 
@@ -134,8 +158,19 @@ namespace vl
     bool dataIsDirty() const { return mDataIsDirty; }
 
     //! Notifies that the data of a Volume has changed and that the internal acceleration structures should be recomputed.
-    void setDataDirty() { mDataIsDirty = true; }
+    void setDataDirty() { setDataDirty( ivec3(0,0,0), slices() - ivec3(1,1,1) ); }
+
+    //! Notifies that only the voxels within \p min_voxel and \p max_voxel (inclusive) have changed. 
+    //! Multiple calls accumulate until the next call to setupInternalData().
+    void setDataDirty(const ivec3& min_voxel, const ivec3& max_voxel);
+
+    //! The first voxel of the region changed since the last call to setupInternalData().
+    const ivec3& dirtyRegionMin() const { return mDirtyMin; }
 
+    //! The last voxel of the region changed since the last call to setupInternalData().
+    const ivec3& dirtyRegionMax() const { return mDirtyMax; }
+
+    //! Updates the cube and brick min/max values of the dirty region.
     void setupInternalData();
 
   protected:
@@ -150,8 +185,12 @@ namespace vl
     float mMaximum;
     float mAverage;
     bool mDataIsDirty;
+    ivec3 mDirtyMin;
+    ivec3 mDirtyMax;
 
     std::vector<Cube> mCubes;
+    std::vector<Cube> mBricks;
+    ivec3 mBrickCount;
   };
   //------------------------------------------------------------------------------
   // VolumeInfo
@@ -219,6 +258,19 @@ namespace vl
   //------------------------------------------------------------------------------
   /**
    * An efficient implementation of the Marching Cubes algorithm.
+   *
+   * When multithreading is enabled (default) the volume is partitioned into Z slabs which are processed in parallel 
+   * using vl::defThreadPool(). Each slab owns the vertices lying on the edges starting in its Z planes so that 
+   * vertices shared across slab boundaries are generated only once; the output is identical to the serial one.
+   *
+   * Only the bricks of the volume whose min/max range includes the threshold are visited (see Volume::brick()).
+   * When incremental mode is enabled (see setIncremental()) the geometry of each slab is cached and run() re-extracts 
+   * only the slabs touched by the region passed to Volume::setDataDirty(const ivec3&, const ivec3&), while volumes
+   * whose data and threshold did not change are not processed at all. This makes threshold scrubbing and 
+   * live-updating volumes interactive at the cost of keeping a copy of the generated geometry.
+   *
+   * Volumes larger than the available memory can be stored in a BrickedVolume and processed with 
+   * run(BrickedVolume*, float, bool, const fvec4&), see its documentation for the details.
    */
   class VLVOLUME_EXPORT MarchingCubes
   {
@@ -227,6 +279,19 @@ namespace vl
   
     void run(bool generate_colors);
 
+    /**
+     * Extracts the isosurface of a BrickedVolume one brick at a time, so that only a few bricks need to be in memory at once.
+     *
+     * Each brick is processed together with the first voxel layer of the following bricks, the bricks whose min/max range 
+     * (see BrickedVolume::brickRange()) does not include the threshold are not read at all. 
+     * The vertices lying on the faces shared by two bricks are generated once per brick, use DoubleVertexRemover if needed.
+     * With high quality normals the gradient along the brick faces is computed with one sided differences.
+     * The volumeInfo() objects are not used nor modified, \p color is used for all the vertices if \p generate_colors is true.
+     * Returns false if some bricks could not be read: the error is logged for each of them and the isosurface has a hole
+     * in their place.
+     */
+    bool run(BrickedVolume* volume, float threshold, bool generate_colors=false, const fvec4& color=fvec4(1,1,1,1));
+
     void reset();
 
     const Collection<VolumeInfo>* volumeInfo() const { return &mVolumeInfo; }
@@ -241,6 +306,16 @@ namespace vl
     //! Select hight quality normals for best rendering quality, select low quality normals for best performances.
     bool highQualityNormals() const { return mHighQualityNormals; }
 
+    //! If \p true (default) the volumes are processed in parallel using vl::defThreadPool().
+    void setMultithreaded(bool mt) { mMultithreaded = mt; }
+    //! If \p true (default) the volumes are processed in parallel using vl::defThreadPool().
+    bool multithreaded() const { return mMultithreaded; }
+
+    //! If \p true the generated geometry is cached and only the regions of the volumes that changed are re-extracted by run(). Default is \p false.
+    void setIncremental(bool incremental) { mIncremental = incremental; }
+    //! If \p true the generated geometry is cached and only the regions of the volumes that changed are re-extracted by run(). Default is \p false.
+    bool incremental() const { return mIncremental; }
+
   public:
     ref<ArrayFloat3> mVertsArray;
     ref<ArrayFloat3> mNormsArray;
@@ -253,31 +328,63 @@ namespace vl
     ref<DrawElementsUShort> mDrawElements;
 #endif
 
-  protected:
-    void computeEdges(Volume*, float threshold);
-    void processCube(int x, int y, int z, Volume* vol, float threshold);
-
-  private:
-    std::vector<fvec3> mVerts;
-    std::vector<fvec3> mNorms;
-    std::vector<fvec4> mColors;
-    
 #if defined(VL_OPENGL)
     typedef unsigned int IndexType;
 #else
     typedef unsigned short IndexType;
 #endif
-    std::vector<IndexType> mIndices;
+
+    //! A Z slab of the volume, i.e. a layer of bricks, processed by a single thread.
+    struct Slab
+    {
+      int mZ0, mZ1;    // voxel planes [mZ0, mZ1) owned by the slab
+      std::vector<fvec3> mVerts;
+      std::vector<fvec3> mNorms;
+      std::vector<IndexType> mIndices; // indices >= mVerts.size() refer to the vertices of the next slab
+      std::vector<usvec3> mCubes;
+    };
 
     struct Edge
     {
       Edge(): mX(-1), mY(-1), mZ(-1) {}
       int mX, mY, mZ;
     };
-    std::vector<Edge>  mEdges;
-    std::vector<usvec3> mCubes;
+
+    //! The cached slabs and edges of a volume.
+    struct VolumeCache
+    {
+      VolumeCache(): mThreshold(0), mHighQualityNormals(false) {}
+      //! Keeps the cached volume alive so that a new Volume allocated at the same address cannot be mistaken for it.
+      ref<Volume> mVolume;
+      ivec3 mSlices;
+      float mThreshold;
+      bool mHighQualityNormals;
+      std::vector<Slab> mSlabs;
+      std::vector<Edge> mEdges;
+    };
+
+  protected:
+    void extract(bool generate_colors);
+    void updateArrays(bool generate_colors);
+    void computeEdges(Volume*, float threshold, VolumeCache& cache, Slab& slab);
+    void processCube(int x, int y, int z, Volume* vol, float threshold, VolumeCache& cache, Slab& slab);
+
+    class ComputeEdgesTask;
+    class ProcessCubesTask;
+    friend class ComputeEdgesTask;
+    friend class ProcessCubesTask;
+
+  private:
+    std::vector<fvec3> mVerts;
+    std::vector<fvec3> mNorms;
+    std::vector<fvec4> mColors;
+    std::vector<IndexType> mIndices;
+
+    std::vector<VolumeCache> mCaches;
     Collection<VolumeInfo> mVolumeInfo;
     bool mHighQualityNormals;
+    bool mMultithreaded;
+    bool mIncremental;
 
   protected:
     static const int mTriangleConnectionTable[256][16];
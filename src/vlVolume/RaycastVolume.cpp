@@ -56,6 +56,21 @@ using namespace vl;
  * </table>
  * </center>
  *
+ * Large volumes can be rendered at a lower resolution while interacting, see setLOD() and VolumeLOD.
+ *
+ * Empty space skipping is supported by setMacroCellGrid(): the box is replaced by the bounding box of the visible cells of a 
+ * MacroCellGrid. Such proxy is convex, i.e. every ray enters and exits it once, so it works with any shader and render state,
+ * including the ones rendering the back faces and marching back to front, and with blending.
+ * Calling setCellProxyEnabled(true) the proxy follows the boundary faces of the visible cells. A ray can enter such proxy several
+ * times, so it must be rendered with back face culling, depth test and without blending: only the nearest entry point survives 
+ * and the shader marches front to back from it.
+ *
+ * In both cases the rays march until the end of the volume texture. To skip the empty cells along the way the shader can use
+ * the texture returned by MacroCellGrid::createTexture() and the \p "uniform vec3 macro_cell_count", \p "uniform vec3 macro_cell_size"
+ * and \p "uniform vec3 macro_cell_origin" variables, which are set to the number of cells, the size of a cell and the position 
+ * of the first voxel in texture coordinates. See the \p "/glsl/volume_raycast_skip.fs" shader.
+ * The cells are computed assuming that the volume and the transfer function textures use TPW_CLAMP_TO_EDGE wrapping.
+ *
  * \sa 
  * - \ref pagGuideRaycastVolume
  * - \ref pagGuideSlicedVolume
@@ -65,6 +80,8 @@ using namespace vl;
 RaycastVolume::RaycastVolume()
 {
   VL_DEBUG_SET_OBJECT_NAME()
+  mCellProxyEnabled = false;
+
   // box geometry
   mGeometry = new Geometry;
 
@@ -81,6 +98,7 @@ RaycastVolume::RaycastVolume()
   // install index array
   ref<DrawElementsUInt> de = new DrawElementsUInt( PT_QUADS );
   mGeometry->drawCalls()->push_back( de.get() );
+  mBoxDrawCall = de;
   unsigned int de_indices[] = 
   {
     0,1,2,3, 1,5,6,2, 5,4,7,6, 4,0,3,7, 3,2,6,7, 4,5,1,0
@@ -174,6 +192,21 @@ void RaycastVolume::updateUniforms( vl::Actor*actor, vl::real, const vl::Camera*
     }
     actor->gocUniform( "eye_look" )->setUniform( look );
   }
+
+  if ( mMacroCellGrid && mMacroCellGrid->volume() )
+  {
+    const ivec3& count = mMacroCellGrid->cellCount();
+    if ( glsl->getUniformLocation( "macro_cell_count" ) != -1 )
+      actor->gocUniform( "macro_cell_count" )->setUniform( fvec3( (float)count.x(), (float)count.y(), (float)count.z() ) );
+    const Image* vol = mMacroCellGrid->volume();
+    if ( glsl->getUniformLocation( "macro_cell_size" ) != -1 )
+    {
+      float cs = (float)mMacroCellGrid->cellSize();
+      actor->gocUniform( "macro_cell_size" )->setUniform( fvec3( cs/vol->width(), cs/vol->height(), cs/vol->depth() ) );
+    }
+    if ( glsl->getUniformLocation( "macro_cell_origin" ) != -1 )
+      actor->gocUniform( "macro_cell_origin" )->setUniform( fvec3( 0.5f/vol->width(), 0.5f/vol->height(), 0.5f/vol->depth() ) );
+  }
 }
 //-----------------------------------------------------------------------------
 void RaycastVolume::bindActor( Actor* actor )
@@ -188,6 +221,10 @@ void RaycastVolume::onActorRenderStarted( Actor* actor, real clock, const Camera
   if ( pass>0 )
     return;
 
+  // select the resolution of the volume texture
+  if ( mLOD )
+    mLOD->update( actor, clock, camera, shader, box() );
+
   // setup uniform variables
 
   if ( shader->getGLSLProgram() )
@@ -219,6 +256,9 @@ void RaycastVolume::generateTextureCoordinates( const ivec3& size )
     fvec3( x0,y0,z0 ), fvec3( x1,y0,z0 ), fvec3( x1,y1,z0 ), fvec3( x0,y1,z0 ), 
   };
   memcpy( mTexCoord->ptr(), texc, sizeof( texc ) );
+
+  if ( mMacroCellGrid )
+    updateProxyGeometry();
 }
 //-----------------------------------------------------------------------------
 void RaycastVolume::generateTextureCoordinates(const ivec3& img_size, const ivec3& min_corner, const ivec3& max_corner)
@@ -246,6 +286,9 @@ void RaycastVolume::generateTextureCoordinates(const ivec3& img_size, const ivec
       fvec3( x0,y0,z0 ), fvec3( x1,y0,z0 ), fvec3( x1,y1,z0 ), fvec3( x0,y1,z0 ), 
     };
     memcpy( mTexCoord->ptr(), texc, sizeof(texc) );
+
+    if ( mMacroCellGrid )
+      updateProxyGeometry();
 }
 //-----------------------------------------------------------------------------
 void RaycastVolume::setBox( const AABB& box ) 
@@ -265,5 +308,127 @@ void RaycastVolume::setBox( const AABB& box )
   };
   memcpy( mVertCoord->ptr(), box_verts, sizeof( box_verts ) );
   mGeometry->setBoundsDirty( true );
+
+  if ( mMacroCellGrid )
+    updateProxyGeometry();
+}
+//-----------------------------------------------------------------------------
+void RaycastVolume::updateProxyGeometry()
+{
+  mGeometry->drawCalls()->clear();
+  mGeometry->setBoundsDirty( true );
+
+  if ( !mMacroCellGrid || !mMacroCellGrid->volume() )
+  {
+    // restore the box
+    mGeometry->setVertexArray( mVertCoord.get() );
+    mGeometry->setTexCoordArray( 0, mTexCoord.get() );
+    mGeometry->drawCalls()->push_back( mBoxDrawCall.get() );
+    return;
+  }
+
+  const MacroCellGrid* grid = mMacroCellGrid.get();
+  const ivec3 size( grid->volume()->width(), grid->volume()->height(), grid->volume()->depth() );
+  const ivec3& count = grid->cellCount();
+
+  // voxel centers span the box, texture coordinates are linear in the position (see generateTextureCoordinates())
+  const fvec3 box_min = ( fvec3 )mBox.minCorner();
+  const fvec3 box_ext = ( fvec3 )( mBox.maxCorner() - mBox.minCorner() );
+  const fvec3 tex_min = texCoords()[4];
+  const fvec3 tex_ext = texCoords()[2] - texCoords()[4];
+  fvec3 voxel_to_pos;
+  for( int i=0; i<3; ++i )
+    voxel_to_pos[i] = size[i] > 1 ? box_ext[i] / ( size[i]-1 ) : 0;
+
+  // same corner order and faces of the box, the neighbour cell of each face is given by its offset
+  const int faces[6][4] = { {0,1,2,3}, {1,5,6,2}, {5,4,7,6}, {4,0,3,7}, {3,2,6,7}, {4,5,1,0} };
+  const ivec3 offsets[6] = { ivec3(0,0,1), ivec3(1,0,0), ivec3(0,0,-1), ivec3(-1,0,0), ivec3(0,1,0), ivec3(0,-1,0) };
+
+  // the bounding box of the occupied cells
+  ivec3 min_cell = count;
+  ivec3 max_cell( -1,-1,-1 );
+  for( int z=0; z<count.z(); ++z )
+  {
+    for( int y=0; y<count.y(); ++y )
+    {
+      for( int x=0; x<count.x(); ++x )
+      {
+        if ( !grid->isOccupied( x,y,z ) )
+          continue;
+        const ivec3 c( x,y,z );
+        for( int i=0; i<3; ++i )
+        {
+          min_cell[i] = c[i] < min_cell[i] ? c[i] : min_cell[i];
+          max_cell[i] = c[i] > max_cell[i] ? c[i] : max_cell[i];
+        }
+      }
+    }
+  }
+
+  // no occupied cells: nothing to render
+  if ( max_cell.x() < 0 )
+  {
+    mGeometry->setVertexArray( new ArrayFloat3 );
+    mGeometry->setTexCoordArray( 0, new ArrayFloat3 );
+    return;
+  }
+
+  // without the cell proxy the bounding box is generated as a single cell spanning all the others
+  const ivec3 last_cell = mCellProxyEnabled ? max_cell : min_cell;
+
+  std::vector<fvec3> verts;
+  std::vector<fvec3> texcs;
+  for( int z=min_cell.z(); z<=last_cell.z(); ++z )
+  {
+    for( int y=min_cell.y(); y<=last_cell.y(); ++y )
+    {
+      for( int x=min_cell.x(); x<=last_cell.x(); ++x )
+      {
+        if ( mCellProxyEnabled && !grid->isOccupied( x,y,z ) )
+          continue;
+
+        ivec3 v0, v1, unused;
+        grid->cellVoxels( x,y,z, v0, v1 );
+        if ( !mCellProxyEnabled )
+          grid->cellVoxels( max_cell.x(),max_cell.y(),max_cell.z(), unused, v1 );
+        fvec3 p0 = box_min + voxel_to_pos * ( fvec3 )v0;
+        fvec3 p1 = box_min + voxel_to_pos * ( fvec3 )v1;
+        fvec3 corners[] = 
+        {
+          fvec3( p0.x(),p0.y(),p1.z() ), fvec3( p1.x(),p0.y(),p1.z() ), fvec3( p1.x(),p1.y(),p1.z() ), fvec3( p0.x(),p1.y(),p1.z() ), 
+          fvec3( p0.x(),p0.y(),p0.z() ), fvec3( p1.x(),p0.y(),p0.z() ), fvec3( p1.x(),p1.y(),p0.z() ), fvec3( p0.x(),p1.y(),p0.z() ), 
+        };
+
+        for( int f=0; f<6; ++f )
+        {
+          ivec3 n = ivec3( x,y,z ) + offsets[f];
+          if ( mCellProxyEnabled && n.x() >= 0 && n.y() >= 0 && n.z() >= 0 && n.x() < count.x() && n.y() < count.y() && n.z() < count.z() && grid->isOccupied( n.x(),n.y(),n.z() ) )
+            continue;
+          for( int i=0; i<4; ++i )
+          {
+            const fvec3& p = corners[ faces[f][i] ];
+            fvec3 t;
+            for( int k=0; k<3; ++k )
+              t[k] = tex_min[k] + ( box_ext[k] != 0 ? ( p[k] - box_min[k] ) / box_ext[k] : 0 ) * tex_ext[k];
+            verts.push_back( p );
+            texcs.push_back( t );
+          }
+        }
+      }
+    }
+  }
+
+  ref<ArrayFloat3> vert_array = new ArrayFloat3;
+  ref<ArrayFloat3> texc_array = new ArrayFloat3;
+  vert_array->resize( verts.size() );
+  texc_array->resize( texcs.size() );
+  if ( !verts.empty() )
+  {
+    memcpy( vert_array->ptr(), &verts[0], sizeof( verts[0] ) * verts.size() );
+    memcpy( texc_array->ptr(), &texcs[0], sizeof( texcs[0] ) * texcs.size() );
+  }
+  mGeometry->setVertexArray( vert_array.get() );
+  mGeometry->setTexCoordArray( 0, texc_array.get() );
+  mGeometry->drawCalls()->push_back( new DrawArrays( PT_QUADS, 0, (int)verts.size() ) );
 }
 //-----------------------------------------------------------------------------
@@ -30,6 +30,8 @@
 /**************************************************************************************/
 
 #include <vlVolume/link_config.hpp>
+#include <vlVolume/VolumePyramid.hpp>
+#include <vlVolume/MacroCellGrid.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/Actor.hpp>
 
@@ -86,11 +88,45 @@ namespace vl
     //! Use this function to visualize a subset of the volume. The subset is defined by \p min_corner and \p max_corner.
     void generateTextureCoordinates(const ivec3& img_size, const ivec3& min_corner, const ivec3& max_corner);
 
+    //! Enables level of detail rendering: the VolumeLOD selects the level of its VolumePyramid bound to the volume texture before the volume is rendered. 
+    void setLOD(VolumeLOD* lod) { mLOD = lod; }
+
+    //! The VolumeLOD used to select the resolution of the volume texture, NULL by default.
+    VolumeLOD* lod() { return mLOD.get(); }
+
+    //! The VolumeLOD used to select the resolution of the volume texture, NULL by default.
+    const VolumeLOD* lod() const { return mLOD.get(); }
+
+    //! Enables empty space skipping: the box is replaced by the bounding box of the occupied cells of \p grid, or by their boundary 
+    //! faces if isCellProxyEnabled(), so that rays start close to the visible content. The \p grid must have been built from the 
+    //! volume rendered. Pass NULL to restore the box.
+    void setMacroCellGrid(MacroCellGrid* grid) { mMacroCellGrid = grid; updateProxyGeometry(); }
+
+    //! The MacroCellGrid used for empty space skipping, NULL by default.
+    MacroCellGrid* macroCellGrid() { return mMacroCellGrid.get(); }
+
+    //! The MacroCellGrid used for empty space skipping, NULL by default.
+    const MacroCellGrid* macroCellGrid() const { return mMacroCellGrid.get(); }
+
+    //! Regenerates the proxy geometry from the occupied cells of macroCellGrid(), to be called after MacroCellGrid::updateOccupancy() or MacroCellGrid::update() return true.
+    void updateProxyGeometry();
+
+    //! If \p true the proxy geometry is made of the boundary faces of the occupied cells instead of their bounding box (default is false).
+    //! Such proxy is not convex: it can be used only rendering its front faces with depth test and without blending, see setMacroCellGrid().
+    void setCellProxyEnabled(bool enabled) { mCellProxyEnabled = enabled; if (mMacroCellGrid) updateProxyGeometry(); }
+
+    //! If \p true the proxy geometry is made of the boundary faces of the occupied cells instead of their bounding box (default is false).
+    bool isCellProxyEnabled() const { return mCellProxyEnabled; }
+
   protected:
     ref<Geometry> mGeometry;
+    ref<DrawCall> mBoxDrawCall;
+    ref<VolumeLOD> mLOD;
+    ref<MacroCellGrid> mMacroCellGrid;
     AABB mBox;
     ref<ArrayFloat3> mTexCoord;
     ref<ArrayFloat3> mVertCoord;
+    bool mCellProxyEnabled;
   };
 }
 
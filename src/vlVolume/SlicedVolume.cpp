@@ -69,12 +69,272 @@ using namespace vl;
  * The updateUniforms() method also fills the \p "uniform vec3 eye_position" variable which contains the camera position in
  * object space, useful to compute specular highlights etc.
  *
+ * Large volumes can be rendered at a lower resolution while interacting, see setLOD() and VolumeLOD.
+ *
+ * The slices are regenerated in parallel using defThreadPool() every time the actor or the camera move. 
+ * Using setAsyncSliceGeneration() the slices can be generated by a worker thread while the previous frame is 
+ * rendered, at the cost of having them one frame behind the camera.
+ *
  * \sa 
  * - \ref pagGuideSlicedVolume
  * - \ref pagGuideRaycastVolume
  * - RaycastVolume
  */
 //-----------------------------------------------------------------------------
+namespace
+{
+  const int MaxSlicePoints = 12;
+
+  //! A box edge parametrized by the camera space z of the slicing plane.
+  struct SliceEdge
+  {
+    float mZ0, mInvDZ;
+    float mZMin, mZMax;
+    fvec3 mP0, mDP;
+    fvec3 mT0, mDT;
+    float mX0, mDX, mY0, mDY;
+  };
+
+  //! Monotonic with atan2(y,x) in the range [0,4) but much cheaper.
+  inline float pseudoAngle(float x, float y)
+  {
+    float d = fabs(x) + fabs(y);
+    if (d == 0)
+      return 0;
+    float p = y / d;
+    if (x < 0)
+      return 2 - p;
+    else
+    if (y < 0)
+      return 4 + p;
+    else
+      return p;
+  }
+
+  //! Computes the polygon of each slice, its vertices are sorted counter-clockwise as seen from the camera.
+  class SlicePolygonTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int islice=begin; islice<end; ++islice)
+      {
+        float z = mZStart - mZStep*(islice+1);
+        fvec3* pts = mPoints    + islice*MaxSlicePoints;
+        fvec3* tex = mTexCoords + islice*MaxSlicePoints;
+        float x[MaxSlicePoints];
+        float y[MaxSlicePoints];
+        float cx = 0, cy = 0;
+        int n = 0;
+        for(int iedge=0; iedge<12; ++iedge)
+        {
+          const SliceEdge& e = mEdges[iedge];
+          if (z < e.mZMin || z > e.mZMax)
+            continue;
+          float lambda = (z - e.mZ0) * e.mInvDZ;
+          x[n] = e.mX0 + e.mDX*lambda;
+          y[n] = e.mY0 + e.mDY*lambda;
+          pts[n] = e.mP0 + e.mDP*lambda;
+          tex[n] = e.mT0 + e.mDT*lambda;
+          cx += x[n];
+          cy += y[n];
+          ++n;
+        }
+        mCounts[islice] = n;
+        if (n < 3)
+          continue;
+
+        // insertion sort by angle around the centroid
+        cx /= n;
+        cy /= n;
+        float angle[MaxSlicePoints];
+        for(int i=0; i<n; ++i)
+        {
+          float a = pseudoAngle(x[i]-cx, y[i]-cy);
+          fvec3 p = pts[i];
+          fvec3 t = tex[i];
+          int j = i;
+          for(; j>0 && angle[j-1] > a; --j)
+          {
+            angle[j] = angle[j-1];
+            pts[j] = pts[j-1];
+            tex[j] = tex[j-1];
+          }
+          angle[j] = a;
+          pts[j] = p;
+          tex[j] = t;
+        }
+      }
+    }
+
+  public:
+    const SliceEdge* mEdges;
+    float mZStart;
+    float mZStep;
+    fvec3* mPoints;
+    fvec3* mTexCoords;
+    int* mCounts;
+  };
+
+  //! Triangulates the slice polygons writing each slice at its own offset in the vertex arrays.
+  class SliceTriangleTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      for(int islice=begin; islice<end; ++islice)
+      {
+        const fvec3* pts = mPoints    + islice*MaxSlicePoints;
+        const fvec3* tex = mTexCoords + islice*MaxSlicePoints;
+        fvec3* vert = mVertices  + mOffsets[islice];
+        fvec3* texc = mTexCoordsOut + mOffsets[islice];
+        for(int i=1; i<mCounts[islice]-1; ++i)
+        {
+          *vert++ = pts[0]; *vert++ = pts[i]; *vert++ = pts[i+1];
+          *texc++ = tex[0]; *texc++ = tex[i]; *texc++ = tex[i+1];
+        }
+      }
+    }
+
+  public:
+    const fvec3* mPoints;
+    const fvec3* mTexCoords;
+    const int* mCounts;
+    const int* mOffsets;
+    fvec3* mVertices;
+    fvec3* mTexCoordsOut;
+  };
+}
+//-----------------------------------------------------------------------------
+// SlicedVolume::SliceJob
+//-----------------------------------------------------------------------------
+//! Generates the slices of a SlicedVolume, it can run in the calling thread or asynchronously as a ThreadPool task.
+struct SlicedVolume::SliceJob: public ParallelForTask
+{
+  SliceJob()
+  {
+    mSliceCount = 0;
+    mVertexArray   = new ArrayFloat3;
+    mTexCoordArray = new ArrayFloat3;
+  }
+
+  void setup(const fmat4& modelview, const AABB& box, const fvec3* tex_coords, int slice_count)
+  {
+    mModelview = modelview;
+    mBox = box;
+    memcpy(mTexCoord, tex_coords, sizeof(mTexCoord));
+    mSliceCount = slice_count > 0 ? slice_count : 0;
+  }
+
+  void run(int, int, int) { generate(); }
+
+  void generate()
+  {
+    fvec3 box_min = (fvec3)mBox.minCorner();
+    fvec3 box_max = (fvec3)mBox.maxCorner();
+    fvec3 obj_verts[] =
+    {
+      fvec3(box_min.x(), box_min.y(), box_min.z()), fvec3(box_max.x(), box_min.y(), box_min.z()),
+      fvec3(box_max.x(), box_max.y(), box_min.z()), fvec3(box_min.x(), box_max.y(), box_min.z()),
+      fvec3(box_min.x(), box_min.y(), box_max.z()), fvec3(box_max.x(), box_min.y(), box_max.z()),
+      fvec3(box_max.x(), box_max.y(), box_max.z()), fvec3(box_min.x(), box_max.y(), box_max.z())
+    };
+
+    fvec3 cube_verts[8];
+    int min_idx = 0;
+    int max_idx = 0;
+    for(int i=0; i<8; ++i)
+    {
+      cube_verts[i] = mModelview * obj_verts[i];
+      if (fabs(cube_verts[i].z()) < fabs(cube_verts[min_idx].z())) min_idx = i;
+      if (fabs(cube_verts[i].z()) > fabs(cube_verts[max_idx].z())) max_idx = i;
+    }
+
+    // the intersections are computed in camera space and interpolated directly in object and texture space
+    static const int edge_verts[12][2] = 
+    {
+      {0,1}, {1,2}, {2,3}, {3,0}, 
+      {4,5}, {5,6}, {6,7}, {7,4}, 
+      {1,5}, {2,6}, {3,7}, {0,4}
+    };
+    SliceEdge edges[12];
+    for(int iedge=0; iedge<12; ++iedge)
+    {
+      int v0 = edge_verts[iedge][0];
+      int v1 = edge_verts[iedge][1];
+      SliceEdge& e = edges[iedge];
+      float dz = cube_verts[v1].z() - cube_verts[v0].z();
+      e.mZ0   = cube_verts[v0].z();
+      e.mInvDZ = dz != 0 ? 1.0f / dz : 0;
+      // edges parallel to the slices are never intersected
+      e.mZMin = dz != 0 ? (dz > 0 ? e.mZ0 : e.mZ0 + dz) : 1;
+      e.mZMax = dz != 0 ? (dz > 0 ? e.mZ0 + dz : e.mZ0) : 0;
+      e.mP0 = obj_verts[v0];
+      e.mDP = obj_verts[v1] - obj_verts[v0];
+      e.mT0 = mTexCoord[v0];
+      e.mDT = mTexCoord[v1] - mTexCoord[v0];
+      e.mX0 = cube_verts[v0].x();
+      e.mDX = cube_verts[v1].x() - cube_verts[v0].x();
+      e.mY0 = cube_verts[v0].y();
+      e.mDY = cube_verts[v1].y() - cube_verts[v0].y();
+    }
+
+    mPoints.resize( mSliceCount*MaxSlicePoints + 1 );
+    mPointsT.resize( mSliceCount*MaxSlicePoints + 1 );
+    mCounts.resize( mSliceCount + 1 );
+    mOffsets.resize( mSliceCount + 1 );
+
+    // slices go from back to front
+    SlicePolygonTask poly_task;
+    poly_task.mEdges  = edges;
+    poly_task.mZStart = cube_verts[max_idx].z();
+    poly_task.mZStep  = (cube_verts[max_idx].z() - cube_verts[min_idx].z()) / (mSliceCount+1);
+    poly_task.mPoints = &mPoints[0];
+    poly_task.mTexCoords = &mPointsT[0];
+    poly_task.mCounts = &mCounts[0];
+    parallelFor(0, mSliceCount, &poly_task, 64);
+
+    int vert_count = 0;
+    for(int islice=0; islice<mSliceCount; ++islice)
+    {
+      mOffsets[islice] = vert_count;
+      if (mCounts[islice] >= 3)
+        vert_count += (mCounts[islice]-2)*3;
+    }
+
+    // avoid copying the old content when the size changes
+    if ((int)mVertexArray->size() != vert_count)
+    {
+      mVertexArray->resize(0);
+      mVertexArray->resize(vert_count);
+      mTexCoordArray->resize(0);
+      mTexCoordArray->resize(vert_count);
+    }
+    if (!vert_count)
+      return;
+
+    SliceTriangleTask tri_task;
+    tri_task.mPoints = &mPoints[0];
+    tri_task.mTexCoords = &mPointsT[0];
+    tri_task.mCounts = &mCounts[0];
+    tri_task.mOffsets = &mOffsets[0];
+    tri_task.mVertices = mVertexArray->begin();
+    tri_task.mTexCoordsOut = mTexCoordArray->begin();
+    parallelFor(0, mSliceCount, &tri_task, 64);
+  }
+
+  fmat4 mModelview;
+  AABB mBox;
+  fvec3 mTexCoord[8];
+  int mSliceCount;
+  std::vector<fvec3> mPoints;
+  std::vector<fvec3> mPointsT;
+  std::vector<int> mCounts;
+  std::vector<int> mOffsets;
+  ref<ArrayFloat3> mVertexArray;
+  ref<ArrayFloat3> mTexCoordArray;
+};
+//-----------------------------------------------------------------------------
 //! Constructor.
 SlicedVolume::SlicedVolume()
 {
@@ -82,6 +342,10 @@ SlicedVolume::SlicedVolume()
   mSliceCount = 1024;
   mGeometry = new Geometry;
   mGeometry->setObjectName("vl::SlicedVolume");
+  mDrawArrays = new DrawArrays(PT_TRIANGLES, 0, 0);
+  mSliceJob = new SliceJob;
+  mAsyncId = 0;
+  mAsyncSliceGeneration = false;
   
   fvec3 texc[] = 
   {
@@ -91,6 +355,13 @@ SlicedVolume::SlicedVolume()
   memcpy(mTexCoord, texc, sizeof(texc));
 }
 //-----------------------------------------------------------------------------
+SlicedVolume::~SlicedVolume()
+{
+  if (mAsyncId)
+    mAsyncPool->waitAsync(mAsyncId);
+  delete mSliceJob;
+}
+//-----------------------------------------------------------------------------
 /** Reimplement this method to update the uniform variables of your GLSL program before the volume is rendered.
  * By default updateUniforms() updates the position of up to 4 lights in object space. Such positions are stored in the
  * \p "uniform vec3 light_position[4]" variable.
@@ -146,18 +417,6 @@ void SlicedVolume::updateUniforms(Actor*actor, real, const Camera* camera, Rende
   }
 }
 //-----------------------------------------------------------------------------
-namespace
-{
-  class Edge
-  {
-  public:
-    int v0, v1, intersection, flags;
-    bool operator<(const Edge& other) const
-    {
-      return intersection > other.intersection;
-    }
-  };
-}
 //-----------------------------------------------------------------------------
 void SlicedVolume::bindActor(Actor* actor)
 {
@@ -170,6 +429,10 @@ void SlicedVolume::onActorRenderStarted(Actor* actor, real clock, const Camera*
   if (pass>0)
     return;
 
+  // select the resolution of the volume texture
+  if (mLOD)
+    mLOD->update(actor, clock, camera, shader, box());
+
   // setup uniform variables
 
   if (shader->getGLSLProgram())
@@ -184,152 +447,73 @@ void SlicedVolume::onActorRenderStarted(Actor* actor, real clock, const Camera*
   else
     mat = (fmat4)camera->viewMatrix();
 
+  // pick up the slices generated during the previous frame
+  waitSlices();
+
   if (mCache == mat)
     return;
   else
     mCache = mat;
 
-  fmat4 imat = mat.getInverse();
-
-  fvec3 cube_verts[] =
-  {
-    fvec3((float)box().minCorner().x(), (float)box().minCorner().y(), (float)box().minCorner().z()),
-    fvec3((float)box().maxCorner().x(), (float)box().minCorner().y(), (float)box().minCorner().z()),
-    fvec3((float)box().maxCorner().x(), (float)box().maxCorner().y(), (float)box().minCorner().z()),
-    fvec3((float)box().minCorner().x(), (float)box().maxCorner().y(), (float)box().minCorner().z()),
-    fvec3((float)box().minCorner().x(), (float)box().minCorner().y(), (float)box().maxCorner().z()),
-    fvec3((float)box().maxCorner().x(), (float)box().minCorner().y(), (float)box().maxCorner().z()),
-    fvec3((float)box().maxCorner().x(), (float)box().maxCorner().y(), (float)box().maxCorner().z()),
-    fvec3((float)box().minCorner().x(), (float)box().maxCorner().y(), (float)box().maxCorner().z())
-  };
-
-  int min_idx = 0;
-  int max_idx = 0;
-  for(int i=0; i<8; ++i)
+  if (mAsyncSliceGeneration && mGeometry->vertexArray())
   {
-    cube_verts[i] = mat * cube_verts[i];
-    if (fabs(cube_verts[i].z()) < fabs(cube_verts[min_idx].z())) min_idx = i;
-    if (fabs(cube_verts[i].z()) > fabs(cube_verts[max_idx].z())) max_idx = i;
-  }
-
-  if (cube_verts[min_idx].z() > 0)
-  {
-    // fixme?
-    // the actor is not visible: remove the geometry or disable the actor?
-    // return;
+    mSliceJob->setup(mat, box(), texCoords(), sliceCount());
+    ThreadPool* pool = defThreadPool();
+    mAsyncId = pool ? pool->parallelForAsync(0, 1, mSliceJob) : 0;
+    if (mAsyncId)
+    {
+      mAsyncPool = pool;
+      return;
+    }
   }
 
-  const int TOP    = 1;
-  const int BOTTOM = 2;
-  const int LEFT   = 4;
-  const int RIGHT  = 8;
-  const int FRONT  = 16;
-  const int BACK   = 32;
+  generateSlices(mat);
 
-  Edge edges[] =
+  // fixme: 
+  // it seems we have some problems with camera clipping/culling when the camera is close to the volume: the slices disappear or degenerate.
+  // it does not seem to depend from camera clipping plane optimization.
+}
+//-----------------------------------------------------------------------------
+void SlicedVolume::generateSlices(const fmat4& modelview)
+{
+  waitSlices();
+  mSliceJob->setup(modelview, box(), texCoords(), sliceCount());
+  mSliceJob->generate();
+  applySlices();
+}
+//-----------------------------------------------------------------------------
+void SlicedVolume::waitSlices()
+{
+  if (mAsyncId)
   {
-    {0,1,-1,FRONT |BOTTOM}, {1,2,-1,FRONT|RIGHT}, {2,3,-1,FRONT|TOP},  {3,0,-1,FRONT |LEFT},
-    {4,5,-1,BACK  |BOTTOM}, {5,6,-1,BACK |RIGHT}, {6,7,-1,BACK |TOP},  {7,4,-1,BACK  |LEFT},
-    {1,5,-1,BOTTOM|RIGHT},  {2,6,-1,TOP  |RIGHT}, {3,7,-1,TOP  |LEFT}, {0,4,-1,BOTTOM|LEFT}
-  };
-
-  std::vector<fvec3> points;
-  std::vector<fvec3> points_t;
-  std::vector<fvec3> polygons;
-  std::vector<fvec3> polygons_t;
-
-  polygons.reserve(sliceCount()*5);
-  polygons_t.reserve(sliceCount()*5);
-  float zrange = cube_verts[max_idx].z() - cube_verts[min_idx].z();
-  float zstep  = zrange/(sliceCount()+1);
-  int vert_idx[12];
-  for(int islice=0; islice<sliceCount(); ++islice)
+    mAsyncPool->waitAsync(mAsyncId);
+    mAsyncId = 0;
+    mAsyncPool = NULL;
+    applySlices();
+  }
+}
+//-----------------------------------------------------------------------------
+void SlicedVolume::applySlices()
+{
+  // the arrays just generated are swapped with the ones in use which will be reused for the next generation
+  ref<ArrayFloat3> vertex_array = mSliceJob->mVertexArray;
+  ref<ArrayFloat3> texcoo_array = mSliceJob->mTexCoordArray;
+  mSliceJob->mVertexArray   = cast<ArrayFloat3>(mGeometry->vertexArray());
+  mSliceJob->mTexCoordArray = cast<ArrayFloat3>(mGeometry->texCoordArray(0));
+  if (!mSliceJob->mVertexArray || !mSliceJob->mTexCoordArray)
   {
-    float z = cube_verts[max_idx].z() - zstep*(islice+1);
-    fvec3 plane_o(0,0,z);
-    fvec3 plane_n(0,0,1.0f);
-    points.clear();
-    points_t.clear();
-    for(int iedge=0; iedge<12; ++iedge)
-    {
-      edges[iedge].intersection = -1;
-      fvec3 vi  = cube_verts[ edges[iedge].v0 ];
-      fvec3 eij = cube_verts[ edges[iedge].v1 ] - cube_verts[ edges[iedge].v0 ];
-      float denom = dot(plane_n,eij);
-      if (denom == 0)
-        continue;
-      float lambda = (z - dot(plane_n,vi))/denom;
-      if (lambda<0 || lambda>1)
-        continue;
-      fvec3 v = vi + eij*lambda;
-      edges[iedge].intersection = (int)points.size();
-      points.push_back(v);
-      fvec3 a = texCoords()[ edges[iedge].v0 ];
-      fvec3 b = texCoords()[ edges[iedge].v1 ] - texCoords()[ edges[iedge].v0 ];
-      fvec3 vt = a + b*lambda;
-      points_t.push_back(vt);
-    }
-    std::sort(edges, edges+12);
-    int vert_idx_c = 0;
-    for(int ie0=0; ie0<12-1; ++ie0)
-    {
-      if (edges[ie0].intersection == -1)
-        break;
-      vert_idx[vert_idx_c++] = edges[ie0].intersection;
-      for(int ie1=ie0+1; ie1<12; ++ie1)
-      {
-        if (edges[ie1].intersection == -1)
-          continue;
-        if( (edges[ie0].flags & edges[ie1].flags) )
-        {
-          Edge t       = edges[ie0+1];
-          edges[ie0+1] = edges[ie1];
-          edges[ie1]   = t;
-          break;
-        }
-      }
-    }
-    for(int vc=0; vc<vert_idx_c-2; ++vc)
-    {
-      polygons.push_back(imat*points  [vert_idx[0]]);
-      polygons.push_back(imat*points  [vert_idx[vc+1]]);
-      polygons.push_back(imat*points  [vert_idx[vc+2]]);
-      polygons_t.push_back(points_t[vert_idx[0]]);
-      polygons_t.push_back(points_t[vert_idx[vc+1]]);
-      polygons_t.push_back(points_t[vert_idx[vc+2]]);
-    }
-    #ifndef NDEBUG
-      for(int ie0=0; ie0<12-1; ++ie0)
-      {
-        if (edges[ie0].intersection == -1)
-          break;
-        if (edges[ie0+1].intersection == -1)
-          break;
-        VL_CHECK(edges[ie0].flags & edges[ie0+1].flags)
-      }
-    #endif
+    mSliceJob->mVertexArray   = new ArrayFloat3;
+    mSliceJob->mTexCoordArray = new ArrayFloat3;
   }
 
-  mGeometry->drawCalls()->clear();
-  ref<DrawArrays> da = new DrawArrays(PT_TRIANGLES, 0, (int)polygons.size());
-  mGeometry->drawCalls()->push_back( da.get() );
-  ref<ArrayFloat3> vertex_array = new ArrayFloat3;
-  ref<ArrayFloat3> texcoo_array = new ArrayFloat3;
-  vertex_array->resize(polygons.size());
-  texcoo_array->resize(polygons_t.size());
-  VL_CHECK((size_t)vertex_array->bufferObject()->bytesUsed() == sizeof(polygons  [0])*polygons.  size());
-  VL_CHECK((size_t)texcoo_array->bufferObject()->bytesUsed() == sizeof(polygons_t[0])*polygons_t.size());
-  memcpy(vertex_array->ptr(), &polygons  [0], vertex_array->bufferObject()->bytesUsed());
-  memcpy(texcoo_array->ptr(), &polygons_t[0], texcoo_array->bufferObject()->bytesUsed());
+  mDrawArrays->setCount((int)vertex_array->size());
+  if (mGeometry->drawCalls()->empty())
+    mGeometry->drawCalls()->push_back( mDrawArrays.get() );
   mGeometry->setVertexArray(vertex_array.get());
   mGeometry->setTexCoordArray(0,texcoo_array.get());
 
   mGeometry->setDisplayListDirty(true);
   mGeometry->setBufferObjectDirty(true);
-
-  // fixme: 
-  // it seems we have some problems with camera clipping/culling when the camera is close to the volume: the slices disappear or degenerate.
-  // it does not seem to depend from camera clipping plane optimization.
 }
 //-----------------------------------------------------------------------------
 void SlicedVolume::generateTextureCoordinates(const ivec3& img_size)
@@ -33,9 +33,11 @@
 #define SlicedVolume_INCLUDE_ONCE
 
 #include <vlVolume/link_config.hpp>
+#include <vlVolume/VolumePyramid.hpp>
 #include <vlGraphics/Actor.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/Light.hpp>
+#include <vlCore/ThreadPool.hpp>
 
 namespace vl
 {
@@ -46,6 +48,8 @@ namespace vl
   public:
     //! Constructor.
     SlicedVolume();
+
+    ~SlicedVolume();
     
     void onActorRenderStarted(Actor* actor, real frame_clock, const Camera* cam, Renderable* renderable, const Shader* shader, int pass);
 
@@ -58,7 +62,7 @@ namespace vl
     virtual void updateUniforms(Actor* actor, real clock, const Camera* camera, Renderable* rend, const Shader* shader);
     
     //! Defines the number of slices used to render the volume: more slices generate a better (and slower) rendering.
-    void setSliceCount(int count) { mSliceCount = count; }
+    void setSliceCount(int count) { mSliceCount = count; mCache.fill(0); }
     
     //! Returns the number of slices used to render the volume.
     int sliceCount() const { return mSliceCount; }
@@ -88,12 +92,47 @@ namespace vl
     //! Use this function to visualize a subset of the volume. The subset is defined by \p min_corner and \p max_corner.
     void generateTextureCoordinates(const ivec3& img_size, const ivec3& min_corner, const ivec3& max_corner);
 
+    //! Enables level of detail rendering: the VolumeLOD selects the level of its VolumePyramid bound to the volume texture before the volume is rendered. 
+    void setLOD(VolumeLOD* lod) { mLOD = lod; }
+
+    //! The VolumeLOD used to select the resolution of the volume texture, NULL by default.
+    VolumeLOD* lod() { return mLOD.get(); }
+
+    //! The VolumeLOD used to select the resolution of the volume texture, NULL by default.
+    const VolumeLOD* lod() const { return mLOD.get(); }
+
+    //! If enabled the slices for a new view are generated by a worker thread of defThreadPool() while the current frame 
+    //! is rendered and are used starting from the next frame, i.e. the slices lag one frame behind the camera.
+    //! Disabled by default, in which case the slices are generated in parallel before the volume is rendered.
+    void setAsyncSliceGeneration(bool async) { mAsyncSliceGeneration = async; }
+
+    //! Whether the slices are generated asynchronously one frame ahead, see setAsyncSliceGeneration().
+    bool asyncSliceGeneration() const { return mAsyncSliceGeneration; }
+
+    //! Generates the slices of the volume as seen with the given modelview matrix, i.e. the matrix transforming the 
+    //! object space of the volume to the camera space. Usually you don't need to call this function since the slices
+    //! are automatically regenerated as the actor or the camera move.
+    void generateSlices(const fmat4& modelview);
+
+  protected:
+    void waitSlices();
+    void applySlices();
+
+  private:
+    struct SliceJob;
+
   protected:
     int mSliceCount;
     ref<Geometry> mGeometry;
+    ref<DrawArrays> mDrawArrays;
+    ref<ThreadPool> mAsyncPool;
+    ref<VolumeLOD> mLOD;
     AABB mBox;
     fmat4 mCache;
     fvec3 mTexCoord[8];
+    SliceJob* mSliceJob;
+    int mAsyncId;
+    bool mAsyncSliceGeneration;
   };
 }
 
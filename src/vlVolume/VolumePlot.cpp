@@ -35,6 +35,7 @@
 #include <vlGraphics/FontManager.hpp>
 #include <vlCore/VisualizationLibrary.hpp>
 #include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlCore/ThreadPool.hpp>
 
 using namespace vl;
 
@@ -64,6 +65,9 @@ Example:
   plot.compute( my_func(), 0.900f );
   sceneManager()->tree()->addChild(plot.actorTreeMulti());
 \endcode
+
+The function is sampled one row at a time using Function::evaluateRow(). If Function::isThreadSafe() returns true the Z slices 
+of the grid are evaluated in parallel using defThreadPool(), the isosurface extraction is always performed in parallel.
  */
 
 //-----------------------------------------------------------------------------
@@ -205,29 +209,64 @@ void VolumePlot::setupLabels(const String& format, const fvec3& min_corner, cons
     mActors.push_back( text_a.get() );
   }
 }
+namespace
+{
+  class EvaluateFunctionTask: public ParallelForTask
+  {
+  public:
+    void run(int begin, int end, int)
+    {
+      int w = (int)mX.size();
+      for(int z=begin; z<end; ++z)
+      {
+        float tz = (float)z/(mDepth-1);
+        float vz = mMinCorner.z()*(1.0f-tz) + mMaxCorner.z()*tz;
+        for(int y=0; y<mHeight; ++y)
+        {
+          float ty = (float)y/(mHeight-1);
+          float vy = mMinCorner.y()*(1.0f-ty) + mMaxCorner.y()*ty;
+          mFunc->evaluateRow(&mX[0], w, vy, vz, mScalar + y*w + z*w*mHeight);
+        }
+      }
+    }
+
+  public:
+    const VolumePlot::Function* mFunc;
+    float* mScalar;
+    std::vector<float> mX;
+    int mHeight;
+    int mDepth;
+    fvec3 mMinCorner;
+    fvec3 mMaxCorner;
+  };
+}
 //-----------------------------------------------------------------------------
 void VolumePlot::evaluateFunction(float* scalar, const fvec3& min_corner, const fvec3& max_corner, const Function& func)
 {
-  fvec3 v;
   int w = mSamplingResolution.x();
   int h = mSamplingResolution.y();
   int d = mSamplingResolution.z();
-  for(int z=0; z<d; ++z)
+  if (w <= 0 || h <= 0 || d <= 0)
+    return;
+
+  EvaluateFunctionTask task;
+  task.mFunc = &func;
+  task.mScalar = scalar;
+  task.mHeight = h;
+  task.mDepth = d;
+  task.mMinCorner = min_corner;
+  task.mMaxCorner = max_corner;
+  // the x coordinates are the same for every row
+  task.mX.resize(w);
+  for(int x=0; x<w; ++x)
   {
-    float tz = (float)z/(d-1);
-    v.z() = min_corner.z()*(1.0f-tz) + max_corner.z()*tz;
-    for(int y=0; y<h; ++y)
-    {
-      float ty = (float)y/(h-1);
-      v.y() = min_corner.y()*(1.0f-ty) + max_corner.y()*ty;
-      for(int x=0; x<w; ++x)
-      {
-        float tx = (float)x/(w-1);
-        v.x() = min_corner.x()*(1.0f-tx) + max_corner.x()*tx;
-        // evaluate function
-        scalar[x+y*w+z*w*h] = func(v.x(),v.y(),v.z());
-      }
-    }
+    float tx = (float)x/(w-1);
+    task.mX[x] = min_corner.x()*(1.0f-tx) + max_corner.x()*tx;
   }
+
+  if (func.isThreadSafe())
+    parallelFor(0, d, &task);
+  else
+    task.run(0, d, 0);
 }
 //-----------------------------------------------------------------------------
@@ -52,11 +52,27 @@ namespace vl
     VL_INSTRUMENT_CLASS(vl::VolumePlot, Object)
 
   public:
-    //! A function to be used with VolumePlot
+    //! A function to be used with VolumePlot.
+    //! The function is evaluated by a single thread unless isThreadSafe() is reimplemented to return true.
     class Function
     {
     public:
+      virtual ~Function() {}
+
       virtual float operator()(float x, float y, float z) const = 0;
+
+      //! Evaluates the function at the \p count points (x[i], y, z) storing the results in \p out.
+      //! Reimplement this method to evaluate a whole row of samples in one call, for example using SIMD instructions.
+      //! The default implementation calls operator() once per point.
+      virtual void evaluateRow(const float* x, int count, float y, float z, float* out) const
+      {
+        for(int i=0; i<count; ++i)
+          out[i] = (*this)(x[i], y, z);
+      }
+
+      //! Return true if the function can be evaluated by several threads at the same time, i.e. if operator() and evaluateRow()
+      //! do not modify any shared state. Default is false.
+      virtual bool isThreadSafe() const { return false; }
     };
 
   public:
@@ -0,0 +1,431 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/VolumePyramid.hpp>
+#include <vlVolume/BrickedVolume.hpp>
+#include <vlGraphics/GLSL.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlGraphics/OpenGLContext.hpp>
+#include <vlCore/ThreadPool.hpp>
+#include <vlCore/glsl_math.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  //! The number of components of the formats supported by VolumePyramid, 0 if not supported.
+  int componentCount(EImageFormat format)
+  {
+    switch(format)
+    {
+    case IF_RGB:
+    case IF_BGR:             return 3;
+    case IF_RGBA:
+    case IF_BGRA:            return 4;
+    case IF_LUMINANCE_ALPHA: return 2;
+    case IF_RED:
+    case IF_GREEN:
+    case IF_BLUE:
+    case IF_ALPHA:
+    case IF_LUMINANCE:
+    case IF_DEPTH_COMPONENT: return 1;
+    default:                 return 0;
+    }
+  }
+
+  //! The type used to reduce the voxels: 8 and 16 bits values are represented exactly by a float.
+  template<typename T> struct Accum { typedef float type; };
+  template<> struct Accum<unsigned int> { typedef double type; };
+  template<> struct Accum<int> { typedef double type; };
+
+  template<typename T> inline T roundAverage(typename Accum<T>::type sum) { return (T)floor(sum * 0.125 + 0.5); }
+  template<> inline float roundAverage<float>(float sum) { return sum * 0.125f; }
+  template<> inline half roundAverage<half>(float sum) { return half(sum * 0.125f); }
+
+  template<typename T> struct AverageOp
+  {
+    typedef typename Accum<T>::type A;
+    static inline A combine(A a, A b) { return a + b; }
+    static inline T result(A a) { return roundAverage<T>(a); }
+  };
+
+  template<typename T> struct MinimumOp
+  {
+    typedef typename Accum<T>::type A;
+    static inline A combine(A a, A b) { return b < a ? b : a; }
+    static inline T result(A a) { return (T)a; }
+  };
+
+  template<typename T> struct MaximumOp
+  {
+    typedef typename Accum<T>::type A;
+    static inline A combine(A a, A b) { return b > a ? b : a; }
+    static inline T result(A a) { return (T)a; }
+  };
+
+  //! Reduces the 2x2x2 blocks of a 3D image, one output slice per item.
+  template<typename T, class Op>
+  class DownsampleTask: public ParallelForTask
+  {
+    typedef typename Accum<T>::type A;
+
+  public:
+    DownsampleTask(const Image* src, Image* dst, int comps): mSrc(src), mDst(dst), mComps(comps) {}
+
+    const T* srcRow(int y, int z) const { return (const T*)(mSrc->pixels() + ((size_t)z*mSrc->height() + y)*mSrc->pitch()); }
+
+    virtual void run(int begin, int end, int)
+    {
+      const int w = mSrc->width();
+      const int h = mSrc->height();
+      const int d = mSrc->depth();
+      for(int z=begin; z<end; ++z)
+      {
+        const int z0 = 2*z;
+        const int z1 = 2*z+1 < d ? 2*z+1 : d-1;
+        for(int y=0; y<mDst->height(); ++y)
+        {
+          const int y0 = 2*y;
+          const int y1 = 2*y+1 < h ? 2*y+1 : h-1;
+          const T* r00 = srcRow(y0, z0);
+          const T* r01 = srcRow(y1, z0);
+          const T* r10 = srcRow(y0, z1);
+          const T* r11 = srcRow(y1, z1);
+          T* out = (T*)(mDst->pixels() + ((size_t)z*mDst->height() + y)*mDst->pitch());
+          for(int x=0; x<mDst->width(); ++x)
+          {
+            const int x0 = 2*x * mComps;
+            const int x1 = (2*x+1 < w ? 2*x+1 : w-1) * mComps;
+            for(int c=0; c<mComps; ++c, ++out)
+            {
+              A a = (A)r00[x0+c];
+              a = Op::combine(a, (A)r00[x1+c]);
+              a = Op::combine(a, (A)r01[x0+c]);
+              a = Op::combine(a, (A)r01[x1+c]);
+              a = Op::combine(a, (A)r10[x0+c]);
+              a = Op::combine(a, (A)r10[x1+c]);
+              a = Op::combine(a, (A)r11[x0+c]);
+              a = Op::combine(a, (A)r11[x1+c]);
+              *out = Op::result(a);
+            }
+          }
+        }
+      }
+    }
+
+  protected:
+    const Image* mSrc;
+    Image* mDst;
+    int mComps;
+  };
+
+  template<typename T>
+  void downsampleT(const Image* src, Image* dst, int comps, VolumePyramid::EReduction reduction)
+  {
+    switch(reduction)
+    {
+    case VolumePyramid::Average: { DownsampleTask<T, AverageOp<T> > task(src, dst, comps); parallelFor(0, dst->depth(), &task); break; }
+    case VolumePyramid::Minimum: { DownsampleTask<T, MinimumOp<T> > task(src, dst, comps); parallelFor(0, dst->depth(), &task); break; }
+    case VolumePyramid::Maximum: { DownsampleTask<T, MaximumOp<T> > task(src, dst, comps); parallelFor(0, dst->depth(), &task); break; }
+    }
+  }
+
+  inline int halfSize(int n) { return (n+1) / 2; }
+}
+//-----------------------------------------------------------------------------
+// VolumePyramid
+//-----------------------------------------------------------------------------
+VolumePyramid::VolumePyramid()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mSize = ivec3(0,0,0);
+  mReduction = Average;
+}
+//-----------------------------------------------------------------------------
+void VolumePyramid::clear()
+{
+  mLevels.clear();
+  mSize = ivec3(0,0,0);
+}
+//-----------------------------------------------------------------------------
+ref<Image> VolumePyramid::downsample(const Image* img, EReduction reduction)
+{
+  const int comps = componentCount(img->format());
+  if (img->dimension() != ID_3D || !comps)
+  {
+    Log::error("VolumePyramid::downsample(): the image must be a 3D non compressed image.\n");
+    return NULL;
+  }
+
+  ref<Image> dst = new Image(halfSize(img->width()), halfSize(img->height()), halfSize(img->depth()), img->byteAlignment(), img->format(), img->type());
+  switch(img->type())
+  {
+  case IT_UNSIGNED_BYTE:  downsampleT<unsigned char> (img, dst.get(), comps, reduction); break;
+  case IT_BYTE:           downsampleT<GLbyte>        (img, dst.get(), comps, reduction); break;
+  case IT_UNSIGNED_SHORT: downsampleT<unsigned short>(img, dst.get(), comps, reduction); break;
+  case IT_SHORT:          downsampleT<short>         (img, dst.get(), comps, reduction); break;
+  case IT_UNSIGNED_INT:   downsampleT<unsigned int>  (img, dst.get(), comps, reduction); break;
+  case IT_INT:            downsampleT<int>           (img, dst.get(), comps, reduction); break;
+  case IT_FLOAT:          downsampleT<float>         (img, dst.get(), comps, reduction); break;
+  case IT_HALF_FLOAT:     downsampleT<half>          (img, dst.get(), comps, reduction); break;
+  default:
+    Log::error("VolumePyramid::downsample(): unsupported image type.\n");
+    return NULL;
+  }
+  return dst;
+}
+//-----------------------------------------------------------------------------
+bool VolumePyramid::build(const Image* img, EReduction reduction, int min_size)
+{
+  clear();
+  mReduction = reduction;
+  if (!img || img->dimension() != ID_3D)
+  {
+    Log::error("VolumePyramid::build(): a 3D image is required.\n");
+    return false;
+  }
+
+  mSize = ivec3(img->width(), img->height(), img->depth());
+  mLevels.push_back( const_cast<Image*>(img) );
+  ivec3 size = mSize;
+  while(size.x() > min_size || size.y() > min_size || size.z() > min_size)
+  {
+    ref<Image> level = downsample(mLevels.back().get(), reduction);
+    if (!level)
+    {
+      clear();
+      return false;
+    }
+    mLevels.push_back(level);
+    size = ivec3(level->width(), level->height(), level->depth());
+    if (size == ivec3(1,1,1))
+      break;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool VolumePyramid::build(BrickedVolume* volume, EReduction reduction, int min_size)
+{
+  clear();
+  mReduction = reduction;
+  const int B = volume->brickSize();
+  if (B % 2)
+  {
+    Log::error("VolumePyramid::build(): the brick size of the BrickedVolume must be even.\n");
+    return false;
+  }
+
+  mSize = volume->size();
+  ref<Image> level1 = new Image(halfSize(mSize.x()), halfSize(mSize.y()), halfSize(mSize.z()), 1, IF_LUMINANCE, volume->type());
+  const int vsize = level1->bitsPerPixel() / 8;
+
+  // bricks have even dimensions except along the far borders of the volume, where the clamping of 
+  // downsample() matches the one of the whole volume, so each brick maps exactly to a block of level 1.
+  const ivec3& bricks = volume->brickCount();
+  for(int bz=0; bz<bricks.z(); ++bz)
+  {
+    for(int by=0; by<bricks.y(); ++by)
+    {
+      for(int bx=0; bx<bricks.x(); ++bx)
+      {
+        ref<Image> brick = volume->brick(bx, by, bz);
+        ref<Image> small;
+        if (brick)
+          small = downsample(brick.get(), reduction);
+        if (!small)
+        {
+          clear();
+          return false;
+        }
+        const ivec3 o = volume->brickOrigin(bx, by, bz) / 2;
+        for(int z=0; z<small->depth(); ++z)
+        {
+          for(int y=0; y<small->height(); ++y)
+          {
+            unsigned char* dst = level1->pixels() + ((size_t)(o.z()+z)*level1->height() + o.y()+y)*level1->pitch() + (size_t)o.x()*vsize;
+            const unsigned char* src = small->pixels() + ((size_t)z*small->height() + y)*small->pitch();
+            memcpy(dst, src, (size_t)small->width()*vsize);
+          }
+        }
+      }
+    }
+  }
+
+  // level 0 is not kept in memory
+  mLevels.push_back( NULL );
+  mLevels.push_back( level1 );
+  ivec3 size = ivec3(level1->width(), level1->height(), level1->depth());
+  while((size.x() > min_size || size.y() > min_size || size.z() > min_size) && size != ivec3(1,1,1))
+  {
+    mLevels.push_back( downsample(mLevels.back().get(), reduction) );
+    size = ivec3(mLevels.back()->width(), mLevels.back()->height(), mLevels.back()->depth());
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+int VolumePyramid::selectLevel(const Camera* camera, const Transform* transform, const AABB& box, float pixel_size) const
+{
+  if (mLevels.empty() || !camera->viewport() || mSize.x() < 1 || mSize.y() < 1 || mSize.z() < 1)
+    return 0;
+
+  mat4 world;
+  if (transform)
+    world = transform->worldMatrix();
+
+  // the largest voxel edge in world space
+  vec3 extent = box.maxCorner() - box.minCorner();
+  real voxel = 0;
+  for(int i=0; i<3; ++i)
+  {
+    vec3 edge;
+    edge[i] = extent[i] / mSize[i];
+    real len = (world * vec4(edge, 0)).xyz().length();
+    voxel = len > voxel ? len : voxel;
+  }
+
+  // distance from the camera of the nearest point of the bounding sphere
+  vec3 center = camera->viewMatrix() * (world * box.center());
+  real radius = (world * vec4(extent * 0.5f, 0)).xyz().length();
+  real dist = -center.z() - radius;
+  if (dist < camera->nearPlane())
+    dist = camera->nearPlane();
+
+  const mat4& proj = camera->projectionMatrix();
+  real pixels_per_unit = proj.e(1,1) * camera->viewport()->height() * 0.5f;
+  if (proj.e(3,2) != 0)
+    pixels_per_unit /= dist;
+
+  real voxel_pixels = voxel * pixels_per_unit;
+  int level = 0;
+  while(level+1 < levelCount() && voxel_pixels * 2 <= pixel_size)
+  {
+    voxel_pixels *= 2;
+    ++level;
+  }
+  return level;
+}
+//-----------------------------------------------------------------------------
+// VolumeLOD
+//-----------------------------------------------------------------------------
+VolumeLOD::VolumeLOD(VolumePyramid* pyramid, Shader* shader, int texture_unit)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mPyramid = pyramid;
+  mSampler = shader->gocTextureSampler(texture_unit);
+  mTextures.resize(pyramid->levelCount());
+  if (!mTextures.empty())
+    mTextures[0] = mSampler->texture();
+  mOpenGLContext = NULL;
+  mTextureFormat = TF_UNKNOWN;
+  mTextureUnit = texture_unit;
+  mCurrentLevel = 0;
+  mInteractiveBias = 1;
+  mPixelSize = 1.0f;
+  mRefinementDelay = 0.25f;
+  mLastMotion = -1e10;
+  mHasLastMatrix = false;
+}
+//-----------------------------------------------------------------------------
+Texture* VolumeLOD::levelTexture(int level)
+{
+  if (!mTextures[level] && mPyramid->level(level))
+  {
+    const Texture* tex0 = mTextures[0].get();
+    ETextureFormat format = mTextureFormat;
+    if (format == TF_UNKNOWN)
+      format = tex0 ? tex0->internalFormat() : TF_RGBA;
+    mTextures[level] = new Texture(mPyramid->level(level), format, false, false);
+    if (tex0)
+    {
+      // same filtering and wrapping of the full resolution texture, without mipmaps
+      TexParameter* par = mTextures[level]->getTexParameter();
+      *par = *tex0->getTexParameter();
+      if (par->minFilter() != TPF_NEAREST && par->minFilter() != TPF_LINEAR)
+        par->setMinFilter(TPF_LINEAR);
+      par->setGenerateMipmap(false);
+      par->setDirty(true);
+    }
+  }
+  return mTextures[level].get();
+}
+//-----------------------------------------------------------------------------
+void VolumeLOD::update(Actor* actor, real clock, const Camera* camera, const Shader* shader, const AABB& box)
+{
+  if (mTextures.empty())
+    return;
+
+  mat4 mat = camera->viewMatrix();
+  if (actor->transform())
+    mat = mat * actor->transform()->worldMatrix();
+  if (mat != mLastMatrix)
+  {
+    // the first frame is not a movement
+    if (mHasLastMatrix)
+      mLastMotion = clock;
+    mLastMatrix = mat;
+    mHasLastMatrix = true;
+  }
+
+  int level = 0;
+  bool moving = clock - mLastMotion < mRefinementDelay;
+  if (moving)
+  {
+    level = mPyramid->selectLevel(camera, actor->transform(), box, mPixelSize) + mInteractiveBias;
+    level = clamp(level, 0, (int)mTextures.size()-1);
+  }
+
+  // levels not available, like level 0 of the pyramid of a BrickedVolume without a texture, are skipped
+  while(level+1 < (int)mTextures.size() && !levelTexture(level))
+    ++level;
+
+  if (level != mCurrentLevel && levelTexture(level))
+  {
+    mCurrentLevel = level;
+    Texture* tex = levelTexture(level);
+    mSampler->setTexture(tex);
+    // the render states have already been applied for this frame: bind the texture immediately
+    VL_glActiveTexture( GL_TEXTURE0 + mTextureUnit ); VL_CHECK_OGL()
+    glBindTexture( tex->dimension(), tex->handle() ); VL_CHECK_OGL()
+  }
+
+  if (moving && mCurrentLevel > 0 && mOpenGLContext)
+    mOpenGLContext->update();
+
+  const GLSLProgram* glsl = shader->getGLSLProgram();
+  if (glsl && glsl->getUniformLocation("volume_lod") != -1)
+    actor->gocUniform("volume_lod")->setUniformI(mCurrentLevel);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,200 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://www.visualizationlibrary.org                                               */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef VolumePyramid_INCLUDE_ONCE
+#define VolumePyramid_INCLUDE_ONCE
+
+#include <vlVolume/link_config.hpp>
+#include <vlCore/Image.hpp>
+#include <vlGraphics/Shader.hpp>
+#include <vlGraphics/Actor.hpp>
+
+namespace vl
+{
+  class BrickedVolume;
+
+  //------------------------------------------------------------------------------
+  // VolumePyramid
+  //------------------------------------------------------------------------------
+  /**
+   * A multiresolution pyramid of a 3D image, each level is half the size of the previous one along each axis.
+   *
+   * The levels are computed in parallel using vl::defThreadPool() by reducing each 2x2x2 block of voxels to its average, 
+   * minimum or maximum value, see EReduction. Minimum and maximum pyramids are useful for maximum intensity projection
+   * and to conservatively skip empty regions. A level of size N along an axis produces a level of size (N+1)/2, the last 
+   * voxel of odd sized levels being reduced with itself. 
+   *
+   * The pyramid of a BrickedVolume is built one brick at a time so that the full resolution volume does not need to be in memory,
+   * in this case level(0) is NULL.
+   *
+   * \sa VolumeLOD, RaycastVolume, SlicedVolume
+   */
+  class VLVOLUME_EXPORT VolumePyramid: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VolumePyramid, Object)
+
+  public:
+    typedef enum { Average, Minimum, Maximum } EReduction;
+
+  public:
+    VolumePyramid();
+
+    //! Builds the pyramid of a 3D image, level(0) is \p img itself. 
+    //! Levels are generated until the largest dimension is not greater than \p min_size.
+    //! Supports the same types and formats of Image::convertType(), returns false on failure.
+    bool build(const Image* img, EReduction reduction=Average, int min_size=16);
+
+    //! Builds the pyramid of a BrickedVolume, whose brick size must be even. Level 1 is computed brick by brick and level(0) is NULL.
+    bool build(BrickedVolume* volume, EReduction reduction=Average, int min_size=16);
+
+    //! Releases all the levels.
+    void clear();
+
+    //! Returns a 3D image half the size of \p img reduced as specified by \p reduction, or NULL if the image is not supported.
+    static ref<Image> downsample(const Image* img, EReduction reduction);
+
+    //! The number of levels including level 0.
+    int levelCount() const { return (int)mLevels.size(); }
+
+    const Image* level(int i) const { return mLevels[i].get(); }
+
+    Image* level(int i) { return mLevels[i].get(); }
+
+    //! The size of the full resolution volume.
+    const ivec3& size() const { return mSize; }
+
+    EReduction reduction() const { return mReduction; }
+
+    /**
+     * Returns the coarsest level whose voxels are not larger than \p pixel_size pixels once projected on the screen.
+     * \param camera The camera used to render the volume.
+     * \param transform The transform of the volume Actor, can be NULL.
+     * \param box The box enclosing the volume in object space.
+     * \param pixel_size The maximum size in pixels of a voxel.
+     */
+    int selectLevel(const Camera* camera, const Transform* transform, const AABB& box, float pixel_size=1.0f) const;
+
+  protected:
+    std::vector< ref<Image> > mLevels;
+    ivec3 mSize;
+    EReduction mReduction;
+  };
+  //------------------------------------------------------------------------------
+  // VolumeLOD
+  //------------------------------------------------------------------------------
+  /**
+   * Selects which level of a VolumePyramid is bound to a TextureSampler while rendering a volume with 
+   * RaycastVolume or SlicedVolume.
+   *
+   * While the camera or the volume move a coarse level is selected based on the projected voxel size 
+   * (see VolumePyramid::selectLevel(), setPixelSize() and setInteractiveBias()), when they stop for longer than 
+   * refinementDelay() seconds, according to the frame clock, the full resolution level is selected again. 
+   * Applications that render only on demand should specify their OpenGLContext with setOpenGLContext() so that 
+   * a new frame is requested while a refinement is pending.
+   *
+   * The texture bound to the sampler when the VolumeLOD is created is used as level 0, the textures of the other levels 
+   * are created on demand with the same TexParameter settings. If the GLSLProgram has a \p "uniform int volume_lod" 
+   * variable it is set to the current level, for example to scale the raycasting step.
+   */
+  class VLVOLUME_EXPORT VolumeLOD: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VolumeLOD, Object)
+
+  public:
+    //! Constructor.
+    //! \param pyramid The pyramid of the volume.
+    //! \param shader The Shader used to render the volume.
+    //! \param texture_unit The texture unit of \p shader the volume texture is bound to.
+    VolumeLOD(VolumePyramid* pyramid, Shader* shader, int texture_unit=0);
+
+    const VolumePyramid* pyramid() const { return mPyramid.get(); }
+
+    VolumePyramid* pyramid() { return mPyramid.get(); }
+
+    int textureUnit() const { return mTextureUnit; }
+
+    //! The format of the textures created for the pyramid levels, TF_UNKNOWN (default) uses the format of the level 0 texture or TF_RGBA.
+    void setTextureFormat(ETextureFormat format) { mTextureFormat = format; }
+
+    //! The format of the textures created for the pyramid levels, TF_UNKNOWN (default) uses the format of the level 0 texture or TF_RGBA.
+    ETextureFormat textureFormat() const { return mTextureFormat; }
+
+    //! The maximum projected size of a voxel in pixels while interacting, default is 1.
+    void setPixelSize(float pixel_size) { mPixelSize = pixel_size; }
+
+    //! The maximum projected size of a voxel in pixels while interacting, default is 1.
+    float pixelSize() const { return mPixelSize; }
+
+    //! The number of levels added to the selected level while interacting, default is 1.
+    void setInteractiveBias(int bias) { mInteractiveBias = bias; }
+
+    //! The number of levels added to the selected level while interacting, default is 1.
+    int interactiveBias() const { return mInteractiveBias; }
+
+    //! The time in seconds after the last movement after which the full resolution level is selected, default is 0.25.
+    void setRefinementDelay(real seconds) { mRefinementDelay = seconds; }
+
+    //! The time in seconds after the last movement after which the full resolution level is selected, default is 0.25.
+    real refinementDelay() const { return mRefinementDelay; }
+
+    //! If not NULL OpenGLContext::update() is called while a refinement is pending.
+    void setOpenGLContext(OpenGLContext* ctx) { mOpenGLContext = ctx; }
+
+    OpenGLContext* openglContext() { return mOpenGLContext; }
+
+    //! The level currently bound.
+    int currentLevel() const { return mCurrentLevel; }
+
+    //! Selects and binds the appropriate level, called by RaycastVolume and SlicedVolume before the volume is rendered.
+    void update(Actor* actor, real clock, const Camera* camera, const Shader* shader, const AABB& box);
+
+  protected:
+    Texture* levelTexture(int level);
+
+  protected:
+    ref<VolumePyramid> mPyramid;
+    ref<TextureSampler> mSampler;
+    std::vector< ref<Texture> > mTextures;
+    OpenGLContext* mOpenGLContext;
+    ETextureFormat mTextureFormat;
+    int mTextureUnit;
+    int mCurrentLevel;
+    int mInteractiveBias;
+    float mPixelSize;
+    real mRefinementDelay;
+    real mLastMotion;
+    mat4 mLastMatrix;
+    bool mHasLastMatrix;
+  };
+}
+
+#endif
@@ -32,9 +32,393 @@
 #include <vlVolume/VolumeUtils.hpp>
 #include <vlCore/Log.hpp>
 #include <vlCore/glsl_math.hpp>
+#include <vlCore/ImageView.hpp>
+#include <vlCore/ThreadPool.hpp>
+
+#if VL_SSE2
+  #include <emmintrin.h>
+#endif
 
 using namespace vl;
 
+namespace
+{
+  //! Converts a component to the value returned by Image::sample().
+  template<typename T> inline float sampleValue(T v) { return (float)((double)v / ImageComponent<T>::maxValue()); }
+  template<> inline float sampleValue(float v) { return v; }
+  template<> inline float sampleValue(half v) { return (float)(double)v; }
+
+  //! Reads the rows of one component of a volume as floats, either as raw values or normalized like Image::sample().
+  class VolumeRows
+  {
+  public:
+    VolumeRows(): mWidth(0), mHeight(0), mDepth(0) {}
+    virtual ~VolumeRows() {}
+    virtual void load(int y, int z, float* out) const = 0;
+
+    int mWidth;
+    int mHeight;
+    int mDepth;
+  };
+
+  template<typename T, int N>
+  class VolumeRowsT: public VolumeRows
+  {
+  public:
+    VolumeRowsT(const Image* img, int channel, bool normalized): mView(img), mChannel(channel), mNormalized(normalized)
+    {
+      mWidth  = mView.width();
+      mHeight = mView.height();
+      mDepth  = mView.depth();
+      if (sizeof(T) <= 2 && ImageComponent<T>::type() != IT_HALF_FLOAT)
+      {
+        // 8 and 16 bits components are converted with a table
+        mLUT.resize( 1 << (sizeof(T)*8) );
+        for(int i=0; i<(int)mLUT.size(); ++i)
+        {
+          T v = (T)i;
+          mLUT[i] = normalized ? sampleValue<T>(v) : (float)v;
+        }
+      }
+    }
+
+    virtual void load(int y, int z, float* out) const
+    {
+      if (mChannel < 0)
+      {
+        memset(out, 0, sizeof(float)*mWidth);
+        return;
+      }
+      const T* px = mView.row(y, z) + mChannel;
+      if (!mLUT.empty())
+      {
+        const float* lut = &mLUT[0];
+        const int mask = (int)mLUT.size() - 1; // signed types index the table with their bit pattern
+        for(int x=0; x<mWidth; ++x)
+          out[x] = lut[(int)px[x*N] & mask];
+      }
+      else
+      if (mNormalized)
+      {
+        for(int x=0; x<mWidth; ++x)
+          out[x] = sampleValue<T>(px[x*N]);
+      }
+      else
+      {
+        for(int x=0; x<mWidth; ++x)
+          out[x] = (float)px[x*N];
+      }
+    }
+
+    ConstImageView<T,N> mView;
+    int mChannel;
+    bool mNormalized;
+    std::vector<float> mLUT;
+  };
+
+  template<typename T>
+  VolumeRows* createVolumeRowsT(const Image* img, int comps, int channel, bool normalized)
+  {
+    switch(comps)
+    {
+      case 1:  return ConstImageView<T,1>::compatible(img) ? new VolumeRowsT<T,1>(img, channel, normalized) : NULL;
+      case 2:  return ConstImageView<T,2>::compatible(img) ? new VolumeRowsT<T,2>(img, channel, normalized) : NULL;
+      case 3:  return ConstImageView<T,3>::compatible(img) ? new VolumeRowsT<T,3>(img, channel, normalized) : NULL;
+      case 4:  return ConstImageView<T,4>::compatible(img) ? new VolumeRowsT<T,4>(img, channel, normalized) : NULL;
+      default: return NULL;
+    }
+  }
+
+  //! Returns a reader of the component that Image::sample() returns as red, NULL if the type() or format() is not supported.
+  VolumeRows* createVolumeRows(const Image* img, bool normalized)
+  {
+    int comps = 0, channel = 0;
+    switch(img->format())
+    {
+      case IF_RGB:             comps = 3; break;
+      case IF_RGBA:            comps = 4; break;
+      case IF_BGR:             comps = 3; channel = 2; break;
+      case IF_BGRA:            comps = 4; channel = 2; break;
+      case IF_LUMINANCE_ALPHA: comps = 2; break;
+      case IF_RED:
+      case IF_LUMINANCE:
+      case IF_DEPTH_COMPONENT: comps = 1; break;
+      // red is always 0
+      case IF_GREEN:
+      case IF_BLUE:
+      case IF_ALPHA:           comps = 1; channel = -1; break;
+      default:
+        return NULL;
+    }
+    switch(img->type())
+    {
+      case IT_UNSIGNED_BYTE:  return createVolumeRowsT<unsigned char> (img, comps, channel, normalized);
+      case IT_BYTE:           return createVolumeRowsT<GLbyte>        (img, comps, channel, normalized);
+      case IT_UNSIGNED_SHORT: return createVolumeRowsT<unsigned short>(img, comps, channel, normalized);
+      case IT_SHORT:          return createVolumeRowsT<short>         (img, comps, channel, normalized);
+      case IT_UNSIGNED_INT:   return createVolumeRowsT<unsigned int>  (img, comps, channel, normalized);
+      case IT_INT:            return createVolumeRowsT<int>           (img, comps, channel, normalized);
+      case IT_FLOAT:          return createVolumeRowsT<float>         (img, comps, channel, normalized);
+      case IT_HALF_FLOAT:     return createVolumeRowsT<half>          (img, comps, channel, normalized);
+      default:                return NULL;
+    }
+  }
+
+  //! Normalizes the vectors (gx[i], gy[i], gz[i]), zero vectors are left untouched.
+  //! The reciprocal of the length is computed in float, so the results match fvec3::normalize() only within float rounding,
+  //! the scalar loop performs the same operations of the SSE2 one so that the results do not depend on the position in the row.
+  void normalizeRow(float* gx, float* gy, float* gz, int count)
+  {
+    int i = 0;
+#if VL_SSE2
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for(; i+4<=count; i+=4)
+    {
+      __m128 x = _mm_loadu_ps(gx+i);
+      __m128 y = _mm_loadu_ps(gy+i);
+      __m128 z = _mm_loadu_ps(gz+i);
+      __m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps(_mm_mul_ps(x,x), _mm_mul_ps(y,y)), _mm_mul_ps(z,z) ) );
+      __m128 nonzero = _mm_cmpneq_ps(len, zero);
+      __m128 inv = _mm_or_ps( _mm_and_ps(nonzero, _mm_div_ps(one, len)), _mm_andnot_ps(nonzero, one) );
+      _mm_storeu_ps(gx+i, _mm_mul_ps(x, inv));
+      _mm_storeu_ps(gy+i, _mm_mul_ps(y, inv));
+      _mm_storeu_ps(gz+i, _mm_mul_ps(z, inv));
+    }
+#endif
+    for(; i<count; ++i)
+    {
+      float len = ::sqrt(gx[i]*gx[i] + gy[i]*gy[i] + gz[i]*gz[i]);
+      float inv = len != 0 ? 1.0f / len : 1.0f;
+      gx[i] *= inv; gy[i] *= inv; gz[i] *= inv;
+    }
+  }
+
+  //! Computes the normalized central differences "previous - next" of the row y, z with clamped coordinates.
+  class GradientRow
+  {
+  public:
+    GradientRow(const VolumeRows* rows): mRows(rows)
+    {
+      int w = rows->mWidth;
+      mBuffer.resize(w * 8);
+      mGX = &mBuffer[w*5];
+      mGY = &mBuffer[w*6];
+      mGZ = &mBuffer[w*7];
+    }
+
+    void compute(int y, int z)
+    {
+      const int w = mRows->mWidth;
+      float* c  = &mBuffer[0];
+      float* yn = &mBuffer[w*1];
+      float* yp = &mBuffer[w*2];
+      float* zn = &mBuffer[w*3];
+      float* zp = &mBuffer[w*4];
+      mRows->load(y, z, c);
+      mRows->load(clamp(y-1, 0, mRows->mHeight-1), z, yn);
+      mRows->load(clamp(y+1, 0, mRows->mHeight-1), z, yp);
+      mRows->load(y, clamp(z-1, 0, mRows->mDepth-1), zn);
+      mRows->load(y, clamp(z+1, 0, mRows->mDepth-1), zp);
+      for(int x=0; x<w; ++x)
+      {
+        mGX[x] = c[x > 0 ? x-1 : 0] - c[x < w-1 ? x+1 : w-1];
+        mGY[x] = yn[x] - yp[x];
+        mGZ[x] = zn[x] - zp[x];
+      }
+      normalizeRow(mGX, mGY, mGZ, w);
+    }
+
+    const VolumeRows* mRows;
+    std::vector<float> mBuffer;
+    float* mGX;
+    float* mGY;
+    float* mGZ;
+  };
+
+  //! Computes genGradientNormals() over a range of slices.
+  class GradientNormalsTask: public ParallelForTask
+  {
+  public:
+    GradientNormalsTask(const VolumeRows* rows, Image* gradient): mRows(rows), mGradient(gradient) {}
+
+    virtual void run(int begin, int end, int)
+    {
+      GradientRow grad(mRows);
+      const int w = mRows->mWidth;
+      for(int z=begin; z<end; ++z)
+      {
+        for(int y=0; y<mRows->mHeight; ++y)
+        {
+          grad.compute(y, z);
+          // write normal packed into 0..1 format
+          fvec3* px = (fvec3*)mGradient->pixels() + ((size_t)z*mRows->mHeight + y)*w;
+          for(int x=0; x<w; ++x)
+            px[x] = fvec3(grad.mGX[x], grad.mGY[x], grad.mGZ[x]) * 0.5f + 0.5f;
+        }
+      }
+    }
+
+    const VolumeRows* mRows;
+    Image* mGradient;
+  };
+
+  //! Computes genRGBAVolume() over a range of slices.
+  template<typename data_type>
+  class RGBAVolumeTask: public ParallelForTask
+  {
+  public:
+    RGBAVolumeTask(const Image* data, const Image* trfunc, Image* volume, const fvec3* light_dir, bool alpha_from_data, float normalizer_num): 
+      mView(data), mTrFunc(trfunc), mVolume(volume), mAlphaFromData(alpha_from_data), mNormalizer(normalizer_num), mRows(NULL)
+    {
+      if (light_dir)
+      {
+        mL = *light_dir;
+        mL.normalize();
+        mRows = new VolumeRowsT<data_type,1>(data, 0, false);
+      }
+      if (sizeof(data_type) <= 2)
+      {
+        // 8 and 16 bits data: tabulate the transfer function
+        mColorLUT.resize( 1 << (sizeof(data_type)*8) );
+        for(int i=0; i<(int)mColorLUT.size(); ++i)
+          mColorLUT[i] = transfer((data_type)i);
+      }
+    }
+
+    //! The transfer function color and the data value in the alpha channel.
+    fvec4 transfer(data_type v) const
+    {
+      // value
+      float lum = v * mNormalizer;
+      // value -> transfer function
+      const int tr_width = mTrFunc->width();
+      float xval = lum*tr_width;
+      VL_CHECK(xval>=0)
+      if (xval > tr_width-1.001f)
+        xval = tr_width-1.001f;
+      int ix1 = (int)xval;
+      int ix2 = ix1+1;
+      VL_CHECK(ix2<tr_width)
+      float w21  = (float)fract(xval);
+      float w11  = 1.0f - w21;
+      fvec4 c11  = (fvec4)((const ubvec4*)mTrFunc->pixels())[ix1];
+      fvec4 c21  = (fvec4)((const ubvec4*)mTrFunc->pixels())[ix2];
+      fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
+      if (mAlphaFromData)
+        rgba.a() = lum;
+      return rgba;
+    }
+
+    ~RGBAVolumeTask() { delete mRows; }
+
+    virtual void run(int begin, int end, int)
+    {
+      const int w = mView.width();
+      const int h = mView.height();
+      GradientRow* grad = mRows ? new GradientRow(mRows) : NULL;
+      for(int z=begin; z<end; ++z)
+      {
+        for(int y=0; y<h; ++y)
+        {
+          const data_type* lum_px = mView.row(y, z);
+          ubvec4* rgba_px = (ubvec4*)mVolume->pixels() + ((size_t)z*h + y)*w;
+          if (grad)
+            grad->compute(y, z);
+          for(int x=0; x<w; ++x, ++rgba_px)
+          {
+            fvec4 rgba = mColorLUT.empty() ? transfer(lum_px[x]) : mColorLUT[ (int)lum_px[x] ];
+
+            if (grad)
+            {
+              // bake the lighting
+              fvec3 N1(grad->mGX[x], grad->mGY[x], grad->mGZ[x]);
+              fvec3 N2 = -N1 * 0.15f;
+              float l1 = max(dot(N1,mL),0.0f);
+              float l2 = max(dot(N2,mL),0.0f); // opposite dim light to enhance 3D perception
+              rgba.r() = rgba.r()*l1 + rgba.r()*l2+0.2f; // +0.2f = ambient light
+              rgba.g() = rgba.g()*l1 + rgba.g()*l2+0.2f;
+              rgba.b() = rgba.b()*l1 + rgba.b()*l2+0.2f;
+              rgba.r() = clamp(rgba.r(), 0.0f, 1.0f);
+              rgba.g() = clamp(rgba.g(), 0.0f, 1.0f);
+              rgba.b() = clamp(rgba.b(), 0.0f, 1.0f);
+            }
+
+            // map pixel
+            rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
+            rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
+            rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
+            rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
+          }
+        }
+      }
+      delete grad;
+    }
+
+    ConstImageView<data_type,1> mView;
+    const Image* mTrFunc;
+    Image* mVolume;
+    fvec3 mL;
+    bool mAlphaFromData;
+    float mNormalizer;
+    VolumeRows* mRows;
+    std::vector<fvec4> mColorLUT;
+  };
+
+  template<typename data_type, EImageType img_type>
+  ref<Image> genRGBAVolumeImpl(const Image* data, const Image* trfunc, const fvec3* light_dir, bool alpha_from_data)
+  {
+    if (!trfunc || !data)
+      return NULL;
+    if (data->format() != IF_LUMINANCE)
+    {
+      Log::error("genRGBAVolume() called with non IF_LUMINANCE data format().\n");
+      return NULL;
+    }
+    if (data->type() != img_type)
+    {
+      Log::error("genRGBAVolume() called with invalid data type().\n");
+      return NULL;
+    }
+    if (data->dimension() != ID_3D)
+    {
+      Log::error("genRGBAVolume() called with non 3D data.\n");
+      return NULL;
+    }
+    if (trfunc->dimension() != ID_1D)
+    {
+      Log::error("genRGBAVolume() transfer function image must be an 1D image.\n");
+      return NULL;
+    }
+    if (trfunc->format() != IF_RGBA)
+    {
+      Log::error("genRGBAVolume() transfer function format() must be IF_RGBA.\n");
+      return NULL;
+    }
+    if (trfunc->type() != IT_UNSIGNED_BYTE)
+    {
+      Log::error("genRGBAVolume() transfer function format() must be IT_UNSIGNED_BYTE.\n");
+      return NULL;
+    }
+
+    float normalizer_num = 0;
+    switch(data->type())
+    {
+      case IT_UNSIGNED_BYTE:  normalizer_num = 1.0f/255.0f;   break;
+      case IT_UNSIGNED_SHORT: normalizer_num = 1.0f/65535.0f; break;
+      case IT_FLOAT:          normalizer_num = 1.0f;          break;
+      default:
+        break;
+    }
+
+    // generated volume
+    ref<Image> volume = new Image( data->width(), data->height(), data->depth(), 1, IF_RGBA, IT_UNSIGNED_BYTE );
+    RGBAVolumeTask<data_type> task(data, trfunc, volume.get(), light_dir, alpha_from_data, normalizer_num);
+    parallelFor(0, data->depth(), &task);
+
+    return volume;
+  }
+}
 //-----------------------------------------------------------------------------
 ref<Image> vl::genRGBAVolume(const Image* data, const Image* trfunc, const fvec3& light_dir, bool alpha_from_data)
 {
@@ -75,263 +459,29 @@ ref<Image> vl::genRGBAVolume(const Image* data, const Image* trfunc, bool alpha_
 template<typename data_type, EImageType img_type>
 ref<Image> vl::genRGBAVolumeT(const Image* data, const Image* trfunc, const fvec3& light_dir, bool alpha_from_data)
 {
-  if (!trfunc || !data)
-    return NULL;
-  if (data->format() != IF_LUMINANCE)
-  {
-    Log::error("genRGBAVolume() called with non IF_LUMINANCE data format().\n");
-    return NULL;
-  }
-  if (data->type() != img_type)
-  {
-    Log::error("genRGBAVolume() called with invalid data type().\n");
-    return NULL;
-  }
-  if (data->dimension() != ID_3D)
-  {
-    Log::error("genRGBAVolume() called with non 3D data.\n");
-    return NULL;
-  }
-  if (trfunc->dimension() != ID_1D)
-  {
-    Log::error("genRGBAVolume() transfer function image must be an 1D image.\n");
-    return NULL;
-  }
-  if (trfunc->format() != IF_RGBA)
-  {
-    Log::error("genRGBAVolume() transfer function format() must be IF_RGBA.\n");
-    return NULL;
-  }
-  if (trfunc->type() != IT_UNSIGNED_BYTE)
-  {
-    Log::error("genRGBAVolume() transfer function format() must be IT_UNSIGNED_BYTE.\n");
-    return NULL;
-  }
-
-  float normalizer_num = 0;
-  switch(data->type())
-  {
-    case IT_UNSIGNED_BYTE:  normalizer_num = 1.0f/255.0f;   break;
-    case IT_UNSIGNED_SHORT: normalizer_num = 1.0f/65535.0f; break;
-    case IT_FLOAT:          normalizer_num = 1.0f;          break;
-    default:
-      break;
-  }
-
-  // light normalization
-  fvec3 L = light_dir;
-  L.normalize();
-  int w = data->width();
-  int h = data->height();
-  int d = data->depth();
-  int pitch = data->pitch();
-  const unsigned char* lum_px = data->pixels();
-  // generated volume
-  ref<Image> volume = new Image( w, h, d, 1, IF_RGBA, IT_UNSIGNED_BYTE );
-  ubvec4* rgba_px = (ubvec4*)volume->pixels();
-  for(int z=0; z<d; ++z)
-  {
-    int z1 = z-1;
-    int z2 = z+1;
-    z1 = clamp(z1, 0, d-1);
-    z2 = clamp(z2, 0, d-1);
-    for(int y=0; y<h; ++y)
-    {
-      int y1 = y-1;
-      int y2 = y+1;
-      y1 = clamp(y1, 0, h-1);
-      y2 = clamp(y2, 0, h-1);
-      for(int x=0; x<w; ++x, ++rgba_px)
-      {
-        // value
-        float lum = (*(data_type*)(lum_px + x*sizeof(data_type) + y*pitch + z*pitch*h)) * normalizer_num;
-        // value -> transfer function
-        float xval = lum*trfunc->width();
-        VL_CHECK(xval>=0)
-        if (xval > trfunc->width()-1.001f)
-          xval = trfunc->width()-1.001f;
-        int ix1 = (int)xval;
-        int ix2 = ix1+1;
-        VL_CHECK(ix2<trfunc->width())
-        float w21  = (float)fract(xval);
-        float w11  = 1.0f - w21;
-        fvec4 c11  = (fvec4)((ubvec4*)trfunc->pixels())[ix1];
-        fvec4 c21  = (fvec4)((ubvec4*)trfunc->pixels())[ix2];
-        fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
-
-        // bake the lighting
-        int x1 = x-1;
-        int x2 = x+1;
-        x1 = clamp(x1, 0, w-1);
-        x2 = clamp(x2, 0, w-1);
-        data_type vx1 = (*(data_type*)(lum_px + x1*sizeof(data_type) + y *pitch + z *pitch*h));
-        data_type vx2 = (*(data_type*)(lum_px + x2*sizeof(data_type) + y *pitch + z *pitch*h));
-        data_type vy1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y1*pitch + z *pitch*h));
-        data_type vy2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y2*pitch + z *pitch*h));
-        data_type vz1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z1*pitch*h));
-        data_type vz2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z2*pitch*h));
-        fvec3 N1(float(vx1-vx2), float(vy1-vy2), float(vz1-vz2));
-        N1.normalize();
-        fvec3 N2 = -N1 * 0.15f;
-        float l1 = max(dot(N1,L),0.0f);
-        float l2 = max(dot(N2,L),0.0f); // opposite dim light to enhance 3D perception
-        rgba.r() = rgba.r()*l1 + rgba.r()*l2+0.2f; // +0.2f = ambient light
-        rgba.g() = rgba.g()*l1 + rgba.g()*l2+0.2f;
-        rgba.b() = rgba.b()*l1 + rgba.b()*l2+0.2f;
-        rgba.r() = clamp(rgba.r(), 0.0f, 1.0f);
-        rgba.g() = clamp(rgba.g(), 0.0f, 1.0f);
-        rgba.b() = clamp(rgba.b(), 0.0f, 1.0f);
-
-        // map pixel
-        rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
-        rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
-        rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
-        if (alpha_from_data)
-          rgba_px->a() = (unsigned char)(lum*255.0f);
-        else
-          rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
-      }
-    }
-  }
-
-  return volume;
+  return genRGBAVolumeImpl<data_type, img_type>(data, trfunc, &light_dir, alpha_from_data);
 }
 //-----------------------------------------------------------------------------
 template<typename data_type, EImageType img_type>
 ref<Image> vl::genRGBAVolumeT(const Image* data, const Image* trfunc, bool alpha_from_data)
 {
-  if (!trfunc || !data)
-    return NULL;
-  if (data->format() != IF_LUMINANCE)
-  {
-    Log::error("genRGBAVolume() called with non IF_LUMINANCE data format().\n");
-    return NULL;
-  }
-  if (data->type() != img_type)
-  {
-    Log::error("genRGBAVolume() called with invalid data type().\n");
-    return NULL;
-  }  
-  if (data->dimension() != ID_3D)
-  {
-    Log::error("genRGBAVolume() called with non 3D data.\n");
-    return NULL;
-  }
-  if (trfunc->dimension() != ID_1D)
-  {
-    Log::error("genRGBAVolume() transfer function image must be an 1D image.\n");
-    return NULL;
-  }
-  if (trfunc->format() != IF_RGBA)
-  {
-    Log::error("genRGBAVolume() transfer function format() must be IF_RGBA.\n");
-    return NULL;
-  }
-  if (trfunc->type() != IT_UNSIGNED_BYTE)
-  {
-    Log::error("genRGBAVolume() transfer function format() must be IT_UNSIGNED_BYTE.\n");
-    return NULL;
-  }
-
-  float normalizer_num = 0;
-  switch(data->type())
-  {
-    case IT_UNSIGNED_BYTE:  normalizer_num = 1.0f/255.0f;   break;
-    case IT_UNSIGNED_SHORT: normalizer_num = 1.0f/65535.0f; break;
-    case IT_FLOAT:          normalizer_num = 1.0f;          break;
-    default:
-      break;
-  }
-
-  // light normalization
-  int w = data->width();
-  int h = data->height();
-  int d = data->depth();
-  int pitch = data->pitch();
-  const unsigned char* lum_px = data->pixels();
-  // generated volume
-  ref<Image> volume = new Image( w, h, d, 1, IF_RGBA, IT_UNSIGNED_BYTE );
-  ubvec4* rgba_px = (ubvec4*)volume->pixels();
-  for(int z=0; z<d; ++z)
-  {
-    int z1 = z-1;
-    int z2 = z+1;
-    z1 = clamp(z1, 0, d-1);
-    z2 = clamp(z2, 0, d-1);
-    for(int y=0; y<h; ++y)
-    {
-      int y1 = y-1;
-      int y2 = y+1;
-      y1 = clamp(y1, 0, h-1);
-      y2 = clamp(y2, 0, h-1);
-      for(int x=0; x<w; ++x, ++rgba_px)
-      {
-        // value
-        float lum = (*(data_type*)(lum_px + x*sizeof(data_type) + y*pitch + z*pitch*h)) * normalizer_num;
-        // value -> transfer function
-        float xval = lum*trfunc->width();
-        VL_CHECK(xval>=0)
-        if (xval > trfunc->width()-1.001f)
-          xval = trfunc->width()-1.001f;
-        int ix1 = (int)xval;
-        int ix2 = ix1+1;
-        VL_CHECK(ix2<trfunc->width())
-        float w21  = (float)fract(xval);
-        float w11  = 1.0f - w21;
-        fvec4 c11  = (fvec4)((ubvec4*)trfunc->pixels())[ix1];
-        fvec4 c21  = (fvec4)((ubvec4*)trfunc->pixels())[ix2];
-        fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
-
-        // map pixel
-        rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
-        rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
-        rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
-        if (alpha_from_data)
-          rgba_px->a() = (unsigned char)(lum*255.0f);
-        else
-          rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
-      }
-    }
-  }
-
-  return volume;
+  return genRGBAVolumeImpl<data_type, img_type>(data, trfunc, NULL, alpha_from_data);
 }
 //-----------------------------------------------------------------------------
 ref<Image> vl::genGradientNormals(const Image* img)
 {
-  ref<Image> gradient = new Image;
-  gradient->allocate3D(img->width(), img->height(), img->depth(), 1, IF_RGB, IT_FLOAT);
-  fvec3* px = (fvec3*)gradient->pixels();
-  fvec3 A, B;
-  for(int z=0; z<gradient->depth(); ++z)
+  VolumeRows* rows = img->dimension() == ID_3D ? createVolumeRows(img, true) : NULL;
+  if (!rows)
   {
-    for(int y=0; y<gradient->height(); ++y)
-    {
-      for(int x=0; x<gradient->width(); ++x)
-      {
-        // clamped coordinates
-        int xp = x+1, xn = x-1;
-        int yp = y+1, yn = y-1;
-        int zp = z+1, zn = z-1;
-        if (xn<0) xn = 0;
-        if (yn<0) yn = 0;
-        if (zn<0) zn = 0;
-        if (xp>img->width() -1) xp = img->width() -1;
-        if (yp>img->height()-1) yp = img->height()-1;
-        if (zp>img->depth() -1) zp = img->depth() -1;
-
-        A.x() = img->sample(xn,y,z).r();
-        B.x() = img->sample(xp,y,z).r();
-        A.y() = img->sample(x,yn,z).r();
-        B.y() = img->sample(x,yp,z).r();
-        A.z() = img->sample(x,y,zn).r();
-        B.z() = img->sample(x,y,zp).r();
-
-        // write normal packed into 0..1 format
-        px[x + img->width()*y + img->width()*img->height()*z] = normalize(A - B) * 0.5f + 0.5f;
-      }
-    }
+    Log::error("genGradientNormals(): unsupported image type(), format() or dimension().\n");
+    return NULL;
   }
+
+  ref<Image> gradient = new Image;
+  gradient->allocate3D(img->width(), img->height(), img->depth(), 1, IF_RGB, IT_FLOAT);
+  GradientNormalsTask task(rows, gradient.get());
+  parallelFor(0, img->depth(), &task);
+  delete rows;
   return gradient;
 }
 //-----------------------------------------------------------------------------
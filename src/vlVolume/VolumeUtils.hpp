@@ -42,7 +42,9 @@ namespace vl
    * \param trfunc An 1D Image used as transfer function that is used to assign to each value in \p data an RGBA value in the new image.
    * The Image pointed by \p trfunc must mast have type() \p IT_UNSIGNED_BYTE and format() \p IF_RGBA.
    * \param light_dir The direction of the light in object space.
-   * \param alpha_from_data If set to true the \p alpha channel of the generated image will be taken from \p data otherwise from the transfer function. */
+   * \param alpha_from_data If set to true the \p alpha channel of the generated image will be taken from \p data otherwise from the transfer function. 
+   *
+   * The slices are processed in parallel using vl::defThreadPool(). */
   VLVOLUME_EXPORT ref<Image> genRGBAVolume(const Image* data, const Image* trfunc, const fvec3& light_dir, bool alpha_from_data=true);
 
   /** Generates an RGBA image based on the given data source and transfer function.
@@ -58,7 +60,10 @@ namespace vl
   /** Generates an image whose RGB components represent the normals computed from the input image gradient packed into 0..1 range. 
   * The format of the image is IF_RGB/IT_FLOAT which is equivalent to a 3D grid of fvec3.
   * The generated image is ready to be used as a texture for normal lookup. 
-  * The original normal can be recomputed as N = (RGB - 0.5)*2.0. */
+  * The original normal can be recomputed as N = (RGB - 0.5)*2.0. 
+  * The gradient is computed from the values returned by Image::sample().r(), \p data must be a 3D image with one of the 
+  * types and formats supported by Image::sample(), returns NULL otherwise. The slices are processed in parallel using 
+  * vl::defThreadPool() and the normalization uses SSE2. */
   VLVOLUME_EXPORT ref<Image> genGradientNormals(const Image* data);
 
   /** Internally used. */